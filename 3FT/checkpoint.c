@@ -0,0 +1,152 @@
+/*--------------------------------------------------------------------*/
+/* checkpoint.c                                                       */
+/*--------------------------------------------------------------------*/
+
+/* fork, waitpid, stat, and clock_gettime are POSIX rather than ISO C */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "checkpoint.h"
+
+/* A checkpoint run */
+struct checkpoint
+{
+   /* the snapshot file being written */
+   char *pcFile;
+   /* the child writing it, or 0 if it ran inline */
+   pid_t iPid;
+   /* whether the run is over, and its status if so */
+   boolean bDone;
+   int iStatus;
+   /* when the run started and, once done, when it ended */
+   struct timespec sStart;
+   struct timespec sEnd;
+};
+
+/*--------------------------------------------------------------------*/
+
+int Checkpoint_start(int (*pfWrite)(const char *pcFile),
+                     const char *pcFile, boolean bBackground,
+                     Checkpoint_T *poCResult)
+{
+   struct checkpoint *psNew;
+
+   assert(pfWrite != NULL);
+   assert(pcFile != NULL);
+   assert(poCResult != NULL);
+
+   *poCResult = NULL;
+
+   psNew = malloc(sizeof(struct checkpoint));
+   if(psNew == NULL)
+      return MEMORY_ERROR;
+   psNew->pcFile = malloc(strlen(pcFile) + 1);
+   if(psNew->pcFile == NULL) {
+      free(psNew);
+      return MEMORY_ERROR;
+   }
+   strcpy(psNew->pcFile, pcFile);
+
+   (void) clock_gettime(CLOCK_MONOTONIC, &psNew->sStart);
+   psNew->bDone = FALSE;
+   psNew->iStatus = SUCCESS;
+   psNew->iPid = 0;
+
+   if(!bBackground) {
+      psNew->iStatus = (*pfWrite)(pcFile);
+      psNew->bDone = TRUE;
+      (void) clock_gettime(CLOCK_MONOTONIC, &psNew->sEnd);
+   }
+   else {
+      psNew->iPid = fork();
+      if(psNew->iPid < 0) {
+         free(psNew->pcFile);
+         free(psNew);
+         return MEMORY_ERROR;
+      }
+      /* the child must not run the parent's atexit handlers or
+         flush its copies of the parent's stdio buffers */
+      if(psNew->iPid == 0)
+         _exit((*pfWrite)(pcFile));
+   }
+
+   *poCResult = psNew;
+   return SUCCESS;
+}
+
+int Checkpoint_finish(Checkpoint_T oCCheckpoint, boolean bWait,
+                      boolean *pbDone)
+{
+   int iWaitStatus;
+   pid_t iResult;
+
+   assert(oCCheckpoint != NULL);
+   assert(pbDone != NULL);
+
+   if(!oCCheckpoint->bDone) {
+      /* only an interrupted wait is worth retrying; any other failure
+         means there is no child left to wait for */
+      do
+         iResult = waitpid(oCCheckpoint->iPid, &iWaitStatus,
+                           bWait ? 0 : WNOHANG);
+      while(iResult < 0 && errno == EINTR);
+
+      if(iResult == 0) {
+         *pbDone = FALSE;
+         return SUCCESS;
+      }
+
+      if(iResult < 0 || !WIFEXITED(iWaitStatus))
+         oCCheckpoint->iStatus = IO_ERROR;
+      else
+         oCCheckpoint->iStatus = WEXITSTATUS(iWaitStatus);
+      oCCheckpoint->bDone = TRUE;
+      (void) clock_gettime(CLOCK_MONOTONIC, &oCCheckpoint->sEnd);
+   }
+
+   *pbDone = TRUE;
+   return oCCheckpoint->iStatus;
+}
+
+double Checkpoint_getSeconds(Checkpoint_T oCCheckpoint)
+{
+   struct timespec sNow;
+
+   assert(oCCheckpoint != NULL);
+
+   if(oCCheckpoint->bDone)
+      sNow = oCCheckpoint->sEnd;
+   else
+      (void) clock_gettime(CLOCK_MONOTONIC, &sNow);
+
+   return (double) (sNow.tv_sec - oCCheckpoint->sStart.tv_sec)
+      + (sNow.tv_nsec - oCCheckpoint->sStart.tv_nsec) / 1e9;
+}
+
+size_t Checkpoint_getBytes(Checkpoint_T oCCheckpoint)
+{
+   struct stat sInfo;
+
+   assert(oCCheckpoint != NULL);
+
+   if(!oCCheckpoint->bDone || stat(oCCheckpoint->pcFile, &sInfo) != 0)
+      return 0;
+   return (size_t) sInfo.st_size;
+}
+
+void Checkpoint_free(Checkpoint_T oCCheckpoint)
+{
+   assert(oCCheckpoint != NULL);
+   assert(oCCheckpoint->bDone);
+
+   free(oCCheckpoint->pcFile);
+   free(oCCheckpoint);
+}
@@ -0,0 +1,57 @@
+/*--------------------------------------------------------------------*/
+/* checkpoint.h                                                       */
+/*--------------------------------------------------------------------*/
+
+#ifndef CHECKPOINT_INCLUDED
+#define CHECKPOINT_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A Checkpoint_T is one run of a function that writes a snapshot
+  file, either inline or in a forked child process. A child sees a
+  copy-on-write image of its parent's memory as of the fork, so the
+  parent may keep mutating its data while the child persists it.
+*/
+typedef struct checkpoint *Checkpoint_T;
+
+/*
+  Starts (*pfWrite)(pcFile), which must return an a4def status. If
+  bBackground is TRUE it runs in a forked child and this returns at
+  once; otherwise it runs to completion before this returns. Returns
+  an int SUCCESS status and sets *poCResult to the new checkpoint if
+  it was started. Otherwise, sets *poCResult to NULL and returns
+  status:
+  * MEMORY_ERROR if memory could not be allocated or the process
+                 could not be forked
+*/
+int Checkpoint_start(int (*pfWrite)(const char *pcFile),
+                     const char *pcFile, boolean bBackground,
+                     Checkpoint_T *poCResult);
+
+/*
+  Checks whether oCCheckpoint has finished, waiting for it if bWait
+  is TRUE. Sets *pbDone accordingly. Once done, returns the status
+  (*pfWrite) returned, or IO_ERROR if its child process died or
+  could not be waited for; otherwise returns SUCCESS.
+*/
+int Checkpoint_finish(Checkpoint_T oCCheckpoint, boolean bWait,
+                      boolean *pbDone);
+
+/*
+  Returns the wall-clock seconds oCCheckpoint has taken so far, or
+  took in total once it is done.
+*/
+double Checkpoint_getSeconds(Checkpoint_T oCCheckpoint);
+
+/*
+  Returns the size in bytes of the file oCCheckpoint wrote, or 0 if
+  it is not done or the file cannot be examined.
+*/
+size_t Checkpoint_getBytes(Checkpoint_T oCCheckpoint);
+
+/* Frees oCCheckpoint, which must be done. */
+void Checkpoint_free(Checkpoint_T oCCheckpoint);
+
+#endif
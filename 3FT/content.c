@@ -0,0 +1,1440 @@
+/*--------------------------------------------------------------------*/
+/* content.c                                                          */
+/*--------------------------------------------------------------------*/
+
+/* getpid is POSIX rather than ISO C */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include "lz.h"
+#include "content.h"
+
+/* A run of a writable body's bytes */
+struct extent
+{
+   /* the bytes, how many are in use, and how many are allocated */
+   unsigned char *pucData;
+   size_t ulLength;
+   size_t ulCapacity;
+   /* the offset in the body of the first byte */
+   size_t ulStart;
+};
+
+/* A file body */
+struct content
+{
+   /* the number of references held to this body */
+   size_t ulRefs;
+   /* the bytes of this body as stored, how many of them are stored,
+      and how many there are once decompressed */
+   void *pvData;
+   size_t ulStoredLength;
+   size_t ulLength;
+   /* how to free pvData, or NULL if it is borrowed */
+   void (*pfFree)(void *pvData);
+   /* whether pvData is compressed, and if so the cache slot holding
+      it decompressed, or -1 if none does */
+   boolean bCompressed;
+   int iCacheSlot;
+   /* the number of pins held on this body, and, while a compressed
+      body is pinned, a private buffer holding it decompressed */
+   size_t ulPins;
+   void *pvPinned;
+   /* whether this body is an owned one that the spill tier may evict,
+      whether it is evicted now, in which case pvData is NULL, and
+      whether it has a slot in the spill file holding its stored bytes,
+      and if so where */
+   boolean bSpillable;
+   boolean bSpilled;
+   boolean bHasSlot;
+   size_t ulSlot;
+   /* the neighbouring bodies in the spill tier's list of resident
+      bodies, most recently used first, or of evicted ones */
+   Content_T oCPrevUse;
+   Content_T oCNextUse;
+   /* whether this body is writable, in which case its bytes are in
+      psExtents rather than pvData, every extent but the last is full,
+      and the extents' capacities grow geometrically */
+   boolean bChunked;
+   struct extent *psExtents;
+   size_t ulExtents;
+   size_t ulExtentSlots;
+   /* whether this body is in the content store, and if so its hash
+      and the next body in its bucket */
+   boolean bInterned;
+   unsigned long ulHash;
+   Content_T oCNext;
+};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  The content store is a hash table of interned bodies, chained within
+  buckets, that doubles its bucket count whenever it holds as many
+  bodies as buckets.
+*/
+
+/* the store's buckets, or NULL before anything is interned */
+static Content_T *poCBuckets;
+/* the number of buckets and of bodies in the store */
+static size_t ulBucketCount;
+static size_t ulDistinct;
+/* the bytes the store's bodies occupy */
+static size_t ulStoredBytes;
+/* the references held to the store's bodies, and the bytes they
+   would occupy without sharing */
+static size_t ulReferences;
+static size_t ulLogicalBytes;
+
+/* The number of buckets the store starts with */
+static const size_t MIN_BUCKET_COUNT = 64;
+
+/* The smallest extent allocated for a writable body */
+static const size_t MIN_EXTENT_SIZE = 64;
+
+/*
+  Compressed bodies are read through a small cache of decompressed
+  buffers, the least recently used of which is reused on a miss.
+*/
+
+/* The number of decompressed buffers in the cache */
+enum { CACHE_SLOTS = 8 };
+
+/* A decompressed buffer in the cache */
+struct cacheSlot
+{
+   /* the body decompressed here, or NULL if the slot is free */
+   Content_T oCOwner;
+   /* the buffer, and how many bytes it can hold */
+   void *pvBuffer;
+   size_t ulCapacity;
+   /* the tick of the last read through this slot */
+   unsigned long ulLastUse;
+};
+
+static struct cacheSlot asCache[CACHE_SLOTS];
+/* the tick counting reads through the cache */
+static unsigned long ulCacheTick;
+/* the reads served by the cache and those that had to decompress */
+static size_t ulCacheHits;
+static size_t ulCacheMisses;
+
+/* the number of compressed bodies, and their logical and stored
+   bytes */
+static size_t ulCompressed;
+static size_t ulCompressedLogical;
+static size_t ulCompressedStored;
+
+/*
+  The spill tier keeps the stored bytes of owned bodies within a
+  memory budget by evicting the least recently used of them to a spill
+  file, from which they are read back when next accessed. A body keeps
+  its slot in the file when read back, since bodies that may be
+  evicted never change, so evicting it again writes nothing. A child
+  forked to write a checkpoint reads the spill file through its own
+  stream, opened before the fork, and evicts nothing, so as not to
+  disturb its parent's; until the child is reaped the parent holds
+  the slots it frees rather than reusing them, so the child reads
+  what was there when it was forked.
+*/
+
+/* A free run of bytes in the spill file */
+struct freeSlot
+{
+   size_t ulOffset;
+   size_t ulLength;
+};
+
+/* the spill file and its name, or NULL while the tier is off */
+static FILE *psSpillFile;
+static char *pcSpillName;
+/* the process that opened the spill file, and the stream a forked
+   child reads it through, or NULL if none is open */
+static pid_t iSpillOwner;
+static FILE *psChildSpillFile;
+/* the most bytes resident bodies that may be evicted should occupy */
+static size_t ulBudget;
+/* the bytes resident bodies that may be evicted occupy */
+static size_t ulResident;
+/* the bytes writable bodies have allocated, which count against the
+   budget although they are never evicted */
+static size_t ulWritable;
+/* the resident bodies that may be evicted, most recently used first,
+   and the least recently used */
+static Content_T oCMostUsed;
+static Content_T oCLeastUsed;
+/* the evicted bodies, in no particular order */
+static Content_T oCSpilled;
+/* the number of evicted bodies and their stored bytes */
+static size_t ulSpilledCount;
+static size_t ulSpilledBytes;
+/* the free runs of the spill file below ulSpillEnd, by offset */
+static struct freeSlot *psFreeSlots;
+static size_t ulFreeSlots;
+static size_t ulFreeSlotCapacity;
+/* the offset past the last slot in the spill file */
+static size_t ulSpillEnd;
+/* whether a forked child may be reading the spill file, and the runs
+   freed since, which are not reused until it is reaped */
+static boolean bSlotsHeld;
+static struct freeSlot *psHeldSlots;
+static size_t ulHeldSlots;
+static size_t ulHeldCapacity;
+/* the accesses to resident bodies that may be evicted, those to
+   evicted bodies, and the evictions so far */
+static size_t ulSpillHits;
+static size_t ulSpillMisses;
+static size_t ulEvictions;
+
+/*
+  Returns the FNV-1a hash of the ulLength bytes at pvData.
+*/
+static unsigned long Content_hash(const void *pvData, size_t ulLength)
+{
+   const unsigned char *pucData = pvData;
+   unsigned long ulHash = 2166136261UL;
+   size_t u;
+
+   for(u = 0; u < ulLength; u++) {
+      ulHash ^= pucData[u];
+      ulHash *= 16777619UL;
+   }
+   return ulHash;
+}
+
+/*
+  Grows the store to twice as many buckets, or to MIN_BUCKET_COUNT if
+  it has none. Returns SUCCESS, or MEMORY_ERROR if allocation fails,
+  in which case the store is left as it was.
+*/
+static int Content_growStore(void)
+{
+   Content_T *poCNew;
+   Content_T oCCurr;
+   Content_T oCNext;
+   size_t ulNewCount;
+   size_t u;
+
+   ulNewCount = (ulBucketCount == 0) ? MIN_BUCKET_COUNT
+      : 2 * ulBucketCount;
+   poCNew = calloc(ulNewCount, sizeof(Content_T));
+   if(poCNew == NULL)
+      return MEMORY_ERROR;
+
+   for(u = 0; u < ulBucketCount; u++) {
+      for(oCCurr = poCBuckets[u]; oCCurr != NULL; oCCurr = oCNext) {
+         oCNext = oCCurr->oCNext;
+         oCCurr->oCNext = poCNew[oCCurr->ulHash % ulNewCount];
+         poCNew[oCCurr->ulHash % ulNewCount] = oCCurr;
+      }
+   }
+
+   free(poCBuckets);
+   poCBuckets = poCNew;
+   ulBucketCount = ulNewCount;
+   return SUCCESS;
+}
+
+/*
+  Removes the interned body oCContent from the store's table.
+*/
+static void Content_unintern(Content_T oCContent)
+{
+   Content_T *poCLink;
+
+   assert(oCContent != NULL);
+   assert(oCContent->bInterned);
+
+   poCLink = &poCBuckets[oCContent->ulHash % ulBucketCount];
+   while(*poCLink != oCContent)
+      poCLink = &(*poCLink)->oCNext;
+   *poCLink = oCContent->oCNext;
+
+   ulDistinct--;
+   ulStoredBytes -= oCContent->ulStoredLength;
+   if(ulDistinct == 0) {
+      free(poCBuckets);
+      poCBuckets = NULL;
+      ulBucketCount = 0;
+   }
+}
+
+/*
+  Returns the decompressed bytes of the compressed body oCContent,
+  from the cache if they are there and by decompressing them into the
+  least recently used slot otherwise. Returns NULL if a buffer could
+  not be allocated.
+*/
+static void *Content_readCache(Content_T oCContent)
+{
+   struct cacheSlot *psSlot;
+   void *pvBuffer;
+   int iSlot;
+   int i;
+
+   assert(oCContent != NULL);
+   assert(oCContent->bCompressed);
+
+   ulCacheTick++;
+   if(oCContent->iCacheSlot >= 0) {
+      psSlot = &asCache[oCContent->iCacheSlot];
+      psSlot->ulLastUse = ulCacheTick;
+      ulCacheHits++;
+      return psSlot->pvBuffer;
+   }
+   ulCacheMisses++;
+
+   iSlot = 0;
+   for(i = 1; i < CACHE_SLOTS; i++)
+      if(asCache[i].ulLastUse < asCache[iSlot].ulLastUse)
+         iSlot = i;
+   psSlot = &asCache[iSlot];
+
+   if(psSlot->ulCapacity < oCContent->ulLength) {
+      pvBuffer = realloc(psSlot->pvBuffer, oCContent->ulLength);
+      if(pvBuffer == NULL)
+         return NULL;
+      psSlot->pvBuffer = pvBuffer;
+      psSlot->ulCapacity = oCContent->ulLength;
+   }
+
+   if(psSlot->oCOwner != NULL)
+      psSlot->oCOwner->iCacheSlot = -1;
+   psSlot->oCOwner = NULL;
+   if(!LZ_decompress(oCContent->pvData, oCContent->ulStoredLength,
+                     psSlot->pvBuffer, oCContent->ulLength))
+      return NULL;
+
+   psSlot->oCOwner = oCContent;
+   psSlot->ulLastUse = ulCacheTick;
+   oCContent->iCacheSlot = iSlot;
+   return psSlot->pvBuffer;
+}
+
+/*
+  Frees the cache's buffers once no compressed body is left to need
+  them.
+*/
+static void Content_trimCache(void)
+{
+   int i;
+
+   if(ulCompressed != 0)
+      return;
+   for(i = 0; i < CACHE_SLOTS; i++) {
+      free(asCache[i].pvBuffer);
+      asCache[i].pvBuffer = NULL;
+      asCache[i].ulCapacity = 0;
+      asCache[i].oCOwner = NULL;
+   }
+}
+
+/*
+  Links oCContent into the list whose first body is *poCFirst (and,
+  if poCLast is not NULL, whose last is *poCLast) at the front.
+*/
+static void Content_linkFirst(Content_T oCContent, Content_T *poCFirst,
+                              Content_T *poCLast)
+{
+   assert(oCContent != NULL);
+   assert(poCFirst != NULL);
+
+   oCContent->oCPrevUse = NULL;
+   oCContent->oCNextUse = *poCFirst;
+   if(*poCFirst != NULL)
+      (*poCFirst)->oCPrevUse = oCContent;
+   else if(poCLast != NULL)
+      *poCLast = oCContent;
+   *poCFirst = oCContent;
+}
+
+/*
+  Unlinks oCContent from the list whose first body is *poCFirst (and,
+  if poCLast is not NULL, whose last is *poCLast).
+*/
+static void Content_unlink(Content_T oCContent, Content_T *poCFirst,
+                           Content_T *poCLast)
+{
+   assert(oCContent != NULL);
+   assert(poCFirst != NULL);
+
+   if(oCContent->oCPrevUse != NULL)
+      oCContent->oCPrevUse->oCNextUse = oCContent->oCNextUse;
+   else
+      *poCFirst = oCContent->oCNextUse;
+   if(oCContent->oCNextUse != NULL)
+      oCContent->oCNextUse->oCPrevUse = oCContent->oCPrevUse;
+   else if(poCLast != NULL)
+      *poCLast = oCContent->oCPrevUse;
+   oCContent->oCPrevUse = NULL;
+   oCContent->oCNextUse = NULL;
+}
+
+/*
+  Returns the run of ulLength bytes starting at ulOffset to the spill
+  file's free runs, merging it with its neighbours and with the end of
+  the file. If the free list cannot grow the run is lost until the
+  spill file is next emptied.
+*/
+static void Content_releaseSlot(size_t ulOffset, size_t ulLength)
+{
+   struct freeSlot *psNew;
+   size_t ulIndex = 0;
+   size_t u;
+
+   if(ulLength == 0)
+      return;
+
+   while(ulIndex < ulFreeSlots &&
+         psFreeSlots[ulIndex].ulOffset < ulOffset)
+      ulIndex++;
+
+   /* merge with the run before, the run after, or both */
+   if(ulIndex > 0 && psFreeSlots[ulIndex - 1].ulOffset
+      + psFreeSlots[ulIndex - 1].ulLength == ulOffset) {
+      ulIndex--;
+      psFreeSlots[ulIndex].ulLength += ulLength;
+   }
+   else {
+      if(ulFreeSlots == ulFreeSlotCapacity) {
+         psNew = realloc(psFreeSlots, (ulFreeSlotCapacity * 2 + 4)
+                         * sizeof(struct freeSlot));
+         if(psNew == NULL)
+            return;
+         psFreeSlots = psNew;
+         ulFreeSlotCapacity = ulFreeSlotCapacity * 2 + 4;
+      }
+      for(u = ulFreeSlots; u > ulIndex; u--)
+         psFreeSlots[u] = psFreeSlots[u - 1];
+      psFreeSlots[ulIndex].ulOffset = ulOffset;
+      psFreeSlots[ulIndex].ulLength = ulLength;
+      ulFreeSlots++;
+   }
+   if(ulIndex + 1 < ulFreeSlots &&
+      psFreeSlots[ulIndex].ulOffset + psFreeSlots[ulIndex].ulLength
+      == psFreeSlots[ulIndex + 1].ulOffset) {
+      psFreeSlots[ulIndex].ulLength += psFreeSlots[ulIndex + 1].ulLength;
+      for(u = ulIndex + 1; u + 1 < ulFreeSlots; u++)
+         psFreeSlots[u] = psFreeSlots[u + 1];
+      ulFreeSlots--;
+   }
+
+   /* a run reaching the end of the file just moves the end back */
+   if(psFreeSlots[ulFreeSlots - 1].ulOffset
+      + psFreeSlots[ulFreeSlots - 1].ulLength == ulSpillEnd) {
+      ulSpillEnd = psFreeSlots[ulFreeSlots - 1].ulOffset;
+      ulFreeSlots--;
+   }
+}
+
+/*
+  Frees the run of ulLength bytes starting at ulOffset in the spill
+  file, or, while a forked child may be reading it, holds the run
+  until Content_endFork. If the held list cannot grow the run is lost
+  until the spill file is next emptied.
+*/
+static void Content_freeSlot(size_t ulOffset, size_t ulLength)
+{
+   struct freeSlot *psNew;
+
+   if(!bSlotsHeld) {
+      Content_releaseSlot(ulOffset, ulLength);
+      return;
+   }
+   if(ulHeldSlots == ulHeldCapacity) {
+      psNew = realloc(psHeldSlots, (ulHeldCapacity * 2 + 4)
+                      * sizeof(struct freeSlot));
+      if(psNew == NULL)
+         return;
+      psHeldSlots = psNew;
+      ulHeldCapacity = ulHeldCapacity * 2 + 4;
+   }
+   psHeldSlots[ulHeldSlots].ulOffset = ulOffset;
+   psHeldSlots[ulHeldSlots].ulLength = ulLength;
+   ulHeldSlots++;
+}
+
+/*
+  Returns the offset of a run of ulLength bytes in the spill file,
+  taken from the first free run large enough or else from its end.
+*/
+static size_t Content_allocSlot(size_t ulLength)
+{
+   size_t ulOffset;
+   size_t u;
+
+   for(u = 0; u < ulFreeSlots; u++)
+      if(psFreeSlots[u].ulLength >= ulLength) {
+         ulOffset = psFreeSlots[u].ulOffset;
+         psFreeSlots[u].ulOffset += ulLength;
+         psFreeSlots[u].ulLength -= ulLength;
+         if(psFreeSlots[u].ulLength == 0) {
+            for(; u + 1 < ulFreeSlots; u++)
+               psFreeSlots[u] = psFreeSlots[u + 1];
+            ulFreeSlots--;
+         }
+         return ulOffset;
+      }
+
+   ulOffset = ulSpillEnd;
+   ulSpillEnd += ulLength;
+   return ulOffset;
+}
+
+/*
+  Evicts the resident body oCContent to the spill file, writing its
+  stored bytes to a new slot unless it has one already. Returns TRUE,
+  or FALSE if they could not be written, in which case oCContent
+  stays resident.
+*/
+static boolean Content_evict(Content_T oCContent)
+{
+   assert(oCContent != NULL);
+   assert(oCContent->bSpillable && !oCContent->bSpilled);
+   assert(psSpillFile != NULL);
+
+   if(!oCContent->bHasSlot) {
+      oCContent->ulSlot = Content_allocSlot(oCContent->ulStoredLength);
+      /* nothing is left buffered for a forked child to flush */
+      if(fseek(psSpillFile, (long) oCContent->ulSlot, SEEK_SET) != 0 ||
+         fwrite(oCContent->pvData, 1, oCContent->ulStoredLength,
+                psSpillFile) != oCContent->ulStoredLength ||
+         fflush(psSpillFile) != 0) {
+         Content_freeSlot(oCContent->ulSlot, oCContent->ulStoredLength);
+         return FALSE;
+      }
+      oCContent->bHasSlot = TRUE;
+   }
+
+   free(oCContent->pvData);
+   oCContent->pvData = NULL;
+   oCContent->bSpilled = TRUE;
+   Content_unlink(oCContent, &oCMostUsed, &oCLeastUsed);
+   Content_linkFirst(oCContent, &oCSpilled, NULL);
+   ulResident -= oCContent->ulStoredLength;
+   ulSpilledCount++;
+   ulSpilledBytes += oCContent->ulStoredLength;
+   ulEvictions++;
+   return TRUE;
+}
+
+/*
+  Evicts least recently used bodies other than oCKeep (which may be
+  NULL) and pinned ones until the resident ones fit the budget, or
+  none is left to evict, or one cannot be written.
+*/
+static void Content_enforceBudget(Content_T oCKeep)
+{
+   Content_T oCCurr;
+   Content_T oCPrev;
+
+   if(psSpillFile == NULL || getpid() != iSpillOwner)
+      return;
+
+   oCCurr = oCLeastUsed;
+   while(ulResident + ulWritable > ulBudget && oCCurr != NULL) {
+      oCPrev = oCCurr->oCPrevUse;
+      if(oCCurr != oCKeep && oCCurr->ulPins == 0 &&
+         !Content_evict(oCCurr))
+         return;
+      oCCurr = oCPrev;
+   }
+}
+
+/*
+  Makes the body oCContent, which owns a buffer freed with free, one
+  that the spill tier may evict, as its most recently used, and keeps
+  the resident bodies within the budget.
+*/
+static void Content_track(Content_T oCContent)
+{
+   assert(oCContent != NULL);
+   assert(oCContent->pvData != NULL && oCContent->pfFree == free);
+
+   oCContent->bSpillable = TRUE;
+   Content_linkFirst(oCContent, &oCMostUsed, &oCLeastUsed);
+   ulResident += oCContent->ulStoredLength;
+   Content_enforceBudget(oCContent);
+}
+
+/*
+  Makes sure that the stored bytes of oCContent are in memory, reading
+  them back from the spill file if it was evicted, and marks it the
+  most recently used. Returns SUCCESS, or MEMORY_ERROR if there was
+  no memory to read them into, or IO_ERROR if they could not be read
+  back.
+*/
+static int Content_load(Content_T oCContent)
+{
+   FILE *psFile;
+   void *pvData;
+
+   assert(oCContent != NULL);
+
+   if(!oCContent->bSpillable)
+      return SUCCESS;
+   if(!oCContent->bSpilled) {
+      ulSpillHits++;
+      if(oCContent != oCMostUsed) {
+         Content_unlink(oCContent, &oCMostUsed, &oCLeastUsed);
+         Content_linkFirst(oCContent, &oCMostUsed, &oCLeastUsed);
+      }
+      return SUCCESS;
+   }
+
+   assert(psSpillFile != NULL && oCContent->bHasSlot);
+   psFile = psSpillFile;
+   if(getpid() != iSpillOwner) {
+      if(psChildSpillFile == NULL)
+         return IO_ERROR;
+      psFile = psChildSpillFile;
+   }
+
+   pvData = malloc(oCContent->ulStoredLength == 0 ? 1
+                   : oCContent->ulStoredLength);
+   if(pvData == NULL)
+      return MEMORY_ERROR;
+   if(fseek(psFile, (long) oCContent->ulSlot, SEEK_SET) != 0 ||
+      fread(pvData, 1, oCContent->ulStoredLength, psFile)
+      != oCContent->ulStoredLength) {
+      free(pvData);
+      return IO_ERROR;
+   }
+   ulSpillMisses++;
+
+   oCContent->pvData = pvData;
+   oCContent->bSpilled = FALSE;
+   Content_unlink(oCContent, &oCSpilled, NULL);
+   ulSpilledCount--;
+   ulSpilledBytes -= oCContent->ulStoredLength;
+   Content_linkFirst(oCContent, &oCMostUsed, &oCLeastUsed);
+   ulResident += oCContent->ulStoredLength;
+   Content_enforceBudget(oCContent);
+   return SUCCESS;
+}
+
+/*
+  Removes oCContent, which is being destroyed, from the spill tier,
+  freeing its slot in the spill file if it has one.
+*/
+static void Content_untrack(Content_T oCContent)
+{
+   assert(oCContent != NULL);
+   assert(oCContent->bSpillable);
+
+   if(oCContent->bSpilled) {
+      Content_unlink(oCContent, &oCSpilled, NULL);
+      ulSpilledCount--;
+      ulSpilledBytes -= oCContent->ulStoredLength;
+   }
+   else {
+      Content_unlink(oCContent, &oCMostUsed, &oCLeastUsed);
+      ulResident -= oCContent->ulStoredLength;
+   }
+   if(oCContent->bHasSlot)
+      Content_freeSlot(oCContent->ulSlot, oCContent->ulStoredLength);
+   oCContent->bSpillable = FALSE;
+}
+
+/*
+  Returns the index of the extent of the writable body oCContent that
+  holds offset ulOffset, which must be less than its total capacity.
+*/
+static size_t Content_findExtent(Content_T oCContent, size_t ulOffset)
+{
+   size_t ulLow = 0;
+   size_t ulHigh;
+   size_t ulMid;
+
+   assert(oCContent != NULL);
+   assert(oCContent->bChunked);
+
+   ulHigh = oCContent->ulExtents - 1;
+   while(ulLow < ulHigh) {
+      ulMid = ulLow + (ulHigh - ulLow + 1) / 2;
+      if(oCContent->psExtents[ulMid].ulStart <= ulOffset)
+         ulLow = ulMid;
+      else
+         ulHigh = ulMid - 1;
+   }
+   return ulLow;
+}
+
+/*
+  Makes the writable body oCContent able to hold ulEnd bytes without
+  further allocation, adding an extent at least as large as all those
+  before it if need be. Returns SUCCESS, or MEMORY_ERROR, in which
+  case oCContent is unchanged.
+*/
+static int Content_reserveExtents(Content_T oCContent, size_t ulEnd)
+{
+   struct extent *psLast;
+   struct extent *psExtents;
+   size_t ulCapacity;
+   size_t ulSize;
+   size_t ulSlots;
+
+   assert(oCContent != NULL);
+   assert(oCContent->bChunked);
+
+   psLast = &oCContent->psExtents[oCContent->ulExtents - 1];
+   ulCapacity = psLast->ulStart + psLast->ulCapacity;
+   if(ulEnd <= ulCapacity)
+      return SUCCESS;
+
+   if(oCContent->ulExtents == oCContent->ulExtentSlots) {
+      ulSlots = 2 * oCContent->ulExtentSlots;
+      psExtents = realloc(oCContent->psExtents,
+                          ulSlots * sizeof(struct extent));
+      if(psExtents == NULL)
+         return MEMORY_ERROR;
+      oCContent->psExtents = psExtents;
+      oCContent->ulExtentSlots = ulSlots;
+   }
+
+   /* doubling the capacity each time makes appends O(1) amortized */
+   ulSize = ulEnd - ulCapacity;
+   if(ulSize < ulCapacity)
+      ulSize = ulCapacity;
+   if(ulSize < MIN_EXTENT_SIZE)
+      ulSize = MIN_EXTENT_SIZE;
+
+   psLast = &oCContent->psExtents[oCContent->ulExtents];
+   psLast->pucData = malloc(ulSize);
+   if(psLast->pucData == NULL)
+      return MEMORY_ERROR;
+   psLast->ulLength = 0;
+   psLast->ulCapacity = ulSize;
+   psLast->ulStart = ulCapacity;
+   oCContent->ulExtents++;
+   ulWritable += ulSize;
+   Content_enforceBudget(NULL);
+   return SUCCESS;
+}
+
+/*
+  Copies the ulLength bytes at pucData (or zeros, if pucData is NULL)
+  into the writable body oCContent at offset ulOffset, which must not
+  be past its end, growing it as needed into the capacity reserved by
+  Content_reserveExtents.
+*/
+static void Content_copyIn(Content_T oCContent, size_t ulOffset,
+                           const unsigned char *pucData,
+                           size_t ulLength)
+{
+   struct extent *psExtent;
+   size_t ulIndex;
+   size_t ulWithin;
+   size_t ulChunk;
+
+   assert(oCContent != NULL);
+   assert(ulOffset <= oCContent->ulLength);
+
+   if(ulLength == 0)
+      return;
+
+   ulIndex = Content_findExtent(oCContent, ulOffset);
+   while(ulLength > 0) {
+      assert(ulIndex < oCContent->ulExtents);
+      psExtent = &oCContent->psExtents[ulIndex];
+      ulWithin = ulOffset - psExtent->ulStart;
+      ulChunk = psExtent->ulCapacity - ulWithin;
+      if(ulChunk > ulLength)
+         ulChunk = ulLength;
+
+      if(pucData == NULL)
+         memset(psExtent->pucData + ulWithin, 0, ulChunk);
+      else {
+         memcpy(psExtent->pucData + ulWithin, pucData, ulChunk);
+         pucData += ulChunk;
+      }
+      if(ulWithin + ulChunk > psExtent->ulLength)
+         psExtent->ulLength = ulWithin + ulChunk;
+
+      ulOffset += ulChunk;
+      ulLength -= ulChunk;
+      ulIndex++;
+   }
+
+   if(ulOffset > oCContent->ulLength)
+      oCContent->ulLength = ulOffset;
+}
+
+/*
+  Gathers the extents of the writable body oCContent into one, so that
+  its bytes are contiguous. The one keeps the capacity of them all, so
+  that appends fit into it until that doubles again, and reading the
+  body in between need not gather it anew. Returns SUCCESS, or
+  MEMORY_ERROR, in which case oCContent is unchanged.
+*/
+static int Content_flatten(Content_T oCContent)
+{
+   struct extent *psLast;
+   unsigned char *pucData;
+   size_t ulCapacity;
+   size_t ulPos = 0;
+   size_t u;
+
+   assert(oCContent != NULL);
+   assert(oCContent->bChunked);
+
+   if(oCContent->ulExtents == 1)
+      return SUCCESS;
+
+   psLast = &oCContent->psExtents[oCContent->ulExtents - 1];
+   ulCapacity = psLast->ulStart + psLast->ulCapacity;
+   pucData = malloc(ulCapacity);
+   if(pucData == NULL)
+      return MEMORY_ERROR;
+   for(u = 0; u < oCContent->ulExtents; u++) {
+      memcpy(pucData + ulPos, oCContent->psExtents[u].pucData,
+             oCContent->psExtents[u].ulLength);
+      ulPos += oCContent->psExtents[u].ulLength;
+      free(oCContent->psExtents[u].pucData);
+   }
+
+   oCContent->psExtents[0].pucData = pucData;
+   oCContent->psExtents[0].ulLength = oCContent->ulLength;
+   oCContent->psExtents[0].ulCapacity = ulCapacity;
+   oCContent->psExtents[0].ulStart = 0;
+   oCContent->ulExtents = 1;
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Content_new(void *pvData, size_t ulLength,
+                void (*pfFree)(void *pvData), Content_T *poCResult)
+{
+   struct content *psNew;
+
+   assert(poCResult != NULL);
+
+   psNew = malloc(sizeof(struct content));
+   if(psNew == NULL) {
+      *poCResult = NULL;
+      return MEMORY_ERROR;
+   }
+
+   psNew->ulRefs = 1;
+   psNew->pvData = pvData;
+   psNew->ulStoredLength = ulLength;
+   psNew->ulLength = ulLength;
+   psNew->pfFree = pfFree;
+   psNew->bCompressed = FALSE;
+   psNew->iCacheSlot = -1;
+   psNew->ulPins = 0;
+   psNew->pvPinned = NULL;
+   psNew->bSpillable = FALSE;
+   psNew->bSpilled = FALSE;
+   psNew->bHasSlot = FALSE;
+   psNew->ulSlot = 0;
+   psNew->oCPrevUse = NULL;
+   psNew->oCNextUse = NULL;
+   psNew->bChunked = FALSE;
+   psNew->psExtents = NULL;
+   psNew->ulExtents = 0;
+   psNew->ulExtentSlots = 0;
+   psNew->bInterned = FALSE;
+   psNew->ulHash = 0;
+   psNew->oCNext = NULL;
+
+   /* a buffer with the caller's own destructor must outlive its file,
+      so it is never evicted */
+   if(pvData != NULL && pfFree == free)
+      Content_track(psNew);
+   *poCResult = psNew;
+   return SUCCESS;
+}
+
+int Content_copy(const void *pvData, size_t ulLength,
+                 Content_T *poCResult)
+{
+   void *pvCopy;
+   int iStatus;
+
+   assert(poCResult != NULL);
+
+   if(pvData == NULL)
+      return Content_new(NULL, ulLength, NULL, poCResult);
+
+   /* malloc(0) may return NULL, so always ask for at least a byte */
+   pvCopy = malloc((ulLength == 0) ? 1 : ulLength);
+   if(pvCopy == NULL) {
+      *poCResult = NULL;
+      return MEMORY_ERROR;
+   }
+   memcpy(pvCopy, pvData, ulLength);
+
+   iStatus = Content_new(pvCopy, ulLength, free, poCResult);
+   if(iStatus != SUCCESS)
+      free(pvCopy);
+   return iStatus;
+}
+
+int Content_newWritable(Content_T oCSource, size_t ulCapacity,
+                        Content_T *poCResult)
+{
+   struct content *psNew;
+   size_t ulLength = 0;
+   void *pvSource = NULL;
+   int iStatus;
+
+   assert(poCResult != NULL);
+
+   if(oCSource != NULL &&
+      (oCSource->pvData != NULL || oCSource->bSpilled ||
+       oCSource->bChunked)) {
+      pvSource = Content_getData(oCSource);
+      if(pvSource == NULL) {
+         *poCResult = NULL;
+         return MEMORY_ERROR;
+      }
+      ulLength = oCSource->ulLength;
+   }
+
+   iStatus = Content_new(NULL, 0, free, &psNew);
+   if(iStatus != SUCCESS) {
+      *poCResult = NULL;
+      return iStatus;
+   }
+
+   if(ulCapacity < ulLength)
+      ulCapacity = ulLength;
+   if(ulCapacity < MIN_EXTENT_SIZE)
+      ulCapacity = MIN_EXTENT_SIZE;
+   psNew->psExtents = malloc(sizeof(struct extent));
+   if(psNew->psExtents != NULL)
+      psNew->psExtents[0].pucData = malloc(ulCapacity);
+   if(psNew->psExtents == NULL || psNew->psExtents[0].pucData == NULL) {
+      free(psNew->psExtents);
+      free(psNew);
+      *poCResult = NULL;
+      return MEMORY_ERROR;
+   }
+
+   psNew->bChunked = TRUE;
+   psNew->ulExtents = 1;
+   psNew->ulExtentSlots = 1;
+   psNew->psExtents[0].ulLength = 0;
+   psNew->psExtents[0].ulCapacity = ulCapacity;
+   psNew->psExtents[0].ulStart = 0;
+   Content_copyIn(psNew, 0, pvSource, ulLength);
+   ulWritable += ulCapacity;
+   Content_enforceBudget(NULL);
+
+   *poCResult = psNew;
+   return SUCCESS;
+}
+
+int Content_intern(const void *pvData, size_t ulLength,
+                   Content_T *poCResult)
+{
+   unsigned long ulHash;
+   Content_T oCCurr;
+   int iStatus;
+
+   assert(poCResult != NULL);
+
+   if(pvData == NULL)
+      return Content_new(NULL, ulLength, NULL, poCResult);
+
+   /* bodies are hashed and compared by their decompressed bytes */
+   ulHash = Content_hash(pvData, ulLength);
+   if(ulBucketCount != 0) {
+      for(oCCurr = poCBuckets[ulHash % ulBucketCount];
+          oCCurr != NULL; oCCurr = oCCurr->oCNext) {
+         if(oCCurr->ulHash == ulHash && oCCurr->ulLength == ulLength &&
+            Content_getData(oCCurr) != NULL &&
+            memcmp(Content_getData(oCCurr), pvData, ulLength) == 0) {
+            Content_retain(oCCurr);
+            *poCResult = oCCurr;
+            return SUCCESS;
+         }
+      }
+   }
+
+   if(ulDistinct >= ulBucketCount) {
+      iStatus = Content_growStore();
+      if(iStatus != SUCCESS) {
+         *poCResult = NULL;
+         return iStatus;
+      }
+   }
+
+   iStatus = Content_copy(pvData, ulLength, poCResult);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   (*poCResult)->bInterned = TRUE;
+   (*poCResult)->ulHash = ulHash;
+   (*poCResult)->oCNext = poCBuckets[ulHash % ulBucketCount];
+   poCBuckets[ulHash % ulBucketCount] = *poCResult;
+   ulDistinct++;
+   ulStoredBytes += ulLength;
+   ulReferences++;
+   ulLogicalBytes += ulLength;
+   return SUCCESS;
+}
+
+void Content_retain(Content_T oCContent)
+{
+   assert(oCContent != NULL);
+
+   oCContent->ulRefs++;
+   if(oCContent->bInterned) {
+      ulReferences++;
+      ulLogicalBytes += oCContent->ulLength;
+   }
+}
+
+void Content_release(Content_T oCContent)
+{
+   if(oCContent == NULL)
+      return;
+
+   assert(oCContent->ulRefs > 0);
+
+   if(oCContent->bInterned) {
+      ulReferences--;
+      ulLogicalBytes -= oCContent->ulLength;
+   }
+
+   oCContent->ulRefs--;
+   if(oCContent->ulRefs != 0)
+      return;
+   assert(oCContent->ulPins == 0);
+
+   if(oCContent->bSpillable)
+      Content_untrack(oCContent);
+   if(oCContent->bInterned)
+      Content_unintern(oCContent);
+   if(oCContent->bCompressed) {
+      if(oCContent->iCacheSlot >= 0)
+         asCache[oCContent->iCacheSlot].oCOwner = NULL;
+      ulCompressed--;
+      ulCompressedLogical -= oCContent->ulLength;
+      ulCompressedStored -= oCContent->ulStoredLength;
+   }
+   if(oCContent->bChunked) {
+      while(oCContent->ulExtents > 0) {
+         oCContent->ulExtents--;
+         ulWritable -= oCContent->psExtents[oCContent->ulExtents].ulCapacity;
+         free(oCContent->psExtents[oCContent->ulExtents].pucData);
+      }
+      free(oCContent->psExtents);
+   }
+   else if(oCContent->pfFree != NULL)
+      (*oCContent->pfFree)(oCContent->pvData);
+   free(oCContent);
+   Content_trimCache();
+}
+
+int Content_pin(Content_T oCContent)
+{
+   void *pvData;
+   int iStatus;
+
+   assert(oCContent != NULL);
+
+   iStatus = Content_load(oCContent);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(oCContent->bCompressed && oCContent->pvPinned == NULL) {
+      pvData = malloc(oCContent->ulLength);
+      if(pvData == NULL)
+         return MEMORY_ERROR;
+      if(!LZ_decompress(oCContent->pvData, oCContent->ulStoredLength,
+                        pvData, oCContent->ulLength)) {
+         free(pvData);
+         return MEMORY_ERROR;
+      }
+      oCContent->pvPinned = pvData;
+   }
+   else if(oCContent->bChunked &&
+           Content_flatten(oCContent) != SUCCESS)
+      return MEMORY_ERROR;
+
+   Content_retain(oCContent);
+   oCContent->ulPins++;
+   return SUCCESS;
+}
+
+void Content_unpin(Content_T oCContent)
+{
+   assert(oCContent != NULL);
+   assert(oCContent->ulPins > 0);
+
+   oCContent->ulPins--;
+   if(oCContent->ulPins == 0) {
+      free(oCContent->pvPinned);
+      oCContent->pvPinned = NULL;
+   }
+   Content_release(oCContent);
+}
+
+int Content_compress(Content_T oCContent)
+{
+   void *pvPacked;
+   void *pvShrunk;
+   size_t ulPacked;
+
+   assert(oCContent != NULL);
+   assert(oCContent->pfFree != NULL);
+
+   if(oCContent->bCompressed || oCContent->bChunked ||
+      oCContent->pvData == NULL ||
+      oCContent->ulLength == 0)
+      return SUCCESS;
+
+   /* only a smaller result is worth keeping */
+   pvPacked = malloc(oCContent->ulLength);
+   if(pvPacked == NULL)
+      return MEMORY_ERROR;
+   ulPacked = LZ_compress(oCContent->pvData, oCContent->ulLength,
+                          pvPacked, oCContent->ulLength - 1);
+   if(ulPacked == 0) {
+      free(pvPacked);
+      return SUCCESS;
+   }
+   pvShrunk = realloc(pvPacked, ulPacked);
+   if(pvShrunk != NULL)
+      pvPacked = pvShrunk;
+
+   (*oCContent->pfFree)(oCContent->pvData);
+   if(oCContent->bInterned)
+      ulStoredBytes -= oCContent->ulLength - ulPacked;
+   if(oCContent->bSpillable) {
+      ulResident -= oCContent->ulLength - ulPacked;
+      /* the slot holds the bytes as they were */
+      if(oCContent->bHasSlot)
+         Content_freeSlot(oCContent->ulSlot, oCContent->ulLength);
+      oCContent->bHasSlot = FALSE;
+   }
+   oCContent->pvData = pvPacked;
+   oCContent->ulStoredLength = ulPacked;
+   oCContent->pfFree = free;
+   oCContent->bCompressed = TRUE;
+
+   ulCompressed++;
+   ulCompressedLogical += oCContent->ulLength;
+   ulCompressedStored += ulPacked;
+   return SUCCESS;
+}
+
+int Content_fetch(Content_T oCContent, void **ppvData)
+{
+   int iStatus;
+
+   assert(oCContent != NULL);
+   assert(ppvData != NULL);
+
+   *ppvData = NULL;
+   /* a pinned body is resident and never evicted, and it is read
+      without touching the tier's shared state, as pinned reads may
+      be made without the FT's lock */
+   if(oCContent->ulPins > 0) {
+      if(oCContent->pvPinned != NULL)
+         *ppvData = oCContent->pvPinned;
+      else if(oCContent->bChunked)
+         *ppvData = oCContent->psExtents[0].pucData;
+      else
+         *ppvData = oCContent->pvData;
+      return SUCCESS;
+   }
+   /* a cache hit needs no stored bytes */
+   if(!oCContent->bCompressed || oCContent->iCacheSlot < 0) {
+      iStatus = Content_load(oCContent);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   if(oCContent->bCompressed) {
+      *ppvData = Content_readCache(oCContent);
+      return (*ppvData == NULL) ? MEMORY_ERROR : SUCCESS;
+   }
+   if(oCContent->bChunked) {
+      iStatus = Content_flatten(oCContent);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      *ppvData = oCContent->psExtents[0].pucData;
+      return SUCCESS;
+   }
+   *ppvData = oCContent->pvData;
+   return SUCCESS;
+}
+
+void *Content_getData(Content_T oCContent)
+{
+   void *pvData;
+
+   assert(oCContent != NULL);
+
+   (void) Content_fetch(oCContent, &pvData);
+   return pvData;
+}
+
+boolean Content_isWritable(Content_T oCContent)
+{
+   assert(oCContent != NULL);
+
+   return (boolean) (oCContent->bChunked && oCContent->ulRefs == 1);
+}
+
+int Content_read(Content_T oCContent, size_t ulOffset, void *pvBuffer,
+                 size_t ulLength, size_t *pulRead)
+{
+   unsigned char *pucBuffer = pvBuffer;
+   struct extent *psExtent;
+   unsigned char *pucData;
+   void *pvData;
+   size_t ulIndex;
+   size_t ulWithin;
+   size_t ulChunk;
+   int iStatus;
+
+   assert(oCContent != NULL);
+   assert(pvBuffer != NULL || ulLength == 0);
+   assert(pulRead != NULL);
+
+   *pulRead = 0;
+   if(ulOffset >= oCContent->ulLength ||
+      (oCContent->pvData == NULL && !oCContent->bSpilled &&
+       !oCContent->bChunked))
+      return SUCCESS;
+   if(ulLength > oCContent->ulLength - ulOffset)
+      ulLength = oCContent->ulLength - ulOffset;
+
+   if(!oCContent->bChunked) {
+      iStatus = Content_fetch(oCContent, &pvData);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      pucData = pvData;
+      memcpy(pucBuffer, pucData + ulOffset, ulLength);
+      *pulRead = ulLength;
+      return SUCCESS;
+   }
+
+   ulIndex = Content_findExtent(oCContent, ulOffset);
+   while(*pulRead < ulLength) {
+      psExtent = &oCContent->psExtents[ulIndex++];
+      ulWithin = ulOffset + *pulRead - psExtent->ulStart;
+      ulChunk = psExtent->ulLength - ulWithin;
+      if(ulChunk > ulLength - *pulRead)
+         ulChunk = ulLength - *pulRead;
+      memcpy(pucBuffer + *pulRead, psExtent->pucData + ulWithin, ulChunk);
+      *pulRead += ulChunk;
+   }
+   return SUCCESS;
+}
+
+int Content_write(Content_T oCContent, size_t ulOffset,
+                  const void *pvData, size_t ulLength)
+{
+   size_t ulEnd;
+   int iStatus;
+
+   assert(oCContent != NULL);
+   assert(Content_isWritable(oCContent));
+   assert(pvData != NULL || ulLength == 0);
+
+   ulEnd = ulOffset + ulLength;
+   if(ulEnd < ulOffset)
+      return MEMORY_ERROR;
+
+   iStatus = Content_reserveExtents(oCContent, ulEnd);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* a gap between the old end and ulOffset reads back as zeros */
+   if(ulOffset > oCContent->ulLength)
+      Content_copyIn(oCContent, oCContent->ulLength, NULL,
+                     ulOffset - oCContent->ulLength);
+   Content_copyIn(oCContent, ulOffset, pvData, ulLength);
+   return SUCCESS;
+}
+
+void Content_truncate(Content_T oCContent, size_t ulLength)
+{
+   struct extent *psLast;
+
+   assert(oCContent != NULL);
+   assert(Content_isWritable(oCContent));
+   assert(ulLength <= oCContent->ulLength);
+
+   while(oCContent->ulExtents > 1 &&
+         oCContent->psExtents[oCContent->ulExtents - 1].ulStart
+         >= ulLength) {
+      psLast = &oCContent->psExtents[--oCContent->ulExtents];
+      ulWritable -= psLast->ulCapacity;
+      free(psLast->pucData);
+   }
+
+   psLast = &oCContent->psExtents[oCContent->ulExtents - 1];
+   psLast->ulLength = ulLength - psLast->ulStart;
+   oCContent->ulLength = ulLength;
+}
+
+size_t Content_getLength(Content_T oCContent)
+{
+   assert(oCContent != NULL);
+
+   return oCContent->ulLength;
+}
+
+boolean Content_isOwned(Content_T oCContent)
+{
+   assert(oCContent != NULL);
+
+   return (boolean) (oCContent->pfFree != NULL);
+}
+
+void Content_getStoreStats(size_t *pulReferences,
+                           size_t *pulLogicalBytes,
+                           size_t *pulDistinct, size_t *pulStoredBytes)
+{
+   assert(pulReferences != NULL);
+   assert(pulLogicalBytes != NULL);
+   assert(pulDistinct != NULL);
+   assert(pulStoredBytes != NULL);
+
+   *pulReferences = ulReferences;
+   *pulLogicalBytes = ulLogicalBytes;
+   *pulDistinct = ulDistinct;
+   *pulStoredBytes = ulStoredBytes;
+}
+
+void Content_getCompressionStats(size_t *pulCompressed,
+                                 size_t *pulLogicalBytes,
+                                 size_t *pulStoredBytes,
+                                 size_t *pulCacheHits,
+                                 size_t *pulCacheMisses)
+{
+   assert(pulCompressed != NULL);
+   assert(pulLogicalBytes != NULL);
+   assert(pulStoredBytes != NULL);
+   assert(pulCacheHits != NULL);
+   assert(pulCacheMisses != NULL);
+
+   *pulCompressed = ulCompressed;
+   *pulLogicalBytes = ulCompressedLogical;
+   *pulStoredBytes = ulCompressedStored;
+   *pulCacheHits = ulCacheHits;
+   *pulCacheMisses = ulCacheMisses;
+}
+
+int Content_setSpill(const char *pcSpillFile, size_t ulNewBudget)
+{
+   Content_T oCCurr;
+   size_t ulOldBudget;
+   char *pcName;
+   int iStatus;
+
+   if(pcSpillFile == NULL) {
+      /* every evicted body comes back, without evicting any other,
+         before the file goes */
+      ulOldBudget = ulBudget;
+      ulBudget = (size_t) -1;
+      while(oCSpilled != NULL) {
+         iStatus = Content_load(oCSpilled);
+         if(iStatus != SUCCESS) {
+            ulBudget = ulOldBudget;
+            return iStatus;
+         }
+      }
+      for(oCCurr = oCMostUsed; oCCurr != NULL;
+          oCCurr = oCCurr->oCNextUse)
+         oCCurr->bHasSlot = FALSE;
+      if(psSpillFile != NULL) {
+         (void) fclose(psSpillFile);
+         (void) remove(pcSpillName);
+      }
+      free(pcSpillName);
+      free(psFreeSlots);
+      free(psHeldSlots);
+      psSpillFile = NULL;
+      pcSpillName = NULL;
+      psFreeSlots = NULL;
+      ulFreeSlots = 0;
+      ulFreeSlotCapacity = 0;
+      psHeldSlots = NULL;
+      ulHeldSlots = 0;
+      ulHeldCapacity = 0;
+      ulSpillEnd = 0;
+      return SUCCESS;
+   }
+
+   if(pcSpillName == NULL || strcmp(pcSpillName, pcSpillFile) != 0) {
+      iStatus = Content_setSpill(NULL, 0);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      pcName = malloc(strlen(pcSpillFile) + 1);
+      if(pcName == NULL)
+         return MEMORY_ERROR;
+      strcpy(pcName, pcSpillFile);
+      psSpillFile = fopen(pcSpillFile, "w+b");
+      if(psSpillFile == NULL) {
+         free(pcName);
+         return IO_ERROR;
+      }
+      pcSpillName = pcName;
+      iSpillOwner = getpid();
+   }
+
+   ulBudget = ulNewBudget;
+   Content_enforceBudget(NULL);
+   return SUCCESS;
+}
+
+int Content_beginFork(void)
+{
+   assert(!bSlotsHeld);
+
+   if(psSpillFile != NULL) {
+      psChildSpillFile = fopen(pcSpillName, "rb");
+      if(psChildSpillFile == NULL)
+         return IO_ERROR;
+   }
+   bSlotsHeld = TRUE;
+   return SUCCESS;
+}
+
+void Content_endFork(void)
+{
+   size_t u;
+
+   assert(bSlotsHeld);
+
+   if(psChildSpillFile != NULL)
+      (void) fclose(psChildSpillFile);
+   psChildSpillFile = NULL;
+   bSlotsHeld = FALSE;
+   for(u = 0; u < ulHeldSlots; u++)
+      Content_releaseSlot(psHeldSlots[u].ulOffset,
+                          psHeldSlots[u].ulLength);
+   ulHeldSlots = 0;
+}
+
+void Content_getSpillStats(size_t *pulResidentBytes,
+                           size_t *pulSpilled, size_t *pulSpilledBytes,
+                           size_t *pulHits, size_t *pulMisses,
+                           size_t *pulEvictions)
+{
+   assert(pulResidentBytes != NULL);
+   assert(pulSpilled != NULL);
+   assert(pulSpilledBytes != NULL);
+   assert(pulHits != NULL);
+   assert(pulMisses != NULL);
+   assert(pulEvictions != NULL);
+
+   *pulResidentBytes = ulResident + ulWritable;
+   *pulSpilled = ulSpilledCount;
+   *pulSpilledBytes = ulSpilledBytes;
+   *pulHits = ulSpillHits;
+   *pulMisses = ulSpillMisses;
+   *pulEvictions = ulEvictions;
+}
@@ -0,0 +1,232 @@
+/*--------------------------------------------------------------------*/
+/* content.h                                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef CONTENT_INCLUDED
+#define CONTENT_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A Content_T is the body of a file in a File Tree: a buffer and its
+  length, with a count of the references held to it. A body either
+  borrows a buffer that its creator keeps alive, or owns it and frees
+  it when the last reference is released. Owned bodies may be
+  interned in the content store, which keeps one shared body per
+  distinct byte sequence, and may be compressed, in which case they
+  are read through a small cache of decompressed buffers. A writable
+  body keeps its bytes in extents of geometrically growing size, so
+  that it can be written in place and appended to in O(1) amortized
+  time; it is gathered into one buffer only when read as a whole.
+  Under a memory budget, the least recently used owned bodies that are
+  not writable are evicted to a spill file and read back on access.
+*/
+typedef struct content *Content_T;
+
+/*
+  Creates a body of ulLength bytes at pvData (which may be NULL)
+  holding one reference. If pfFree is not NULL the body owns pvData
+  and calls (*pfFree)(pvData) when its last reference is released;
+  otherwise pvData is only borrowed. Returns an int SUCCESS status
+  and sets *poCResult to the new body if successful. Otherwise, sets
+  *poCResult to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int Content_new(void *pvData, size_t ulLength,
+                void (*pfFree)(void *pvData), Content_T *poCResult);
+
+/*
+  Creates a body owning a copy of the ulLength bytes at pvData,
+  holding one reference. A NULL pvData is not copied; a borrowed body
+  is made for it instead. Returns an int SUCCESS status and sets
+  *poCResult to the new body if successful. Otherwise, sets
+  *poCResult to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int Content_copy(const void *pvData, size_t ulLength,
+                 Content_T *poCResult);
+
+/*
+  Creates a writable body holding a copy of the bytes of oCSource
+  (none, if oCSource or its buffer is NULL), with room to grow to at
+  least ulCapacity bytes without allocating, and one reference.
+  Returns an int SUCCESS status and sets *poCResult to the new body
+  if successful. Otherwise, sets *poCResult to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int Content_newWritable(Content_T oCSource, size_t ulCapacity,
+                        Content_T *poCResult);
+
+/*
+  Returns, with one more reference, the interned body whose bytes
+  equal the ulLength bytes at pvData, interning an owned copy of
+  them first if there is none. A NULL pvData is not interned; a
+  borrowed body is made for it instead. Returns an int SUCCESS status
+  and sets *poCResult to the body if successful. Otherwise, sets
+  *poCResult to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int Content_intern(const void *pvData, size_t ulLength,
+                   Content_T *poCResult);
+
+/* Adds a reference to oCContent. */
+void Content_retain(Content_T oCContent);
+
+/*
+  Drops a reference to oCContent, destroying it (and freeing its
+  buffer, if owned) when none remain. oCContent may be NULL.
+*/
+void Content_release(Content_T oCContent);
+
+/*
+  Pins oCContent, adding a reference to it, so that the buffer
+  Content_getData returns for it stays valid and unchanged until
+  Content_unpin: a compressed body gets a private decompressed copy
+  rather than a cache buffer, and a writable body is gathered into
+  one buffer, which the extra reference keeps from being written in
+  place. Reading a pinned body changes no state shared with other
+  bodies. Returns SUCCESS; or MEMORY_ERROR, or IO_ERROR if an evicted
+  body could not be read back, in which case oCContent is not pinned.
+*/
+int Content_pin(Content_T oCContent);
+
+/*
+  Drops a pin and the reference that came with it from oCContent,
+  freeing its private decompressed copy once no pins remain.
+*/
+void Content_unpin(Content_T oCContent);
+
+/*
+  Compresses the owned body oCContent in place if that makes it
+  smaller; otherwise, or if it is already compressed, leaves it be.
+  Returns SUCCESS, or MEMORY_ERROR if there was no memory to try, in
+  which case oCContent is left uncompressed.
+*/
+int Content_compress(Content_T oCContent);
+
+/*
+  Stores in *ppvData the buffer Content_getData would return for
+  oCContent. Returns SUCCESS; or MEMORY_ERROR if a buffer to hold its
+  bytes could not be allocated, or IO_ERROR if they could not be read
+  back from the spill file, in which case *ppvData is NULL.
+*/
+int Content_fetch(Content_T oCContent, void **ppvData);
+
+/*
+  Returns the buffer holding oCContent's bytes, which may be NULL.
+  For a compressed body this is a cache buffer that stays valid only
+  until enough other compressed bodies have been read to evict it,
+  and NULL is also returned if it could not be allocated.
+*/
+void *Content_getData(Content_T oCContent);
+
+/* Returns the number of bytes in oCContent, once decompressed. */
+size_t Content_getLength(Content_T oCContent);
+
+/*
+  Returns TRUE if oCContent is a writable body to which no reference
+  but the caller's is held, so that Content_write and
+  Content_truncate may change it.
+*/
+boolean Content_isWritable(Content_T oCContent);
+
+/*
+  Copies up to ulLength of oCContent's bytes, starting at offset
+  ulOffset, to pvBuffer and stores in *pulRead how many were copied:
+  fewer than ulLength if the body ends first, and none from a NULL
+  buffer. Returns SUCCESS, or MEMORY_ERROR if a compressed body could
+  not be decompressed, or IO_ERROR if an evicted body could not be
+  read back.
+*/
+int Content_read(Content_T oCContent, size_t ulOffset, void *pvBuffer,
+                 size_t ulLength, size_t *pulRead);
+
+/*
+  Writes the ulLength bytes at pvData into the writable body
+  oCContent at offset ulOffset, extending it if they reach past its
+  end; a gap between its old end and ulOffset is filled with zeros.
+  Returns SUCCESS, or MEMORY_ERROR, in which case oCContent is
+  unchanged. Rewriting bytes within the body never fails.
+*/
+int Content_write(Content_T oCContent, size_t ulOffset,
+                  const void *pvData, size_t ulLength);
+
+/*
+  Shortens the writable body oCContent to its first ulLength bytes.
+*/
+void Content_truncate(Content_T oCContent, size_t ulLength);
+
+/* Returns TRUE if oCContent owns its buffer, FALSE if it borrows it. */
+boolean Content_isOwned(Content_T oCContent);
+
+/*
+  Stores in *pulReferences and *pulLogicalBytes the number of
+  references held to interned bodies and the bytes those references
+  represent, and in *pulDistinct and *pulStoredBytes the number of
+  interned bodies and the bytes they actually occupy.
+*/
+void Content_getStoreStats(size_t *pulReferences,
+                           size_t *pulLogicalBytes,
+                           size_t *pulDistinct, size_t *pulStoredBytes);
+
+/*
+  Stores in *pulCompressed the number of compressed bodies, in
+  *pulLogicalBytes and *pulStoredBytes their decompressed and
+  compressed sizes in total, and in *pulCacheHits and *pulCacheMisses
+  how many reads of them the decompression cache has served and how
+  many had to decompress.
+*/
+void Content_getCompressionStats(size_t *pulCompressed,
+                                 size_t *pulLogicalBytes,
+                                 size_t *pulStoredBytes,
+                                 size_t *pulCacheHits,
+                                 size_t *pulCacheMisses);
+
+/*
+  Turns the spill tier on with the spill file pcSpillFile, created or
+  emptied, keeping the stored bytes of resident owned bodies that are
+  freed with free and are not writable or pinned, together with the
+  bytes writable bodies have allocated, within ulBudget bytes by
+  evicting the least recently used of the former to it; or, if
+  pcSpillFile is NULL, reads every evicted body back and closes and
+  removes the spill file. A buffer Content_getData returned for an
+  evictable body stays valid only until it is evicted. Returns
+  SUCCESS; or MEMORY_ERROR or IO_ERROR
+  if an evicted body could not be read back, in which case the tier
+  is left as it was; or IO_ERROR if pcSpillFile could not be created,
+  in which case the tier is off. Must not be called between
+  Content_beginFork and Content_endFork.
+*/
+int Content_setSpill(const char *pcSpillFile, size_t ulBudget);
+
+/*
+  Prepares for forking a child that reads bodies: opens the stream
+  through which the child reads the spill file, if there is one, and
+  holds the slots freed from now on rather than reusing them, so that
+  the file keeps what the child expects to find there. Returns
+  SUCCESS, or IO_ERROR if the spill file could not be opened.
+*/
+int Content_beginFork(void);
+
+/*
+  Ends what Content_beginFork began, once the child has exited:
+  closes the parent's copy of the child's stream and frees the slots
+  held since.
+*/
+void Content_endFork(void);
+
+/*
+  Stores in *pulResidentBytes the bytes the resident bodies that the
+  spill tier may evict occupy, with those writable bodies have
+  allocated, in *pulSpilled and *pulSpilledBytes the number of
+  evicted bodies and their stored bytes, and in *pulHits, *pulMisses,
+  and *pulEvictions how many accesses found a body resident, how many
+  read it back, and how many bodies were evicted.
+*/
+void Content_getSpillStats(size_t *pulResidentBytes,
+                           size_t *pulSpilled, size_t *pulSpilledBytes,
+                           size_t *pulHits, size_t *pulMisses,
+                           size_t *pulEvictions);
+
+#endif
@@ -8,6 +8,9 @@
 #include "dynarray.h"
 #include "path.h"
 #include "nodeFT.h"
+#include "content.h"
+#include "journal.h"
+#include "checkpoint.h"
 #include "ft.h"
 
 /*  
@@ -22,6 +25,284 @@ static boolean bIsInitialized;
 static Node_T oNRoot;
 /* 5. a counter of the number of nodes in the hierarchy */
 static size_t ulCount;
+/* 6. the undo log of the open transaction, or NULL if none is open */
+static DynArray_T oDUndoLog;
+/* 7. the journal mutations are logged to, or NULL if none is open */
+static Journal_T oJJournal;
+/* 8. the sequence number of the last journaled mutation */
+static size_t ulJournalSeq;
+/* 9. the open journal's file name and group size */
+static char *pcJournalFile;
+static size_t ulJournalGroupSize;
+/* 10. the background checkpoint in progress, or NULL if none is, and
+   the rotated journal file to delete once it succeeds (or NULL) */
+static Checkpoint_T oCCheckpoint;
+static char *pcCheckpointPrev;
+/* 11. metrics about the checkpoints taken so far */
+static struct FT_CheckpointStats sCheckpointStats;
+/* 12. the mapped snapshot that recovered contents point into, if any */
+static void *pvSnapshotMap;
+static size_t ulSnapshotMapSize;
+/* 13. whether file contents are deduplicated in the content store */
+static boolean bDedup;
+/* 14. the size from which file contents are compressed, or 0 if
+   they are not */
+static size_t ulCompressThreshold;
+/* 15. how file contents are held by default, and the function that
+   frees taken ones, or NULL for free */
+static enum FT_Ownership eOwnership;
+static void (*pfOwnedFree)(void *pvContents);
+
+/* The state FT_replayRecord carries from record to record */
+struct replay
+{
+   /* the sequence number of the snapshot's checkpoint */
+   size_t ulCheckpoint;
+   /* whether contents point into a mapping rather than being owned */
+   boolean bMapped;
+};
+
+/* The bytes a write record's offset takes up in the journal */
+enum { OFFSET_SIZE = 8 };
+
+/* The kinds of mutation recorded in a transaction's undo log */
+enum UndoKind { UNDO_INSERT, UNDO_REMOVE, UNDO_REPLACE, UNDO_WRITE };
+
+/* An entry in the undo log of an open transaction */
+struct undo
+{
+   /* the kind of mutation this entry undoes */
+   enum UndoKind eKind;
+   /* the first node created (insert), the detached subtree (remove),
+      or the file whose contents were replaced or written (replace,
+      write) */
+   Node_T oNNode;
+   /* the number of nodes created or detached */
+   size_t ulNodes;
+   /* the contents to restore, and a reference to them (replace) */
+   Content_T oCOldContents;
+   /* the offset written at, the length before the write, and the
+      bytes it overwrote (write) */
+   size_t ulOffset;
+   size_t ulOldLength;
+   void *pvSaved;
+   size_t ulSaved;
+};
+
+/* --------------------------------------------------------------------
+
+  The following auxiliary functions maintain the undo log of an open
+  transaction. Each mutation is applied to the tree immediately and
+  then logged; removed subtrees are only detached, not freed, until
+  the transaction commits, so that every entry can be undone without
+  allocating.
+*/
+
+/*
+  Returns the number of nodes in the subtree rooted at oNNode.
+*/
+static size_t FT_countNodes(Node_T oNNode) {
+   size_t ulNodes = 1;
+   size_t c;
+   Node_T oNChild = NULL;
+
+   assert(oNNode != NULL);
+
+   for(c = 0; c < Node_getNumDirChildren(oNNode); c++) {
+      (void) Node_getChild(TRUE, oNNode, c, &oNChild);
+      ulNodes += FT_countNodes(oNChild);
+   }
+   return ulNodes + Node_getNumFileChildren(oNNode);
+}
+
+/*
+  Appends an entry of kind eKind for oNNode to the undo log, if a
+  transaction is open. Returns SUCCESS, or MEMORY_ERROR if the entry
+  could not be allocated, in which case the caller must revert the
+  mutation itself.
+*/
+static int FT_logUndo(enum UndoKind eKind, Node_T oNNode,
+                      size_t ulNodes, Content_T oCOldContents) {
+   struct undo *psUndo;
+
+   assert(oNNode != NULL);
+
+   if(oDUndoLog == NULL)
+      return SUCCESS;
+
+   psUndo = malloc(sizeof(struct undo));
+   if(psUndo == NULL)
+      return MEMORY_ERROR;
+
+   psUndo->eKind = eKind;
+   psUndo->oNNode = oNNode;
+   psUndo->ulNodes = ulNodes;
+   psUndo->oCOldContents = oCOldContents;
+   psUndo->ulOffset = 0;
+   psUndo->ulOldLength = 0;
+   psUndo->pvSaved = NULL;
+   psUndo->ulSaved = 0;
+
+   if(!DynArray_add(oDUndoLog, psUndo)) {
+      free(psUndo);
+      return MEMORY_ERROR;
+   }
+   return SUCCESS;
+}
+
+/*
+  Removes oNNode and its subtree from the FT, updating the FT state
+  variables. Outside a transaction the subtree is freed; inside one
+  it is detached and logged so that FT_abort can restore it.
+  Returns SUCCESS, or MEMORY_ERROR if it could not be logged.
+*/
+static int FT_removeNode(Node_T oNNode) {
+   size_t ulNodes;
+   int iStatus;
+
+   assert(oNNode != NULL);
+
+   if(oDUndoLog == NULL)
+      ulCount -= Node_free(oNNode);
+   else {
+      ulNodes = FT_countNodes(oNNode);
+      Node_unlink(oNNode);
+      iStatus = FT_logUndo(UNDO_REMOVE, oNNode, ulNodes, NULL);
+      if(iStatus != SUCCESS) {
+         (void) Node_relink(oNNode);
+         return iStatus;
+      }
+      ulCount -= ulNodes;
+   }
+
+   if(ulCount == 0)
+      oNRoot = NULL;
+   return SUCCESS;
+}
+
+/* --------------------------------------------------------------------
+
+  The following auxiliary functions write mutations to the journal,
+  if one is open. Space for a record is reserved before the mutation
+  is attempted, so that once the mutation succeeds logging it cannot
+  fail; a reservation left unused by a failed mutation is harmless.
+*/
+
+/*
+  Reserves journal space for a record of pcPath (which may be NULL)
+  with ulLength bytes of contents pvContents. Returns SUCCESS, or the
+  journal's IO_ERROR or MEMORY_ERROR status.
+*/
+static int FT_reserveJournal(const char *pcPath, const void *pvContents,
+                             size_t ulLength) {
+   if(oJJournal == NULL)
+      return SUCCESS;
+
+   return Journal_reserve(oJJournal,
+                          (pcPath == NULL) ? 0 : strlen(pcPath),
+                          (pvContents == NULL) ? 0 : ulLength);
+}
+
+/*
+  Logs a record of kind iOp for pcPath with ulLength bytes of contents
+  pvContents, using space reserved by FT_reserveJournal.
+*/
+static void FT_logJournal(int iOp, const char *pcPath,
+                          const void *pvContents, size_t ulLength) {
+   if(oJJournal != NULL)
+      Journal_append(oJJournal, iOp, ++ulJournalSeq, pcPath,
+                     pvContents, ulLength);
+}
+
+/*
+  Returns TRUE if the ulLength bytes of pvContents, given under
+  ownership eMode, would be stored as a copy owned by the FT, because
+  they are copied, deduplicated, or compressed, and FALSE if the
+  caller's buffer would be kept.
+*/
+static boolean FT_isCopied(const void *pvContents, size_t ulLength,
+                           enum FT_Ownership eMode) {
+   return (boolean) (bDedup || (pvContents != NULL &&
+                                (eMode == FT_COPY ||
+                                 (ulCompressThreshold != 0 &&
+                                  ulLength >= ulCompressThreshold))));
+}
+
+/*
+  Frees pvContents with pfFree (or free, if it is NULL) if they were
+  given to the FT under ownership eMode FT_TAKE.
+*/
+static void FT_discard(void *pvContents, enum FT_Ownership eMode,
+                       void (*pfFree)(void *pvContents)) {
+   if(eMode != FT_TAKE || pvContents == NULL)
+      return;
+   if(pfFree != NULL)
+      (*pfFree)(pvContents);
+   else
+      free(pvContents);
+}
+
+/*
+  Wraps the ulLength bytes of pvContents for storage in a file node:
+  interning a shared copy of them if deduplication is on, compressing
+  the copy if they reach the compression threshold, copying them if
+  eMode is FT_COPY, and otherwise holding them as eMode says, to be
+  freed with pfFree under FT_TAKE. A copy never takes pvContents, so
+  the caller discards them once it is done with them. Returns SUCCESS
+  and sets *poCResult, or returns MEMORY_ERROR.
+*/
+static int FT_newContent(void *pvContents, size_t ulLength,
+                         enum FT_Ownership eMode,
+                         void (*pfFree)(void *pvContents),
+                         Content_T *poCResult) {
+   int iStatus;
+
+   assert(poCResult != NULL);
+
+   if(!FT_isCopied(pvContents, ulLength, eMode)) {
+      if(eMode != FT_TAKE || pvContents == NULL)
+         pfFree = NULL;
+      else if(pfFree == NULL)
+         pfFree = free;
+      return Content_new(pvContents, ulLength, pfFree, poCResult);
+   }
+
+   if(bDedup)
+      iStatus = Content_intern(pvContents, ulLength, poCResult);
+   else
+      iStatus = Content_copy(pvContents, ulLength, poCResult);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* compression is best effort: a body it fails on stays plain */
+   if(pvContents != NULL && ulCompressThreshold != 0 &&
+      ulLength >= ulCompressThreshold)
+      (void) Content_compress(*poCResult);
+   return SUCCESS;
+}
+
+/*
+  Logs a write of the ulLength bytes at pvData at offset ulOffset of
+  pcPath, using space reserved by FT_reserveJournal for OFFSET_SIZE
+  more bytes than that. The record's contents are the offset,
+  little-endian, followed by the bytes.
+*/
+static void FT_logWrite(const char *pcPath, size_t ulOffset,
+                        const void *pvData, size_t ulLength) {
+   unsigned char aucOffset[OFFSET_SIZE];
+   int i;
+
+   if(oJJournal == NULL)
+      return;
+
+   for(i = 0; i < OFFSET_SIZE; i++)
+      aucOffset[i] = (unsigned char) ((ulOffset >> (8 * i)) & 0xFF);
+   Journal_startRecord(oJJournal, JOURNAL_WRITE, ++ulJournalSeq, pcPath,
+                       OFFSET_SIZE + ulLength);
+   Journal_addContents(oJJournal, aucOffset, OFFSET_SIZE);
+   Journal_addContents(oJJournal, pvData, ulLength);
+   Journal_endRecord(oJJournal);
+}
 
 /* --------------------------------------------------------------------
 
@@ -122,58 +403,113 @@ static int FT_traversePath(Path_T oPPath, Node_T *poNFurthest) {
 
 
 /*
-  Traverses the FT to find a node with absolute path pcPath. Returns a
-  int SUCCESS status and sets *poNResult to be the node, if found.
+  Returns SUCCESS if pcPath is well-formatted, as Path_new would
+  judge it, or BAD_PATH if it is not.
+*/
+static int FT_checkPath(const char *pcPath) {
+   const char *pcEnd;
+
+   assert(pcPath != NULL);
+
+   if(*pcPath == '\0' || *pcPath == '/')
+      return BAD_PATH;
+   for(pcEnd = pcPath; *pcEnd != '\0'; pcEnd++)
+      if(*pcEnd == '/' && (pcEnd[1] == '/' || pcEnd[1] == '\0'))
+         return BAD_PATH;
+   return SUCCESS;
+}
+
+/*
+  Returns SUCCESS if the root exists and is the first component of the
+  well-formatted path pcPath. Otherwise, returns:
+  * NO_SUCH_PATH if there is no root
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+*/
+static int FT_checkRoot(const char *pcPath) {
+   const char *pcEnd;
+   size_t ulRootLength;
+
+   assert(pcPath != NULL);
+
+   if(oNRoot == NULL)
+      return NO_SUCH_PATH;
+
+   for(pcEnd = pcPath; *pcEnd != '/' && *pcEnd != '\0'; pcEnd++)
+      ;
+   ulRootLength = Path_getStrLength(Node_getPath(oNRoot));
+   if(ulRootLength != (size_t) (pcEnd - pcPath) ||
+      strncmp(Path_getPathname(Node_getPath(oNRoot)), pcPath,
+              ulRootLength) != 0)
+      return CONFLICTING_PATH;
+   return SUCCESS;
+}
+
+/*
+  Walks down from oNFrom, whose path must be made of the leading
+  components of the well-formatted path pcPath, finding each longer
+  prefix of pcPath among the children of the last, without allocating.
+  Sets *poNReached to the deepest node found. Returns the node with
+  path pcPath, or NULL if there is none.
+*/
+static Node_T FT_descend(Node_T oNFrom, const char *pcPath,
+                         Node_T *poNReached) {
+   Node_T oNCurr = oNFrom;
+   Node_T oNChild;
+   const char *pcEnd;
+
+   assert(oNFrom != NULL);
+   assert(pcPath != NULL);
+   assert(poNReached != NULL);
+
+   pcEnd = pcPath + Path_getStrLength(Node_getPath(oNFrom));
+   while(*pcEnd != '\0') {
+      for(pcEnd++; *pcEnd != '/' && *pcEnd != '\0'; pcEnd++)
+         ;
+      if(!Node_isDir(oNCurr))
+         break;
+      oNChild = Node_findChild(oNCurr, pcPath,
+                               (size_t) (pcEnd - pcPath));
+      if(oNChild == NULL)
+         break;
+      oNCurr = oNChild;
+   }
+
+   *poNReached = oNCurr;
+   return (*pcEnd == '\0' &&
+           Path_getStrLength(Node_getPath(oNCurr)) ==
+           (size_t) (pcEnd - pcPath)) ? oNCurr : NULL;
+}
+
+/*
+  Traverses the FT to find a node with absolute path pcPath, walking
+  pcPath in place rather than building a Path_T for it, so that
+  nothing is allocated. Returns a int SUCCESS status and sets
+  *poNResult to be the node, if found.
   Otherwise, sets *poNResult to NULL and returns with status:
   * INITIALIZATION_ERROR if the FT is not in an initialized state
   * BAD_PATH if pcPath does not represent a well-formatted path
   * CONFLICTING_PATH if the root's path is not a prefix of pcPath
   * NO_SUCH_PATH if no node with pcPath exists in the hierarchy
-  * MEMORY_ERROR if memory could not be allocated to complete request
  */
 static int FT_findNode(const char *pcPath, Node_T *poNResult) {
-   Path_T oPPath = NULL;
-   Node_T oNFound = NULL;
+   Node_T oNReached;
    int iStatus;
 
    assert(pcPath != NULL);
    assert(poNResult != NULL);
 
-   if(!bIsInitialized) {
-      *poNResult = NULL;
+   *poNResult = NULL;
+   if(!bIsInitialized)
       return INITIALIZATION_ERROR;
-   }
-
-   iStatus = Path_new(pcPath, &oPPath);
-   if(iStatus != SUCCESS) {
-      *poNResult = NULL;
-      return iStatus;
-   }
 
-   iStatus = FT_traversePath(oPPath, &oNFound);
+   iStatus = FT_checkPath(pcPath);
+   if(iStatus == SUCCESS)
+      iStatus = FT_checkRoot(pcPath);
    if(iStatus != SUCCESS)
-   {
-      Path_free(oPPath);
-      *poNResult = NULL;
       return iStatus;
-   }
-
-
-   if(oNFound == NULL) {
-      Path_free(oPPath);
-      *poNResult = NULL;
-      return NO_SUCH_PATH;
-   }
-
-   if(Path_comparePath(Node_getPath(oNFound), oPPath) != 0) {
-      Path_free(oPPath);
-      *poNResult = NULL;
-      return NO_SUCH_PATH;
-   }
 
-   Path_free(oPPath);
-   *poNResult = oNFound;
-   return SUCCESS;
+   *poNResult = FT_descend(oNRoot, pcPath, &oNReached);
+   return (*poNResult == NULL) ? NO_SUCH_PATH : SUCCESS;
 }
 /*--------------------------------------------------------------------*/
 
@@ -192,6 +528,10 @@ int FT_insertDir(const char *pcPath) {
    if(!bIsInitialized)
       return INITIALIZATION_ERROR;
 
+   iStatus = FT_reserveJournal(pcPath, NULL, 0);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
    iStatus = Path_new(pcPath, &oPPath);
    if(iStatus != SUCCESS){
       return iStatus;
@@ -199,8 +539,10 @@ int FT_insertDir(const char *pcPath) {
    
    /* find the closest ancestor of oPPath already in the tree */
    iStatus= FT_traversePath(oPPath, &oNCurr);
-   if(oNCurr !=NULL && Node_isDir(oNCurr) == FALSE)
-            return NOT_A_DIRECTORY;
+   if(oNCurr !=NULL && Node_isDir(oNCurr) == FALSE){
+      Path_free(oPPath);
+      return NOT_A_DIRECTORY;
+   }
    if(iStatus != SUCCESS)
    {
       Path_free(oPPath);
@@ -229,6 +571,11 @@ int FT_insertDir(const char *pcPath) {
          Path_free(oPPath);
          return ALREADY_IN_TREE;
       }
+
+      if(!Node_withinQuotas(oNCurr, ulDepth - ulIndex + 1, 0)) {
+         Path_free(oPPath);
+         return QUOTA_EXCEEDED;
+      }
    }
 
    /* starting at oNCurr, build rest of the path one level at a time */
@@ -246,7 +593,7 @@ int FT_insertDir(const char *pcPath) {
       }
 
       /* insert the new node for this level */
-      iStatus = Node_new(TRUE, oPPrefix, oNCurr, &oNNewNode, NULL, -1);
+      iStatus = Node_new(TRUE, oPPrefix, oNCurr, &oNNewNode, NULL);
       if(iStatus != SUCCESS) {
          Path_free(oPPath);
          Path_free(oPPrefix);
@@ -265,6 +612,12 @@ int FT_insertDir(const char *pcPath) {
    }
 
    Path_free(oPPath);
+   iStatus = FT_logUndo(UNDO_INSERT, oNFirstNew, ulNewNodes, NULL);
+   if(iStatus != SUCCESS) {
+      (void) Node_free(oNFirstNew);
+      return iStatus;
+   }
+   FT_logJournal(JOURNAL_INSERT_DIR, pcPath, NULL, 0);
    /* update FT state variables to reflect insertion */
    if(oNRoot == NULL)
       oNRoot = oNFirstNew;
@@ -285,7 +638,6 @@ boolean FT_containsDir(const char *pcPath) {
 
 int FT_rmDir(const char *pcPath) {
    int iStatus;
-   int freeRet;
    Node_T oNFound = NULL;
 
    assert(pcPath != NULL);
@@ -299,17 +651,24 @@ int FT_rmDir(const char *pcPath) {
    if(Node_isDir(oNFound) == FALSE)
       return NOT_A_DIRECTORY;
 
-   
-   freeRet = Node_free(oNFound);
-   ulCount -= freeRet;
-   if(ulCount == 0)
-      oNRoot = NULL;
+   iStatus = FT_reserveJournal(pcPath, NULL, 0);
+   if(iStatus != SUCCESS)
+      return iStatus;
 
-  
-   return SUCCESS;
+   iStatus = FT_removeNode(oNFound);
+   if(iStatus == SUCCESS)
+      FT_logJournal(JOURNAL_RM_DIR, pcPath, NULL, 0);
+   return iStatus;
 }
 
-int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
+/*
+  Inserts a new file into the FT with absolute path pcPath and
+  contents oCContents, as FT_insertFile does, except that nothing is
+  journaled. The new file takes over the caller's reference to
+  oCContents only if SUCCESS is returned.
+*/
+static int FT_insertFileContent(const char *pcPath,
+                                Content_T oCContents) {
    int iStatus;
    Path_T oPPath = NULL;
    Node_T oNFirstNew = NULL;
@@ -320,11 +679,7 @@ int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
    Node_T oNNewNode2 = NULL;
    
    assert(pcPath != NULL);
-
-  
-   /* validate pcPath and generate a Path_T for it */
-   if(!bIsInitialized)
-      return INITIALIZATION_ERROR;
+   assert(oCContents != NULL);
 
    iStatus = Path_new(pcPath, &oPPath);
    if(iStatus != SUCCESS){
@@ -371,6 +726,12 @@ int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
          Path_free(oPPath);
          return ALREADY_IN_TREE;
       }
+
+      if(!Node_withinQuotas(oNCurr, ulDepth - ulIndex + 1,
+                            Content_getLength(oCContents))) {
+         Path_free(oPPath);
+         return QUOTA_EXCEEDED;
+      }
    }
 
    /* starting at oNCurr, build rest of the path one level at a time */
@@ -389,7 +750,7 @@ int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
       }
 
       /* insert the new node for this level */
-      iStatus = Node_new(TRUE, oPPrefix, oNCurr, &oNNewNode, NULL, -1);
+      iStatus = Node_new(TRUE, oPPrefix, oNCurr, &oNNewNode, NULL);
       if(iStatus != SUCCESS) {
          Path_free(oPPath);
          Path_free(oPPrefix);
@@ -423,7 +784,7 @@ int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
    }
    
    /* insert the new node for this level */
-   iStatus = Node_new(FALSE, oPPrefix2, oNCurr, &oNNewNode2, pvContents, ulLength);
+   iStatus = Node_new(FALSE, oPPrefix2, oNCurr, &oNNewNode2, oCContents);
    if(iStatus != SUCCESS) {
       Path_free(oPPath);
       Path_free(oPPrefix2);
@@ -447,13 +808,133 @@ int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
    Path_free(oPPath);
    /* update FT state variables to reflect insertion */
    if(oNRoot == NULL)
-      return CONFLICTING_PATH;
+      iStatus = CONFLICTING_PATH;
+   else
+      iStatus = FT_logUndo(UNDO_INSERT, oNFirstNew, ulNewNodes, NULL);
+   if(iStatus != SUCCESS) {
+      /* the caller keeps its reference to the contents */
+      (void) Node_replaceContents(oNNewNode2, NULL);
+      (void) Node_free(oNFirstNew);
+      return iStatus;
+   }
    ulCount += ulNewNodes;
    
 
   return SUCCESS;
 }
 
+int FT_insertFile(const char *pcPath, void *pvContents, size_t ulLength) {
+   return FT_insertFileOwned(pcPath, pvContents, ulLength, eOwnership,
+                             pfOwnedFree);
+}
+
+int FT_insertFileOwned(const char *pcPath, void *pvContents,
+                       size_t ulLength, enum FT_Ownership eMode,
+                       void (*pfFree)(void *pvContents)) {
+   Content_T oCContents = NULL;
+   int iStatus = INITIALIZATION_ERROR;
+
+   assert(pcPath != NULL);
+
+   if(bIsInitialized)
+      iStatus = FT_reserveJournal(pcPath, pvContents, ulLength);
+   if(iStatus == SUCCESS)
+      iStatus = FT_newContent(pvContents, ulLength, eMode, pfFree,
+                              &oCContents);
+   if(iStatus != SUCCESS) {
+      FT_discard(pvContents, eMode, pfFree);
+      return iStatus;
+   }
+
+   iStatus = FT_insertFileContent(pcPath, oCContents);
+   if(iStatus == SUCCESS)
+      FT_logJournal(JOURNAL_INSERT_FILE, pcPath, pvContents, ulLength);
+   else
+      Content_release(oCContents);
+
+   /* a copy has not taken the caller's buffer, so it is freed here */
+   if(FT_isCopied(pvContents, ulLength, eMode))
+      FT_discard(pvContents, eMode, pfFree);
+   return iStatus;
+}
+
+int FT_insertFileV(const char *pcPath, const struct FT_Segment *psSegments,
+                   size_t ulSegments) {
+   Content_T oCContents = NULL;
+   unsigned char *pucGathered;
+   size_t ulLength = 0;
+   size_t ulOffset = 0;
+   size_t u;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(psSegments != NULL || ulSegments == 0);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   for(u = 0; u < ulSegments; u++) {
+      assert(psSegments[u].pvData != NULL || psSegments[u].ulLength == 0);
+      if(ulLength + psSegments[u].ulLength < ulLength)
+         return MEMORY_ERROR;
+      ulLength += psSegments[u].ulLength;
+   }
+
+   iStatus = FT_reserveJournal(pcPath, "", ulLength);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* contents to be shared or compressed are gathered and then stored
+      as FT_insertFile would store a copy of them */
+   if(bDedup ||
+      (ulCompressThreshold != 0 && ulLength >= ulCompressThreshold)) {
+      pucGathered = malloc(ulLength == 0 ? 1 : ulLength);
+      if(pucGathered == NULL)
+         return MEMORY_ERROR;
+      for(u = 0; u < ulSegments; u++) {
+         if(psSegments[u].ulLength != 0)
+            memcpy(pucGathered + ulOffset, psSegments[u].pvData,
+                   psSegments[u].ulLength);
+         ulOffset += psSegments[u].ulLength;
+      }
+      iStatus = FT_newContent(pucGathered, ulLength, FT_COPY, NULL,
+                              &oCContents);
+      free(pucGathered);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   else {
+      /* gather the segments straight into the FT's own copy, which
+         has room for all of them, so the writes cannot fail */
+      iStatus = Content_newWritable(NULL, ulLength, &oCContents);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      for(u = 0; u < ulSegments; u++) {
+         iStatus = Content_write(oCContents, ulOffset,
+                                 psSegments[u].pvData,
+                                 psSegments[u].ulLength);
+         assert(iStatus == SUCCESS);
+         ulOffset += psSegments[u].ulLength;
+      }
+   }
+
+   iStatus = FT_insertFileContent(pcPath, oCContents);
+   if(iStatus != SUCCESS) {
+      Content_release(oCContents);
+      return iStatus;
+   }
+
+   if(oJJournal != NULL) {
+      Journal_startRecord(oJJournal, JOURNAL_INSERT_FILE, ++ulJournalSeq,
+                          pcPath, ulLength);
+      for(u = 0; u < ulSegments; u++)
+         Journal_addContents(oJJournal, psSegments[u].pvData,
+                             psSegments[u].ulLength);
+      Journal_endRecord(oJJournal);
+   }
+   return SUCCESS;
+}
+
 boolean FT_containsFile(const char *pcPath) {
    int iStatus;
    Node_T oNFound = NULL;
@@ -468,7 +949,6 @@ boolean FT_containsFile(const char *pcPath) {
 
 int FT_rmFile(const char *pcPath) {
    int iStatus;
-   int freeRet;
    Node_T oNFound = NULL;
 
    
@@ -483,10 +963,14 @@ int FT_rmFile(const char *pcPath) {
    if(Node_isDir(oNFound) == TRUE)
       return NOT_A_FILE;
 
-   freeRet = Node_free(oNFound);
-   ulCount -= freeRet;
-   
-   return SUCCESS;
+   iStatus = FT_reserveJournal(pcPath, NULL, 0);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   iStatus = FT_removeNode(oNFound);
+   if(iStatus == SUCCESS)
+      FT_logJournal(JOURNAL_RM_FILE, pcPath, NULL, 0);
+   return iStatus;
 }
 
 void *FT_getFileContents(const char *pcPath) {
@@ -507,74 +991,2284 @@ void *FT_getFileContents(const char *pcPath) {
 
 void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
                              size_t ulNewLength) {
+   return FT_replaceFileContentsOwned(pcPath, pvNewContents, ulNewLength,
+                                      eOwnership, pfOwnedFree);
+}
+
+void *FT_replaceFileContentsOwned(const char *pcPath,
+                                  void *pvNewContents,
+                                  size_t ulNewLength,
+                                  enum FT_Ownership eMode,
+                                  void (*pfFree)(void *pvContents)) {
    int iStatus;
    Node_T oNFound = NULL;
+   Content_T oCNewContents = NULL;
+   Content_T oCOldContents;
+   void *pvOldContents;
 
    
    assert(pcPath != NULL);
 
    iStatus = FT_findNode(pcPath, &oNFound);
-
-   if(iStatus != SUCCESS || Node_isDir(oNFound) == TRUE)
+   if(iStatus == SUCCESS && Node_isDir(oNFound) == TRUE)
+      iStatus = NOT_A_FILE;
+   if(iStatus == SUCCESS && ulNewLength > Node_getFileSize(oNFound) &&
+      !Node_withinQuotas(Node_getParent(oNFound), 0,
+                         ulNewLength - Node_getFileSize(oNFound)))
+      iStatus = QUOTA_EXCEEDED;
+   if(iStatus == SUCCESS)
+      iStatus = FT_reserveJournal(pcPath, pvNewContents, ulNewLength);
+   if(iStatus == SUCCESS)
+      iStatus = FT_newContent(pvNewContents, ulNewLength, eMode, pfFree,
+                              &oCNewContents);
+   if(iStatus != SUCCESS) {
+      FT_discard(pvNewContents, eMode, pfFree);
       return NULL;
+   }
 
-   return Node_replaceFileContents(oNFound, pvNewContents, ulNewLength);
+   oCOldContents = Node_replaceContents(oNFound, oCNewContents);
+   if(FT_logUndo(UNDO_REPLACE, oNFound, 0, oCOldContents) != SUCCESS) {
+      Content_release(Node_replaceContents(oNFound, oCOldContents));
+      if(FT_isCopied(pvNewContents, ulNewLength, eMode))
+         FT_discard(pvNewContents, eMode, pfFree);
+      return NULL;
+   }
+   FT_logJournal(JOURNAL_REPLACE, pcPath, pvNewContents, ulNewLength);
+   if(FT_isCopied(pvNewContents, ulNewLength, eMode))
+      FT_discard(pvNewContents, eMode, pfFree);
+
+   /* taken contents and copies belong to the FT, so only borrowed
+      contents go back to the caller; an open transaction keeps its
+      reference */
+   pvOldContents = Content_isOwned(oCOldContents) ? NULL
+      : Content_getData(oCOldContents);
+   if(oDUndoLog == NULL)
+      Content_release(oCOldContents);
+   return pvOldContents;
 }
 
-int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
-
+/*
+  Makes the contents of the file oNFile writable in place, replacing
+  them with a private copy if they are borrowed, shared, compressed,
+  or otherwise not writable, and logging the replacement for undo.
+  Returns SUCCESS and sets *poCResult to the writable contents, or
+  returns MEMORY_ERROR.
+*/
+static int FT_makeWritable(Node_T oNFile, Content_T *poCResult) {
+   Content_T oCOld;
+   Content_T oCNew;
    int iStatus;
-   Node_T oNFound = NULL;
 
-   
-   assert(pbIsFile != NULL);
-   assert(pulSize != NULL);
+   assert(oNFile != NULL);
+   assert(poCResult != NULL);
 
-   iStatus = FT_findNode(pcPath, &oNFound);
+   oCOld = Node_getContents(oNFile);
+   if(Content_isWritable(oCOld)) {
+      *poCResult = oCOld;
+      return SUCCESS;
+   }
 
-   if(iStatus != SUCCESS){
-      oNFound = NULL;
+   iStatus = Content_newWritable(oCOld, 0, &oCNew);
+   if(iStatus != SUCCESS)
       return iStatus;
-   }
 
-   if(Node_isDir(oNFound) == TRUE)
-      *pbIsFile = FALSE;
-   else {
-      *pbIsFile = TRUE;
-      *pulSize = Node_getFileSize(oNFound);
+   (void) Node_replaceContents(oNFile, oCNew);
+   iStatus = FT_logUndo(UNDO_REPLACE, oNFile, 0, oCOld);
+   if(iStatus != SUCCESS) {
+      Content_release(Node_replaceContents(oNFile, oCOld));
+      return iStatus;
    }
+   if(oDUndoLog == NULL)
+      Content_release(oCOld);
+
+   *poCResult = oCNew;
    return SUCCESS;
 }
 
-   
+/*
+  Reverts a write to the contents of the file oNFile at offset
+  ulOffset that grew them from ulOldLength bytes and overwrote the
+  ulSaved bytes pvSaved, without allocating.
+*/
+static void FT_revertWrite(Node_T oNFile, size_t ulOffset,
+                           size_t ulOldLength, const void *pvSaved,
+                           size_t ulSaved) {
+   Content_T oCContents;
+   int iStatus;
 
-int FT_init(void) {
+   assert(oNFile != NULL);
+
+   oCContents = Node_getContents(oNFile);
+   Content_truncate(oCContents, ulOldLength);
+   iStatus = Content_write(oCContents, ulOffset, pvSaved, ulSaved);
+   assert(iStatus == SUCCESS);
+   Node_updateSize(oNFile);
+}
+
+/*
+  Implements FT_writeFile and, if bAppend is TRUE, FT_appendFile,
+  which ignores ulOffset.
+*/
+static int FT_writeRange(const char *pcPath, size_t ulOffset,
+                         const void *pvData, size_t ulLength,
+                         boolean bAppend) {
+   Node_T oNFound = NULL;
+   Content_T oCContents;
+   struct undo *psUndo;
+   void *pvSaved = NULL;
+   size_t ulOldLength;
+   size_t ulSaved = 0;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(pvData != NULL || ulLength == 0);
+
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(Node_isDir(oNFound))
+      return NOT_A_FILE;
+
+   if(ulLength > (size_t) -1 - OFFSET_SIZE)
+      return MEMORY_ERROR;
+
+   ulOldLength = Node_getFileSize(oNFound);
+   if(bAppend)
+      ulOffset = ulOldLength;
+   if(ulOffset <= (size_t) -1 - ulLength &&
+      ulOffset + ulLength > ulOldLength &&
+      !Node_withinQuotas(Node_getParent(oNFound), 0,
+                         ulOffset + ulLength - ulOldLength))
+      return QUOTA_EXCEEDED;
+   /* the record's contents, which start with the offset, are never
+      NULL even when pvData is */
+   iStatus = FT_reserveJournal(pcPath, "", OFFSET_SIZE + ulLength);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   iStatus = FT_makeWritable(oNFound, &oCContents);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* a transaction keeps the bytes about to be overwritten */
+   if(oDUndoLog != NULL && ulOffset < ulOldLength) {
+      ulSaved = (ulLength < ulOldLength - ulOffset) ? ulLength
+         : ulOldLength - ulOffset;
+      pvSaved = malloc(ulSaved);
+      if(pvSaved == NULL)
+         return MEMORY_ERROR;
+      (void) Content_read(oCContents, ulOffset, pvSaved, ulSaved,
+                          &ulSaved);
+   }
+
+   iStatus = Content_write(oCContents, ulOffset, pvData, ulLength);
+   if(iStatus != SUCCESS) {
+      free(pvSaved);
+      return iStatus;
+   }
+   Node_updateSize(oNFound);
+
+   iStatus = FT_logUndo(UNDO_WRITE, oNFound, 0, NULL);
+   if(iStatus != SUCCESS) {
+      FT_revertWrite(oNFound, ulOffset, ulOldLength, pvSaved,
+                     ulSaved);
+      free(pvSaved);
+      return iStatus;
+   }
+   if(oDUndoLog != NULL) {
+      psUndo = DynArray_get(oDUndoLog, DynArray_getLength(oDUndoLog) - 1);
+      psUndo->ulOffset = ulOffset;
+      psUndo->ulOldLength = ulOldLength;
+      psUndo->pvSaved = pvSaved;
+      psUndo->ulSaved = ulSaved;
+   }
+
+   FT_logWrite(pcPath, ulOffset, pvData, ulLength);
+   return SUCCESS;
+}
+
+int FT_readFile(const char *pcPath, size_t ulOffset, void *pvBuffer,
+                size_t ulLength, size_t *pulRead) {
+   Node_T oNFound = NULL;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(pvBuffer != NULL || ulLength == 0);
+   assert(pulRead != NULL);
+
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(Node_isDir(oNFound))
+      return NOT_A_FILE;
+
+   return Content_read(Node_getContents(oNFound), ulOffset, pvBuffer,
+                       ulLength, pulRead);
+}
+
+int FT_readFileV(const char *pcPath, size_t ulOffset,
+                 const struct FT_Segment *psSegments, size_t ulSegments,
+                 size_t *pulRead) {
+   Node_T oNFound = NULL;
+   Content_T oCContents;
+   size_t ulRead;
+   size_t u;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(psSegments != NULL || ulSegments == 0);
+   assert(pulRead != NULL);
+
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(Node_isDir(oNFound))
+      return NOT_A_FILE;
+
+   /* scatter straight from the contents into each segment in turn */
+   oCContents = Node_getContents(oNFound);
+   *pulRead = 0;
+   for(u = 0; u < ulSegments; u++) {
+      iStatus = Content_read(oCContents, ulOffset + *pulRead,
+                             psSegments[u].pvData,
+                             psSegments[u].ulLength, &ulRead);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      *pulRead += ulRead;
+      if(ulRead < psSegments[u].ulLength)
+         break;
+   }
+   return SUCCESS;
+}
+
+int FT_pin(const char *pcPath, FT_Contents_T *poCResult) {
+   Node_T oNFound = NULL;
+   Content_T oCContents;
+   void *pvData;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(poCResult != NULL);
+
+   *poCResult = NULL;
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(Node_isDir(oNFound))
+      return NOT_A_FILE;
+
+   /* aborting the transaction would rewrite these in place, so the
+      pin is taken on a copy instead */
+   oCContents = Node_getContents(oNFound);
+   if(oDUndoLog != NULL && Content_isWritable(oCContents)) {
+      pvData = Content_getData(oCContents);
+      if(pvData == NULL)
+         return MEMORY_ERROR;
+      iStatus = Content_copy(pvData, Content_getLength(oCContents),
+                             &oCContents);
+      if(iStatus != SUCCESS)
+         return iStatus;
+      iStatus = Content_pin(oCContents);
+      Content_release(oCContents);
+   }
+   else
+      iStatus = Content_pin(oCContents);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   *poCResult = oCContents;
+   return SUCCESS;
+}
+
+void *FT_getPinnedData(FT_Contents_T oCContents) {
+   assert(oCContents != NULL);
+
+   return Content_getData(oCContents);
+}
+
+size_t FT_getPinnedLength(FT_Contents_T oCContents) {
+   assert(oCContents != NULL);
+
+   return Content_getLength(oCContents);
+}
+
+void FT_unpin(FT_Contents_T oCContents) {
+   assert(oCContents != NULL);
+
+   Content_unpin(oCContents);
+}
+
+int FT_writeFile(const char *pcPath, size_t ulOffset,
+                 const void *pvData, size_t ulLength) {
+   return FT_writeRange(pcPath, ulOffset, pvData, ulLength, FALSE);
+}
+
+int FT_appendFile(const char *pcPath, const void *pvData,
+                  size_t ulLength) {
+   return FT_writeRange(pcPath, 0, pvData, ulLength, TRUE);
+}
+
+int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
+
+   int iStatus;
+   Node_T oNFound = NULL;
+
+   
+   assert(pbIsFile != NULL);
+   assert(pulSize != NULL);
+
+   iStatus = FT_findNode(pcPath, &oNFound);
+
+   if(iStatus != SUCCESS){
+      oNFound = NULL;
+      return iStatus;
+   }
+
+   if(Node_isDir(oNFound) == TRUE)
+      *pbIsFile = FALSE;
+   else {
+      *pbIsFile = TRUE;
+      *pulSize = Node_getFileSize(oNFound);
+   }
+   return SUCCESS;
+}
+
+int FT_setQuota(const char *pcPath, size_t ulMaxNodes,
+                size_t ulMaxBytes) {
+   Node_T oNFound = NULL;
+   int iStatus;
+
+   assert(pcPath != NULL);
+
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(!Node_isDir(oNFound))
+      return NOT_A_DIRECTORY;
+
+   Node_setQuota(oNFound, ulMaxNodes, ulMaxBytes);
+   return SUCCESS;
+}
+
+int FT_getQuota(const char *pcPath, size_t *pulMaxNodes,
+                size_t *pulMaxBytes) {
+   Node_T oNFound = NULL;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(pulMaxNodes != NULL);
+   assert(pulMaxBytes != NULL);
+
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(!Node_isDir(oNFound))
+      return NOT_A_DIRECTORY;
+
+   Node_getQuota(oNFound, pulMaxNodes, pulMaxBytes);
+   return SUCCESS;
+}
+
+int FT_statSubtree(const char *pcPath, struct FT_SubtreeStats *psStats) {
+   Node_T oNFound = NULL;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(psStats != NULL);
+
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   Node_getTotals(oNFound, &psStats->ulDirs, &psStats->ulFiles,
+                  &psStats->ulBytes);
+   if(Node_isDir(oNFound))
+      psStats->ulDirs++;
+   else
+      psStats->ulFiles++;
+   return SUCCESS;
+}
+
+   
+
+int FT_statEx(const char *pcPath, struct FT_StatEx *psStat) {
+   Node_T oNFound = NULL;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(psStat != NULL);
+
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   psStat->bIsFile = (boolean) !Node_isDir(oNFound);
+   psStat->ulSize = Node_getFileSize(oNFound);
+   psStat->ulDirChildren = Node_getNumDirChildren(oNFound);
+   psStat->ulFileChildren = Node_getNumFileChildren(oNFound);
+   psStat->ulDepth = Path_getDepth(Node_getPath(oNFound));
+   Node_getTotals(oNFound, &psStat->sSubtree.ulDirs,
+                  &psStat->sSubtree.ulFiles, &psStat->sSubtree.ulBytes);
+   if(psStat->bIsFile)
+      psStat->sSubtree.ulFiles++;
+   else
+      psStat->sSubtree.ulDirs++;
+   return SUCCESS;
+}
+
+/*
+  Compares the paths that pvFirst and pvSecond each point to, as
+  strcmp would.
+*/
+static int FT_comparePathRefs(const void *pvFirst, const void *pvSecond) {
+   assert(pvFirst != NULL);
+   assert(pvSecond != NULL);
+
+   return strcmp(*(const char *const *) pvFirst,
+                 *(const char *const *) pvSecond);
+}
+
+/*
+  Fills *psResult with what FT_stat would report for pcPath, starting
+  the walk from the deepest ancestor of *poNLast (or from the root, if
+  *poNLast is NULL) that leads pcPath, and then sets *poNLast to the
+  deepest node the walk reached.
+*/
+static void FT_statFrom(const char *pcPath, Node_T *poNLast,
+                        struct FT_StatResult *psResult) {
+   Node_T oNStart;
+   Node_T oNFound;
+   const char *pcStart;
+   size_t ulCommon;
+   size_t ulLength;
+
+   assert(pcPath != NULL);
+   assert(poNLast != NULL);
+   assert(psResult != NULL);
+
+   psResult->iStatus = FT_checkPath(pcPath);
+   if(psResult->iStatus == SUCCESS)
+      psResult->iStatus = FT_checkRoot(pcPath);
+   if(psResult->iStatus != SUCCESS)
+      return;
+
+   oNStart = oNRoot;
+   if(*poNLast != NULL) {
+      /* climb to the deepest ancestor whose path leads pcPath too */
+      pcStart = Path_getPathname(Node_getPath(*poNLast));
+      for(ulCommon = 0; pcStart[ulCommon] != '\0' &&
+             pcStart[ulCommon] == pcPath[ulCommon]; ulCommon++)
+         ;
+      oNStart = *poNLast;
+      for(;;) {
+         ulLength = Path_getStrLength(Node_getPath(oNStart));
+         if(ulLength < ulCommon ||
+            (ulLength == ulCommon && (pcPath[ulLength] == '/' ||
+                                      pcPath[ulLength] == '\0')))
+            break;
+         oNStart = Node_getParent(oNStart);
+      }
+   }
+
+   oNFound = FT_descend(oNStart, pcPath, poNLast);
+   if(oNFound == NULL) {
+      psResult->iStatus = NO_SUCH_PATH;
+      return;
+   }
+   psResult->bIsFile = (boolean) !Node_isDir(oNFound);
+   psResult->ulSize = Node_getFileSize(oNFound);
+}
+
+int FT_statMany(const char *const apcPaths[], size_t ulCount,
+                struct FT_StatResult psResults[]) {
+   DynArray_T oDOrder;
+   const char *const *ppcPath;
+   Node_T oNLast = NULL;
+   size_t ulIndex;
+
+   assert(apcPaths != NULL || ulCount == 0);
+   assert(psResults != NULL || ulCount == 0);
+
+   if(!bIsInitialized) {
+      for(ulIndex = 0; ulIndex < ulCount; ulIndex++)
+         psResults[ulIndex].iStatus = INITIALIZATION_ERROR;
+      return INITIALIZATION_ERROR;
+   }
+
+   /* without the memory to sort, visit the paths in the given order */
+   oDOrder = DynArray_new(ulCount);
+   if(oDOrder == NULL) {
+      for(ulIndex = 0; ulIndex < ulCount; ulIndex++)
+         FT_statFrom(apcPaths[ulIndex], &oNLast, &psResults[ulIndex]);
+      return SUCCESS;
+   }
+
+   for(ulIndex = 0; ulIndex < ulCount; ulIndex++)
+      (void) DynArray_set(oDOrder, ulIndex, &apcPaths[ulIndex]);
+   DynArray_sort(oDOrder, FT_comparePathRefs);
+   for(ulIndex = 0; ulIndex < ulCount; ulIndex++) {
+      ppcPath = DynArray_get(oDOrder, ulIndex);
+      FT_statFrom(*ppcPath, &oNLast,
+                  &psResults[ppcPath - apcPaths]);
+   }
+   DynArray_free(oDOrder);
+   return SUCCESS;
+}
+
+int FT_readdir(const char *pcPath, boolean bAfterFile,
+               const char *pcAfter, struct FT_DirEntry psEntries[],
+               size_t ulMax, size_t *pulCount) {
+   Node_T oNFound = NULL;
+   Node_T oNChild;
+   boolean bIsDir;
+   size_t ulIndex;
+   size_t ulEnd;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(psEntries != NULL || ulMax == 0);
+   assert(pulCount != NULL);
+
+   *pulCount = 0;
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(!Node_isDir(oNFound))
+      return NOT_A_DIRECTORY;
+
+   /* files first, unless the listing already resumes among the
+      directories */
+   bIsDir = (boolean) (pcAfter != NULL && !bAfterFile);
+   ulIndex = (pcAfter == NULL) ? 0 :
+      Node_findChildAfter(oNFound, bIsDir, pcAfter);
+   for(;;) {
+      ulEnd = bIsDir ? Node_getNumDirChildren(oNFound) :
+         Node_getNumFileChildren(oNFound);
+      for(; ulIndex < ulEnd && *pulCount < ulMax; ulIndex++) {
+         (void) Node_getChild(bIsDir, oNFound, ulIndex, &oNChild);
+         psEntries[*pulCount].pcPath =
+            Path_getPathname(Node_getPath(oNChild));
+         psEntries[*pulCount].bIsFile = (boolean) !bIsDir;
+         psEntries[*pulCount].ulSize = Node_getFileSize(oNChild);
+         (*pulCount)++;
+      }
+      if(bIsDir || *pulCount == ulMax)
+         break;
+      bIsDir = TRUE;
+      ulIndex = 0;
+   }
+   return SUCCESS;
+}
+
+/*
+  Calls (*pfVisit)(psEntry, pvExtra) with an entry describing oNNode
+  and returns what it returns.
+*/
+static enum FT_WalkAction FT_visit(Node_T oNNode,
+   enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry *psEntry,
+                                 void *pvExtra),
+   void *pvExtra) {
+   struct FT_DirEntry sEntry;
+
+   assert(oNNode != NULL);
+   assert(pfVisit != NULL);
+
+   sEntry.pcPath = Path_getPathname(Node_getPath(oNNode));
+   sEntry.bIsFile = (boolean) !Node_isDir(oNNode);
+   sEntry.ulSize = Node_getFileSize(oNNode);
+   return (*pfVisit)(&sEntry, pvExtra);
+}
+
+/*
+  Visits oNNode and then, unless told to skip them, its file and
+  directory children in turn, as FT_walk does. Returns FT_WALK_STOP if
+  the visitor stopped the walk, or FT_WALK_CONTINUE otherwise.
+*/
+static enum FT_WalkAction FT_walkFrom(Node_T oNNode,
+   enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry *psEntry,
+                                 void *pvExtra),
+   void *pvExtra) {
+   enum FT_WalkAction eAction;
+   Node_T oNChild = NULL;
+   size_t c;
+
+   assert(oNNode != NULL);
+   assert(pfVisit != NULL);
+
+   eAction = FT_visit(oNNode, pfVisit, pvExtra);
+   if(eAction != FT_WALK_CONTINUE || !Node_isDir(oNNode))
+      return (eAction == FT_WALK_STOP) ? FT_WALK_STOP : FT_WALK_CONTINUE;
+
+   for(c = 0; c < Node_getNumFileChildren(oNNode); c++) {
+      (void) Node_getChild(FALSE, oNNode, c, &oNChild);
+      if(FT_walkFrom(oNChild, pfVisit, pvExtra) == FT_WALK_STOP)
+         return FT_WALK_STOP;
+   }
+   for(c = 0; c < Node_getNumDirChildren(oNNode); c++) {
+      (void) Node_getChild(TRUE, oNNode, c, &oNChild);
+      if(FT_walkFrom(oNChild, pfVisit, pvExtra) == FT_WALK_STOP)
+         return FT_WALK_STOP;
+   }
+   return FT_WALK_CONTINUE;
+}
+
+int FT_walk(const char *pcPath,
+            enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry
+                                          *psEntry, void *pvExtra),
+            void *pvExtra) {
+   Node_T oNFound = NULL;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(pfVisit != NULL);
+
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   (void) FT_walkFrom(oNFound, pfVisit, pvExtra);
+   return SUCCESS;
+}
+
+/* The state of an FT_glob search */
+struct FT_GlobState
+{
+   /* the visitor matches are reported to, and what to pass it */
+   enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry *psEntry,
+                                 void *pvExtra);
+   void *pvExtra;
+   /* the components of the pattern, and how many there are */
+   const char **ppcComps;
+   size_t ulComps;
+   /* for each depth of the search, ulComps + 1 flags marking the
+      components a node at that depth is next to match, the last
+      meaning that the whole pattern has matched; and how many depths
+      there is room for */
+   unsigned char *pucSets;
+   size_t ulDepths;
+   /* MEMORY_ERROR if the sets could not grow, or SUCCESS */
+   int iStatus;
+};
+
+/*
+  Returns TRUE if the pattern component pcComp is "**".
+*/
+static boolean FT_isGlobstar(const char *pcComp) {
+   assert(pcComp != NULL);
+
+   return (boolean) (pcComp[0] == '*' && pcComp[1] == '*' &&
+                     (pcComp[2] == '/' || pcComp[2] == '\0'));
+}
+
+/*
+  Returns the start of the pattern component after the one at pcComp,
+  or the end of the pattern if it is the last.
+*/
+static const char *FT_nextComponent(const char *pcComp) {
+   assert(pcComp != NULL);
+
+   while(*pcComp != '/' && *pcComp != '\0')
+      pcComp++;
+   return (*pcComp == '/') ? pcComp + 1 : pcComp;
+}
+
+/*
+  Returns the number of characters in the pattern component at pcComp.
+*/
+static size_t FT_componentLength(const char *pcComp) {
+   const char *pcEnd;
+
+   assert(pcComp != NULL);
+
+   for(pcEnd = pcComp; *pcEnd != '/' && *pcEnd != '\0'; pcEnd++)
+      ;
+   return (size_t) (pcEnd - pcComp);
+}
+
+/*
+  Returns TRUE if the name pcName matches the ulLength characters of
+  the pattern component at pcComp, in which '*' matches any run of
+  characters and '?' any one.
+*/
+static boolean FT_matchName(const char *pcComp, size_t ulLength,
+                            const char *pcName) {
+   const char *pcMark = NULL;
+   size_t ulComp = 0;
+   size_t ulStar = 0;
+
+   assert(pcComp != NULL);
+   assert(pcName != NULL);
+
+   /* on a mismatch, let the last '*' seen swallow one more character */
+   while(*pcName != '\0') {
+      if(ulComp < ulLength &&
+         (pcComp[ulComp] == '?' || pcComp[ulComp] == *pcName)) {
+         ulComp++;
+         pcName++;
+      }
+      else if(ulComp < ulLength && pcComp[ulComp] == '*') {
+         ulStar = ulComp++;
+         pcMark = pcName;
+      }
+      else if(pcMark != NULL) {
+         ulComp = ulStar + 1;
+         pcName = ++pcMark;
+      }
+      else
+         return FALSE;
+   }
+   while(ulComp < ulLength && pcComp[ulComp] == '*')
+      ulComp++;
+   return (boolean) (ulComp == ulLength);
+}
+
+/*
+  Flags in pucSet, whose other flags are already set, each component
+  that a "**" before it lets a node match without consuming one.
+*/
+static void FT_globClose(const struct FT_GlobState *psState,
+                         unsigned char *pucSet) {
+   size_t p;
+
+   assert(psState != NULL);
+   assert(pucSet != NULL);
+
+   for(p = 0; p < psState->ulComps; p++)
+      if(pucSet[p] && FT_isGlobstar(psState->ppcComps[p]))
+         pucSet[p + 1] = 1;
+}
+
+/*
+  Sets the flags at pucTo to mark what a node named pcName is next to
+  match, given that its parent was next to match what pucFrom marks:
+  a "**" matches it and still applies below it, and any other
+  component it matches is followed by the next. Returns TRUE if some
+  component remains to be matched below it, or FALSE if the search
+  need not go further down.
+*/
+static boolean FT_globStep(const struct FT_GlobState *psState,
+                           const unsigned char *pucFrom,
+                           const char *pcName, unsigned char *pucTo) {
+   const char *pcComp;
+   boolean bDeeper = FALSE;
+   size_t p;
+
+   assert(psState != NULL);
+   assert(pucFrom != NULL);
+   assert(pcName != NULL);
+   assert(pucTo != NULL);
+
+   memset(pucTo, 0, psState->ulComps + 1);
+   for(p = 0; p < psState->ulComps; p++) {
+      if(!pucFrom[p])
+         continue;
+      pcComp = psState->ppcComps[p];
+      if(FT_isGlobstar(pcComp))
+         pucTo[p] = 1;
+      else if(FT_matchName(pcComp, FT_componentLength(pcComp), pcName))
+         pucTo[p + 1] = 1;
+   }
+   FT_globClose(psState, pucTo);
+
+   for(p = 0; p < psState->ulComps; p++)
+      if(pucTo[p])
+         bDeeper = TRUE;
+   return bDeeper;
+}
+
+/*
+  Continues a search below the directory oNParent, which sits at
+  depth ulDepth of it and whose flags there mark what its children are
+  next to match, visiting the matching nodes in the order FT_toString
+  lists them. When only one component without "**" remains, children
+  are scanned only from the first whose name begins with its
+  characters before any '*' or '?'. Returns FT_WALK_STOP if the
+  visitor stopped the search or the flags for the next depth could
+  not be allocated, or FT_WALK_CONTINUE otherwise.
+*/
+static enum FT_WalkAction FT_globBelow(Node_T oNParent, size_t ulDepth,
+                                       struct FT_GlobState *psState) {
+   size_t ulWidth;
+   unsigned char *pucFrom;
+   unsigned char *pucNew;
+   const char *pcComp = NULL;
+   const char *pcName;
+   Node_T oNChild = NULL;
+   size_t ulLength = 0;
+   size_t ulLiteral = 0;
+   size_t ulSkip;
+   size_t ulIndex;
+   size_t ulEnd;
+   size_t p;
+   boolean bDeeper;
+   boolean bIsDir;
+   int iKind = 0;
+
+   assert(oNParent != NULL);
+   assert(psState != NULL);
+
+   ulWidth = psState->ulComps + 1;
+   if(ulDepth + 2 > psState->ulDepths) {
+      pucNew = realloc(psState->pucSets,
+                       psState->ulDepths * 2 * ulWidth);
+      if(pucNew == NULL) {
+         psState->iStatus = MEMORY_ERROR;
+         return FT_WALK_STOP;
+      }
+      psState->pucSets = pucNew;
+      psState->ulDepths *= 2;
+   }
+
+   /* a lone plain component can be sought by its leading literal, and
+      only a directory can match it if it is not the last */
+   pucFrom = psState->pucSets + ulDepth * ulWidth;
+   for(p = 0; p < psState->ulComps; p++)
+      if(pucFrom[p]) {
+         if(pcComp != NULL || FT_isGlobstar(psState->ppcComps[p])) {
+            pcComp = NULL;
+            break;
+         }
+         pcComp = psState->ppcComps[p];
+         iKind = (p + 1 < psState->ulComps);
+      }
+   if(pcComp != NULL) {
+      ulLength = FT_componentLength(pcComp);
+      for(ulLiteral = 0; ulLiteral < ulLength &&
+             pcComp[ulLiteral] != '*' && pcComp[ulLiteral] != '?';
+          ulLiteral++)
+         ;
+   }
+   else
+      iKind = 0;
+   ulSkip = Path_getStrLength(Node_getPath(oNParent)) + 1;
+
+   for(; iKind < 2; iKind++) {
+      bIsDir = (boolean) iKind;
+      ulEnd = bIsDir ? Node_getNumDirChildren(oNParent) :
+         Node_getNumFileChildren(oNParent);
+      ulIndex = (pcComp == NULL) ? 0 :
+         Node_seekChildName(oNParent, bIsDir, pcComp, ulLiteral);
+      for(; ulIndex < ulEnd; ulIndex++) {
+         (void) Node_getChild(bIsDir, oNParent, ulIndex, &oNChild);
+         pcName = Path_getPathname(Node_getPath(oNChild)) + ulSkip;
+         if(pcComp != NULL &&
+            (strncmp(pcName, pcComp, ulLiteral) != 0 ||
+             (ulLiteral == ulLength && pcName[ulLength] != '\0')))
+            break;
+         /* searching below a child may have moved the flags */
+         pucFrom = psState->pucSets + ulDepth * ulWidth;
+         bDeeper = FT_globStep(psState, pucFrom, pcName,
+                               pucFrom + ulWidth);
+         if(pucFrom[ulWidth + psState->ulComps] &&
+            FT_visit(oNChild, psState->pfVisit, psState->pvExtra) ==
+            FT_WALK_STOP)
+            return FT_WALK_STOP;
+         if(bIsDir && bDeeper &&
+            FT_globBelow(oNChild, ulDepth + 1, psState) == FT_WALK_STOP)
+            return FT_WALK_STOP;
+      }
+   }
+   return FT_WALK_CONTINUE;
+}
+
+int FT_glob(const char *pcPattern,
+            enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry
+                                          *psEntry, void *pvExtra),
+            void *pvExtra) {
+   struct FT_GlobState sState;
+   const char *pcComp;
+   size_t ulWidth;
+   boolean bDeeper;
+
+   assert(pcPattern != NULL);
+   assert(pfVisit != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   sState.iStatus = FT_checkPath(pcPattern);
+   if(sState.iStatus != SUCCESS)
+      return sState.iStatus;
+   if(oNRoot == NULL)
+      return SUCCESS;
+
+   sState.pfVisit = pfVisit;
+   sState.pvExtra = pvExtra;
+   sState.ulComps = 0;
+   for(pcComp = pcPattern; *pcComp != '\0';
+       pcComp = FT_nextComponent(pcComp))
+      sState.ulComps++;
+   ulWidth = sState.ulComps + 1;
+   sState.ulDepths = 8;
+   sState.ppcComps = malloc(sState.ulComps * sizeof(const char *));
+   sState.pucSets = malloc(sState.ulDepths * ulWidth);
+   if(sState.ppcComps == NULL || sState.pucSets == NULL) {
+      free(sState.ppcComps);
+      free(sState.pucSets);
+      return MEMORY_ERROR;
+   }
+   sState.ulComps = 0;
+   for(pcComp = pcPattern; *pcComp != '\0';
+       pcComp = FT_nextComponent(pcComp))
+      sState.ppcComps[sState.ulComps++] = pcComp;
+
+   /* the root is matched against the first component, or against
+      those a leading "**" lets it reach */
+   memset(sState.pucSets, 0, ulWidth);
+   sState.pucSets[0] = 1;
+   FT_globClose(&sState, sState.pucSets);
+   bDeeper = FT_globStep(&sState, sState.pucSets,
+                         Path_getPathname(Node_getPath(oNRoot)),
+                         sState.pucSets + ulWidth);
+   if((!sState.pucSets[ulWidth + sState.ulComps] ||
+       FT_visit(oNRoot, pfVisit, pvExtra) != FT_WALK_STOP) &&
+      bDeeper && Node_isDir(oNRoot))
+      (void) FT_globBelow(oNRoot, 1, &sState);
+
+   free(sState.ppcComps);
+   free(sState.pucSets);
+   return sState.iStatus;
+}
+
+/* The bounds of an FT_scanRange and the visitor it reports to */
+struct FT_ScanState
+{
+   const char *pcLow;
+   /* NULL if the range has no upper bound */
+   const char *pcHigh;
+   enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry *psEntry,
+                                 void *pvExtra);
+   void *pvExtra;
+};
+
+/*
+  Visits oNNode if its path is in psState's range, and then, unless
+  told to skip them, those nodes below it that are, as FT_scanRange
+  does. Returns FT_WALK_STOP if the visitor stopped the scan, or
+  FT_WALK_CONTINUE otherwise.
+*/
+static enum FT_WalkAction FT_scanFrom(Node_T oNNode,
+                                      struct FT_ScanState *psState) {
+   const char *pcPath = Path_getPathname(Node_getPath(oNNode));
+   const char *pcLowName = "";
+   Node_T oNChild = NULL;
+   enum FT_WalkAction eAction = FT_WALK_CONTINUE;
+   size_t ulPathLength;
+   size_t ulLowLength = 0;
+   size_t ulPrefix;
+   size_t ulIndex;
+   size_t ulEnd;
+   boolean bIsDir;
+   int iKind;
+   int iCompare;
+
+   assert(oNNode != NULL);
+   assert(psState != NULL);
+
+   if(strcmp(psState->pcLow, pcPath) <= 0 &&
+      (psState->pcHigh == NULL || strcmp(pcPath, psState->pcHigh) < 0))
+      eAction = FT_visit(oNNode, psState->pfVisit, psState->pvExtra);
+   if(eAction != FT_WALK_CONTINUE || !Node_isDir(oNNode))
+      return (eAction == FT_WALK_STOP) ? FT_WALK_STOP : FT_WALK_CONTINUE;
+
+   /* every path below oNNode begins with its path and a '/'; if the
+      low bound does too, only the children named from its next
+      component on, or named by a prefix of it, can lead into range */
+   ulPathLength = strlen(pcPath);
+   iCompare = strncmp(psState->pcLow, pcPath, ulPathLength);
+   if(iCompare > 0 ||
+      (iCompare == 0 && (unsigned char) psState->pcLow[ulPathLength] >
+       (unsigned char) '/'))
+      return FT_WALK_CONTINUE;
+   if(iCompare == 0 && psState->pcLow[ulPathLength] == '/') {
+      pcLowName = psState->pcLow + ulPathLength + 1;
+      while(pcLowName[ulLowLength] != '/' &&
+            pcLowName[ulLowLength] != '\0')
+         ulLowLength++;
+   }
+
+   for(iKind = 0; iKind < 2; iKind++) {
+      bIsDir = (boolean) iKind;
+      for(ulPrefix = 1; bIsDir && ulPrefix < ulLowLength; ulPrefix++) {
+         ulIndex = Node_seekChildName(oNNode, TRUE, pcLowName, ulPrefix);
+         if(ulIndex == Node_getNumDirChildren(oNNode))
+            continue;
+         (void) Node_getChild(TRUE, oNNode, ulIndex, &oNChild);
+         if(strncmp(Path_getPathname(Node_getPath(oNChild)) +
+                    ulPathLength + 1, pcLowName, ulPrefix) == 0 &&
+            Path_getStrLength(Node_getPath(oNChild)) ==
+            ulPathLength + 1 + ulPrefix &&
+            FT_scanFrom(oNChild, psState) == FT_WALK_STOP)
+            return FT_WALK_STOP;
+      }
+
+      ulEnd = bIsDir ? Node_getNumDirChildren(oNNode) :
+         Node_getNumFileChildren(oNNode);
+      ulIndex = Node_seekChildName(oNNode, bIsDir, pcLowName, ulLowLength);
+      for(; ulIndex < ulEnd; ulIndex++) {
+         (void) Node_getChild(bIsDir, oNNode, ulIndex, &oNChild);
+         if(psState->pcHigh != NULL &&
+            strcmp(Path_getPathname(Node_getPath(oNChild)),
+                   psState->pcHigh) >= 0)
+            break;
+         if(FT_scanFrom(oNChild, psState) == FT_WALK_STOP)
+            return FT_WALK_STOP;
+      }
+   }
+   return FT_WALK_CONTINUE;
+}
+
+int FT_scanRange(const char *pcLow, const char *pcHigh,
+                 enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry
+                                               *psEntry, void *pvExtra),
+                 void *pvExtra) {
+   struct FT_ScanState sState;
+
+   assert(pcLow != NULL);
+   assert(pfVisit != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(oNRoot == NULL)
+      return SUCCESS;
+
+   sState.pcLow = pcLow;
+   sState.pcHigh = pcHigh;
+   sState.pfVisit = pfVisit;
+   sState.pvExtra = pvExtra;
+   (void) FT_scanFrom(oNRoot, &sState);
+   return SUCCESS;
+}
+
+int FT_setNameIndex(boolean bEnable) {
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   return Node_setIndex(NODE_NAME_INDEX, bEnable, oNRoot);
+}
+
+/* The name FT_findByName seeks, and the visitor it reports to */
+struct FT_NameSearch
+{
+   const char *pcName;
+   enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry *psEntry,
+                                 void *pvExtra);
+   void *pvExtra;
+};
+
+/*
+  An FT_walk visitor that passes psEntry on to the visitor of the
+  FT_NameSearch pvSearch if its last component is the name sought.
+*/
+static enum FT_WalkAction FT_matchEntryName(const struct FT_DirEntry
+                                            *psEntry, void *pvSearch) {
+   struct FT_NameSearch *psSearch = pvSearch;
+   const char *pcName;
+
+   assert(psEntry != NULL);
+   assert(psSearch != NULL);
+
+   pcName = strrchr(psEntry->pcPath, '/');
+   pcName = (pcName == NULL) ? psEntry->pcPath : pcName + 1;
+   if(strcmp(pcName, psSearch->pcName) != 0)
+      return FT_WALK_CONTINUE;
+   return ((*psSearch->pfVisit)(psEntry, psSearch->pvExtra) ==
+           FT_WALK_STOP) ? FT_WALK_STOP : FT_WALK_CONTINUE;
+}
+
+int FT_findByName(const char *pcName,
+                  enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry
+                                                *psEntry, void *pvExtra),
+                  void *pvExtra) {
+   struct FT_NameSearch sSearch;
+   Node_T oNCurr;
+
+   assert(pcName != NULL);
+   assert(pfVisit != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(*pcName == '\0' || strchr(pcName, '/') != NULL)
+      return BAD_PATH;
+   if(oNRoot == NULL)
+      return SUCCESS;
+
+   if(!Node_hasIndex(NODE_NAME_INDEX)) {
+      sSearch.pcName = pcName;
+      sSearch.pfVisit = pfVisit;
+      sSearch.pvExtra = pvExtra;
+      (void) FT_walkFrom(oNRoot, FT_matchEntryName, &sSearch);
+      return SUCCESS;
+   }
+
+   for(oNCurr = Node_findKeyed(NODE_NAME_INDEX, pcName); oNCurr != NULL;
+       oNCurr = Node_getNextKeyed(NODE_NAME_INDEX, oNCurr))
+      if(FT_visit(oNCurr, pfVisit, pvExtra) == FT_WALK_STOP)
+         break;
+   return SUCCESS;
+}
+
+void FT_getNameIndexStats(struct FT_IndexStats *psStats) {
+   assert(psStats != NULL);
+
+   Node_getIndexStats(NODE_NAME_INDEX, &psStats->ulKeys,
+                      &psStats->ulEntries, &psStats->ulBytes);
+}
+
+int FT_setExtensionIndex(boolean bEnable) {
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   return Node_setIndex(NODE_EXTENSION_INDEX, bEnable, oNRoot);
+}
+
+/* The subtree and extension FT_findByExtension seeks */
+struct FT_ExtensionSearch
+{
+   const char *pcExtension;
+   enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry *psEntry,
+                                 void *pvExtra);
+   void *pvExtra;
+};
+
+/*
+  An FT_walk visitor that passes psEntry on to the visitor of the
+  FT_ExtensionSearch pvSearch if it is a file with the extension
+  sought.
+*/
+static enum FT_WalkAction FT_matchEntryExtension(const struct FT_DirEntry
+                                                 *psEntry,
+                                                 void *pvSearch) {
+   struct FT_ExtensionSearch *psSearch = pvSearch;
+   const char *pcName;
+   const char *pcDot;
+
+   assert(psEntry != NULL);
+   assert(psSearch != NULL);
+
+   if(!psEntry->bIsFile)
+      return FT_WALK_CONTINUE;
+   pcName = strrchr(psEntry->pcPath, '/');
+   pcName = (pcName == NULL) ? psEntry->pcPath : pcName + 1;
+   pcDot = strrchr(pcName, '.');
+   if(pcDot == NULL || pcDot == pcName ||
+      strcmp(pcDot + 1, psSearch->pcExtension) != 0)
+      return FT_WALK_CONTINUE;
+   return ((*psSearch->pfVisit)(psEntry, psSearch->pvExtra) ==
+           FT_WALK_STOP) ? FT_WALK_STOP : FT_WALK_CONTINUE;
+}
+
+int FT_findByExtension(const char *pcPath, const char *pcExtension,
+                       enum FT_WalkAction (*pfVisit)(const struct
+                                                     FT_DirEntry *psEntry,
+                                                     void *pvExtra),
+                       void *pvExtra) {
+   struct FT_ExtensionSearch sSearch;
+   Node_T oNFound = NULL;
+   Node_T oNCurr;
+   const char *pcCandidate;
+   size_t ulLength;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(pcExtension != NULL);
+   assert(pfVisit != NULL);
+
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(*pcExtension == '\0' || strchr(pcExtension, '/') != NULL ||
+      strchr(pcExtension, '.') != NULL)
+      return BAD_PATH;
+
+   if(!Node_hasIndex(NODE_EXTENSION_INDEX)) {
+      sSearch.pcExtension = pcExtension;
+      sSearch.pfVisit = pfVisit;
+      sSearch.pvExtra = pvExtra;
+      (void) FT_walkFrom(oNFound, FT_matchEntryExtension, &sSearch);
+      return SUCCESS;
+   }
+
+   /* a file is in the subtree if the subtree's path leads its own */
+   ulLength = Path_getStrLength(Node_getPath(oNFound));
+   for(oNCurr = Node_findKeyed(NODE_EXTENSION_INDEX, pcExtension);
+       oNCurr != NULL;
+       oNCurr = Node_getNextKeyed(NODE_EXTENSION_INDEX, oNCurr)) {
+      pcCandidate = Path_getPathname(Node_getPath(oNCurr));
+      if(strncmp(pcCandidate, pcPath, ulLength) != 0 ||
+         (pcCandidate[ulLength] != '/' && pcCandidate[ulLength] != '\0'))
+         continue;
+      if(FT_visit(oNCurr, pfVisit, pvExtra) == FT_WALK_STOP)
+         break;
+   }
+   return SUCCESS;
+}
+
+void FT_getExtensionIndexStats(struct FT_IndexStats *psStats) {
+   assert(psStats != NULL);
+
+   Node_getIndexStats(NODE_EXTENSION_INDEX, &psStats->ulKeys,
+                      &psStats->ulEntries, &psStats->ulBytes);
+}
+
+int FT_setContentIndex(boolean bEnable) {
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   return Node_setContentIndex(bEnable, oNRoot);
+}
+
+/* The visitor FT_findContentCandidates reports to */
+struct FT_ContentSearch
+{
+   enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry *psEntry,
+                                 void *pvExtra);
+   void *pvExtra;
+};
+
+/*
+  An FT_walk visitor that passes psEntry on to the visitor of the
+  FT_ContentSearch pvSearch if it is a file.
+*/
+static enum FT_WalkAction FT_matchEntryFile(const struct FT_DirEntry
+                                            *psEntry, void *pvSearch) {
+   struct FT_ContentSearch *psSearch = pvSearch;
+
+   assert(psEntry != NULL);
+   assert(psSearch != NULL);
+
+   if(!psEntry->bIsFile)
+      return FT_WALK_CONTINUE;
+   return ((*psSearch->pfVisit)(psEntry, psSearch->pvExtra) ==
+           FT_WALK_STOP) ? FT_WALK_STOP : FT_WALK_CONTINUE;
+}
+
+/*
+  A content index visitor that passes the file oNNode on to the
+  visitor of the FT_ContentSearch pvSearch. Returns FALSE once that
+  visitor stops the search.
+*/
+static boolean FT_visitCandidate(Node_T oNNode, void *pvSearch) {
+   struct FT_ContentSearch *psSearch = pvSearch;
+
+   assert(oNNode != NULL);
+   assert(psSearch != NULL);
+
+   return (boolean) (FT_visit(oNNode, psSearch->pfVisit,
+                              psSearch->pvExtra) != FT_WALK_STOP);
+}
+
+int FT_findContentCandidates(const char *pcPattern,
+                             enum FT_WalkAction (*pfVisit)(const struct
+                                                           FT_DirEntry
+                                                           *psEntry,
+                                                           void *pvExtra),
+                             void *pvExtra) {
+   struct FT_ContentSearch sSearch;
+
+   assert(pcPattern != NULL);
+   assert(pfVisit != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(oNRoot == NULL)
+      return SUCCESS;
+
+   sSearch.pfVisit = pfVisit;
+   sSearch.pvExtra = pvExtra;
+   if(!Node_hasContentIndex()) {
+      (void) FT_walkFrom(oNRoot, FT_matchEntryFile, &sSearch);
+      return SUCCESS;
+   }
+   return Node_queryContents(pcPattern, FT_visitCandidate, &sSearch);
+}
+
+void FT_getContentIndexStats(struct FT_IndexStats *psStats) {
+   assert(psStats != NULL);
+
+   Node_getContentIndexStats(&psStats->ulKeys, &psStats->ulEntries,
+                             &psStats->ulBytes);
+}
+
+int FT_setSizeIndex(boolean bEnable) {
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   return Node_setSizeIndex(bEnable, oNRoot);
+}
+
+/* The range of lengths FT_findBySize seeks, and its visitor */
+struct FT_SizeSearch
+{
+   size_t ulMin;
+   size_t ulMax;
+   enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry *psEntry,
+                                 void *pvExtra);
+   void *pvExtra;
+};
+
+/*
+  An FT_walk visitor that passes psEntry on to the visitor of the
+  FT_SizeSearch pvSearch if it is a file with a length in range.
+*/
+static enum FT_WalkAction FT_matchEntrySize(const struct FT_DirEntry
+                                            *psEntry, void *pvSearch) {
+   struct FT_SizeSearch *psSearch = pvSearch;
+
+   assert(psEntry != NULL);
+   assert(psSearch != NULL);
+
+   if(!psEntry->bIsFile || psEntry->ulSize < psSearch->ulMin ||
+      psEntry->ulSize > psSearch->ulMax)
+      return FT_WALK_CONTINUE;
+   return ((*psSearch->pfVisit)(psEntry, psSearch->pvExtra) ==
+           FT_WALK_STOP) ? FT_WALK_STOP : FT_WALK_CONTINUE;
+}
+
+int FT_findBySize(size_t ulMin, size_t ulMax,
+                  enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry
+                                                *psEntry, void *pvExtra),
+                  void *pvExtra) {
+   struct FT_SizeSearch sSearch;
+   Node_T oNCurr;
+
+   assert(pfVisit != NULL);
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+   if(oNRoot == NULL || ulMin > ulMax)
+      return SUCCESS;
+
+   if(!Node_hasSizeIndex()) {
+      sSearch.ulMin = ulMin;
+      sSearch.ulMax = ulMax;
+      sSearch.pfVisit = pfVisit;
+      sSearch.pvExtra = pvExtra;
+      (void) FT_walkFrom(oNRoot, FT_matchEntrySize, &sSearch);
+      return SUCCESS;
+   }
+
+   for(oNCurr = Node_findSizeAtLeast(ulMin);
+       oNCurr != NULL && Node_getFileSize(oNCurr) <= ulMax;
+       oNCurr = Node_getNextBySize(oNCurr))
+      if(FT_visit(oNCurr, pfVisit, pvExtra) == FT_WALK_STOP)
+         break;
+   return SUCCESS;
+}
+
+void FT_getSizeIndexStats(struct FT_IndexStats *psStats) {
+   assert(psStats != NULL);
+
+   Node_getSizeIndexStats(&psStats->ulKeys, &psStats->ulEntries,
+                          &psStats->ulBytes);
+}
+
+/*
+  A candidate in FT_topK's search: the value of oNNode itself or, if
+  bSlot, the best value in the subtree of the child in slot ulSlot of
+  oNNode's ranking, which bounds every value that subtree holds and
+  those of the subtrees of the children in the slots below it
+*/
+struct FT_TopCandidate
+{
+   Node_T oNNode;
+   boolean bSlot;
+   size_t ulSlot;
+   size_t ulValue;
+};
+
+/* A binary max-heap of candidates */
+struct FT_TopHeap
+{
+   struct FT_TopCandidate *psItems;
+   size_t ulCount;
+   size_t ulCapacity;
+};
+
+/*
+  Returns TRUE if candidate psFirst belongs above psSecond in the
+  heap: it has the greater value or, on a tie, is a node's own value
+  and so can be reported without opening a subtree.
+*/
+static boolean FT_isAbove(const struct FT_TopCandidate *psFirst,
+                          const struct FT_TopCandidate *psSecond) {
+   assert(psFirst != NULL);
+   assert(psSecond != NULL);
+
+   if(psFirst->ulValue != psSecond->ulValue)
+      return (boolean) (psFirst->ulValue > psSecond->ulValue);
+   return (boolean) (!psFirst->bSlot && psSecond->bSlot);
+}
+
+/*
+  Pushes a copy of the candidate *psCandidate onto psHeap. Returns
+  SUCCESS, or MEMORY_ERROR if the heap could not grow.
+*/
+static int FT_pushCandidate(struct FT_TopHeap *psHeap,
+                            const struct FT_TopCandidate *psCandidate) {
+   struct FT_TopCandidate *psNew;
+   struct FT_TopCandidate sSwap;
+   size_t ulNewCapacity;
+   size_t ulChild;
+   size_t ulParent;
+
+   assert(psHeap != NULL);
+   assert(psCandidate != NULL);
+
+   if(psHeap->ulCount == psHeap->ulCapacity) {
+      ulNewCapacity = (psHeap->ulCapacity == 0) ? 16
+         : 2 * psHeap->ulCapacity;
+      psNew = realloc(psHeap->psItems,
+                      ulNewCapacity * sizeof(struct FT_TopCandidate));
+      if(psNew == NULL)
+         return MEMORY_ERROR;
+      psHeap->psItems = psNew;
+      psHeap->ulCapacity = ulNewCapacity;
+   }
+
+   ulChild = psHeap->ulCount++;
+   psHeap->psItems[ulChild] = *psCandidate;
+   while(ulChild > 0) {
+      ulParent = (ulChild - 1) / 2;
+      if(!FT_isAbove(&psHeap->psItems[ulChild],
+                     &psHeap->psItems[ulParent]))
+         break;
+      sSwap = psHeap->psItems[ulChild];
+      psHeap->psItems[ulChild] = psHeap->psItems[ulParent];
+      psHeap->psItems[ulParent] = sSwap;
+      ulChild = ulParent;
+   }
+   return SUCCESS;
+}
+
+/*
+  Removes the top candidate from the non-empty psHeap into *psTop.
+*/
+static void FT_popCandidate(struct FT_TopHeap *psHeap,
+                            struct FT_TopCandidate *psTop) {
+   struct FT_TopCandidate sSwap;
+   size_t ulParent = 0;
+   size_t ulChild;
+
+   assert(psHeap != NULL);
+   assert(psHeap->ulCount > 0);
+   assert(psTop != NULL);
+
+   *psTop = psHeap->psItems[0];
+   psHeap->psItems[0] = psHeap->psItems[--psHeap->ulCount];
+   for(;;) {
+      ulChild = 2 * ulParent + 1;
+      if(ulChild >= psHeap->ulCount)
+         break;
+      if(ulChild + 1 < psHeap->ulCount &&
+         FT_isAbove(&psHeap->psItems[ulChild + 1],
+                    &psHeap->psItems[ulChild]))
+         ulChild++;
+      if(!FT_isAbove(&psHeap->psItems[ulChild],
+                     &psHeap->psItems[ulParent]))
+         break;
+      sSwap = psHeap->psItems[ulChild];
+      psHeap->psItems[ulChild] = psHeap->psItems[ulParent];
+      psHeap->psItems[ulParent] = sSwap;
+      ulParent = ulChild;
+   }
+}
+
+/*
+  Pushes onto psHeap the candidate for the subtree of the child in
+  slot ulSlot of oNParent's ranking under eRanking, if there is such a
+  child and anything in its subtree ranks. Returns SUCCESS, or
+  MEMORY_ERROR if the heap could not grow.
+*/
+static int FT_pushSlot(struct FT_TopHeap *psHeap, Node_T oNParent,
+                       enum Node_Ranking eRanking, size_t ulSlot) {
+   struct FT_TopCandidate sCandidate;
+
+   assert(psHeap != NULL);
+   assert(oNParent != NULL);
+
+   if(ulSlot >= Node_getNumRanked(oNParent, eRanking) ||
+      !Node_getBest(Node_getRanked(oNParent, eRanking, ulSlot),
+                    eRanking, &sCandidate.ulValue))
+      return SUCCESS;
+   sCandidate.oNNode = oNParent;
+   sCandidate.bSlot = TRUE;
+   sCandidate.ulSlot = ulSlot;
+   return FT_pushCandidate(psHeap, &sCandidate);
+}
+
+/*
+  Pushes onto psHeap the candidates the subtree rooted at oNNode opens
+  into under eRanking: oNNode's own value, if it ranks, and the
+  subtree of the child atop its ranking. Returns SUCCESS, or
+  MEMORY_ERROR if the heap could not grow.
+*/
+static int FT_openCandidate(struct FT_TopHeap *psHeap, Node_T oNNode,
+                            enum Node_Ranking eRanking) {
+   struct FT_TopCandidate sCandidate;
+   int iStatus;
+
+   assert(psHeap != NULL);
+   assert(oNNode != NULL);
+
+   sCandidate.oNNode = oNNode;
+   sCandidate.bSlot = FALSE;
+   sCandidate.ulSlot = 0;
+   if(!Node_isDir(oNNode)) {
+      if(eRanking != NODE_RANK_FILE_SIZE)
+         return SUCCESS;
+      sCandidate.ulValue = Node_getFileSize(oNNode);
+      return FT_pushCandidate(psHeap, &sCandidate);
+   }
+
+   if(eRanking == NODE_RANK_ENTRIES) {
+      sCandidate.ulValue = Node_getNumChildren(oNNode);
+      iStatus = FT_pushCandidate(psHeap, &sCandidate);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   return FT_pushSlot(psHeap, oNNode, eRanking, 0);
+}
+
+int FT_topK(const char *pcPath, enum FT_Ranking eRanking, size_t ulK,
+            struct FT_RankEntry psEntries[], size_t *pulCount) {
+   struct FT_TopHeap sHeap;
+   struct FT_TopCandidate sTop;
+   enum Node_Ranking eNodeRanking;
+   Node_T oNFound = NULL;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(eRanking == FT_RANK_FILE_SIZE || eRanking == FT_RANK_ENTRIES);
+   assert(psEntries != NULL || ulK == 0);
+   assert(pulCount != NULL);
+
+   *pulCount = 0;
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS || ulK == 0)
+      return iStatus;
+   eNodeRanking = (eRanking == FT_RANK_FILE_SIZE) ? NODE_RANK_FILE_SIZE
+      : NODE_RANK_ENTRIES;
+
+   /* open the best candidate until it is a node's own value, which
+      then beats everything left; a slot hands its place to the two
+      below it in its parent's ranking as its child's subtree opens */
+   sHeap.psItems = NULL;
+   sHeap.ulCount = 0;
+   sHeap.ulCapacity = 0;
+   iStatus = FT_openCandidate(&sHeap, oNFound, eNodeRanking);
+   while(iStatus == SUCCESS && sHeap.ulCount > 0 && *pulCount < ulK) {
+      FT_popCandidate(&sHeap, &sTop);
+      if(!sTop.bSlot) {
+         psEntries[*pulCount].pcPath =
+            Path_getPathname(Node_getPath(sTop.oNNode));
+         psEntries[*pulCount].ulValue = sTop.ulValue;
+         (*pulCount)++;
+         continue;
+      }
+      iStatus = FT_pushSlot(&sHeap, sTop.oNNode, eNodeRanking,
+                            2 * sTop.ulSlot + 1);
+      if(iStatus == SUCCESS)
+         iStatus = FT_pushSlot(&sHeap, sTop.oNNode, eNodeRanking,
+                               2 * sTop.ulSlot + 2);
+      if(iStatus == SUCCESS)
+         iStatus = FT_openCandidate(&sHeap,
+                                    Node_getRanked(sTop.oNNode,
+                                                   eNodeRanking,
+                                                   sTop.ulSlot),
+                                    eNodeRanking);
+   }
+   free(sHeap.psItems);
+
+   if(iStatus != SUCCESS)
+      *pulCount = 0;
+   return iStatus;
+}
+
+int FT_init(void) {
 
    if(bIsInitialized)
       return INITIALIZATION_ERROR;
 
-   bIsInitialized = TRUE;
-   oNRoot = NULL;
-   ulCount = 0;
-   
+   bIsInitialized = TRUE;
+   oNRoot = NULL;
+   ulCount = 0;
+   memset(&sCheckpointStats, 0, sizeof(sCheckpointStats));
+   
+   return SUCCESS;
+}
+
+int FT_destroy(void) {
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   /* put back anything detached by an open transaction so that
+      it is freed along with the rest of the tree */
+   if(oDUndoLog != NULL)
+      (void) FT_abort();
+
+   if(oCCheckpoint != NULL) {
+      boolean bDone;
+      (void) FT_pollCheckpoint(TRUE, &bDone);
+   }
+
+   if(oJJournal != NULL)
+      (void) FT_closeJournal();
+   ulJournalSeq = 0;
+
+   /* with the indexes off, freeing the tree need not unindex it */
+   (void) Node_setIndex(NODE_NAME_INDEX, FALSE, NULL);
+   (void) Node_setIndex(NODE_EXTENSION_INDEX, FALSE, NULL);
+   (void) Node_setContentIndex(FALSE, NULL);
+   (void) Node_setSizeIndex(FALSE, NULL);
+   if(oNRoot) {
+      ulCount -= Node_destroyFree(oNRoot);
+      oNRoot = NULL;
+   }
+
+   Journal_unmap(pvSnapshotMap, ulSnapshotMapSize);
+   pvSnapshotMap = NULL;
+   ulSnapshotMapSize = 0;
+
+   bDedup = FALSE;
+   ulCompressThreshold = 0;
+   eOwnership = FT_BORROW;
+   pfOwnedFree = NULL;
+   /* nothing is left evicted once every file is gone */
+   (void) Content_setSpill(NULL, 0);
+   bIsInitialized = FALSE;
+
+   return SUCCESS;
+}
+
+
+int FT_begin(void) {
+
+   int iStatus;
+
+   if(!bIsInitialized || oDUndoLog != NULL)
+      return INITIALIZATION_ERROR;
+
+   iStatus = FT_reserveJournal(NULL, NULL, 0);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   oDUndoLog = DynArray_new(0);
+   if(oDUndoLog == NULL)
+      return MEMORY_ERROR;
+
+   /* hold the transaction's records back until it commits */
+   if(oJJournal != NULL)
+      Journal_mark(oJJournal);
+   FT_logJournal(JOURNAL_BEGIN, NULL, NULL, 0);
+   return SUCCESS;
+}
+
+int FT_commit(void) {
+   size_t u;
+   struct undo *psUndo;
+   int iStatus;
+
+   if(!bIsInitialized || oDUndoLog == NULL)
+      return INITIALIZATION_ERROR;
+
+   /* a transaction whose commit record can't be logged stays open */
+   iStatus = FT_reserveJournal(NULL, NULL, 0);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   FT_logJournal(JOURNAL_COMMIT, NULL, NULL, 0);
+   if(oJJournal != NULL)
+      Journal_release(oJJournal);
+
+   /* oldest first, so a detached subtree is freed before any
+      detached ancestor that would have freed its parent */
+   for(u = 0; u < DynArray_getLength(oDUndoLog); u++) {
+      psUndo = DynArray_get(oDUndoLog, u);
+      if(psUndo->eKind == UNDO_REMOVE)
+         (void) Node_free(psUndo->oNNode);
+      else if(psUndo->eKind == UNDO_REPLACE)
+         Content_release(psUndo->oCOldContents);
+      free(psUndo->pvSaved);
+      free(psUndo);
+   }
+
+   DynArray_free(oDUndoLog);
+   oDUndoLog = NULL;
+   return SUCCESS;
+}
+
+int FT_abort(void) {
+   size_t u;
+   struct undo *psUndo;
+   int iStatus;
+
+   if(!bIsInitialized || oDUndoLog == NULL)
+      return INITIALIZATION_ERROR;
+
+   if(oJJournal != NULL)
+      Journal_rollback(oJJournal);
+
+   /* newest first, so each entry sees the tree as it left it */
+   for(u = DynArray_getLength(oDUndoLog); u > 0; u--) {
+      psUndo = DynArray_get(oDUndoLog, u - 1);
+      switch(psUndo->eKind) {
+         case UNDO_INSERT:
+            if(psUndo->oNNode == oNRoot)
+               oNRoot = NULL;
+            ulCount -= Node_free(psUndo->oNNode);
+            break;
+         case UNDO_REMOVE:
+            /* the parent's array held this child before, and arrays
+               never shrink, so this cannot need to allocate */
+            iStatus = Node_relink(psUndo->oNNode);
+            assert(iStatus == SUCCESS);
+            if(Node_getParent(psUndo->oNNode) == NULL)
+               oNRoot = psUndo->oNNode;
+            ulCount += psUndo->ulNodes;
+            break;
+         case UNDO_REPLACE:
+            Content_release(Node_replaceContents(psUndo->oNNode,
+                                            psUndo->oCOldContents));
+            break;
+         case UNDO_WRITE:
+            FT_revertWrite(psUndo->oNNode,
+                           psUndo->ulOffset, psUndo->ulOldLength,
+                           psUndo->pvSaved, psUndo->ulSaved);
+            break;
+      }
+      free(psUndo->pvSaved);
+      free(psUndo);
+   }
+
+   DynArray_free(oDUndoLog);
+   oDUndoLog = NULL;
    return SUCCESS;
 }
 
-int FT_destroy(void) {
 
-   if(!bIsInitialized)
+/* --------------------------------------------------------------------
+
+  The following auxiliary functions write and read snapshots. A
+  snapshot is a journal file that starts with a checkpoint record,
+  carrying the sequence number of the last mutation it reflects, and
+  then inserts every node in pre-order with sequence number 0.
+*/
+
+/*
+  Appends insert records for the subtree rooted at oNNode to oJSnap
+  in pre-order. Returns SUCCESS, or IO_ERROR or MEMORY_ERROR.
+*/
+static int FT_snapshotNode(Journal_T oJSnap, Node_T oNNode) {
+   const char *pcPath;
+   void *pvContents = NULL;
+   size_t ulLength = 0;
+   Node_T oNChild = NULL;
+   size_t c;
+   int iStatus;
+
+   assert(oJSnap != NULL);
+   assert(oNNode != NULL);
+
+   pcPath = Path_getPathname(Node_getPath(oNNode));
+   if(!Node_isDir(oNNode)) {
+      ulLength = Node_getFileSize(oNNode);
+      iStatus = Content_fetch(Node_getContents(oNNode), &pvContents);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+
+   iStatus = Journal_reserve(oJSnap, strlen(pcPath),
+                             (pvContents == NULL) ? 0 : ulLength);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   Journal_append(oJSnap, Node_isDir(oNNode) ? JOURNAL_INSERT_DIR :
+                  JOURNAL_INSERT_FILE, 0, pcPath, pvContents, ulLength);
+
+   for(c = 0; c < Node_getNumFileChildren(oNNode); c++) {
+      (void) Node_getChild(FALSE, oNNode, c, &oNChild);
+      iStatus = FT_snapshotNode(oJSnap, oNChild);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   for(c = 0; c < Node_getNumDirChildren(oNNode); c++) {
+      (void) Node_getChild(TRUE, oNNode, c, &oNChild);
+      iStatus = FT_snapshotNode(oJSnap, oNChild);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+   return SUCCESS;
+}
+
+/*
+  Returns a new string holding pcFile followed by pcSuffix, or NULL
+  if there is an allocation error. The caller owns the result.
+*/
+static char *FT_suffixName(const char *pcFile, const char *pcSuffix) {
+   char *pcResult;
+
+   assert(pcFile != NULL);
+   assert(pcSuffix != NULL);
+
+   pcResult = malloc(strlen(pcFile) + strlen(pcSuffix) + 1);
+   if(pcResult == NULL)
+      return NULL;
+   return strcat(strcpy(pcResult, pcFile), pcSuffix);
+}
+
+/*
+  Writes a snapshot of the FT to pcFile, going through a temporary
+  file so that a crash part way leaves any previous snapshot intact.
+  Returns SUCCESS, or IO_ERROR or MEMORY_ERROR.
+*/
+static int FT_writeSnapshot(const char *pcFile) {
+   /* records written and fsync'd together while snapshotting */
+   enum { SNAPSHOT_GROUP_SIZE = 4096 };
+   Journal_T oJSnap;
+   char *pcTemp;
+   int iStatus;
+
+   assert(pcFile != NULL);
+
+   pcTemp = FT_suffixName(pcFile, ".tmp");
+   if(pcTemp == NULL)
+      return MEMORY_ERROR;
+   (void) remove(pcTemp);
+
+   iStatus = Journal_open(pcTemp, SNAPSHOT_GROUP_SIZE, &oJSnap);
+   if(iStatus != SUCCESS) {
+      free(pcTemp);
+      return iStatus;
+   }
+
+   iStatus = Journal_reserve(oJSnap, 0, 0);
+   if(iStatus == SUCCESS) {
+      Journal_append(oJSnap, JOURNAL_CHECKPOINT, ulJournalSeq,
+                     NULL, NULL, 0);
+      if(oNRoot != NULL)
+         iStatus = FT_snapshotNode(oJSnap, oNRoot);
+   }
+   if(Journal_close(oJSnap) != SUCCESS && iStatus == SUCCESS)
+      iStatus = IO_ERROR;
+
+   if(iStatus == SUCCESS && rename(pcTemp, pcFile) != 0)
+      iStatus = IO_ERROR;
+   if(iStatus != SUCCESS)
+      (void) remove(pcTemp);
+
+   free(pcTemp);
+   return iStatus;
+}
+
+/*
+  Applies one record read back by Journal_replay or Journal_map to
+  the FT, taking ownership of pvContents unless it is mapped. pvExtra
+  is the struct replay for this recovery: log records that the
+  snapshot's checkpoint already reflects are skipped. Statuses of the
+  replayed calls are ignored (only successful calls are logged, so
+  they succeed again) except for MEMORY_ERROR.
+*/
+static int FT_replayRecord(int iOp, size_t ulSeq, const char *pcPath,
+                           void *pvContents, size_t ulLength,
+                           void *pvExtra) {
+   struct replay *psReplay = pvExtra;
+   int iStatus = SUCCESS;
+   /* the FT takes what replay allocated, but not what is mapped */
+   enum FT_Ownership eReplayed;
+
+   assert(psReplay != NULL);
+
+   eReplayed = psReplay->bMapped ? FT_BORROW : FT_TAKE;
+
+   if(ulSeq > ulJournalSeq)
+      ulJournalSeq = ulSeq;
+
+   if(iOp == JOURNAL_CHECKPOINT) {
+      psReplay->ulCheckpoint = ulSeq;
+      return SUCCESS;
+   }
+   if(ulSeq != 0 && ulSeq <= psReplay->ulCheckpoint) {
+      if(!psReplay->bMapped)
+         free(pvContents);
+      return SUCCESS;
+   }
+
+   switch(iOp) {
+      case JOURNAL_INSERT_DIR:
+         iStatus = FT_insertDir(pcPath);
+         break;
+      case JOURNAL_INSERT_FILE:
+         iStatus = FT_insertFileOwned(pcPath, pvContents, ulLength,
+                                      eReplayed, NULL);
+         pvContents = NULL;
+         break;
+      case JOURNAL_RM_DIR:
+         iStatus = FT_rmDir(pcPath);
+         break;
+      case JOURNAL_RM_FILE:
+         iStatus = FT_rmFile(pcPath);
+         break;
+      case JOURNAL_REPLACE:
+         (void) FT_replaceFileContentsOwned(pcPath, pvContents,
+                                            ulLength, eReplayed, NULL);
+         pvContents = NULL;
+         break;
+      case JOURNAL_WRITE:
+         if(pvContents != NULL && ulLength >= OFFSET_SIZE) {
+            unsigned char *pucOffset = pvContents;
+            size_t ulOffset = 0;
+            int i;
+
+            for(i = OFFSET_SIZE - 1; i >= 0; i--)
+               ulOffset = (ulOffset << 8) | pucOffset[i];
+            iStatus = FT_writeFile(pcPath, ulOffset,
+                                   pucOffset + OFFSET_SIZE,
+                                   ulLength - OFFSET_SIZE);
+         }
+         break;
+      case JOURNAL_BEGIN:
+         if(oDUndoLog != NULL)
+            (void) FT_abort();
+         iStatus = FT_begin();
+         break;
+      case JOURNAL_COMMIT:
+         if(oDUndoLog != NULL)
+            iStatus = FT_commit();
+         break;
+      default:
+         break;
+   }
+
+   if(!psReplay->bMapped)
+      free(pvContents);
+   return (iStatus == MEMORY_ERROR) ? MEMORY_ERROR : SUCCESS;
+}
+
+/*
+  Records the outcome iStatus of oCDone in the checkpoint metrics and
+  frees it. On success, the rotated journal pcPrev (if not NULL) is
+  now redundant and is deleted. pcPrev is freed either way.
+*/
+static void FT_recordCheckpoint(Checkpoint_T oCDone, int iStatus,
+                                char *pcPrev) {
+   size_t ulBytes;
+
+   assert(oCDone != NULL);
+
+   if(iStatus == SUCCESS) {
+      ulBytes = Checkpoint_getBytes(oCDone);
+      sCheckpointStats.ulCompleted++;
+      sCheckpointStats.dLastSeconds = Checkpoint_getSeconds(oCDone);
+      sCheckpointStats.ulLastBytes = ulBytes;
+      sCheckpointStats.ulTotalBytes += ulBytes;
+      if(pcPrev != NULL)
+         (void) remove(pcPrev);
+   }
+   else
+      sCheckpointStats.ulFailed++;
+
+   free(pcPrev);
+   Checkpoint_free(oCDone);
+}
+
+/*
+  Moves the open journal's file aside to pcPrev and continues logging
+  to a fresh file, so that a checkpoint starting now makes everything
+  in pcPrev redundant once it completes. If pcPrev is still there
+  from a checkpoint that never completed, it must be kept, so logging
+  just continues in the current file. Returns SUCCESS, or IO_ERROR or
+  MEMORY_ERROR, in which case logging continues unchanged.
+*/
+static int FT_rotateJournal(const char *pcPrev) {
+   Journal_T oJNew;
+   FILE *psExisting;
+   int iStatus;
+
+   assert(pcPrev != NULL);
+   assert(oJJournal != NULL);
+
+   iStatus = Journal_sync(oJJournal);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   psExisting = fopen(pcPrev, "rb");
+   if(psExisting != NULL) {
+      (void) fclose(psExisting);
+      return SUCCESS;
+   }
+
+   if(rename(pcJournalFile, pcPrev) != 0)
+      return IO_ERROR;
+   iStatus = Journal_open(pcJournalFile, ulJournalGroupSize, &oJNew);
+   if(iStatus != SUCCESS) {
+      (void) rename(pcPrev, pcJournalFile);
+      return iStatus;
+   }
+
+   /* everything was synced above, so this writes nothing */
+   (void) Journal_close(oJJournal);
+   oJJournal = oJNew;
+   return SUCCESS;
+}
+
+int FT_openJournal(const char *pcLogFile, size_t ulGroupSize) {
+   int iStatus;
+
+   assert(pcLogFile != NULL);
+
+   if(!bIsInitialized || oJJournal != NULL || oDUndoLog != NULL)
       return INITIALIZATION_ERROR;
 
-   if(oNRoot) {
-      ulCount -= Node_destroyFree(oNRoot);
-      oNRoot = NULL;
+   pcJournalFile = FT_suffixName(pcLogFile, "");
+   if(pcJournalFile == NULL)
+      return MEMORY_ERROR;
+
+   iStatus = Journal_open(pcLogFile, ulGroupSize, &oJJournal);
+   if(iStatus != SUCCESS) {
+      free(pcJournalFile);
+      pcJournalFile = NULL;
+      return iStatus;
    }
+   ulJournalGroupSize = ulGroupSize;
+   return SUCCESS;
+}
 
-   bIsInitialized = FALSE;
+int FT_syncJournal(void) {
+
+   if(!bIsInitialized || oJJournal == NULL)
+      return INITIALIZATION_ERROR;
+
+   return Journal_sync(oJJournal);
+}
+
+int FT_closeJournal(void) {
+   int iStatus;
+
+   if(!bIsInitialized || oJJournal == NULL || oDUndoLog != NULL)
+      return INITIALIZATION_ERROR;
+
+   iStatus = Journal_close(oJJournal);
+   oJJournal = NULL;
+   free(pcJournalFile);
+   pcJournalFile = NULL;
+   return iStatus;
+}
+
+int FT_checkpoint(const char *pcSnapshotFile) {
+   Checkpoint_T oCRun;
+   char *pcPrev = NULL;
+   boolean bDone;
+   int iStatus;
+
+   assert(pcSnapshotFile != NULL);
+
+   if(!bIsInitialized || oDUndoLog != NULL || oCCheckpoint != NULL)
+      return INITIALIZATION_ERROR;
+
+   if(oJJournal != NULL) {
+      pcPrev = FT_suffixName(pcJournalFile, ".prev");
+      if(pcPrev == NULL)
+         return MEMORY_ERROR;
+   }
+
+   iStatus = Checkpoint_start(FT_writeSnapshot, pcSnapshotFile, FALSE,
+                              &oCRun);
+   if(iStatus != SUCCESS) {
+      free(pcPrev);
+      return iStatus;
+   }
+   iStatus = Checkpoint_finish(oCRun, TRUE, &bDone);
+   FT_recordCheckpoint(oCRun, iStatus, pcPrev);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   /* everything logged so far is in the snapshot */
+   if(oJJournal != NULL)
+      iStatus = Journal_truncate(oJJournal);
+   return iStatus;
+}
+
+int FT_checkpointAsync(const char *pcSnapshotFile) {
+   char *pcPrev = NULL;
+   int iStatus;
+
+   assert(pcSnapshotFile != NULL);
+
+   if(!bIsInitialized || oDUndoLog != NULL || oCCheckpoint != NULL)
+      return INITIALIZATION_ERROR;
+
+   if(oJJournal != NULL) {
+      pcPrev = FT_suffixName(pcJournalFile, ".prev");
+      if(pcPrev == NULL)
+         return MEMORY_ERROR;
+      iStatus = FT_rotateJournal(pcPrev);
+      if(iStatus != SUCCESS) {
+         free(pcPrev);
+         return iStatus;
+      }
+   }
+
+   /* the child must find the spill file as it was when forked */
+   iStatus = Content_beginFork();
+   if(iStatus != SUCCESS) {
+      free(pcPrev);
+      return iStatus;
+   }
+   iStatus = Checkpoint_start(FT_writeSnapshot, pcSnapshotFile, TRUE,
+                              &oCCheckpoint);
+   if(iStatus != SUCCESS) {
+      Content_endFork();
+      free(pcPrev);
+      return iStatus;
+   }
+   pcCheckpointPrev = pcPrev;
+   return SUCCESS;
+}
+
+int FT_pollCheckpoint(boolean bWait, boolean *pbDone) {
+   int iStatus;
+
+   assert(pbDone != NULL);
+
+   if(!bIsInitialized || oCCheckpoint == NULL)
+      return INITIALIZATION_ERROR;
+
+   iStatus = Checkpoint_finish(oCCheckpoint, bWait, pbDone);
+   if(*pbDone) {
+      Content_endFork();
+      FT_recordCheckpoint(oCCheckpoint, iStatus, pcCheckpointPrev);
+      oCCheckpoint = NULL;
+      pcCheckpointPrev = NULL;
+   }
+   return iStatus;
+}
+
+void FT_getCheckpointStats(struct FT_CheckpointStats *psStats) {
+   assert(psStats != NULL);
+
+   *psStats = sCheckpointStats;
+   psStats->bRunning = (boolean) (oCCheckpoint != NULL);
+}
+
+/*
+  Implements FT_recover and, if bMap is TRUE, FT_recoverMapped.
+*/
+static int FT_recoverFrom(const char *pcSnapshotFile,
+                          const char *pcLogFile, boolean bMap) {
+   struct replay sReplay;
+   char *pcPrev;
+   int iStatus = SUCCESS;
+
+   assert(pcLogFile != NULL);
+
+   if(!bIsInitialized || oNRoot != NULL || oDUndoLog != NULL ||
+      oJJournal != NULL || pvSnapshotMap != NULL)
+      return INITIALIZATION_ERROR;
+
+   sReplay.ulCheckpoint = 0;
+   sReplay.bMapped = bMap;
+   if(pcSnapshotFile != NULL && bMap)
+      iStatus = Journal_map(pcSnapshotFile, FT_replayRecord, &sReplay,
+                            &pvSnapshotMap, &ulSnapshotMapSize);
+   else if(pcSnapshotFile != NULL)
+      iStatus = Journal_replay(pcSnapshotFile, FT_replayRecord,
+                               &sReplay);
+
+   /* journals are small and rewritten in place, so always copy */
+   sReplay.bMapped = FALSE;
+
+   /* a rotated journal holds the records before those in pcLogFile */
+   if(iStatus == SUCCESS) {
+      pcPrev = FT_suffixName(pcLogFile, ".prev");
+      if(pcPrev == NULL)
+         iStatus = MEMORY_ERROR;
+      else {
+         iStatus = Journal_replay(pcPrev, FT_replayRecord, &sReplay);
+         free(pcPrev);
+      }
+   }
+   if(iStatus == SUCCESS)
+      iStatus = Journal_replay(pcLogFile, FT_replayRecord, &sReplay);
+
+   /* a transaction the log doesn't see commit never happened */
+   if(oDUndoLog != NULL)
+      (void) FT_abort();
+   return iStatus;
+}
+
+int FT_recover(const char *pcSnapshotFile, const char *pcLogFile) {
+   return FT_recoverFrom(pcSnapshotFile, pcLogFile, FALSE);
+}
+
+int FT_recoverMapped(const char *pcSnapshotFile, const char *pcLogFile) {
+   return FT_recoverFrom(pcSnapshotFile, pcLogFile, TRUE);
+}
 
+int FT_setDedup(boolean bEnable) {
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   bDedup = bEnable;
+   return SUCCESS;
+}
+
+int FT_setCompression(size_t ulThreshold) {
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   ulCompressThreshold = ulThreshold;
+   return SUCCESS;
+}
+
+int FT_setMemoryBudget(const char *pcSpillFile, size_t ulBudget) {
+   boolean bDone;
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   /* its child may still be reading the spill file */
+   if(oCCheckpoint != NULL)
+      (void) FT_pollCheckpoint(TRUE, &bDone);
+   return Content_setSpill(pcSpillFile, ulBudget);
+}
+
+int FT_setOwnership(enum FT_Ownership eMode,
+                    void (*pfFree)(void *pvContents)) {
+
+   if(!bIsInitialized)
+      return INITIALIZATION_ERROR;
+
+   eOwnership = eMode;
+   pfOwnedFree = pfFree;
    return SUCCESS;
 }
 
+void FT_getContentStats(struct FT_ContentStats *psStats) {
+   assert(psStats != NULL);
+
+   Content_getCompressionStats(&psStats->ulCompressed,
+                               &psStats->ulCompressedLogicalBytes,
+                               &psStats->ulCompressedStoredBytes,
+                               &psStats->ulCacheHits,
+                               &psStats->ulCacheMisses);
+   Content_getSpillStats(&psStats->ulResidentBytes, &psStats->ulSpilled,
+                         &psStats->ulSpilledBytes, &psStats->ulSpillHits,
+                         &psStats->ulSpillMisses, &psStats->ulEvictions);
+   Content_getStoreStats(&psStats->ulReferences,
+                         &psStats->ulLogicalBytes,
+                         &psStats->ulDistinct, &psStats->ulStoredBytes);
+   if(psStats->ulStoredBytes == 0)
+      psStats->dDedupRatio = 1.0;
+   else
+      psStats->dDedupRatio = (double) psStats->ulLogicalBytes
+         / psStats->ulStoredBytes;
+}
+
 
 /* --------------------------------------------------------------------
 
@@ -703,3 +3397,118 @@ char *FT_toString(void) {
    
    return result;
 }
+
+/* The state FT_writeSubtree's visitor carries between nodes */
+struct FT_WriteState
+{
+   /* the number of '/'s in the deepest paths to write */
+   size_t ulMaxSlashes;
+   /* where to write, and what to pass it */
+   int (*pfWrite)(const char *pcText, size_t ulLength, void *pvExtra);
+   void *pvExtra;
+   /* SUCCESS, or the first other status pfWrite returned */
+   int iStatus;
+};
+
+/*
+  Writes psEntry's path and a newline through the writer in the
+  FT_WriteState pvState, passing over the children of a node at the
+  depth limit and stopping if the writer fails.
+*/
+static enum FT_WalkAction FT_writeEntry(const struct FT_DirEntry *psEntry,
+                                        void *pvState) {
+   struct FT_WriteState *psState = pvState;
+   size_t ulSlashes = 0;
+   size_t ulLength;
+
+   assert(psEntry != NULL);
+   assert(psState != NULL);
+
+   for(ulLength = 0; psEntry->pcPath[ulLength] != '\0'; ulLength++)
+      if(psEntry->pcPath[ulLength] == '/')
+         ulSlashes++;
+
+   psState->iStatus = (*psState->pfWrite)(psEntry->pcPath, ulLength,
+                                          psState->pvExtra);
+   if(psState->iStatus == SUCCESS)
+      psState->iStatus = (*psState->pfWrite)("\n", 1, psState->pvExtra);
+   if(psState->iStatus != SUCCESS)
+      return FT_WALK_STOP;
+   return (ulSlashes >= psState->ulMaxSlashes) ? FT_WALK_SKIP :
+      FT_WALK_CONTINUE;
+}
+
+int FT_writeSubtree(const char *pcPath, size_t ulMaxDepth,
+                    int (*pfWrite)(const char *pcText, size_t ulLength,
+                                   void *pvExtra),
+                    void *pvExtra) {
+   struct FT_WriteState sState;
+   Node_T oNFound = NULL;
+   size_t ulSlashes;
+   int iStatus;
+
+   assert(pcPath != NULL);
+   assert(pfWrite != NULL);
+
+   iStatus = FT_findNode(pcPath, &oNFound);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   ulSlashes = Path_getDepth(Node_getPath(oNFound)) - 1;
+   sState.ulMaxSlashes = (ulMaxDepth > FT_UNLIMITED - ulSlashes) ?
+      FT_UNLIMITED : ulSlashes + ulMaxDepth;
+   sState.pfWrite = pfWrite;
+   sState.pvExtra = pvExtra;
+   sState.iStatus = SUCCESS;
+   (void) FT_walkFrom(oNFound, FT_writeEntry, &sState);
+   return sState.iStatus;
+}
+
+/*
+  An FT_writeSubtree writer that adds ulLength to the size_t that
+  pvTotal points to.
+*/
+static int FT_countText(const char *pcText, size_t ulLength,
+                        void *pvTotal) {
+   assert(pcText != NULL);
+   assert(pvTotal != NULL);
+
+   *(size_t *) pvTotal += ulLength;
+   return SUCCESS;
+}
+
+/*
+  An FT_writeSubtree writer that copies the ulLength bytes at pcText
+  to the buffer position that pvNext points to, and advances it.
+*/
+static int FT_copyText(const char *pcText, size_t ulLength,
+                       void *pvNext) {
+   char **ppcNext = pvNext;
+
+   assert(pcText != NULL);
+   assert(ppcNext != NULL);
+
+   memcpy(*ppcNext, pcText, ulLength);
+   *ppcNext += ulLength;
+   return SUCCESS;
+}
+
+char *FT_toStringSubtree(const char *pcPath, size_t ulMaxDepth) {
+   size_t ulTotal = 0;
+   char *pcResult;
+   char *pcNext;
+
+   assert(pcPath != NULL);
+
+   if(FT_writeSubtree(pcPath, ulMaxDepth, FT_countText, &ulTotal)
+      != SUCCESS)
+      return NULL;
+
+   pcResult = malloc(ulTotal + 1);
+   if(pcResult == NULL)
+      return NULL;
+   pcNext = pcResult;
+   (void) FT_writeSubtree(pcPath, ulMaxDepth, FT_copyText, &pcNext);
+   *pcNext = '\0';
+   return pcResult;
+}
@@ -24,6 +24,7 @@
    * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
    * NOT_A_DIRECTORY if a proper prefix of pcPath exists as a file
    * ALREADY_IN_TREE if pcPath is already in the FT (as dir or file)
+   * QUOTA_EXCEEDED if a directory would exceed its quota (FT_setQuota)
    * MEMORY_ERROR if memory could not be allocated to complete request
 */
 int FT_insertDir(const char *pcPath);
@@ -59,11 +60,56 @@ int FT_rmDir(const char *pcPath);
                       or if the new file would be the FT root
    * NOT_A_DIRECTORY if a proper prefix of pcPath exists as a file
    * ALREADY_IN_TREE if pcPath is already in the FT (as dir or file)
+   * QUOTA_EXCEEDED if a directory would exceed its quota (FT_setQuota)
    * MEMORY_ERROR if memory could not be allocated to complete request
 */
 int FT_insertFile(const char *pcPath, void *pvContents,
                   size_t ulLength);
 
+/*
+  How the FT holds the contents given to it: FT_BORROW keeps the
+  caller's buffer, which the caller must keep alive and free after
+  the file is gone; FT_TAKE keeps the caller's buffer and frees it
+  once the file is removed or its contents replaced; FT_COPY keeps a
+  copy of the caller's bytes, which the FT frees.
+*/
+enum FT_Ownership { FT_BORROW, FT_TAKE, FT_COPY };
+
+/*
+  Like FT_insertFile, except that pvContents are held as eOwnership
+  says rather than as FT_setOwnership last set. Under FT_TAKE the FT
+  takes pvContents whether or not the file is inserted, and frees
+  them by calling (*pfFree)(pvContents), or free(pvContents) if
+  pfFree is NULL. Contents deduplicated or compressed are copies, as
+  for FT_insertFile, so taken ones are then freed at once.
+*/
+int FT_insertFileOwned(const char *pcPath, void *pvContents,
+                       size_t ulLength, enum FT_Ownership eOwnership,
+                       void (*pfFree)(void *pvContents));
+
+/* A segment of a file's contents, for FT_insertFileV and FT_readFileV */
+struct FT_Segment
+{
+   /* the segment's bytes, and how many there are */
+   void *pvData;
+   size_t ulLength;
+};
+
+/*
+  Inserts a new file into the FT with absolute path pcPath, whose
+  contents are the ulSegments segments psSegments placed end to end.
+  The caller need not concatenate them first and keeps its own
+  buffers, but the FT does make one copy: the segments are gathered
+  straight into a private copy owned by the FT, held as for
+  FT_writeFile. If deduplication is on or the contents reach the
+  compression threshold, they are instead gathered into a scratch
+  buffer and stored as FT_insertFile stores a copy, shared or
+  compressed as it would be. Returns the same statuses as
+  FT_insertFile.
+*/
+int FT_insertFileV(const char *pcPath, const struct FT_Segment *psSegments,
+                   size_t ulSegments);
+
 /*
   Returns TRUE if the FT contains a file with absolute path
   pcPath and FALSE if not or if there is an error while checking.
@@ -96,11 +142,120 @@ void *FT_getFileContents(const char *pcPath);
   Replaces current contents of the file with absolute path pcPath with
   the parameter pvNewContents of size ulNewLength bytes.
   Returns the old contents if successful. (Note: contents may be NULL.)
-  Returns NULL if unable to complete the request for any reason.
+  Returns NULL if unable to complete the request for any reason, and
+  also if the old contents were taken or copied by the FT (see
+  FT_setOwnership), since the FT frees those itself.
 */
 void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
                              size_t ulNewLength);
 
+/*
+  Like FT_replaceFileContents, except that pvNewContents are held as
+  eOwnership says, and freed under FT_TAKE, as for
+  FT_insertFileOwned.
+*/
+void *FT_replaceFileContentsOwned(const char *pcPath,
+                                  void *pvNewContents,
+                                  size_t ulNewLength,
+                                  enum FT_Ownership eOwnership,
+                                  void (*pfFree)(void *pvContents));
+
+/*
+  Copies up to ulLength bytes of the contents of the file with
+  absolute path pcPath, starting at offset ulOffset, to pvBuffer, and
+  stores in *pulRead how many were copied: fewer than ulLength if the
+  contents end first, and none if they are NULL.
+  Returns SUCCESS if the file is read.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+  * NOT_A_FILE if pcPath is in the FT as a directory not a file
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_readFile(const char *pcPath, size_t ulOffset, void *pvBuffer,
+                size_t ulLength, size_t *pulRead);
+
+/*
+  Like FT_readFile, except that the bytes from offset ulOffset on are
+  scattered straight into the ulSegments segments psSegments in turn,
+  each filled before the next, and *pulRead is the total copied.
+*/
+int FT_readFileV(const char *pcPath, size_t ulOffset,
+                 const struct FT_Segment *psSegments, size_t ulSegments,
+                 size_t *pulRead);
+
+/* A pinned reference to the contents a file had when it was pinned */
+typedef struct content *FT_Contents_T;
+
+/*
+  Pins the contents of the file with absolute path pcPath and sets
+  *poCResult to a handle to them. The bytes FT_getPinnedData returns
+  for the handle stay valid and unchanged until FT_unpin, even if the
+  file is written, replaced, or removed, or the FT destroyed
+  meanwhile: those calls change a copy, and free the pinned contents
+  only once they are unpinned. Contents borrowed from the caller or
+  from a snapshot mapped by FT_recoverMapped are the exception, and
+  live only as long as their owner keeps them. Pinning and unpinning
+  take constant time, except that compressed contents are
+  decompressed into a private buffer, and contents written in place
+  during an open transaction are copied. The FT is not thread-safe,
+  so threads sharing it must serialize FT_pin and FT_unpin with their
+  other calls to it, but can then read pinned contents unlocked.
+  Returns SUCCESS if the contents are pinned.
+  Otherwise, sets *poCResult to NULL and returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+  * NOT_A_FILE if pcPath is in the FT as a directory not a file
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_pin(const char *pcPath, FT_Contents_T *poCResult);
+
+/*
+  Returns the bytes of the pinned contents oCContents, which may be
+  NULL, and must be neither modified nor freed.
+*/
+void *FT_getPinnedData(FT_Contents_T oCContents);
+
+/* Returns the number of bytes in the pinned contents oCContents. */
+size_t FT_getPinnedLength(FT_Contents_T oCContents);
+
+/*
+  Releases the pin oCContents, after which it must not be used.
+*/
+void FT_unpin(FT_Contents_T oCContents);
+
+/*
+  Writes the ulLength bytes at pvData into the contents of the file
+  with absolute path pcPath at offset ulOffset, extending the file if
+  they reach past its end; a gap between its old end and ulOffset is
+  filled with zeros. The first write to a file whose contents the FT
+  does not hold privately (because they are the caller's buffer, a
+  shared copy, or compressed) replaces them with a private copy kept
+  in extents that grow geometrically, so later writes and appends
+  happen in place; the caller's buffer is then no longer used.
+  FT_getFileContents gathers the extents into one buffer, which is
+  valid until the next write, append, or replacement of the file.
+  Returns SUCCESS if the file is written, and otherwise the same
+  statuses as FT_readFile, or QUOTA_EXCEEDED if a directory would
+  exceed its quota (see FT_setQuota).
+*/
+int FT_writeFile(const char *pcPath, size_t ulOffset,
+                 const void *pvData, size_t ulLength);
+
+/*
+  Appends the ulLength bytes at pvData to the contents of the file
+  with absolute path pcPath, as FT_writeFile at the file's current
+  length does, in O(ulLength) amortized time.
+  Returns SUCCESS if the file is appended to, and otherwise the same
+  statuses as FT_writeFile.
+*/
+int FT_appendFile(const char *pcPath, const void *pvData,
+                  size_t ulLength);
+
 /*
   Returns SUCCESS if pcPath exists in the hierarchy,
   Otherwise, returns:
@@ -119,6 +274,228 @@ void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
 */
 int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize);
 
+/* The quota of a directory that has no limit */
+#define FT_UNLIMITED ((size_t) -1)
+
+/*
+  Limits the subtree beneath the directory with absolute path pcPath
+  to ulMaxNodes directories and files and ulMaxBytes bytes of file
+  contents, either of which may be FT_UNLIMITED. From then on,
+  FT_insertDir, FT_insertFile, FT_insertFileV, FT_writeFile, and
+  FT_appendFile return QUOTA_EXCEEDED, and FT_replaceFileContents
+  returns NULL, rather than take that subtree or that of any other
+  directory past its quota; checking takes time proportional to the
+  depth of the change. A quota below what the subtree already holds
+  is allowed, and only stops it from growing. Quotas are not
+  journaled or checkpointed, so they must be set again after
+  recovery. There are none after FT_init.
+  Returns SUCCESS if the quota is set.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+  * NOT_A_DIRECTORY if pcPath is in the FT as a file not a directory
+*/
+int FT_setQuota(const char *pcPath, size_t ulMaxNodes,
+                size_t ulMaxBytes);
+
+/*
+  Stores in *pulMaxNodes and *pulMaxBytes the quotas set by
+  FT_setQuota on the directory with absolute path pcPath, each
+  FT_UNLIMITED if it has none. Returns the same statuses as
+  FT_setQuota, leaving *pulMaxNodes and *pulMaxBytes unchanged unless
+  it returns SUCCESS.
+*/
+int FT_getQuota(const char *pcPath, size_t *pulMaxNodes,
+                size_t *pulMaxBytes);
+
+/* The totals of a subtree of the FT, as reported by FT_statSubtree */
+struct FT_SubtreeStats
+{
+   /* the numbers of directories and files in the subtree, counting
+      its root */
+   size_t ulDirs;
+   size_t ulFiles;
+   /* the bytes of the contents of the subtree's files */
+   size_t ulBytes;
+};
+
+/*
+  Fills *psStats with the totals of the subtree rooted at the
+  directory or file with absolute path pcPath. The totals are kept up
+  to date as the FT changes, so this takes time proportional to the
+  depth of pcPath rather than to the size of the subtree.
+  Returns SUCCESS if pcPath is found.
+  Otherwise, leaves *psStats unchanged and returns the same statuses
+  as FT_stat.
+*/
+int FT_statSubtree(const char *pcPath, struct FT_SubtreeStats *psStats);
+
+/* What FT_statEx reports about a directory or file */
+struct FT_StatEx
+{
+   /* TRUE if it is a file, FALSE if it is a directory */
+   boolean bIsFile;
+   /* the length of a file's contents, or 0 for a directory */
+   size_t ulSize;
+   /* the numbers of a directory's directory and file children, or 0
+      for a file */
+   size_t ulDirChildren;
+   size_t ulFileChildren;
+   /* the number of components in its path, 1 for the root */
+   size_t ulDepth;
+   /* the totals of the subtree rooted at it, as FT_statSubtree
+      reports them */
+   struct FT_SubtreeStats sSubtree;
+};
+
+/*
+  Fills *psStat with what is known about the directory or file with
+  absolute path pcPath. Nothing is allocated, and the time taken is
+  proportional to the depth of pcPath (times the logarithm of the
+  numbers of children along it), so it may be polled cheaply.
+  Returns SUCCESS if pcPath is found.
+  Otherwise, leaves *psStat unchanged and returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+*/
+int FT_statEx(const char *pcPath, struct FT_StatEx *psStat);
+
+/* What FT_statMany reports about one of its paths */
+struct FT_StatResult
+{
+   /* the status FT_stat would return for the path */
+   int iStatus;
+   /* when iStatus is SUCCESS, TRUE if the path is a file */
+   boolean bIsFile;
+   /* when iStatus is SUCCESS, the length of a file's contents, or 0
+      for a directory */
+   size_t ulSize;
+};
+
+/*
+  Looks up each of the ulCount absolute paths in apcPaths, as FT_stat
+  would, and stores what it finds in the corresponding element of
+  psResults; a path is a file that FT_containsFile would report if its
+  result is SUCCESS with bIsFile TRUE. The paths are visited in sorted
+  order, and each walk starts from the deepest node it shares with
+  the last, so that the cost of common prefixes is paid once.
+  Returns SUCCESS, or INITIALIZATION_ERROR if the FT is not in an
+  initialized state, in which case that is also every path's status.
+*/
+int FT_statMany(const char *const apcPaths[], size_t ulCount,
+                struct FT_StatResult psResults[]);
+
+/* One child of a directory, as FT_readdir lists it */
+struct FT_DirEntry
+{
+   /* its absolute path, valid until the FT next changes */
+   const char *pcPath;
+   /* TRUE if it is a file, FALSE if it is a directory */
+   boolean bIsFile;
+   /* the length of a file's contents, or 0 for a directory */
+   size_t ulSize;
+};
+
+/*
+  Lists up to ulMax children of the directory with absolute path
+  pcPath into psEntries, files before directories and each in
+  lexicographic order, and stores in *pulCount how many were listed;
+  fewer than ulMax means the listing is complete. If pcAfter is NULL
+  the listing starts with the first child; otherwise it resumes after
+  the position that the path pcAfter of a file (if bAfterFile) or
+  directory (otherwise) would have, whether or not that child still
+  exists, so a caller that copies the last entry's path and kind may
+  page through a directory in constant memory while it changes.
+  Nothing is allocated.
+  Returns SUCCESS if pcPath is found.
+  Otherwise, sets *pulCount to 0 and returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+  * NOT_A_DIRECTORY if pcPath is in the FT as a file not a directory
+*/
+int FT_readdir(const char *pcPath, boolean bAfterFile,
+               const char *pcAfter, struct FT_DirEntry psEntries[],
+               size_t ulMax, size_t *pulCount);
+
+/* What an FT_walk visitor asks the walk to do next */
+enum FT_WalkAction
+{
+   /* go on, into the visited directory's children */
+   FT_WALK_CONTINUE,
+   /* go on, but not into the visited directory's children */
+   FT_WALK_SKIP,
+   /* end the walk at once */
+   FT_WALK_STOP
+};
+
+/*
+  Visits the directory or file with absolute path pcPath and every
+  node below it in the order FT_toString lists them, calling
+  (*pfVisit)(psEntry, pvExtra) for each; what the visitor returns
+  decides whether the walk goes on, passes over the visited
+  directory's subtree, or stops. Nothing is allocated, so a walk that
+  stops early costs only what it visited. The visitor must not change
+  the FT.
+  Returns SUCCESS if pcPath is found, whether or not the walk stopped.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+*/
+int FT_walk(const char *pcPath,
+            enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry
+                                          *psEntry, void *pvExtra),
+            void *pvExtra);
+
+/*
+  Calls (*pfVisit)(psEntry, pvExtra) for each directory or file whose
+  absolute path matches pcPattern, in the order FT_toString lists
+  them. pcPattern is formatted as a path whose components may hold
+  '*', which matches any run of characters, and '?', which matches
+  any one; a component that is just "**" matches any number of whole
+  components, none included. Components without '*' or '?' are found
+  by binary search, and the children of a directory are scanned only
+  for those whose names begin with a component's characters before
+  its first '*' or '?' while no "**" applies. Each matching node is
+  visited once, however many ways the pattern matches it. If the
+  visitor returns FT_WALK_STOP the search ends; any other value lets
+  it go on. The visitor must not change the FT.
+  Returns SUCCESS, whether or not anything matched.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPattern is not formatted as a path
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_glob(const char *pcPattern,
+            enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry
+                                          *psEntry, void *pvExtra),
+            void *pvExtra);
+
+/*
+  Calls (*pfVisit)(psEntry, pvExtra) for each directory or file whose
+  absolute path p satisfies strcmp(pcLow, p) <= 0 and, unless pcHigh
+  is NULL, strcmp(p, pcHigh) < 0, in the order FT_toString lists
+  them, so that consecutive ranges partition the namespace. In each
+  directory the scan seeks by binary search to the first child that
+  may lead into the range and stops at the first past it. What the
+  visitor returns decides, as for FT_walk, whether the scan goes on,
+  passes over the visited directory's subtree, or stops. The visitor
+  must not change the FT.
+  Returns SUCCESS, or INITIALIZATION_ERROR if the FT is not in an
+  initialized state.
+*/
+int FT_scanRange(const char *pcLow, const char *pcHigh,
+                 enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry
+                                               *psEntry, void *pvExtra),
+                 void *pvExtra);
+
 /*
   Sets the FT data structure to an initialized state.
   The data structure is initially empty.
@@ -129,12 +506,507 @@ int FT_init(void);
 
 /*
   Removes all contents of the data structure and
-  returns it to an uninitialized state.
+  returns it to an uninitialized state. An open transaction is
+  aborted first, a running checkpoint is waited for, an open
+  journal is synced and closed, and a snapshot mapped by
+  FT_recoverMapped is unmapped.
   Returns INITIALIZATION_ERROR if not already initialized,
   and SUCCESS otherwise.
 */
 int FT_destroy(void);
 
+/*
+  Opens a transaction: until the matching FT_commit or FT_abort, the
+  effects of FT_insertDir, FT_insertFile, FT_rmDir, FT_rmFile,
+  FT_replaceFileContents, FT_writeFile, and FT_appendFile are
+  recorded so that they can be kept or discarded as a unit. Subtrees
+  removed inside a transaction are not freed until it commits, and
+  old contents returned by FT_replaceFileContents must stay valid
+  until then, since FT_abort restores them. Transactions do not nest.
+  Returns SUCCESS if the transaction is opened.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+                         or a transaction is already open
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_begin(void);
+
+/*
+  Closes the open transaction, keeping all of its effects.
+  Returns INITIALIZATION_ERROR if the FT is not in an initialized
+  state or no transaction is open, and SUCCESS otherwise.
+*/
+int FT_commit(void);
+
+/*
+  Closes the open transaction, undoing all of its effects in reverse
+  order so that the FT is exactly as it was at FT_begin.
+  Returns INITIALIZATION_ERROR if the FT is not in an initialized
+  state or no transaction is open, and SUCCESS otherwise.
+*/
+int FT_abort(void);
+
+/*
+  Starts logging every successful mutation to the journal file
+  pcLogFile, appending to whatever it already holds. Records are
+  buffered in memory and written and fsync'd ulGroupSize at a time,
+  so up to the last ulGroupSize - 1 mutations may be lost in a crash
+  unless FT_syncJournal is called. A transaction's records are held
+  back until it commits and are replayed all or nothing.
+  Returns SUCCESS if the journal is opened.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state,
+                         a journal is already open,
+                         or a transaction is open
+  * IO_ERROR if pcLogFile could not be opened
+  * MEMORY_ERROR if memory could not be allocated to complete request
+
+  While a journal is open, any mutation may also fail with IO_ERROR
+  if writing out a buffered group fails, or MEMORY_ERROR if the
+  record cannot be buffered; the mutation is then not made.
+*/
+int FT_openJournal(const char *pcLogFile, size_t ulGroupSize);
+
+/*
+  Writes out and fsyncs every buffered journal record.
+  Returns SUCCESS, or INITIALIZATION_ERROR if the FT is not in an
+  initialized state or no journal is open, or IO_ERROR on failure.
+*/
+int FT_syncJournal(void);
+
+/*
+  Syncs and closes the open journal; later mutations are not logged.
+  Returns SUCCESS, or INITIALIZATION_ERROR if the FT is not in an
+  initialized state, no journal is open, or a transaction is open,
+  or IO_ERROR if the buffered records could not be made durable.
+*/
+int FT_closeJournal(void);
+
+/*
+  Writes a snapshot of the whole FT to pcSnapshotFile, replacing it
+  atomically, and then compacts the open journal (if any) by
+  discarding every record the snapshot already reflects.
+  Returns SUCCESS if the snapshot is written.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state,
+                         a transaction is open,
+                         or a background checkpoint is running
+  * IO_ERROR if the snapshot or journal could not be written
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_checkpoint(const char *pcSnapshotFile);
+
+/*
+  Starts writing a snapshot of the whole FT to pcSnapshotFile in a
+  forked child process, which persists a copy-on-write image of the
+  tree as of this call while the FT keeps accepting mutations. The
+  open journal (if any) is moved aside to the same name plus ".prev"
+  and logging continues in a fresh file; the old one is deleted when
+  the checkpoint completes. Use FT_pollCheckpoint to collect it.
+  Returns SUCCESS if the checkpoint is started.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state,
+                         a transaction is open,
+                         or a checkpoint is already running
+  * IO_ERROR if the journal could not be moved aside or the spill
+             file (see FT_setMemoryBudget) could not be opened for the
+             child
+  * MEMORY_ERROR if memory could not be allocated or the process
+                 could not be forked
+*/
+int FT_checkpointAsync(const char *pcSnapshotFile);
+
+/*
+  Checks whether the checkpoint started by FT_checkpointAsync has
+  finished, waiting for it if bWait is TRUE, and sets *pbDone
+  accordingly. Returns SUCCESS while it is running or if it
+  succeeded, and INITIALIZATION_ERROR if the FT is not in an
+  initialized state or no checkpoint is running. If it failed,
+  returns its IO_ERROR or MEMORY_ERROR status; the journal then
+  still holds every record the snapshot would have replaced.
+*/
+int FT_pollCheckpoint(boolean bWait, boolean *pbDone);
+
+/* Metrics about the checkpoints taken since FT_init */
+struct FT_CheckpointStats
+{
+   /* the number of checkpoints that succeeded and that failed */
+   size_t ulCompleted;
+   size_t ulFailed;
+   /* whether a background checkpoint is running now */
+   boolean bRunning;
+   /* the wall-clock duration in seconds of the last success */
+   double dLastSeconds;
+   /* the bytes written by the last success and by all successes */
+   size_t ulLastBytes;
+   size_t ulTotalBytes;
+};
+
+/*
+  Fills *psStats with metrics about the checkpoints taken by
+  FT_checkpoint and FT_checkpointAsync.
+*/
+void FT_getCheckpointStats(struct FT_CheckpointStats *psStats);
+
+/*
+  Rebuilds the FT from the snapshot pcSnapshotFile (skipped if NULL
+  or missing) and then replays the journal pcLogFile (preceded by
+  the file moved aside by FT_checkpointAsync, if any) on top of it,
+  skipping records the snapshot already reflects, up to the last
+  intact record. A transaction whose commit was not logged is not
+  replayed. The FT must be initialized and empty, with no journal or
+  transaction open; call FT_openJournal afterward to keep logging.
+  Recovered file contents are allocated by the FT and held as under
+  FT_TAKE, so the FT frees them itself.
+  Returns SUCCESS if recovery completes.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not initialized and empty,
+                         or a journal or transaction is open
+  * IO_ERROR if either file exists but could not be read
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_recover(const char *pcSnapshotFile, const char *pcLogFile);
+
+/*
+  Like FT_recover, except that the snapshot is memory-mapped and the
+  contents of the files it holds point straight into the mapping
+  rather than into copies on the heap: FT_getFileContents on them is
+  zero-copy and bodies are only paged in when touched. The mapping is
+  private, so writing through those pointers changes neither the
+  snapshot file nor any other process's view of it. It stays mapped
+  until FT_destroy, so those contents must not be freed, and are not
+  guaranteed any alignment. Contents replayed from the journal are
+  copies, as with FT_recover. Returns the same statuses as FT_recover,
+  and INITIALIZATION_ERROR if a snapshot is already mapped.
+*/
+int FT_recoverMapped(const char *pcSnapshotFile, const char *pcLogFile);
+
+/*
+  Turns deduplication of file contents on (bEnable TRUE) or off for
+  the files inserted or replaced from now on. While it is on,
+  FT_insertFile and FT_replaceFileContents hash the contents they are
+  given and store one shared, FT-owned copy per distinct sequence of
+  bytes: the caller keeps its own buffer, and FT_getFileContents
+  returns the shared copy, which must be neither modified nor freed.
+  Shared copies are freed once no file refers to them. Deduplication
+  is off after FT_init.
+  Returns SUCCESS, or INITIALIZATION_ERROR if the FT is not in an
+  initialized state.
+*/
+int FT_setDedup(boolean bEnable);
+
+/*
+  Turns compression of file contents on for the files inserted or
+  replaced from now on whose contents are at least ulThreshold bytes
+  long, or off if ulThreshold is 0. While it is on, FT_insertFile and
+  FT_replaceFileContents store such contents as an FT-owned copy,
+  compressed if that makes it smaller; the caller keeps its own
+  buffer. FT_getFileContents decompresses them into a small cache
+  and returns the cached copy, which must be neither modified nor
+  freed and stays valid only until several other compressed files
+  have been read. FT_stat reports the uncompressed size. Compression
+  is off after FT_init.
+  Returns SUCCESS, or INITIALIZATION_ERROR if the FT is not in an
+  initialized state.
+*/
+int FT_setCompression(size_t ulThreshold);
+
+/*
+  Keeps the contents owned by the FT (those taken, copied,
+  deduplicated, or compressed, and those being written in place by
+  FT_writeFile or FT_appendFile; not those borrowed or those taken
+  with a pfFree of the caller's own) within ulBudget bytes of memory,
+  as stored, by evicting the least recently used of them, other than
+  those being written in place, to the spill file pcSpillFile, which
+  is created or emptied, and reading them back when they are next
+  accessed. The directory structure always stays in memory, as do
+  pinned contents. The pointer FT_getFileContents returns to such
+  contents stays valid only until they are evicted; pin them to keep
+  them in memory. If pcSpillFile is NULL, every evicted file's
+  contents are read back and the spill file is removed, as it is by
+  FT_destroy. There is no budget after
+  FT_init. A checkpoint started by FT_checkpointAsync is waited for
+  first, as its child may still be reading the spill file.
+  Returns SUCCESS if the budget is set.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * IO_ERROR if pcSpillFile could not be created, in which case there
+             is no budget, or if an evicted file's contents could not
+             be read back
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_setMemoryBudget(const char *pcSpillFile, size_t ulBudget);
+
+/*
+  Sets how FT_insertFile and FT_replaceFileContents hold the contents
+  they are given from now on, as described for enum FT_Ownership.
+  Under FT_TAKE, taken contents are freed by calling
+  (*pfFree)(pvContents), or free(pvContents) if pfFree is NULL;
+  removing a directory frees those of every file beneath it. Contents
+  taken with a pfFree other than free are never evicted under
+  FT_setMemoryBudget, so pfFree is only called once their file is
+  gone. Contents are borrowed after FT_init.
+  Returns SUCCESS, or INITIALIZATION_ERROR if the FT is not in an
+  initialized state.
+*/
+int FT_setOwnership(enum FT_Ownership eOwnership,
+                    void (*pfFree)(void *pvContents));
+
+/* Metrics about the copies of file contents made by the FT */
+struct FT_ContentStats
+{
+   /* the number of files referring to a shared copy, and the bytes
+      their contents would take up if each had its own */
+   size_t ulReferences;
+   size_t ulLogicalBytes;
+   /* the number of shared copies, and the bytes they take up */
+   size_t ulDistinct;
+   size_t ulStoredBytes;
+   /* ulLogicalBytes / ulStoredBytes, or 1 if nothing is shared */
+   double dDedupRatio;
+   /* the number of compressed copies, and the bytes they take up
+      uncompressed and compressed */
+   size_t ulCompressed;
+   size_t ulCompressedLogicalBytes;
+   size_t ulCompressedStoredBytes;
+   /* the reads of compressed copies served from the cache, and those
+      that had to decompress */
+   size_t ulCacheHits;
+   size_t ulCacheMisses;
+   /* the bytes the resident contents FT_setMemoryBudget counts take
+      up, and the number of contents evicted to the spill file and the
+      bytes they take up there */
+   size_t ulResidentBytes;
+   size_t ulSpilled;
+   size_t ulSpilledBytes;
+   /* the accesses that found contents resident, those that read them
+      back from the spill file, and the evictions to it */
+   size_t ulSpillHits;
+   size_t ulSpillMisses;
+   size_t ulEvictions;
+};
+
+/*
+  Fills *psStats with metrics about the contents stored while
+  deduplication, compression, or a memory budget was on.
+*/
+void FT_getContentStats(struct FT_ContentStats *psStats);
+
+/*
+  Turns the name index on (if bEnable) or off. While it is on, every
+  directory and file is indexed by the last component of its path, so
+  that FT_findByName takes time proportional to the number of matches
+  rather than to the size of the FT, at the cost in memory that
+  FT_getNameIndexStats reports. Turning it on indexes the whole FT.
+  It is off after FT_init, and turns itself off if there is no memory
+  to index a node as the FT changes.
+  Returns SUCCESS if the index is turned on or off.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request,
+                 in which case the index stays off
+*/
+int FT_setNameIndex(boolean bEnable);
+
+/*
+  Calls (*pfVisit)(psEntry, pvExtra) for each directory or file whose
+  path's last component is pcName, in no particular order, until the
+  visitor returns FT_WALK_STOP. Without the name index this walks the
+  whole FT. The visitor must not change the FT.
+  Returns SUCCESS, whether or not anything was found.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcName is empty or holds a '/'
+*/
+int FT_findByName(const char *pcName,
+                  enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry
+                                                *psEntry, void *pvExtra),
+                  void *pvExtra);
+
+/* Metrics about a secondary index */
+struct FT_IndexStats
+{
+   /* the number of distinct keys, and of entries filed under them */
+   size_t ulKeys;
+   size_t ulEntries;
+   /* the bytes of memory the index occupies, counting the links it
+      keeps for each directory or file it holds, and none while it is
+      off */
+   size_t ulBytes;
+};
+
+/* Fills *psStats with metrics about the name index. */
+void FT_getNameIndexStats(struct FT_IndexStats *psStats);
+
+/*
+  Turns the extension index on (if bEnable) or off. While it is on,
+  every file whose last path component holds a '.' after its first
+  character is indexed by its extension, what follows the last '.',
+  so that FT_findByExtension takes time proportional to the number of
+  files with the extension rather than to the size of the subtree, at
+  the cost in memory that FT_getExtensionIndexStats reports. Turning
+  it on indexes the whole FT. It is off after FT_init, and turns
+  itself off if there is no memory to index a file as the FT changes.
+  Returns SUCCESS if the index is turned on or off.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request,
+                 in which case the index stays off
+*/
+int FT_setExtensionIndex(boolean bEnable);
+
+/*
+  Calls (*pfVisit)(psEntry, pvExtra) for each file in the subtree
+  rooted at absolute path pcPath whose extension is pcExtension (given
+  without its '.'), in no particular order, until the visitor returns
+  FT_WALK_STOP. With the extension index on, only the files with that
+  extension are examined, each by checking that pcPath leads its
+  path; without it the subtree is walked. The visitor must not change
+  the FT.
+  Returns SUCCESS if pcPath is found, whether or not anything was.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path, or
+             pcExtension is empty or holds a '/' or '.'
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+*/
+int FT_findByExtension(const char *pcPath, const char *pcExtension,
+                       enum FT_WalkAction (*pfVisit)(const struct
+                                                     FT_DirEntry *psEntry,
+                                                     void *pvExtra),
+                       void *pvExtra);
+
+/* Fills *psStats with metrics about the extension index. */
+void FT_getExtensionIndexStats(struct FT_IndexStats *psStats);
+
+/*
+  Turns the content index on (if bEnable) or off. While it is on,
+  every file's contents are indexed by the sequences of three bytes
+  they hold, so that FT_findContentCandidates need only name the files
+  that hold those of a pattern rather than every file, at the cost in
+  memory that FT_getContentIndexStats reports. Files whose contents
+  change are indexed again at the next search, not as they change;
+  borrowed contents the caller changes in place are not noticed. It
+  is off after FT_init, and turns itself off if there is no memory to
+  track a file as the FT changes.
+  Returns SUCCESS if the index is turned on or off.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request,
+                 in which case the index stays off
+*/
+int FT_setContentIndex(boolean bEnable);
+
+/*
+  Calls (*pfVisit)(psEntry, pvExtra) for each file whose contents
+  might match pcPattern, in no particular order, until the visitor
+  returns FT_WALK_STOP. pcPattern is a simple regular expression that
+  may match anywhere in a file: '.' matches any byte, '*' lets the
+  item before it repeat any number of times, none included, '\' makes
+  the byte after it literal, and every other byte is literal. Every
+  file with a match is visited, but so may others, so the visitor must
+  check each one. With the content index on, only files holding each
+  three bytes of the pattern's literal runs are visited, along with
+  any whose contents could not be indexed; without it, or for a
+  pattern with no run of three, every file is. The visitor must not
+  change the FT.
+  Returns SUCCESS, whether or not anything was found.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to read the pattern
+*/
+int FT_findContentCandidates(const char *pcPattern,
+                             enum FT_WalkAction (*pfVisit)(const struct
+                                                           FT_DirEntry
+                                                           *psEntry,
+                                                           void *pvExtra),
+                             void *pvExtra);
+
+/*
+  Fills *psStats with metrics about the content index: its keys are
+  distinct trigrams and its entries the files filed under them.
+*/
+void FT_getContentIndexStats(struct FT_IndexStats *psStats);
+
+/*
+  Turns the size index on (if bEnable) or off. While it is on, every
+  file is kept in order of the length of its contents, so that
+  FT_findBySize takes time proportional to the logarithm of the number
+  of files plus the number it lists, rather than to the size of the
+  FT, at the cost in memory that FT_getSizeIndexStats reports. Turning
+  it on indexes the whole FT. It is off after FT_init, and turns
+  itself off if there is no memory to index a file as the FT changes.
+  Returns SUCCESS if the index is turned on or off.
+  Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request,
+                 in which case the index stays off
+*/
+int FT_setSizeIndex(boolean bEnable);
+
+/*
+  Calls (*pfVisit)(psEntry, pvExtra) for each file whose contents are
+  at least ulMin and at most ulMax bytes long, until the visitor
+  returns FT_WALK_STOP. With the size index on, files are visited in
+  ascending order of length, files of equal length in no particular
+  order; without it the whole FT is walked. The visitor must not
+  change the FT.
+  Returns SUCCESS, whether or not anything was found, or
+  INITIALIZATION_ERROR if the FT is not in an initialized state.
+*/
+int FT_findBySize(size_t ulMin, size_t ulMax,
+                  enum FT_WalkAction (*pfVisit)(const struct FT_DirEntry
+                                                *psEntry, void *pvExtra),
+                  void *pvExtra);
+
+/*
+  Fills *psStats with metrics about the size index: its keys are
+  distinct lengths and its entries the files of those lengths.
+*/
+void FT_getSizeIndexStats(struct FT_IndexStats *psStats);
+
+/* What FT_topK ranks nodes by */
+enum FT_Ranking
+{
+   /* files, by the length of their contents */
+   FT_RANK_FILE_SIZE,
+   /* directories, by their number of children */
+   FT_RANK_ENTRIES
+};
+
+/* One node as FT_topK ranks it */
+struct FT_RankEntry
+{
+   /* its absolute path, valid until the FT next changes */
+   const char *pcPath;
+   /* the length of a file's contents, or a directory's number of
+      children */
+   size_t ulValue;
+};
+
+/*
+  Lists into psEntries, best first, up to ulK of the nodes in the
+  subtree rooted at absolute path pcPath, itself included, that rank
+  highest by eRanking: the largest files, or the directories with the
+  most children. Ties are listed in no particular order. Every
+  directory keeps its children in a heap ordered by the best value in
+  their subtrees, so only the nodes listed, the directories on the
+  way to them, and a few of their siblings are looked at: the time
+  taken grows with K and the depth of the subtree, not with its size
+  or the number of children of its directories.
+  Stores in *pulCount how many were listed.
+  Returns SUCCESS if pcPath is found.
+  Otherwise, sets *pulCount to 0 and returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_topK(const char *pcPath, enum FT_Ranking eRanking, size_t ulK,
+            struct FT_RankEntry psEntries[], size_t *pulCount);
+
 /*
   Returns a string representation of the
   data structure, or NULL if the structure is
@@ -149,4 +1021,36 @@ int FT_destroy(void);
 */
 char *FT_toString(void);
 
+/*
+  Returns a string representation of the directory or file with
+  absolute path pcPath and of the nodes below it down to ulMaxDepth
+  levels deeper (0 for pcPath alone, or FT_UNLIMITED for all of
+  them), in the same form as FT_toString, or NULL if the structure is
+  not initialized, pcPath is not found, or there is an allocation
+  error. The time taken is proportional to the length of the result,
+  not to the size of the FT.
+
+  Allocates memory for the returned string,
+  which is then owned by client!
+*/
+char *FT_toStringSubtree(const char *pcPath, size_t ulMaxDepth);
+
+/*
+  Streams the representation FT_toStringSubtree would return for
+  pcPath and ulMaxDepth, without building it, by calling
+  (*pfWrite)(pcText, ulLength, pvExtra) with successive pieces of it,
+  which are not NUL-terminated. If pfWrite returns a status other than
+  SUCCESS the stream ends and that status is returned.
+  Returns SUCCESS if pcPath is found and the stream completed.
+  Otherwise, returns the status pfWrite returned or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+*/
+int FT_writeSubtree(const char *pcPath, size_t ulMaxDepth,
+                    int (*pfWrite)(const char *pcText, size_t ulLength,
+                                   void *pvExtra),
+                    void *pvExtra);
+
 #endif
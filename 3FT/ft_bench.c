@@ -0,0 +1,178 @@
+/*--------------------------------------------------------------------*/
+/* ft_bench.c                                                         */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "ft.h"
+
+/*
+  Measures the throughput/memory trade-off of FT_setCompression. A
+  corpus of text-like files is inserted, read back once in full (the
+  cold pass, which mostly misses the decompression cache), and then a
+  few of them are read many times (the hot pass, which mostly hits
+  it), with compression off and at several thresholds. Build it with
+  the FT sources in place of ft_client.c.
+*/
+
+/* The shape of the corpus and of the hot pass */
+enum { FILE_COUNT = 2000, MIN_FILE_SIZE = 256, MAX_FILE_SIZE = 16384,
+       HOT_FILES = 4, HOT_READS = 200000 };
+
+/* The words the text-like bodies are drawn from */
+static const char *apcWords[] = {
+   "the", "file", "tree", "directory", "node", "path", "contents",
+   "insert", "remove", "return", "status", "struct", "static", "size_t",
+   "const", "char", "void", "int", "if", "else", "for", "while",
+   "assert", "NULL", "SUCCESS", "MEMORY_ERROR", "{", "}", "(", ");",
+   "=", "==", "!=", "+=", "->", "*", "/*", "*/", "\n", "\n   "
+};
+
+/* The state of the pseudo-random generator, for a repeatable corpus */
+static unsigned long ulSeed = 217;
+
+/*
+  Returns the next pseudo-random number in [0, ulBound).
+*/
+static size_t Bench_random(size_t ulBound) {
+   ulSeed = (ulSeed * 1103515245UL + 12345UL) & 0x7FFFFFFFUL;
+   return (size_t) ((ulSeed >> 8) % ulBound);
+}
+
+/*
+  Fills the ulLength bytes at pcBody with words separated by spaces.
+*/
+static void Bench_fillBody(char *pcBody, size_t ulLength) {
+   size_t ulWords = sizeof(apcWords) / sizeof(apcWords[0]);
+   size_t ulPos = 0;
+   const char *pcWord;
+   size_t ulWordLength;
+
+   while(ulPos < ulLength) {
+      pcWord = apcWords[Bench_random(ulWords)];
+      ulWordLength = strlen(pcWord);
+      if(ulWordLength > ulLength - ulPos)
+         ulWordLength = ulLength - ulPos;
+      memcpy(pcBody + ulPos, pcWord, ulWordLength);
+      ulPos += ulWordLength;
+      if(ulPos < ulLength)
+         pcBody[ulPos++] = ' ';
+   }
+}
+
+/*
+  Returns the seconds of processor time since ulStart.
+*/
+static double Bench_seconds(clock_t ulStart) {
+   return (double) (clock() - ulStart) / CLOCKS_PER_SEC;
+}
+
+/*
+  Runs the benchmark with compression threshold ulThreshold on the
+  FILE_COUNT bodies apcBodies of lengths aulLengths, and prints one
+  row of results.
+*/
+static void Bench_run(size_t ulThreshold, char **apcBodies,
+                      size_t *aulLengths, size_t ulTotal) {
+   char acPath[64];
+   struct FT_ContentStats sBefore;
+   struct FT_ContentStats sStats;
+   clock_t ulStart;
+   double dInsert, dCold, dHot;
+   size_t ulHotBytes = 0;
+   size_t ulStored;
+   size_t i;
+   int iStatus;
+   char *pcContents;
+
+   iStatus = FT_init();
+   assert(iStatus == SUCCESS);
+   FT_getContentStats(&sBefore);
+   iStatus = FT_setCompression(ulThreshold);
+   assert(iStatus == SUCCESS);
+   iStatus = FT_insertDir("bench");
+   assert(iStatus == SUCCESS);
+
+   ulStart = clock();
+   for(i = 0; i < FILE_COUNT; i++) {
+      sprintf(acPath, "bench/f%lu", (unsigned long) i);
+      iStatus = FT_insertFile(acPath, apcBodies[i], aulLengths[i]);
+      assert(iStatus == SUCCESS);
+   }
+   dInsert = Bench_seconds(ulStart);
+
+   ulStart = clock();
+   for(i = 0; i < FILE_COUNT; i++) {
+      sprintf(acPath, "bench/f%lu", (unsigned long) i);
+      pcContents = FT_getFileContents(acPath);
+      assert(pcContents != NULL);
+      assert(memcmp(pcContents, apcBodies[i], aulLengths[i]) == 0);
+   }
+   dCold = Bench_seconds(ulStart);
+
+   ulStart = clock();
+   for(i = 0; i < HOT_READS; i++) {
+      sprintf(acPath, "bench/f%lu", (unsigned long) (i % HOT_FILES));
+      pcContents = FT_getFileContents(acPath);
+      assert(pcContents != NULL);
+      ulHotBytes += aulLengths[i % HOT_FILES];
+   }
+   dHot = Bench_seconds(ulStart);
+
+   /* uncompressed contents are borrowed, so count them as stored */
+   FT_getContentStats(&sStats);
+   ulStored = ulTotal - sStats.ulCompressedLogicalBytes
+      + sStats.ulCompressedStoredBytes;
+
+   printf("%9lu %10lu %6.2f %9.1f %9.1f %9.1f %8lu %8lu\n",
+          (unsigned long) ulThreshold, (unsigned long) ulStored,
+          (double) ulTotal / ulStored,
+          ulTotal / 1e6 / (dInsert > 0 ? dInsert : 1e-9),
+          ulTotal / 1e6 / (dCold > 0 ? dCold : 1e-9),
+          ulHotBytes / 1e6 / (dHot > 0 ? dHot : 1e-9),
+          (unsigned long) (sStats.ulCacheHits - sBefore.ulCacheHits),
+          (unsigned long) (sStats.ulCacheMisses
+                           - sBefore.ulCacheMisses));
+
+   iStatus = FT_destroy();
+   assert(iStatus == SUCCESS);
+}
+
+/*
+  Builds the corpus and runs the benchmark at each threshold.
+  Returns 0, or 1 if the corpus could not be allocated.
+*/
+int main(void) {
+   static const size_t aulThresholds[] = { 0, 16384, 4096, 1024, 256 };
+   char *apcBodies[FILE_COUNT];
+   size_t aulLengths[FILE_COUNT];
+   size_t ulTotal = 0;
+   size_t i;
+
+   for(i = 0; i < FILE_COUNT; i++) {
+      aulLengths[i] = MIN_FILE_SIZE
+         + Bench_random(MAX_FILE_SIZE - MIN_FILE_SIZE + 1);
+      apcBodies[i] = malloc(aulLengths[i]);
+      if(apcBodies[i] == NULL) {
+         fprintf(stderr, "out of memory\n");
+         return 1;
+      }
+      Bench_fillBody(apcBodies[i], aulLengths[i]);
+      ulTotal += aulLengths[i];
+   }
+
+   printf("%lu files, %lu bytes; throughputs in MB/s\n",
+          (unsigned long) FILE_COUNT, (unsigned long) ulTotal);
+   printf("%9s %10s %6s %9s %9s %9s %8s %8s\n", "threshold", "stored",
+          "ratio", "insert", "cold", "hot", "hits", "misses");
+   for(i = 0; i < sizeof(aulThresholds) / sizeof(aulThresholds[0]); i++)
+      Bench_run(aulThresholds[i], apcBodies, aulLengths, ulTotal);
+
+   for(i = 0; i < FILE_COUNT; i++)
+      free(apcBodies[i]);
+   return 0;
+}
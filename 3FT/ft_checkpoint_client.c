@@ -0,0 +1,127 @@
+/*--------------------------------------------------------------------*/
+/* ft_checkpoint_client.c                                             */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The files this client writes, and removes again before exiting */
+#define SNAPSHOT_FILE "ft_checkpoint_client.snap"
+#define LOG_FILE "ft_checkpoint_client.log"
+#define PREV_FILE "ft_checkpoint_client.log.prev"
+
+/* A snapshot path whose directory does not exist */
+#define BAD_SNAPSHOT_FILE "ft_checkpoint_client.missing/snap"
+
+/* The number of directories the tree starts with */
+enum {DIR_COUNT = 2000};
+
+/*--------------------------------------------------------------------*/
+
+/* Returns TRUE if the file pcFile exists, or FALSE if not. */
+static boolean exists(const char *pcFile) {
+   FILE *psFile;
+
+   psFile = fopen(pcFile, "rb");
+   if (psFile == NULL)
+      return FALSE;
+   fclose(psFile);
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Tears the FT down and recovers it from SNAPSHOT_FILE and LOG_FILE,
+  asserting that it comes back as pcExpected, the FT_toString of the
+  tree before the teardown.
+*/
+static void crashAndRecover(const char *pcExpected) {
+   char *pcAfter;
+
+   assert(FT_destroy() == SUCCESS);
+   assert(FT_init() == SUCCESS);
+   assert(FT_recover(SNAPSHOT_FILE, LOG_FILE) == SUCCESS);
+   pcAfter = FT_toString();
+   assert(pcAfter != NULL && strcmp(pcExpected, pcAfter) == 0);
+   free(pcAfter);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_checkpointAsync and FT_pollCheckpoint: that mutations made
+  while the child writes the snapshot survive recovery, and that after
+  a failed checkpoint the journal moved aside is still replayed.
+  Returns 0.
+*/
+int main(void) {
+   struct FT_CheckpointStats sStats;
+   char acPath[32];
+   char *pcBefore;
+   boolean bDone;
+   int i;
+
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+   remove(PREV_FILE);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_pollCheckpoint(FALSE, &bDone) == INITIALIZATION_ERROR);
+   assert(FT_openJournal(LOG_FILE, 8) == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   for (i = 0; i < DIR_COUNT; i++) {
+      sprintf(acPath, "r/d%d/f", i);
+      assert(FT_insertFile(acPath, "data", 5) == SUCCESS);
+   }
+
+   /* mutate the tree while the child persists it */
+   assert(FT_checkpointAsync(SNAPSHOT_FILE) == SUCCESS);
+   assert(FT_checkpointAsync(SNAPSHOT_FILE) == INITIALIZATION_ERROR);
+   assert(FT_checkpoint(SNAPSHOT_FILE) == INITIALIZATION_ERROR);
+   FT_getCheckpointStats(&sStats);
+   assert(sStats.bRunning);
+   for (i = 0; i < DIR_COUNT / 20; i++) {
+      sprintf(acPath, "r/d%d", i);
+      assert(FT_rmDir(acPath) == SUCCESS);
+   }
+   assert(FT_insertDir("r/after") == SUCCESS);
+   assert(FT_pollCheckpoint(TRUE, &bDone) == SUCCESS && bDone);
+   FT_getCheckpointStats(&sStats);
+   assert(!sStats.bRunning && sStats.ulCompleted == 1);
+   assert(sStats.ulFailed == 0 && sStats.ulLastBytes > 0);
+   assert(!exists(PREV_FILE));
+   pcBefore = FT_toString();
+   assert(pcBefore != NULL);
+   crashAndRecover(pcBefore);
+   free(pcBefore);
+
+   /* a failed checkpoint leaves the moved-aside journal to replay */
+   assert(FT_openJournal(LOG_FILE, 1) == SUCCESS);
+   assert(FT_insertDir("r/x1") == SUCCESS);
+   assert(FT_checkpointAsync(BAD_SNAPSHOT_FILE) == SUCCESS);
+   assert(FT_insertDir("r/x2") == SUCCESS);
+   assert(FT_pollCheckpoint(TRUE, &bDone) == IO_ERROR && bDone);
+   FT_getCheckpointStats(&sStats);
+   assert(sStats.ulFailed == 1 && !sStats.bRunning);
+   assert(exists(PREV_FILE));
+   pcBefore = FT_toString();
+   assert(pcBefore != NULL);
+   crashAndRecover(pcBefore);
+
+   /* a later synchronous checkpoint folds both logs in */
+   assert(FT_openJournal(LOG_FILE, 1) == SUCCESS);
+   assert(FT_checkpoint(SNAPSHOT_FILE) == SUCCESS);
+   assert(!exists(PREV_FILE));
+   crashAndRecover(pcBefore);
+   free(pcBefore);
+   assert(FT_destroy() == SUCCESS);
+
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+   printf("ft_checkpoint_client: all checks passed\n");
+   return 0;
+}
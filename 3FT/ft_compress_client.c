@@ -0,0 +1,176 @@
+/*--------------------------------------------------------------------*/
+/* ft_compress_client.c                                               */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+#include "lz.h"
+
+/* The files this client writes, and removes again before exiting */
+#define SNAPSHOT_FILE "ft_compress_client.snap"
+#define LOG_FILE "ft_compress_client.log"
+
+/* The lengths of the repetitive and of the random test contents */
+enum {TEXT_LENGTH = 5000};
+enum {NOISE_LENGTH = 100000};
+
+/* The number of compressed files inserted by checkTree */
+enum {FILE_COUNT = 20};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks LZ_compress and LZ_decompress on the ulLength bytes at
+  pcData: the round trip gives them back, and a wrong output length
+  or a truncated input is rejected.
+*/
+static void checkRoundTrip(const char *pcData, size_t ulLength) {
+   char *pcPacked;
+   char *pcOut;
+   size_t ulPacked;
+
+   pcPacked = malloc(2 * ulLength + 16);
+   pcOut = malloc(ulLength + 1);
+   assert(pcPacked != NULL && pcOut != NULL);
+   ulPacked = LZ_compress(pcData, ulLength, pcPacked, 2 * ulLength + 16);
+   assert(ulPacked > 0);
+   assert(LZ_decompress(pcPacked, ulPacked, pcOut, ulLength));
+   assert(memcmp(pcOut, pcData, ulLength) == 0);
+   if (ulLength > 0) {
+      assert(!LZ_decompress(pcPacked, ulPacked, pcOut, ulLength - 1));
+      assert(!LZ_decompress(pcPacked, ulPacked - 1, pcOut, ulLength));
+   }
+   free(pcPacked);
+   free(pcOut);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_setCompression on contents built from pcText and pcNoise:
+  that files at or above the threshold are compressed and read back
+  intact, that an abort restores a compressed file's old contents, and
+  that compressed contents survive a checkpoint and recovery.
+*/
+static void checkTree(char *pcText, char *pcNoise) {
+   struct FT_ContentStats sStats;
+   char acPath[32];
+   char *pcContents;
+   boolean bIsFile;
+   size_t ulSize;
+   int i;
+
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_setCompression(100) == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   for (i = 0; i < FILE_COUNT; i++) {
+      sprintf(acPath, "r/f%d", i);
+      pcText[0] = (char)('a' + i);
+      assert(FT_insertFile(acPath, pcText, TEXT_LENGTH) == SUCCESS);
+   }
+   assert(FT_insertFile("r/small", pcText, 50) == SUCCESS);
+   assert(FT_getFileContents("r/small") == pcText);
+   assert(FT_insertFile("r/noise", pcNoise, NOISE_LENGTH) == SUCCESS);
+   assert(memcmp(FT_getFileContents("r/noise"), pcNoise, NOISE_LENGTH)
+          == 0);
+   assert(FT_stat("r/f3", &bIsFile, &ulSize) == SUCCESS);
+   assert(bIsFile && ulSize == TEXT_LENGTH);
+   for (i = 0; i < FILE_COUNT; i++) {
+      sprintf(acPath, "r/f%d", i);
+      pcContents = FT_getFileContents(acPath);
+      assert(pcContents[0] == 'a' + i);
+      assert(memcmp(pcContents + 1, pcText + 1, TEXT_LENGTH - 1) == 0);
+   }
+   FT_getContentStats(&sStats);
+   assert(sStats.ulCompressed == FILE_COUNT + 1);
+   assert(sStats.ulCompressedStoredBytes
+          < sStats.ulCompressedLogicalBytes);
+
+   /* an abort brings back the compressed contents a replace dropped */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_replaceFileContents("r/f2", pcText, 10) == NULL);
+   assert(FT_rmFile("r/f3") == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   pcContents = FT_getFileContents("r/f2");
+   assert(pcContents[0] == 'c');
+   assert(memcmp(pcContents + 1, pcText + 1, TEXT_LENGTH - 1) == 0);
+   assert(FT_stat("r/f3", &bIsFile, &ulSize) == SUCCESS);
+   assert(ulSize == TEXT_LENGTH);
+
+   /* compression and deduplication combine */
+   assert(FT_setDedup(TRUE) == SUCCESS);
+   assert(FT_insertFile("r/d1", pcText, TEXT_LENGTH) == SUCCESS);
+   assert(FT_insertFile("r/d2", pcText, TEXT_LENGTH) == SUCCESS);
+   assert(FT_getFileContents("r/d1") == FT_getFileContents("r/d2"));
+   FT_getContentStats(&sStats);
+   assert(sStats.ulDistinct == 1 && sStats.ulReferences == 2);
+   assert(sStats.ulStoredBytes < TEXT_LENGTH / 10);
+
+   assert(FT_replaceFileContents("r/f1", pcText, 10) == NULL);
+   assert(FT_openJournal(LOG_FILE, 1) == SUCCESS);
+   assert(FT_checkpoint(SNAPSHOT_FILE) == SUCCESS);
+   assert(FT_destroy() == SUCCESS);
+   FT_getContentStats(&sStats);
+   assert(sStats.ulCompressed == 0);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_setCompression(100) == SUCCESS);
+   assert(FT_recover(SNAPSHOT_FILE, LOG_FILE) == SUCCESS);
+   assert(memcmp(FT_getFileContents("r/d2"), pcText, TEXT_LENGTH) == 0);
+   assert(memcmp(FT_getFileContents("r/noise"), pcNoise, NOISE_LENGTH)
+          == 0);
+   assert(FT_stat("r/f1", &bIsFile, &ulSize) == SUCCESS);
+   assert(ulSize == 10);
+   FT_getContentStats(&sStats);
+   assert(sStats.ulCompressed > 0);
+   assert(FT_destroy() == SUCCESS);
+
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks the LZ codec on repetitive, random, and nearly random data,
+  and then compression of file contents in the FT. Returns 0.
+*/
+int main(void) {
+   char *pcText;
+   char *pcNoise;
+   char acPacked[16];
+   size_t ulIndex;
+
+   pcText = malloc(TEXT_LENGTH);
+   pcNoise = malloc(NOISE_LENGTH);
+   assert(pcText != NULL && pcNoise != NULL);
+
+   for (ulIndex = 0; ulIndex < TEXT_LENGTH; ulIndex++)
+      pcText[ulIndex] = "abcab cabd"[ulIndex % 10];
+   checkRoundTrip(pcText, TEXT_LENGTH);
+   assert(LZ_compress(pcText, TEXT_LENGTH, pcNoise, NOISE_LENGTH)
+          < TEXT_LENGTH / 10);
+
+   srand(1);
+   for (ulIndex = 0; ulIndex < NOISE_LENGTH; ulIndex++)
+      pcNoise[ulIndex] = (char)rand();
+   checkRoundTrip(pcNoise, NOISE_LENGTH);
+   for (ulIndex = 0; ulIndex < NOISE_LENGTH; ulIndex++)
+      pcNoise[ulIndex] = "xyz"[rand() % 3];
+   checkRoundTrip(pcNoise, NOISE_LENGTH);
+   checkRoundTrip(pcText, 0);
+   assert(LZ_compress(pcText, 0, acPacked, sizeof(acPacked)) == 1);
+
+   checkTree(pcText, pcNoise);
+
+   free(pcText);
+   free(pcNoise);
+   printf("ft_compress_client: all checks passed\n");
+   return 0;
+}
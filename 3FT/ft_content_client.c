@@ -0,0 +1,298 @@
+/*--------------------------------------------------------------------*/
+/* ft_content_client.c                                                */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The most candidates a search may name, and the longest path */
+enum {MAX_CANDIDATES = 2000};
+enum {MAX_PATH = 64};
+
+/* The number of random mutations */
+enum {STEP_COUNT = 6000};
+
+/* The patterns checked; the first PRECISE_COUNT are a single run of
+   three, so the index names exactly the files that match them */
+static const char *apcPatterns[] = {
+   "abc", "cab", "aaa", "a.c", "ab*c", "abca", "bcabca", "x\\.y", "ab",
+   "", "c.*ab", "\\a\\b\\c", "bbbb"
+};
+
+/* The number of patterns, and of those the index answers exactly */
+enum {PATTERN_COUNT = 13};
+enum {PRECISE_COUNT = 3};
+
+/* The candidates the last search named */
+static char aacCandidates[MAX_CANDIDATES][MAX_PATH];
+static int iCandidates;
+
+/* The pattern, and whether every candidate must match it, that
+   checkVisit checks against */
+static const char *pcPattern;
+static boolean bPrecise;
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns TRUE if the pattern pcPat matches a prefix of the ulText
+  bytes at pcText, or FALSE if not.
+*/
+static boolean matchHere(const char *pcPat, const char *pcText,
+                         size_t ulText) {
+   boolean bAny = FALSE;
+   char c = *pcPat;
+   size_t ulItem = 1;
+   size_t ulSkip;
+
+   if (*pcPat == '\0')
+      return TRUE;
+   if (pcPat[0] == '\\' && pcPat[1] != '\0') {
+      c = pcPat[1];
+      ulItem = 2;
+   }
+   else if (pcPat[0] == '.')
+      bAny = TRUE;
+
+   if (pcPat[ulItem] == '*') {
+      for (ulSkip = 0; ; ulSkip++) {
+         if (matchHere(pcPat + ulItem + 1, pcText + ulSkip,
+                       ulText - ulSkip))
+            return TRUE;
+         if (ulSkip == ulText || (!bAny && pcText[ulSkip] != c))
+            return FALSE;
+      }
+   }
+   if (ulText == 0 || (!bAny && *pcText != c))
+      return FALSE;
+   return matchHere(pcPat + ulItem, pcText + 1, ulText - 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns TRUE if the pattern pcPat matches anywhere in the ulText
+  bytes at pcText, or FALSE if not.
+*/
+static boolean matchAnywhere(const char *pcPat, const char *pcText,
+                             size_t ulText) {
+   size_t ulStart;
+
+   for (ulStart = 0; ulStart <= ulText; ulStart++)
+      if (matchHere(pcPat, pcText + ulStart, ulText - ulStart))
+         return TRUE;
+   return FALSE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Records psEntry as a candidate, and goes on. */
+static enum FT_WalkAction collectVisit(const struct FT_DirEntry *psEntry,
+                                       void *pvExtra) {
+   (void)pvExtra;
+   assert(psEntry->bIsFile && FT_containsFile(psEntry->pcPath));
+   assert(iCandidates < MAX_CANDIDATES
+          && strlen(psEntry->pcPath) < MAX_PATH);
+   strcpy(aacCandidates[iCandidates++], psEntry->pcPath);
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns TRUE if the last search named pcPath, or FALSE if not. */
+static boolean isCandidate(const char *pcPath) {
+   int i;
+
+   for (i = 0; i < iCandidates; i++)
+      if (strcmp(aacCandidates[i], pcPath) == 0)
+         return TRUE;
+   return FALSE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that the last search named psEntry if it is a file whose
+  contents match pcPattern, and, if bPrecise, only if so.
+*/
+static enum FT_WalkAction checkVisit(const struct FT_DirEntry *psEntry,
+                                     void *pvExtra) {
+   const char *pcContents;
+   boolean bMatch;
+
+   (void)pvExtra;
+   if (!psEntry->bIsFile)
+      return FT_WALK_CONTINUE;
+   pcContents = FT_getFileContents(psEntry->pcPath);
+   bMatch = matchAnywhere(pcPattern,
+                          pcContents != NULL ? pcContents : "",
+                          psEntry->ulSize);
+   if (bMatch != isCandidate(psEntry->pcPath) && (bMatch || bPrecise)) {
+      fprintf(stderr, "%s: %s %.*s\n", pcPattern, psEntry->pcPath,
+              (int)psEntry->ulSize, pcContents);
+      assert(FALSE);
+   }
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that FT_findContentCandidates(pcPat) names every file below
+  "r" whose contents match pcPat, and, if bExact, no other.
+*/
+static void checkPattern(const char *pcPat, boolean bExact) {
+   iCandidates = 0;
+   assert(FT_findContentCandidates(pcPat, collectVisit, NULL) == SUCCESS);
+   pcPattern = pcPat;
+   bPrecise = bExact;
+   if (FT_containsDir("r"))
+      assert(FT_walk("r", checkVisit, NULL) == SUCCESS);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks that a search finds every match, and names only matches for
+  a single run of three while the index is on, across a pseudo-random
+  series of insertions, replacements, appends, writes, removals, and
+  transactions committed and aborted, with the index turned off and
+  on again partway.
+*/
+static void checkMutations(void) {
+   char acPath[MAX_PATH];
+   char acData[16];
+   boolean bIndexed = TRUE;
+   int iOp;
+   int iLength;
+   int i;
+   int k;
+
+   assert(FT_setContentIndex(TRUE) == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_setContentIndex(TRUE) == SUCCESS);
+   assert(FT_setOwnership(FT_COPY, NULL) == SUCCESS);
+   checkPattern("abc", TRUE);
+   assert(iCandidates == 0);
+
+   srand(7);
+   for (i = 0; i < STEP_COUNT; i++) {
+      iOp = rand() % 12;
+      sprintf(acPath, "r/%c/%c/%c", 'a' + rand() % 4, 'a' + rand() % 4,
+              'a' + rand() % 5);
+      iLength = rand() % 12;
+      for (k = 0; k < iLength; k++)
+         acData[k] = "abcx.y"[rand() % (rand() % 2 ? 3 : 6)];
+      /* a transaction begun here may still be open from the last */
+      if (i % 400 == 0 && rand() % 2)
+         (void)FT_begin();
+      if (i == STEP_COUNT / 2 || i == STEP_COUNT * 7 / 12) {
+         bIndexed = !bIndexed;
+         assert(FT_setContentIndex(bIndexed) == SUCCESS);
+      }
+      if (iOp < 4)
+         (void)FT_insertFile(acPath, acData, (size_t)iLength);
+      else if (iOp < 6)
+         (void)FT_replaceFileContents(acPath, acData, (size_t)iLength);
+      else if (iOp < 7)
+         (void)FT_appendFile(acPath, acData, (size_t)iLength);
+      else if (iOp < 8)
+         (void)FT_writeFile(acPath, (size_t)(iLength % 3), acData,
+                            (size_t)iLength);
+      else if (iOp < 9) {
+         *strrchr(acPath, '/') = '\0';
+         (void)FT_rmDir(acPath);
+      }
+      else if (iOp < 10)
+         (void)FT_rmFile(acPath);
+      else if (iOp < 11)
+         (void)FT_insertDir(acPath);
+      else if (rand() % 20 == 0) {
+         if (FT_abort() != SUCCESS)
+            (void)FT_commit();
+      }
+      else if (rand() % 20 == 0)
+         (void)FT_commit();
+      if (i % 53 == 0)
+         for (k = 0; k < PATTERN_COUNT; k++)
+            checkPattern(apcPatterns[k], bIndexed && k < PRECISE_COUNT);
+   }
+   (void)FT_commit();
+
+   /* an abort drops what it indexed and brings back what it removed */
+   (void)FT_insertDir("r/a");
+   assert(FT_insertFile("r/a/kept", "xxyzzy", 6) == SUCCESS);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmFile("r/a/kept") == SUCCESS);
+   assert(FT_insertFile("r/a/new", "plugh", 5) == SUCCESS);
+   checkPattern("xyzzy", TRUE);
+   assert(iCandidates == 0);
+   checkPattern("plugh", TRUE);
+   assert(iCandidates == 1);
+   assert(FT_abort() == SUCCESS);
+   checkPattern("plugh", TRUE);
+   assert(iCandidates == 0);
+   checkPattern("xyzzy", TRUE);
+   assert(iCandidates == 1 && isCandidate("r/a/kept"));
+   assert(FT_destroy() == SUCCESS);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks that the index narrows a search for a distinctive run among
+  many compressed files to a handful of candidates.
+*/
+static void checkCompressed(void) {
+   struct FT_IndexStats sStats;
+   char acPath[MAX_PATH];
+   char acData[48];
+   char acRun[8];
+   const char *pcContents;
+   int i;
+   int k;
+
+   assert(FT_init() == SUCCESS);
+   FT_getContentIndexStats(&sStats);
+   assert(sStats.ulKeys == 0 && sStats.ulEntries == 0);
+   assert(FT_setOwnership(FT_COPY, NULL) == SUCCESS);
+   assert(FT_setCompression(8) == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   for (i = 0; i < 600; i++) {
+      for (k = 0; k < (int)sizeof(acData); k++)
+         acData[k] = (char)('A' + rand() % 26);
+      sprintf(acPath, "r/%d/f%d", i % 7, i);
+      assert(FT_insertFile(acPath, acData, sizeof(acData)) == SUCCESS);
+   }
+   assert(FT_setContentIndex(TRUE) == SUCCESS);
+   for (i = 0; i < 300; i++) {
+      sprintf(acPath, "r/%d/f%d", i % 7, i);
+      pcContents = FT_getFileContents(acPath);
+      assert(pcContents != NULL);
+      memcpy(acRun, pcContents + i % 40, 5);
+      acRun[5] = '\0';
+      checkPattern(acRun, FALSE);
+      assert(isCandidate(acPath) && iCandidates < 5);
+   }
+   FT_getContentIndexStats(&sStats);
+   assert(sStats.ulKeys > 0 && sStats.ulEntries >= 600);
+   assert(FT_destroy() == SUCCESS);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_setContentIndex, FT_findContentCandidates, and
+  FT_getContentIndexStats against a reference matcher applied to
+  every file. Returns 0.
+*/
+int main(void) {
+   checkMutations();
+   checkCompressed();
+
+   printf("ft_content_client: all checks passed\n");
+   return 0;
+}
@@ -0,0 +1,100 @@
+/*--------------------------------------------------------------------*/
+/* ft_dedup_client.c                                                  */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The files this client writes, and removes again before exiting */
+#define SNAPSHOT_FILE "ft_dedup_client.snap"
+#define LOG_FILE "ft_dedup_client.log"
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_setDedup: that equal contents share one copy, that an
+  aborted transaction keeps the shared copies its mutations dropped,
+  that the counts fall as files stop referring to them, and that
+  recovery shares contents again when deduplication is on.
+  Returns 0.
+*/
+int main(void) {
+   struct FT_ContentStats sStats;
+   char acHello[] = "hello world";
+   char acHelloToo[] = "hello world";
+   char acOther[] = "other";
+   char *pcBefore;
+   char *pcAfter;
+
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+
+   assert(FT_setDedup(TRUE) == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_setDedup(TRUE) == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   assert(FT_insertFile("r/a", acHello, sizeof(acHello)) == SUCCESS);
+   assert(FT_insertFile("r/b", acHelloToo, sizeof(acHelloToo))
+          == SUCCESS);
+   assert(FT_insertFile("r/c", acOther, sizeof(acOther)) == SUCCESS);
+   assert(FT_getFileContents("r/a") == FT_getFileContents("r/b"));
+   assert(FT_getFileContents("r/a") != acHello);
+   FT_getContentStats(&sStats);
+   assert(sStats.ulReferences == 3 && sStats.ulDistinct == 2);
+   assert(sStats.ulLogicalBytes == 30 && sStats.ulStoredBytes == 18);
+   assert(sStats.dDedupRatio > 1.0);
+
+   /* dropping every reference inside a transaction is undone */
+   pcBefore = FT_toString();
+   assert(pcBefore != NULL);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_replaceFileContents("r/a", acOther, sizeof(acOther))
+          == NULL);
+   assert(FT_rmFile("r/b") == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   pcAfter = FT_toString();
+   assert(pcAfter != NULL && strcmp(pcBefore, pcAfter) == 0);
+   free(pcBefore);
+   free(pcAfter);
+   assert(strcmp(FT_getFileContents("r/a"), "hello world") == 0);
+   assert(FT_getFileContents("r/a") == FT_getFileContents("r/b"));
+   FT_getContentStats(&sStats);
+   assert(sStats.ulReferences == 3 && sStats.ulDistinct == 2);
+
+   /* the same mutations outside a transaction free the copy */
+   assert(FT_replaceFileContents("r/a", acOther, sizeof(acOther))
+          == NULL);
+   assert(FT_rmFile("r/b") == SUCCESS);
+   FT_getContentStats(&sStats);
+   assert(sStats.ulReferences == 2 && sStats.ulDistinct == 1);
+
+   /* with deduplication off the caller's buffer is kept as before */
+   assert(FT_setDedup(FALSE) == SUCCESS);
+   assert(FT_insertFile("r/d", acHello, sizeof(acHello)) == SUCCESS);
+   assert(FT_getFileContents("r/d") == acHello);
+   assert(FT_replaceFileContents("r/d", acHelloToo, sizeof(acHelloToo))
+          == acHello);
+   assert(FT_getFileContents("r/d") == acHelloToo);
+
+   assert(FT_openJournal(LOG_FILE, 1) == SUCCESS);
+   assert(FT_checkpoint(SNAPSHOT_FILE) == SUCCESS);
+   assert(FT_destroy() == SUCCESS);
+   FT_getContentStats(&sStats);
+   assert(sStats.ulReferences == 0 && sStats.ulDistinct == 0);
+
+   /* recovery with deduplication on shares equal contents again */
+   assert(FT_init() == SUCCESS);
+   assert(FT_setDedup(TRUE) == SUCCESS);
+   assert(FT_recover(SNAPSHOT_FILE, LOG_FILE) == SUCCESS);
+   assert(FT_getFileContents("r/a") == FT_getFileContents("r/c"));
+   assert(strcmp(FT_getFileContents("r/d"), "hello world") == 0);
+   assert(FT_destroy() == SUCCESS);
+
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+   printf("ft_dedup_client: all checks passed\n");
+   return 0;
+}
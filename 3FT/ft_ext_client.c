@@ -0,0 +1,257 @@
+/*--------------------------------------------------------------------*/
+/* ft_ext_client.c                                                    */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The names every path is built from; ".log" has no extension, and
+   "a.b.log" has "log" */
+static const char *apcNames[] = {
+   "a.log", "b", "x.log", ".log", "c.txt", "a.b.log", "logs", "lo"
+};
+
+/* The number of names, and of random mutations */
+enum {NAME_COUNT = 8};
+enum {STEP_COUNT = 4000};
+
+/* The directories searched from after each few mutations */
+static const char *apcDirs[] = {"r", "r/a.log", "r/logs", "r/lo"};
+
+/* The number of directories searched from */
+enum {DIR_COUNT = 4};
+
+/* What countVisit records about a search */
+struct Search
+{
+   /* the directory and the extension searched for */
+   const char *pcDir;
+   const char *pcExtension;
+   /* the number of files visited */
+   int iCount;
+};
+
+/* What walkVisit records about a walk */
+struct Walk
+{
+   /* the extension looked for */
+   const char *pcExtension;
+   /* the number of files with that extension, and with any, visited */
+   int iMatches;
+   int iExtended;
+};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that psEntry is a file in the FT below the directory and
+  with the extension the struct Search pvExtra searches for, and
+  counts it.
+*/
+static enum FT_WalkAction countVisit(const struct FT_DirEntry *psEntry,
+                                     void *pvExtra) {
+   struct Search *psSearch = pvExtra;
+   const char *pcLast = strrchr(psEntry->pcPath, '/');
+   const char *pcDot;
+   size_t ulDir = strlen(psSearch->pcDir);
+
+   assert(psEntry->bIsFile && FT_containsFile(psEntry->pcPath));
+   assert(strncmp(psEntry->pcPath, psSearch->pcDir, ulDir) == 0
+          && psEntry->pcPath[ulDir] == '/');
+   assert(pcLast != NULL);
+   pcDot = strrchr(pcLast + 2, '.');
+   assert(pcDot != NULL && strcmp(pcDot + 1, psSearch->pcExtension) == 0);
+   psSearch->iCount++;
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Counts psEntry in the struct Walk pvExtra if it is a file with an
+  extension, and also as a match if that is the one the walk looks
+  for.
+*/
+static enum FT_WalkAction walkVisit(const struct FT_DirEntry *psEntry,
+                                    void *pvExtra) {
+   struct Walk *psWalk = pvExtra;
+   const char *pcLast = strrchr(psEntry->pcPath, '/');
+   const char *pcDot;
+
+   if (!psEntry->bIsFile || pcLast == NULL)
+      return FT_WALK_CONTINUE;
+   pcDot = strrchr(pcLast + 2, '.');
+   if (pcDot == NULL)
+      return FT_WALK_CONTINUE;
+   if (strcmp(pcDot + 1, psWalk->pcExtension) == 0)
+      psWalk->iMatches++;
+   psWalk->iExtended++;
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns the number of files FT_findByExtension finds below pcDir
+  with extension pcExtension, using the extension index if it is on,
+  or -1 if pcDir is not in the FT.
+*/
+static int countExtension(const char *pcDir, const char *pcExtension) {
+   struct Search sSearch;
+
+   sSearch.pcDir = pcDir;
+   sSearch.pcExtension = pcExtension;
+   sSearch.iCount = 0;
+   if (FT_findByExtension(pcDir, pcExtension, countVisit, &sSearch)
+       != SUCCESS)
+      return -1;
+   return sSearch.iCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns the number of files a walk of pcDir's subtree, which leaves
+  the extension index alone, finds with extension pcExtension, or -1
+  if pcDir is not a directory in the FT, and stores in *piExtended the
+  number of files it finds with any extension.
+*/
+static int walkExtension(const char *pcDir, const char *pcExtension,
+                         int *piExtended) {
+   struct Walk sWalk;
+
+   sWalk.pcExtension = pcExtension;
+   sWalk.iMatches = 0;
+   sWalk.iExtended = 0;
+   *piExtended = 0;
+   if (!FT_containsDir(pcDir))
+      return -1;
+   assert(FT_walk(pcDir, walkVisit, &sWalk) == SUCCESS);
+   *piExtended = sWalk.iExtended;
+   return sWalk.iMatches;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that the extension index, which must be on, finds what a
+  walk of each subtree finds, and holds every file with an extension.
+*/
+static void checkIndex(void) {
+   struct FT_IndexStats sStats;
+   int iExtended;
+   int i;
+
+   for (i = 0; i < DIR_COUNT; i++) {
+      assert(countExtension(apcDirs[i], "log")
+             == walkExtension(apcDirs[i], "log", &iExtended));
+      assert(countExtension(apcDirs[i], "txt")
+             == walkExtension(apcDirs[i], "txt", &iExtended));
+   }
+   (void)walkExtension("r", "log", &iExtended);
+   FT_getExtensionIndexStats(&sStats);
+   assert(sStats.ulBytes > 0 && sStats.ulEntries == (size_t)iExtended);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_setExtensionIndex, FT_findByExtension, and
+  FT_getExtensionIndexStats: that the index, left on throughout, finds
+  what a walk finds after each of a pseudo-random series of mutations
+  and of transactions committed and aborted, that an abort restores
+  it, and that turning it off and on rebuilds it. Returns 0.
+*/
+int main(void) {
+   struct FT_IndexStats sStats;
+   struct Search sSearch;
+   char acPath[64];
+   int iExtended;
+   int iOp;
+   int i;
+
+   assert(FT_setExtensionIndex(TRUE) == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_setExtensionIndex(TRUE) == SUCCESS);
+   sSearch.pcDir = "r";
+   sSearch.pcExtension = "log";
+   sSearch.iCount = 0;
+   assert(FT_findByExtension("r", "log", countVisit, &sSearch)
+          == NO_SUCH_PATH);
+
+   srand(5);
+   for (i = 0; i < STEP_COUNT; i++) {
+      iOp = rand() % 10;
+      sprintf(acPath, "r/%s/%s/%s", apcNames[rand() % NAME_COUNT],
+              apcNames[rand() % NAME_COUNT], apcNames[rand() % NAME_COUNT]);
+      /* a transaction begun here may still be open from the last */
+      if (i % 500 == 0 && rand() % 2)
+         (void)FT_begin();
+      if (iOp < 4)
+         (void)FT_insertFile(acPath, "x", 1);
+      else if (iOp < 7)
+         (void)FT_insertDir(acPath);
+      else if (iOp < 8) {
+         *strrchr(acPath, '/') = '\0';
+         (void)FT_rmDir(acPath);
+      }
+      else if (iOp < 9)
+         (void)FT_rmFile(acPath);
+      else if (rand() % 50 == 0) {
+         if (FT_abort() != SUCCESS)
+            (void)FT_commit();
+      }
+      else if (rand() % 50 == 0)
+         (void)FT_commit();
+      if (i % 97 == 0)
+         checkIndex();
+   }
+   (void)FT_commit();
+   checkIndex();
+   assert(FT_findByExtension("r", ".log", countVisit, &sSearch)
+          == BAD_PATH);
+   assert(FT_findByExtension("r", "", countVisit, &sSearch) == BAD_PATH);
+   assert(FT_findByExtension("q", "log", countVisit, &sSearch)
+          == CONFLICTING_PATH);
+
+   /* an abort undoes what it indexed and brings back what it dropped */
+   (void)FT_insertDir("r/logs");
+   (void)FT_insertFile("r/logs/kept.log", "x", 1);
+   i = countExtension("r", "log");
+   assert(i > 0);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("r/logs") == SUCCESS);
+   assert(FT_insertDir("r/new") == SUCCESS);
+   assert(FT_insertFile("r/new/a.zip", "x", 1) == SUCCESS);
+   assert(FT_insertFile("r/new/b.tar.zip", "x", 1) == SUCCESS);
+   assert(countExtension("r", "zip") == 2);
+   assert(FT_setExtensionIndex(TRUE) == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   assert(countExtension("r", "log") == i);
+   assert(countExtension("r", "zip") == 0);
+   checkIndex();
+
+   /* off, it holds nothing and searches walk; on again, it is rebuilt */
+   assert(FT_setExtensionIndex(FALSE) == SUCCESS);
+   FT_getExtensionIndexStats(&sStats);
+   assert(sStats.ulEntries == 0 && sStats.ulBytes == 0);
+   assert(countExtension("r", "log") == i);
+   assert(walkExtension("r", "log", &iExtended) == i);
+   assert(FT_setExtensionIndex(TRUE) == SUCCESS);
+   checkIndex();
+
+   FT_getExtensionIndexStats(&sStats);
+   assert(sStats.ulKeys <= 2 && sStats.ulEntries > 0);
+   assert(FT_rmDir("r") == SUCCESS);
+   FT_getExtensionIndexStats(&sStats);
+   assert(sStats.ulEntries == 0 && sStats.ulKeys == 0);
+   assert(FT_destroy() == SUCCESS);
+   FT_getExtensionIndexStats(&sStats);
+   assert(sStats.ulEntries == 0 && sStats.ulBytes == 0);
+
+   printf("ft_ext_client: all checks passed\n");
+   return 0;
+}
@@ -0,0 +1,291 @@
+/*--------------------------------------------------------------------*/
+/* ft_glob_client.c                                                   */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The longest listing a search may build */
+enum {MAX_LISTING = 400000};
+
+/* The listings from FT_glob and from the reference matcher */
+static char acFound[MAX_LISTING];
+static char acExpected[MAX_LISTING];
+
+/* The pattern referenceVisit matches against */
+static const char *pcPattern;
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns TRUE if the ulText characters at pcText match the ulPat
+  characters at pcPat, a single path component that may hold '*' and
+  '?', or FALSE if not.
+*/
+static boolean matchComponent(const char *pcPat, size_t ulPat,
+                              const char *pcText, size_t ulText) {
+   size_t ulSkip;
+
+   if (ulPat == 0)
+      return ulText == 0;
+   if (*pcPat == '*') {
+      for (ulSkip = 0; ulSkip <= ulText; ulSkip++)
+         if (matchComponent(pcPat + 1, ulPat - 1, pcText + ulSkip,
+                            ulText - ulSkip))
+            return TRUE;
+      return FALSE;
+   }
+   if (ulText == 0 || (*pcPat != '?' && *pcPat != *pcText))
+      return FALSE;
+   return matchComponent(pcPat + 1, ulPat - 1, pcText + 1, ulText - 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns TRUE if the path pcPath matches the pattern pcPat as FT_glob
+  defines it, or FALSE if not. Either may be "" once exhausted.
+*/
+static boolean matchPath(const char *pcPat, const char *pcPath) {
+   const char *pcPatEnd;
+   const char *pcPathEnd;
+   size_t ulPat;
+   size_t ulPath;
+
+   if (*pcPat == '\0')
+      return *pcPath == '\0';
+   pcPatEnd = strchr(pcPat, '/');
+   ulPat = pcPatEnd != NULL ? (size_t)(pcPatEnd - pcPat) : strlen(pcPat);
+
+   /* "**" matches no components, or one and then itself again */
+   if (ulPat == 2 && pcPat[0] == '*' && pcPat[1] == '*') {
+      if (matchPath(pcPatEnd != NULL ? pcPatEnd + 1 : "", pcPath))
+         return TRUE;
+      if (*pcPath == '\0')
+         return FALSE;
+      pcPathEnd = strchr(pcPath, '/');
+      return matchPath(pcPat, pcPathEnd != NULL ? pcPathEnd + 1 : "");
+   }
+
+   if (*pcPath == '\0')
+      return FALSE;
+   pcPathEnd = strchr(pcPath, '/');
+   ulPath = pcPathEnd != NULL ? (size_t)(pcPathEnd - pcPath)
+                              : strlen(pcPath);
+   if (!matchComponent(pcPat, ulPat, pcPath, ulPath))
+      return FALSE;
+   if (pcPatEnd == NULL)
+      return pcPathEnd == NULL;
+   return matchPath(pcPatEnd + 1, pcPathEnd != NULL ? pcPathEnd + 1 : "");
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Adds psEntry's path to the listing pvExtra, and goes on. */
+static enum FT_WalkAction collectVisit(const struct FT_DirEntry *psEntry,
+                                       void *pvExtra) {
+   char *pcListing = pvExtra;
+
+   assert(strlen(pcListing) + strlen(psEntry->pcPath) + 1 < MAX_LISTING);
+   strcat(pcListing, psEntry->pcPath);
+   strcat(pcListing, "\n");
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Adds psEntry's path to acExpected if it matches pcPattern. */
+static enum FT_WalkAction referenceVisit(const struct FT_DirEntry
+                                         *psEntry, void *pvExtra) {
+   if (matchPath(pcPattern, psEntry->pcPath))
+      return collectVisit(psEntry, pvExtra);
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Counts a visit in the int pvExtra, and ends the search. */
+static enum FT_WalkAction stopVisit(const struct FT_DirEntry *psEntry,
+                                    void *pvExtra) {
+   (void)psEntry;
+   (*(int *)pvExtra)++;
+   return FT_WALK_STOP;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that FT_glob(pcPat) visits exactly the paths below "r" that
+  match it, in FT_toString order.
+*/
+static void checkGlob(const char *pcPat) {
+   acFound[0] = acExpected[0] = '\0';
+   pcPattern = pcPat;
+   assert(FT_glob(pcPat, collectVisit, acFound) == SUCCESS);
+   assert(FT_walk("r", referenceVisit, acExpected) == SUCCESS);
+   if (strcmp(acFound, acExpected) != 0) {
+      fprintf(stderr, "%s:\nfound\n%s\nexpected\n%s\n", pcPat, acFound,
+              acExpected);
+      assert(FALSE);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that FT_glob(pcPat) visits every node, as FT_toString lists
+  them.
+*/
+static void checkEverything(const char *pcPat) {
+   char *pcWhole;
+
+   acFound[0] = '\0';
+   assert(FT_glob(pcPat, collectVisit, acFound) == SUCCESS);
+   pcWhole = FT_toString();
+   assert(pcWhole != NULL && strcmp(pcWhole, acFound) == 0);
+   free(pcWhole);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks patterns with '*' and '?' on a wide, shallow tree, along
+  with visitor stops and an aborted transaction.
+*/
+static void checkWide(void) {
+   static const char *apcNames[] = {
+      "a", "ab", "abc", "b", "logs", "x.txt", "y.txt", "a.txt",
+      "CMakeLists.txt", "aXb"
+   };
+   char acPath[64];
+   int iVisits;
+   int i;
+   int j;
+   int k;
+
+   acFound[0] = '\0';
+   assert(FT_glob("r", collectVisit, acFound) == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_glob("r", collectVisit, acFound) == SUCCESS);
+   assert(acFound[0] == '\0');
+   assert(FT_insertDir("r") == SUCCESS);
+   for (i = 0; i < 10; i++)
+      for (j = 0; j < 10; j++) {
+         sprintf(acPath, "r/%s/%s", apcNames[i], apcNames[j]);
+         if (j % 3 == 0) {
+            assert(FT_insertFile(acPath, "x", 1) == SUCCESS);
+            continue;
+         }
+         assert(FT_insertDir(acPath) == SUCCESS);
+         for (k = 4; k < 9; k++) {
+            sprintf(acPath, "r/%s/%s/%s", apcNames[i], apcNames[j],
+                    apcNames[k]);
+            assert(FT_insertFile(acPath, "x", 1) == SUCCESS);
+         }
+      }
+
+   checkGlob("r");
+   checkGlob("*");
+   checkGlob("r/*");
+   checkGlob("r/a*");
+   checkGlob("r/*/logs/*.txt");
+   checkGlob("r/a?/*");
+   checkGlob("r/*b*/*/a.txt");
+   checkGlob("r/a/ab");
+   checkGlob("r/a/zz");
+   checkGlob("r/*X*/?/*");
+   checkGlob("q/*");
+   checkGlob("r/*/*/*");
+   checkGlob("r/a*b");
+   checkGlob("r/*a*a*");
+   checkGlob("r/**/CMakeLists.txt");
+   checkGlob("**/CMakeLists.txt");
+   checkGlob("**/r");
+   checkEverything("**");
+   checkEverything("r/**");
+   assert(FT_glob("r//a", collectVisit, acFound) == BAD_PATH);
+   iVisits = 0;
+   assert(FT_glob("r/**", stopVisit, &iVisits) == SUCCESS);
+   assert(iVisits == 1);
+
+   /* a search sees the tree an abort restores */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("r/logs") == SUCCESS);
+   assert(FT_insertDir("r/a/ab/new/logs") == SUCCESS);
+   assert(FT_insertFile("r/a/ab/new/logs/new.txt", "x", 1) == SUCCESS);
+   checkGlob("r/*/logs/*.txt");
+   checkGlob("r/**/logs/*.txt");
+   assert(FT_abort() == SUCCESS);
+   checkGlob("r/*/logs/*.txt");
+   checkGlob("r/**/logs/*.txt");
+   assert(!FT_containsDir("r/a/ab/new"));
+   assert(FT_destroy() == SUCCESS);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks patterns with several "**" components on a narrow, deep
+  tree, where a node can match in many ways but is visited once.
+*/
+static void checkDeep(void) {
+   static const char *apcNames[] = {"a", "ab", "b", "x.txt", "a.txt"};
+   char acPath[64];
+   int i;
+   int j;
+   int k;
+   int l;
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   assert(FT_insertFile("r/f1", "x", 1) == SUCCESS);
+   assert(FT_insertFile("r/a/f2", "x", 1) == SUCCESS);
+   assert(FT_insertDir("r/a/c") == SUCCESS);
+   assert(FT_insertDir("r/b") == SUCCESS);
+   acFound[0] = '\0';
+   assert(FT_glob("r/**/*", collectVisit, acFound) == SUCCESS);
+   assert(strcmp(acFound, "r/f1\nr/a\nr/a/f2\nr/a/c\nr/b\n") == 0);
+   checkGlob("r/**/*");
+
+   /* a file's name may have been taken by a directory already */
+   for (i = 0; i < 5; i++)
+      for (j = 0; j < 5; j++)
+         for (k = 0; k < 5; k++)
+            for (l = 0; l < 5; l++) {
+               sprintf(acPath, "r/%s/%s/%s/%s", apcNames[i], apcNames[j],
+                       apcNames[k], apcNames[l]);
+               if (strchr(apcNames[l], '.') != NULL)
+                  (void)FT_insertFile(acPath, "x", 1);
+               else
+                  (void)FT_insertDir(acPath);
+            }
+   checkGlob("r/**/*");
+   checkGlob("r/**");
+   checkGlob("**");
+   checkGlob("**/a/**");
+   checkGlob("r/**/a/*");
+   checkGlob("r/**/a*/**/*.txt");
+   checkGlob("r/**/**/b");
+   checkGlob("**/**/a.txt");
+   checkGlob("r/a/**/b/**");
+   checkGlob("r/*/**/a/**/x*");
+   checkGlob("r/**/a/b/**/a");
+   assert(FT_destroy() == SUCCESS);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_glob against a reference matcher applied to every node
+  FT_walk visits. Returns 0.
+*/
+int main(void) {
+   checkWide();
+   checkDeep();
+
+   printf("ft_glob_client: all checks passed\n");
+   return 0;
+}
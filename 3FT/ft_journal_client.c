@@ -0,0 +1,133 @@
+/*--------------------------------------------------------------------*/
+/* ft_journal_client.c                                                */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The files this client writes, and removes again before exiting */
+#define SNAPSHOT_FILE "ft_journal_client.snap"
+#define LOG_FILE "ft_journal_client.log"
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Cuts the last ulBytes bytes off the file pcFile, as a crash in the
+  middle of writing its tail would.
+*/
+static void tearTail(const char *pcFile, size_t ulBytes) {
+   FILE *psFile;
+   char *pcData;
+   long lLength;
+
+   psFile = fopen(pcFile, "rb");
+   assert(psFile != NULL);
+   assert(fseek(psFile, 0, SEEK_END) == 0);
+   lLength = ftell(psFile);
+   assert(lLength >= (long)ulBytes);
+   rewind(psFile);
+   pcData = malloc((size_t)lLength);
+   assert(pcData != NULL);
+   assert(fread(pcData, 1, (size_t)lLength, psFile) == (size_t)lLength);
+   fclose(psFile);
+
+   psFile = fopen(pcFile, "wb");
+   assert(psFile != NULL);
+   assert(fwrite(pcData, 1, (size_t)lLength - ulBytes, psFile)
+          == (size_t)lLength - ulBytes);
+   fclose(psFile);
+   free(pcData);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_openJournal, FT_checkpoint, and FT_recover: that recovery
+  rebuilds exactly the tree that was logged, including committed
+  transactions but neither aborted nor unfinished ones, and that a
+  torn final record is dropped. Returns 0.
+*/
+int main(void) {
+   char *pcBefore;
+   char *pcAfter;
+   boolean bIsFile;
+   size_t ulSize;
+
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_recover(SNAPSHOT_FILE, LOG_FILE) == SUCCESS);
+   assert(FT_openJournal(LOG_FILE, 3) == SUCCESS);
+   assert(FT_openJournal(LOG_FILE, 3) == INITIALIZATION_ERROR);
+   assert(FT_insertDir("r/a") == SUCCESS);
+   assert(FT_insertFile("r/a/f", "hello", 6) == SUCCESS);
+   assert(FT_insertFile("r/n", NULL, 7) == SUCCESS);
+   assert(FT_checkpoint(SNAPSHOT_FILE) == SUCCESS);
+
+   /* records after the snapshot, with one transaction of each fate */
+   assert(FT_insertDir("r/b/c") == SUCCESS);
+   assert(FT_replaceFileContents("r/a/f", "bye", 4) != NULL);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("r/b") == SUCCESS);
+   assert(FT_commit() == SUCCESS);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_insertDir("r/aborted") == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   assert(FT_insertDir("r/z") == SUCCESS);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_insertDir("r/unfinished") == SUCCESS);
+   assert(FT_closeJournal() == INITIALIZATION_ERROR);
+   assert(FT_syncJournal() == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   pcBefore = FT_toString();
+   assert(pcBefore != NULL);
+   assert(FT_destroy() == SUCCESS);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_recover(SNAPSHOT_FILE, LOG_FILE) == SUCCESS);
+   assert(FT_recover(SNAPSHOT_FILE, LOG_FILE) == INITIALIZATION_ERROR);
+   pcAfter = FT_toString();
+   assert(pcAfter != NULL && strcmp(pcBefore, pcAfter) == 0);
+   free(pcBefore);
+   free(pcAfter);
+   assert(strcmp(FT_getFileContents("r/a/f"), "bye") == 0);
+   assert(FT_getFileContents("r/n") == NULL);
+   assert(FT_stat("r/n", &bIsFile, &ulSize) == SUCCESS);
+   assert(bIsFile && ulSize == 7);
+
+   /* keep logging, then lose part of the last record */
+   assert(FT_openJournal(LOG_FILE, 1) == SUCCESS);
+   assert(FT_insertDir("r/y") == SUCCESS);
+   assert(FT_insertDir("r/x") == SUCCESS);
+   assert(FT_closeJournal() == SUCCESS);
+   assert(FT_closeJournal() == INITIALIZATION_ERROR);
+   assert(FT_destroy() == SUCCESS);
+   tearTail(LOG_FILE, 3);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_recover(SNAPSHOT_FILE, LOG_FILE) == SUCCESS);
+   assert(FT_containsDir("r/y") && !FT_containsDir("r/x"));
+   assert(FT_containsDir("r/z") && !FT_containsDir("r/unfinished"));
+   assert(FT_destroy() == SUCCESS);
+
+   /* with no snapshot, the whole log is replayed from scratch */
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+   assert(FT_init() == SUCCESS);
+   assert(FT_openJournal(LOG_FILE, 2) == SUCCESS);
+   assert(FT_insertDir("s") == SUCCESS);
+   assert(FT_insertFile("s/f", "abc", 4) == SUCCESS);
+   assert(FT_destroy() == SUCCESS);
+   assert(FT_init() == SUCCESS);
+   assert(FT_recover(NULL, LOG_FILE) == SUCCESS);
+   assert(strcmp(FT_getFileContents("s/f"), "abc") == 0);
+   assert(FT_destroy() == SUCCESS);
+
+   remove(LOG_FILE);
+   printf("ft_journal_client: all checks passed\n");
+   return 0;
+}
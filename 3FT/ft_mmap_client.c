@@ -0,0 +1,116 @@
+/*--------------------------------------------------------------------*/
+/* ft_mmap_client.c                                                   */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The files this client writes, and removes again before exiting */
+#define SNAPSHOT_FILE "ft_mmap_client.snap"
+#define LOG_FILE "ft_mmap_client.log"
+
+/* The number of large files, and the length of each one's contents */
+enum {FILE_COUNT = 50};
+enum {BODY_LENGTH = 100000};
+
+/* The contents of every large file, filled in by main */
+static char acBody[BODY_LENGTH];
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns TRUE if the file pcFile holds the ulLength bytes at pvBytes
+  anywhere in its first 16 MB, or FALSE if not.
+*/
+static boolean fileHolds(const char *pcFile, const void *pvBytes,
+                         size_t ulLength) {
+   enum {MAX_READ = 1 << 24};
+   FILE *psFile;
+   char *pcData;
+   size_t ulRead;
+   size_t ulIndex;
+   boolean bFound = FALSE;
+
+   psFile = fopen(pcFile, "rb");
+   assert(psFile != NULL);
+   pcData = malloc(MAX_READ);
+   assert(pcData != NULL);
+   ulRead = fread(pcData, 1, MAX_READ, psFile);
+   fclose(psFile);
+   for (ulIndex = 0; !bFound && ulIndex + ulLength <= ulRead; ulIndex++)
+      bFound = memcmp(pcData + ulIndex, pvBytes, ulLength) == 0;
+   free(pcData);
+   return bFound;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_recoverMapped: that it rebuilds the same tree as the
+  snapshot and journal describe, that its contents can be written
+  without touching the snapshot file, and that a checkpoint replacing
+  the mapped snapshot keeps those writes. Returns 0.
+*/
+int main(void) {
+   char acPath[32];
+   char *pcBefore;
+   char *pcAfter;
+   char *pcContents;
+   int i;
+
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+   memset(acBody, 'q', sizeof(acBody) - 1);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_openJournal(LOG_FILE, 4) == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   for (i = 0; i < FILE_COUNT; i++) {
+      sprintf(acPath, "r/d%d/f", i);
+      assert(FT_insertFile(acPath, acBody, sizeof(acBody)) == SUCCESS);
+   }
+   assert(FT_insertFile("r/null", NULL, 3) == SUCCESS);
+   assert(FT_checkpoint(SNAPSHOT_FILE) == SUCCESS);
+   assert(FT_insertFile("r/late", "late", 5) == SUCCESS);
+   pcBefore = FT_toString();
+   assert(pcBefore != NULL);
+   assert(FT_destroy() == SUCCESS);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_recoverMapped(SNAPSHOT_FILE, LOG_FILE) == SUCCESS);
+   assert(FT_recoverMapped(SNAPSHOT_FILE, LOG_FILE)
+          == INITIALIZATION_ERROR);
+   pcAfter = FT_toString();
+   assert(pcAfter != NULL && strcmp(pcBefore, pcAfter) == 0);
+   free(pcBefore);
+   free(pcAfter);
+   assert(strcmp(FT_getFileContents("r/d7/f"), acBody) == 0);
+   assert(strcmp(FT_getFileContents("r/late"), "late") == 0);
+   assert(FT_getFileContents("r/null") == NULL);
+
+   /* the mapping is private: writes stay out of the snapshot file */
+   pcContents = FT_getFileContents("r/d7/f");
+   pcContents[0] = 'Z';
+   assert(!fileHolds(SNAPSHOT_FILE, "Zqqq", 4));
+
+   /* replacing the mapped snapshot keeps the written contents */
+   assert(FT_openJournal(LOG_FILE, 4) == SUCCESS);
+   assert(FT_checkpoint(SNAPSHOT_FILE) == SUCCESS);
+   assert(((char *)FT_getFileContents("r/d7/f"))[0] == 'Z');
+   assert(fileHolds(SNAPSHOT_FILE, "Zqqq", 4));
+   assert(FT_destroy() == SUCCESS);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_recoverMapped(SNAPSHOT_FILE, LOG_FILE) == SUCCESS);
+   assert(((char *)FT_getFileContents("r/d7/f"))[0] == 'Z');
+   assert(((char *)FT_getFileContents("r/d8/f"))[0] == 'q');
+   assert(FT_destroy() == SUCCESS);
+
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+   printf("ft_mmap_client: all checks passed\n");
+   return 0;
+}
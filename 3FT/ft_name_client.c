@@ -0,0 +1,217 @@
+/*--------------------------------------------------------------------*/
+/* ft_name_client.c                                                   */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The names every path is built from */
+static const char *apcNames[] = {"a", "b", "config.json", "c"};
+
+/* The number of names, and of random mutations */
+enum {NAME_COUNT = 4};
+enum {STEP_COUNT = 4000};
+
+/* What countVisit records about a search */
+struct Search
+{
+   /* the name searched for */
+   const char *pcName;
+   /* the number of nodes visited */
+   int iCount;
+};
+
+/* What walkVisit records about a walk */
+struct Walk
+{
+   /* the name looked for */
+   const char *pcName;
+   /* the number of nodes with that name, and of all nodes, visited */
+   int iMatches;
+   int iNodes;
+};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that psEntry is in the FT under the name the struct Search
+  pvExtra searches for, and counts it.
+*/
+static enum FT_WalkAction countVisit(const struct FT_DirEntry *psEntry,
+                                     void *pvExtra) {
+   struct Search *psSearch = pvExtra;
+   const char *pcLast = strrchr(psEntry->pcPath, '/');
+
+   pcLast = pcLast != NULL ? pcLast + 1 : psEntry->pcPath;
+   assert(strcmp(pcLast, psSearch->pcName) == 0);
+   assert(psEntry->bIsFile ? FT_containsFile(psEntry->pcPath)
+                           : FT_containsDir(psEntry->pcPath));
+   psSearch->iCount++;
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Counts psEntry in the struct Walk pvExtra, and also as a match if
+  its last component is the name the walk looks for.
+*/
+static enum FT_WalkAction walkVisit(const struct FT_DirEntry *psEntry,
+                                    void *pvExtra) {
+   struct Walk *psWalk = pvExtra;
+   const char *pcLast = strrchr(psEntry->pcPath, '/');
+
+   pcLast = pcLast != NULL ? pcLast + 1 : psEntry->pcPath;
+   if (strcmp(pcLast, psWalk->pcName) == 0)
+      psWalk->iMatches++;
+   psWalk->iNodes++;
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns the number of nodes FT_findByName finds named pcName, using
+  the name index if it is on.
+*/
+static int countNamed(const char *pcName) {
+   struct Search sSearch;
+
+   sSearch.pcName = pcName;
+   sSearch.iCount = 0;
+   assert(FT_findByName(pcName, countVisit, &sSearch) == SUCCESS);
+   return sSearch.iCount;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns the number of nodes a walk of the whole FT, which leaves the
+  name index alone, finds named pcName, and stores in *piNodes the
+  number of nodes it finds.
+*/
+static int walkNamed(const char *pcName, int *piNodes) {
+   struct Walk sWalk;
+
+   sWalk.pcName = pcName;
+   sWalk.iMatches = 0;
+   sWalk.iNodes = 0;
+   if (FT_containsDir("r"))
+      assert(FT_walk("r", walkVisit, &sWalk) == SUCCESS);
+   *piNodes = sWalk.iNodes;
+   return sWalk.iMatches;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that the name index, which must be on, finds what a walk of
+  the whole FT finds, and holds every node.
+*/
+static void checkIndex(void) {
+   struct FT_IndexStats sStats;
+   int iNodes = 0;
+   int i;
+
+   for (i = 0; i < NAME_COUNT; i++)
+      assert(countNamed(apcNames[i]) == walkNamed(apcNames[i], &iNodes));
+   FT_getNameIndexStats(&sStats);
+   assert(sStats.ulBytes > 0 && sStats.ulEntries == (size_t)iNodes);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_setNameIndex, FT_findByName, and FT_getNameIndexStats:
+  that the index, left on throughout, finds what a walk finds after
+  each of a pseudo-random series of mutations and of transactions
+  committed and aborted, that turning it off and on rebuilds it, and
+  that it shrinks to nothing as the FT empties. Returns 0.
+*/
+int main(void) {
+   struct FT_IndexStats sStats;
+   struct Search sSearch;
+   char acPath[64];
+   char *pcCut;
+   int iNodes;
+   int iOp;
+   int i;
+
+   assert(FT_setNameIndex(TRUE) == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_setNameIndex(TRUE) == SUCCESS);
+   sSearch.pcName = "a";
+   sSearch.iCount = 0;
+   assert(FT_findByName("a/b", countVisit, &sSearch) == BAD_PATH);
+   assert(FT_findByName("", countVisit, &sSearch) == BAD_PATH);
+
+   srand(3);
+   for (i = 0; i < STEP_COUNT; i++) {
+      iOp = rand() % 10;
+      sprintf(acPath, "r/%s/%s/%s", apcNames[rand() % NAME_COUNT],
+              apcNames[rand() % NAME_COUNT], apcNames[rand() % NAME_COUNT]);
+      if (i % 500 == 0 && rand() % 2)
+         assert(FT_begin() == SUCCESS);
+      if (iOp < 4)
+         (void)FT_insertFile(acPath, "x", 1);
+      else if (iOp < 7)
+         (void)FT_insertDir(acPath);
+      else if (iOp < 8) {
+         /* cut the path to "r/x" or "r/x/y" */
+         pcCut = strchr(acPath + 2, '/');
+         if (rand() % 2)
+            pcCut = strchr(pcCut + 1, '/');
+         *pcCut = '\0';
+         (void)FT_rmDir(acPath);
+      }
+      else if (iOp < 9)
+         (void)FT_rmFile(acPath);
+      else if (rand() % 50 == 0) {
+         if (FT_abort() != SUCCESS)
+            (void)FT_commit();
+      }
+      else if (rand() % 50 == 0)
+         (void)FT_commit();
+      if (i % 97 == 0)
+         checkIndex();
+   }
+   (void)FT_commit();
+   checkIndex();
+
+   /* an abort undoes what it indexed and brings back what it dropped */
+   (void)FT_insertDir("r/a");
+   i = countNamed("a");
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("r/a") == SUCCESS);
+   assert(FT_insertDir("r/zz/zz") == SUCCESS);
+   assert(countNamed("zz") == 2);
+   assert(FT_setNameIndex(TRUE) == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   assert(countNamed("a") == i && countNamed("zz") == 0);
+   checkIndex();
+
+   /* off, it holds nothing and searches walk; on again, it is rebuilt */
+   assert(FT_setNameIndex(FALSE) == SUCCESS);
+   FT_getNameIndexStats(&sStats);
+   assert(sStats.ulEntries == 0 && sStats.ulBytes == 0);
+   assert(countNamed("a") == walkNamed("a", &iNodes) && iNodes > 0);
+   assert(FT_setNameIndex(TRUE) == SUCCESS);
+   checkIndex();
+
+   FT_getNameIndexStats(&sStats);
+   assert(sStats.ulKeys <= NAME_COUNT + 1 && sStats.ulBytes > 0);
+   assert(countNamed("r") == 1);
+   assert(FT_rmDir("r") == SUCCESS);
+   FT_getNameIndexStats(&sStats);
+   assert(sStats.ulEntries == 0 && sStats.ulKeys == 0);
+   assert(FT_insertDir("r/a") == SUCCESS);
+   assert(FT_destroy() == SUCCESS);
+   FT_getNameIndexStats(&sStats);
+   assert(sStats.ulEntries == 0 && sStats.ulBytes == 0);
+
+   printf("ft_name_client: all checks passed\n");
+   return 0;
+}
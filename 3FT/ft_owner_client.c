@@ -0,0 +1,153 @@
+/*--------------------------------------------------------------------*/
+/* ft_owner_client.c                                                  */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The files this client writes, and removes again before exiting */
+#define LOG_FILE "ft_owner_client.log"
+#define SPILL_FILE "ft_owner_client.spill"
+
+/* The number of calls made to countingFree */
+static int iFreed = 0;
+
+/*--------------------------------------------------------------------*/
+
+/* Frees pvContents and counts the call. */
+static void countingFree(void *pvContents) {
+   iFreed++;
+   free(pvContents);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a copy of pcString on the heap. */
+static char *copyString(const char *pcString) {
+   char *pcCopy;
+
+   pcCopy = malloc(strlen(pcString) + 1);
+   assert(pcCopy != NULL);
+   strcpy(pcCopy, pcString);
+   return pcCopy;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks that contents taken with the caller's own destructor are
+  never evicted under a memory budget, and are freed through it once
+  their file is gone.
+*/
+static void checkBudget(void) {
+   char acPath[20];
+   char *pcContents;
+   struct FT_ContentStats sStats;
+   int i;
+
+   iFreed = 0;
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   assert(FT_setMemoryBudget(SPILL_FILE, 0) == SUCCESS);
+   for (i = 0; i < 10; i++) {
+      pcContents = malloc(100);
+      assert(pcContents != NULL);
+      memset(pcContents, 'a' + i, 100);
+      sprintf(acPath, "r/f%d", i);
+      assert(FT_insertFileOwned(acPath, pcContents, 100, FT_TAKE,
+                                countingFree) == SUCCESS);
+   }
+   FT_getContentStats(&sStats);
+   assert(sStats.ulSpilled == 0 && iFreed == 0);
+   pcContents = FT_getFileContents("r/f3");
+   assert(pcContents[0] == 'd');
+   assert(FT_rmFile("r/f3") == SUCCESS);
+   assert(iFreed == 1);
+   assert(FT_destroy() == SUCCESS);
+   assert(iFreed == 10);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_setOwnership, FT_insertFileOwned, and
+  FT_replaceFileContentsOwned: when taken contents are freed, on
+  failure, replacement, abort, deduplication, and removal, and that
+  recovered contents are owned by the FT. Returns 0.
+*/
+int main(void) {
+   char acLocal[] = "local";
+   char *pcContents;
+
+   remove(LOG_FILE);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("a/b") == SUCCESS);
+   assert(FT_setOwnership(FT_TAKE, countingFree) == SUCCESS);
+   assert(FT_insertFile("a/b/f1", copyString("one"), 4) == SUCCESS);
+   assert(FT_insertFile("a/b/f2", copyString("two"), 4) == SUCCESS);
+   assert(FT_insertFile("a/b/c/f3", copyString("three"), 6) == SUCCESS);
+
+   /* a failed insert still consumes what it was given */
+   assert(FT_insertFile("a/b/f1", copyString("dupe"), 5) != SUCCESS);
+   assert(iFreed == 1);
+
+   /* a replacement frees the contents it replaces */
+   assert(FT_replaceFileContents("a/b/f1", copyString("ONE"), 4) == NULL);
+   assert(iFreed == 2);
+   assert(strcmp(FT_getFileContents("a/b/f1"), "ONE") == 0);
+
+   /* a file's own mode overrides the default */
+   assert(FT_insertFileOwned("a/b/f4", acLocal, 6, FT_COPY, NULL)
+          == SUCCESS);
+   pcContents = FT_getFileContents("a/b/f4");
+   assert(pcContents != acLocal && strcmp(pcContents, "local") == 0);
+   assert(FT_insertFileOwned("a/b/f5", acLocal, 6, FT_BORROW, NULL)
+          == SUCCESS);
+   assert(FT_getFileContents("a/b/f5") == acLocal);
+   assert(FT_replaceFileContentsOwned("a/b/f5", copyString("x"), 2,
+                                      FT_TAKE, NULL) == acLocal);
+
+   /* an abort frees the new contents and restores the old */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_replaceFileContents("a/b/f2", copyString("TWO"), 4) == NULL);
+   assert(FT_rmFile("a/b/f1") == SUCCESS);
+   assert(iFreed == 2);
+   assert(FT_abort() == SUCCESS);
+   assert(iFreed == 3);
+   assert(strcmp(FT_getFileContents("a/b/f2"), "two") == 0);
+   assert(strcmp(FT_getFileContents("a/b/f1"), "ONE") == 0);
+
+   /* deduplicating taken contents frees the caller's buffer at once */
+   assert(FT_setDedup(TRUE) == SUCCESS);
+   assert(FT_insertFile("a/b/f6", copyString("two"), 4) == SUCCESS);
+   assert(iFreed == 4);
+   assert(FT_setDedup(FALSE) == SUCCESS);
+
+   /* removing a directory frees f1, f2, and f3 beneath it */
+   assert(FT_rmDir("a/b") == SUCCESS);
+   assert(iFreed == 7);
+   assert(FT_destroy() == SUCCESS);
+
+   /* recovered contents belong to the FT */
+   assert(FT_init() == SUCCESS);
+   assert(FT_openJournal(LOG_FILE, 1) == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   assert(FT_insertFile("r/f", "hello", 6) == SUCCESS);
+   assert(strcmp(FT_replaceFileContents("r/f", "bye", 4), "hello") == 0);
+   assert(FT_destroy() == SUCCESS);
+   assert(FT_init() == SUCCESS);
+   assert(FT_recover(NULL, LOG_FILE) == SUCCESS);
+   assert(strcmp(FT_getFileContents("r/f"), "bye") == 0);
+   assert(FT_replaceFileContents("r/f", "z", 2) == NULL);
+   assert(FT_destroy() == SUCCESS);
+   remove(LOG_FILE);
+
+   checkBudget();
+
+   printf("ft_owner_client: all checks passed\n");
+   return 0;
+}
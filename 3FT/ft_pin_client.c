@@ -0,0 +1,111 @@
+/*--------------------------------------------------------------------*/
+/* ft_pin_client.c                                                    */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The length of the compressed test contents */
+enum {BODY_LENGTH = 5000};
+
+/* The number of compressed files pinned alongside the first */
+enum {PIN_COUNT = 20};
+
+/*--------------------------------------------------------------------*/
+
+/* Returns a copy of pcString on the heap. */
+static char *copyString(const char *pcString) {
+   char *pcCopy;
+
+   pcCopy = malloc(strlen(pcString) + 1);
+   assert(pcCopy != NULL);
+   strcpy(pcCopy, pcString);
+   return pcCopy;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_pin, FT_getPinnedData, FT_getPinnedLength, and FT_unpin:
+  that pinned bytes stay as they were across replacement, removal,
+  writes in place, an abort, decompression cache eviction, and
+  FT_destroy. Returns 0.
+*/
+int main(void) {
+   static char acBody[BODY_LENGTH];
+   FT_Contents_T oCOld;
+   FT_Contents_T oCAborted;
+   FT_Contents_T oCCompressed;
+   FT_Contents_T aoCOthers[PIN_COUNT];
+   char acPath[32];
+   int i;
+
+   memset(acBody, 'q', sizeof(acBody));
+   assert(FT_init() == SUCCESS);
+   assert(FT_pin("a", &oCOld) == NO_SUCH_PATH && oCOld == NULL);
+   assert(FT_insertDir("a") == SUCCESS);
+   assert(FT_pin("a", &oCOld) == NOT_A_FILE && oCOld == NULL);
+   assert(FT_pin("b/f", &oCOld) == CONFLICTING_PATH);
+
+   /* replaced and removed contents stay pinned */
+   assert(FT_setOwnership(FT_TAKE, NULL) == SUCCESS);
+   assert(FT_insertFile("a/f", copyString("old"), 4) == SUCCESS);
+   assert(FT_pin("a/f", &oCOld) == SUCCESS);
+   assert(FT_replaceFileContents("a/f", copyString("new"), 4) == NULL);
+   assert(strcmp(FT_getPinnedData(oCOld), "old") == 0);
+   assert(FT_getPinnedLength(oCOld) == 4);
+   assert(FT_rmFile("a/f") == SUCCESS);
+   assert(strcmp(FT_getPinnedData(oCOld), "old") == 0);
+   FT_unpin(oCOld);
+
+   /* a write after pinning changes a copy */
+   assert(FT_setOwnership(FT_BORROW, NULL) == SUCCESS);
+   assert(FT_insertFile("a/w", NULL, 0) == SUCCESS);
+   assert(FT_appendFile("a/w", "abc", 3) == SUCCESS);
+   assert(FT_appendFile("a/w", "def", 3) == SUCCESS);
+   assert(FT_pin("a/w", &oCOld) == SUCCESS);
+   assert(FT_writeFile("a/w", 0, "XY", 2) == SUCCESS);
+   assert(memcmp(FT_getPinnedData(oCOld), "abcdef", 6) == 0);
+   assert(memcmp(FT_getFileContents("a/w"), "XYcdef", 6) == 0);
+
+   /* contents pinned inside a transaction outlive its abort */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_appendFile("a/w", "gh", 2) == SUCCESS);
+   assert(FT_pin("a/w", &oCAborted) == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   assert(FT_getPinnedLength(oCAborted) == 8);
+   assert(memcmp(FT_getPinnedData(oCAborted), "XYcdefgh", 8) == 0);
+   assert(memcmp(FT_getFileContents("a/w"), "XYcdef", 6) == 0);
+
+   /* pinned decompressed contents survive cache eviction */
+   assert(FT_setCompression(1024) == SUCCESS);
+   assert(FT_insertFile("a/c", acBody, sizeof(acBody)) == SUCCESS);
+   assert(FT_pin("a/c", &oCCompressed) == SUCCESS);
+   for (i = 0; i < PIN_COUNT; i++) {
+      sprintf(acPath, "a/c%d", i);
+      acBody[0] = (char)i;
+      assert(FT_insertFile(acPath, acBody, sizeof(acBody)) == SUCCESS);
+      assert(FT_getFileContents(acPath) != NULL);
+      assert(FT_pin(acPath, &aoCOthers[i]) == SUCCESS);
+   }
+   acBody[0] = 'q';
+   assert(memcmp(FT_getPinnedData(oCCompressed), acBody, sizeof(acBody))
+          == 0);
+   for (i = 0; i < PIN_COUNT; i++)
+      FT_unpin(aoCOthers[i]);
+
+   /* and FT_destroy */
+   assert(FT_destroy() == SUCCESS);
+   assert(memcmp(FT_getPinnedData(oCCompressed), acBody, sizeof(acBody))
+          == 0);
+   assert(memcmp(FT_getPinnedData(oCOld), "abcdef", 6) == 0);
+   FT_unpin(oCCompressed);
+   FT_unpin(oCAborted);
+   FT_unpin(oCOld);
+
+   printf("ft_pin_client: all checks passed\n");
+   return 0;
+}
@@ -0,0 +1,101 @@
+/*--------------------------------------------------------------------*/
+/* ft_quota_client.c                                                  */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that FT_statSubtree reports ulDirs directories, ulFiles
+  files, and ulBytes bytes beneath pcPath.
+*/
+static void checkTotals(const char *pcPath, size_t ulDirs,
+                        size_t ulFiles, size_t ulBytes) {
+   struct FT_SubtreeStats sStats;
+
+   assert(FT_statSubtree(pcPath, &sStats) == SUCCESS);
+   assert(sStats.ulDirs == ulDirs && sStats.ulFiles == ulFiles);
+   assert(sStats.ulBytes == ulBytes);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_setQuota and FT_getQuota: that every kind of growth is
+  refused past a node or byte quota, including nested and lowered
+  ones, and that an abort leaves the quotas and the totals they are
+  checked against as they were. Returns 0.
+*/
+int main(void) {
+   char acData[100];
+   size_t ulMaxNodes;
+   size_t ulMaxBytes;
+   boolean bIsFile;
+   size_t ulSize;
+
+   memset(acData, 'z', sizeof(acData));
+   assert(FT_setQuota("r", 1, 1) == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("r/t") == SUCCESS);
+   assert(FT_setQuota("r/t", 3, 50) == SUCCESS);
+   assert(FT_getQuota("r/t", &ulMaxNodes, &ulMaxBytes) == SUCCESS);
+   assert(ulMaxNodes == 3 && ulMaxBytes == 50);
+   assert(FT_getQuota("r", &ulMaxNodes, &ulMaxBytes) == SUCCESS);
+   assert(ulMaxNodes == FT_UNLIMITED && ulMaxBytes == FT_UNLIMITED);
+   assert(FT_setQuota("r/nope", 1, 1) == NO_SUCH_PATH);
+
+   /* refused growth leaves nothing behind */
+   assert(FT_insertDir("r/t/x/y/z/w") == QUOTA_EXCEEDED);
+   assert(!FT_containsDir("r/t/x"));
+   assert(FT_insertDir("r/t/x/y") == SUCCESS);
+   assert(FT_insertFile("r/t/x/f", acData, 10) == SUCCESS);
+   assert(FT_insertFile("r/t/g", acData, 10) == QUOTA_EXCEEDED);
+   assert(FT_insertFile("r/g", acData, 10) == SUCCESS);
+   assert(FT_replaceFileContents("r/t/x/f", acData, 60) == NULL);
+   assert(FT_stat("r/t/x/f", &bIsFile, &ulSize) == SUCCESS);
+   assert(ulSize == 10);
+   assert(FT_replaceFileContents("r/t/x/f", acData, 50) == acData);
+   assert(FT_appendFile("r/t/x/f", acData, 1) == QUOTA_EXCEEDED);
+   assert(FT_writeFile("r/t/x/f", 0, acData, 50) == SUCCESS);
+   assert(FT_writeFile("r/t/x/f", 40, acData, 11) == QUOTA_EXCEEDED);
+   /* the write made the contents the FT's own, so NULL comes back */
+   assert(FT_replaceFileContents("r/t/x/f", acData, 5) == NULL);
+   assert(FT_appendFile("r/t/x/f", acData, 45) == SUCCESS);
+   checkTotals("r/t", 3, 1, 50);
+
+   /* room freed inside an aborted transaction is taken back */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("r/t/x") == SUCCESS);
+   checkTotals("r/t", 1, 0, 0);
+   assert(FT_insertFile("r/t/big", acData, 50) == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   checkTotals("r/t", 3, 1, 50);
+   assert(FT_getQuota("r/t", &ulMaxNodes, &ulMaxBytes) == SUCCESS);
+   assert(ulMaxNodes == 3 && ulMaxBytes == 50);
+   assert(FT_insertFile("r/t/big", acData, 1) == QUOTA_EXCEEDED);
+   assert(FT_appendFile("r/t/x/f", acData, 1) == QUOTA_EXCEEDED);
+
+   /* a nested quota applies alongside its ancestor's */
+   assert(FT_rmFile("r/t/x/f") == SUCCESS);
+   assert(FT_setQuota("r/t/x", FT_UNLIMITED, 5) == SUCCESS);
+   assert(FT_insertFile("r/t/x/h", acData, 6) == QUOTA_EXCEEDED);
+   assert(FT_insertFile("r/t/x/h", acData, 5) == SUCCESS);
+   assert(FT_setQuota("r/t/x/h", 1, 1) == NOT_A_DIRECTORY);
+
+   /* a quota set below the current totals only stops growth */
+   assert(FT_setQuota("r/t", 1, FT_UNLIMITED) == SUCCESS);
+   assert(FT_insertDir("r/t/q") == QUOTA_EXCEEDED);
+   assert(FT_replaceFileContents("r/t/x/h", acData, 3) == acData);
+   checkTotals("r/t", 3, 1, 3);
+   assert(FT_setQuota("r/t", FT_UNLIMITED, FT_UNLIMITED) == SUCCESS);
+   assert(FT_insertDir("r/t/q") == SUCCESS);
+   assert(FT_destroy() == SUCCESS);
+
+   printf("ft_quota_client: all checks passed\n");
+   return 0;
+}
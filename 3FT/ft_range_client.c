@@ -0,0 +1,160 @@
+/*--------------------------------------------------------------------*/
+/* ft_range_client.c                                                  */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The files this client writes, and removes again before exiting */
+#define SNAPSHOT_FILE "ft_range_client.snap"
+#define LOG_FILE "ft_range_client.log"
+#define SPILL_FILE "ft_range_client.spill"
+
+/* The number of ten-byte appends made to grow a large file */
+enum {APPEND_COUNT = 100000};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that the file at pcPath is ulLength bytes long and that
+  reading it from the start gives the ulLength bytes at pvExpected.
+*/
+static void checkFile(const char *pcPath, const void *pvExpected,
+                      size_t ulLength) {
+   char acBuffer[64];
+   boolean bIsFile;
+   size_t ulSize;
+   size_t ulRead;
+
+   assert(ulLength <= sizeof(acBuffer));
+   assert(FT_stat(pcPath, &bIsFile, &ulSize) == SUCCESS);
+   assert(bIsFile && ulSize == ulLength);
+   assert(FT_readFile(pcPath, 0, acBuffer, sizeof(acBuffer), &ulRead)
+          == SUCCESS);
+   assert(ulRead == ulLength);
+   assert(memcmp(acBuffer, pvExpected, ulLength) == 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_readFile, FT_writeFile, and FT_appendFile: reads and writes
+  at offsets, holes, growth by many small appends, undo by an abort,
+  replay from the journal, and that a file growing by appends is
+  counted in the memory budget.
+  Returns 0.
+*/
+int main(void) {
+   struct FT_ContentStats sStats;
+   char acOrig[] = "hello";
+   char acBuffer[64];
+   char acPath[32];
+   char *pcContents;
+   boolean bIsFile;
+   size_t ulSize;
+   size_t ulRead;
+   int i;
+
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   assert(FT_insertFile("r/f", acOrig, 5) == SUCCESS);
+   assert(FT_readFile("r/f", 1, acBuffer, 10, &ulRead) == SUCCESS);
+   assert(ulRead == 4 && memcmp(acBuffer, "ello", 4) == 0);
+   assert(FT_readFile("r/f", 9, acBuffer, 10, &ulRead) == SUCCESS);
+   assert(ulRead == 0);
+   assert(FT_readFile("r", 0, acBuffer, 10, &ulRead) == NOT_A_FILE);
+   assert(FT_readFile("r/x", 0, acBuffer, 10, &ulRead) == NO_SUCH_PATH);
+
+   /* the caller's buffer is never written through */
+   assert(FT_appendFile("r/f", " world", 6) == SUCCESS);
+   assert(strcmp(acOrig, "hello") == 0);
+   assert(FT_writeFile("r/f", 0, "J", 1) == SUCCESS);
+   assert(FT_writeFile("r/f", 13, "!", 1) == SUCCESS);
+   checkFile("r/f", "Jello world\0\0!", 14);
+
+   /* many small appends */
+   for (i = 0; i < APPEND_COUNT; i++)
+      assert(FT_appendFile("r/f", "0123456789", 10) == SUCCESS);
+   assert(FT_stat("r/f", &bIsFile, &ulSize) == SUCCESS);
+   assert(ulSize == 14 + 10 * APPEND_COUNT);
+   assert(FT_readFile("r/f", ulSize - 5, acBuffer, sizeof(acBuffer),
+                      &ulRead) == SUCCESS);
+   assert(ulRead == 5 && memcmp(acBuffer, "56789", 5) == 0);
+   pcContents = FT_getFileContents("r/f");
+   assert(memcmp(pcContents, "Jello", 5) == 0);
+   assert(memcmp(pcContents + 14 + 10 * 777, "0123456789", 10) == 0);
+
+   /* an abort undoes writes and appends to borrowed and own bodies */
+   assert(FT_insertFile("r/g", acOrig, 5) == SUCCESS);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_writeFile("r/g", 2, "LLOOOO", 6) == SUCCESS);
+   assert(FT_appendFile("r/g", "++", 2) == SUCCESS);
+   checkFile("r/g", "heLLOOOO++", 10);
+   assert(FT_writeFile("r/f", 0, "XXXX", 4) == SUCCESS);
+   assert(FT_appendFile("r/f", "zz", 2) == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   assert(FT_getFileContents("r/g") == acOrig);
+   assert(strcmp(acOrig, "hello") == 0);
+   assert(FT_stat("r/f", &bIsFile, &ulSize) == SUCCESS);
+   assert(ulSize == 14 + 10 * APPEND_COUNT);
+   assert(FT_readFile("r/f", 0, acBuffer, 5, &ulRead) == SUCCESS);
+   assert(memcmp(acBuffer, "Jello", 5) == 0);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_writeFile("r/g", 2, "LL", 2) == SUCCESS);
+   assert(FT_commit() == SUCCESS);
+   checkFile("r/g", "heLLo", 5);
+
+   /* writes and appends are replayed from the journal */
+   assert(FT_openJournal(LOG_FILE, 3) == SUCCESS);
+   assert(FT_checkpoint(SNAPSHOT_FILE) == SUCCESS);
+   assert(FT_insertFile("r/h", NULL, 0) == SUCCESS);
+   assert(FT_appendFile("r/h", "abc", 3) == SUCCESS);
+   assert(FT_writeFile("r/h", 5, "de", 2) == SUCCESS);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_appendFile("r/h", "NOPE", 4) == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   assert(FT_destroy() == SUCCESS);
+   assert(FT_init() == SUCCESS);
+   assert(FT_recover(SNAPSHOT_FILE, LOG_FILE) == SUCCESS);
+   assert(FT_readFile("r/f", 0, acBuffer, 5, &ulRead) == SUCCESS);
+   assert(memcmp(acBuffer, "Jello", 5) == 0);
+   checkFile("r/g", "heLLo", 5);
+   checkFile("r/h", "abc\0\0de", 7);
+   assert(FT_destroy() == SUCCESS);
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+
+   /* a growing file pushes other bodies out under a budget */
+   memset(acBuffer, 'q', sizeof(acBuffer));
+   assert(FT_init() == SUCCESS);
+   assert(FT_setOwnership(FT_COPY, NULL) == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   assert(FT_setMemoryBudget(SPILL_FILE, 50000) == SUCCESS);
+   for (i = 0; i < 100; i++) {
+      sprintf(acPath, "r/o%d", i);
+      assert(FT_insertFile(acPath, acBuffer, 64) == SUCCESS);
+   }
+   FT_getContentStats(&sStats);
+   assert(sStats.ulSpilled == 0);
+   assert(FT_insertFile("r/log", acBuffer, 10) == SUCCESS);
+   for (i = 0; i < APPEND_COUNT / 10; i++) {
+      assert(FT_appendFile("r/log", acBuffer, 10) == SUCCESS);
+      pcContents = FT_getFileContents("r/log");
+      assert(pcContents != NULL && pcContents[0] == 'q');
+   }
+   FT_getContentStats(&sStats);
+   assert(sStats.ulSpilled == 100);
+   assert(FT_rmFile("r/log") == SUCCESS);
+   FT_getContentStats(&sStats);
+   assert(sStats.ulResidentBytes == 0);
+   assert(FT_destroy() == SUCCESS);
+
+   printf("ft_range_client: all checks passed\n");
+   return 0;
+}
@@ -0,0 +1,143 @@
+/*--------------------------------------------------------------------*/
+/* ft_readdir_client.c                                                */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The number of entries listed per call to FT_readdir */
+enum {PAGE_SIZE = 3};
+
+/* The longest path this client builds, and the longest listing */
+enum {MAX_PATH = 32};
+enum {MAX_LISTING = 1024};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Pages through the directory pcPath PAGE_SIZE entries at a time,
+  asserting that files come before directories and each kind is in
+  order, and writes each entry's path and kind to pcListing, a line
+  apiece. Returns the number of entries listed.
+*/
+static size_t listAll(const char *pcPath, char *pcListing) {
+   struct FT_DirEntry asEntries[PAGE_SIZE];
+   char acLast[MAX_PATH];
+   boolean bLastFile = FALSE;
+   const char *pcAfter = NULL;
+   size_t ulCount;
+   size_t ulTotal = 0;
+   size_t ulIndex;
+
+   pcListing[0] = '\0';
+   do {
+      assert(FT_readdir(pcPath, bLastFile, pcAfter, asEntries, PAGE_SIZE,
+                        &ulCount) == SUCCESS);
+      for (ulIndex = 0; ulIndex < ulCount; ulIndex++) {
+         if (pcAfter != NULL || ulIndex > 0) {
+            /* no file follows a directory */
+            assert(bLastFile || !asEntries[ulIndex].bIsFile);
+            if (bLastFile == asEntries[ulIndex].bIsFile)
+               assert(strcmp(acLast, asEntries[ulIndex].pcPath) < 0);
+         }
+         strcpy(acLast, asEntries[ulIndex].pcPath);
+         bLastFile = asEntries[ulIndex].bIsFile;
+         pcAfter = acLast;
+         assert(strlen(pcListing) + MAX_PATH + 3 < MAX_LISTING);
+         sprintf(pcListing + strlen(pcListing), "%s %c\n", acLast,
+                 bLastFile ? 'f' : 'd');
+      }
+      ulTotal += ulCount;
+   } while (ulCount == PAGE_SIZE);
+   return ulTotal;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_readdir: its statuses, ordering, paging that resumes
+  correctly when the directory changes between pages, and that an
+  abort restores the listing. Returns 0.
+*/
+int main(void) {
+   struct FT_DirEntry asEntries[PAGE_SIZE];
+   char acBefore[MAX_LISTING];
+   char acAfter[MAX_LISTING];
+   char acLast[MAX_PATH];
+   char acPath[MAX_PATH];
+   char acData[] = "xyz";
+   boolean bLastFile = FALSE;
+   const char *pcAfter = NULL;
+   size_t ulCount;
+   size_t ulTotal = 0;
+   int i;
+
+   assert(FT_readdir("a", FALSE, NULL, asEntries, PAGE_SIZE, &ulCount)
+          == INITIALIZATION_ERROR && ulCount == 0);
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("a") == SUCCESS);
+   for (i = 0; i < 10; i++) {
+      sprintf(acPath, "a/f%d", i);
+      assert(FT_insertFile(acPath, acData, (size_t)(i % 4)) == SUCCESS);
+   }
+   for (i = 0; i < 5; i++) {
+      sprintf(acPath, "a/d%d", i);
+      assert(FT_insertDir(acPath) == SUCCESS);
+   }
+   assert(FT_readdir("a/f1", FALSE, NULL, asEntries, PAGE_SIZE, &ulCount)
+          == NOT_A_DIRECTORY && ulCount == 0);
+   assert(FT_readdir("a/q", FALSE, NULL, asEntries, PAGE_SIZE, &ulCount)
+          == NO_SUCH_PATH);
+   assert(FT_readdir("b", FALSE, NULL, asEntries, PAGE_SIZE, &ulCount)
+          == CONFLICTING_PATH);
+   assert(listAll("a", acBefore) == 15);
+
+   /* change the directory partway through paging it */
+   do {
+      assert(FT_readdir("a", bLastFile, pcAfter, asEntries, PAGE_SIZE,
+                        &ulCount) == SUCCESS);
+      ulTotal += ulCount;
+      if (ulCount > 0) {
+         strcpy(acLast, asEntries[ulCount - 1].pcPath);
+         bLastFile = asEntries[ulCount - 1].bIsFile;
+         pcAfter = acLast;
+      }
+      if (ulTotal == 6) {
+         /* the last entry listed goes; one is added before and after */
+         assert(strcmp(acLast, "a/f5") == 0);
+         assert(FT_rmFile("a/f5") == SUCCESS);
+         assert(FT_insertFile("a/f55", acData, 1) == SUCCESS);
+         assert(FT_insertFile("a/e", acData, 1) == SUCCESS);
+      }
+   } while (ulCount == PAGE_SIZE);
+   assert(ulTotal == 16);
+
+   assert(FT_readdir("a", FALSE, "a/d2", asEntries, PAGE_SIZE, &ulCount)
+          == SUCCESS);
+   assert(ulCount == 2 && strcmp(asEntries[0].pcPath, "a/d3") == 0);
+   assert(FT_readdir("a", TRUE, "a/f9", asEntries, PAGE_SIZE, &ulCount)
+          == SUCCESS);
+   assert(ulCount == PAGE_SIZE && !asEntries[0].bIsFile);
+   assert(FT_readdir("a", FALSE, NULL, asEntries, 0, &ulCount) == SUCCESS);
+   assert(ulCount == 0);
+
+   /* an abort restores the listing */
+   assert(listAll("a", acBefore) == 16);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("a/d1") == SUCCESS);
+   assert(FT_rmFile("a/f0") == SUCCESS);
+   assert(FT_insertDir("a/c") == SUCCESS);
+   assert(FT_insertFile("a/g", acData, 3) == SUCCESS);
+   assert(listAll("a", acAfter) == 16);
+   assert(strcmp(acBefore, acAfter) != 0);
+   assert(FT_abort() == SUCCESS);
+   assert(listAll("a", acAfter) == 16);
+   assert(strcmp(acBefore, acAfter) == 0);
+   assert(FT_destroy() == SUCCESS);
+
+   printf("ft_readdir_client: all checks passed\n");
+   return 0;
+}
@@ -0,0 +1,187 @@
+/*--------------------------------------------------------------------*/
+/* ft_scan_client.c                                                   */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The longest listing a scan may build */
+enum {MAX_LISTING = 200000};
+
+/* The most bounds checked, and the longest one */
+enum {MAX_BOUNDS = 100};
+enum {MAX_BOUND = 40};
+
+/* Names that sort around '-', '/', and each other; the last two are
+   used only in bounds, as "a/" is no name and "zz" sorts past all */
+static const char *apcNames[] = {
+   "a", "a-", "a-b", "a0", "ab", "b", "a!", "a/", "zz"
+};
+
+/* The number of names inserted */
+enum {NAME_COUNT = 7};
+
+/* The listings from FT_scanRange and from the reference filter */
+static char acFound[MAX_LISTING];
+static char acExpected[MAX_LISTING];
+
+/* The range referenceVisit filters by; pcHigh may be NULL */
+static const char *pcLow;
+static const char *pcHigh;
+
+/*--------------------------------------------------------------------*/
+
+/* Adds psEntry's path to the listing pvExtra, and goes on. */
+static enum FT_WalkAction collectVisit(const struct FT_DirEntry *psEntry,
+                                       void *pvExtra) {
+   char *pcListing = pvExtra;
+
+   assert(strlen(pcListing) + strlen(psEntry->pcPath) + 1 < MAX_LISTING);
+   strcat(pcListing, psEntry->pcPath);
+   strcat(pcListing, "\n");
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Adds psEntry's path to pvExtra if it lies in [pcLow, pcHigh). */
+static enum FT_WalkAction referenceVisit(const struct FT_DirEntry
+                                         *psEntry, void *pvExtra) {
+   if (strcmp(pcLow, psEntry->pcPath) <= 0
+       && (pcHigh == NULL || strcmp(psEntry->pcPath, pcHigh) < 0))
+      return collectVisit(psEntry, pvExtra);
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Counts a visit in the int pvExtra, and stops at the third. */
+static enum FT_WalkAction stopVisit(const struct FT_DirEntry *psEntry,
+                                    void *pvExtra) {
+   (void)psEntry;
+   return ++*(int *)pvExtra == 3 ? FT_WALK_STOP : FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that FT_scanRange visits exactly the nodes below "r" with
+  paths in [pcLo, pcHi), in FT_toString order.
+*/
+static void checkRange(const char *pcLo, const char *pcHi) {
+   acFound[0] = acExpected[0] = '\0';
+   pcLow = pcLo;
+   pcHigh = pcHi;
+   assert(FT_scanRange(pcLo, pcHi, collectVisit, acFound) == SUCCESS);
+   assert(FT_walk("r", referenceVisit, acExpected) == SUCCESS);
+   if (strcmp(acFound, acExpected) != 0) {
+      fprintf(stderr, "[%s, %s)\nfound\n%s\nexpected\n%s\n", pcLo,
+              pcHi != NULL ? pcHi : "-", acFound, acExpected);
+      assert(FALSE);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks every range between pairs of the iBounds bounds in
+  aacBounds, and that consecutive ranges split at each bound list
+  every node once between them.
+*/
+static void checkRanges(char aacBounds[][MAX_BOUND], int iBounds) {
+   static char acJoined[MAX_LISTING];
+   char *pcWhole;
+   int i;
+   int j;
+
+   for (i = 0; i < iBounds; i++)
+      for (j = -1; j < iBounds; j++)
+         checkRange(aacBounds[i], j < 0 ? NULL : aacBounds[j]);
+
+   pcWhole = FT_toString();
+   assert(pcWhole != NULL);
+   for (i = 0; i < iBounds; i++) {
+      acJoined[0] = '\0';
+      assert(FT_scanRange("", aacBounds[i], collectVisit, acJoined)
+             == SUCCESS);
+      assert(FT_scanRange(aacBounds[i], NULL, collectVisit, acJoined)
+             == SUCCESS);
+      assert(strlen(acJoined) == strlen(pcWhole));
+   }
+   free(pcWhole);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_scanRange against a reference filter over every node
+  FT_walk visits, for ranges between many bounds, before, during, and
+  after an aborted transaction. Returns 0.
+*/
+int main(void) {
+   char aacBounds[MAX_BOUNDS][MAX_BOUND];
+   char acPath[64];
+   int iBounds = 0;
+   int iVisits;
+   int i;
+   int j;
+   int k;
+
+   acFound[0] = '\0';
+   assert(FT_scanRange("", NULL, collectVisit, acFound)
+          == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_scanRange("", NULL, collectVisit, acFound) == SUCCESS);
+   assert(acFound[0] == '\0');
+   assert(FT_insertDir("r") == SUCCESS);
+   for (i = 0; i < NAME_COUNT; i++)
+      for (j = 0; j < NAME_COUNT; j++) {
+         sprintf(acPath, "r/%s/%s", apcNames[i], apcNames[j]);
+         if (j % 3 == 0) {
+            assert(FT_insertFile(acPath, "x", 1) == SUCCESS);
+            continue;
+         }
+         assert(FT_insertDir(acPath) == SUCCESS);
+         for (k = 0; k < NAME_COUNT; k += 2) {
+            sprintf(acPath, "r/%s/%s/%s", apcNames[i], apcNames[j],
+                    apcNames[k]);
+            assert(FT_insertFile(acPath, "x", 1) == SUCCESS);
+         }
+      }
+
+   strcpy(aacBounds[iBounds++], "");
+   strcpy(aacBounds[iBounds++], "r");
+   strcpy(aacBounds[iBounds++], "r/");
+   strcpy(aacBounds[iBounds++], "r-");
+   strcpy(aacBounds[iBounds++], "s");
+   strcpy(aacBounds[iBounds++], "r0");
+   for (i = 0; i < NAME_COUNT; i++) {
+      sprintf(aacBounds[iBounds++], "r/%s", apcNames[i]);
+      for (j = 0; j < NAME_COUNT + 2; j += 2)
+         sprintf(aacBounds[iBounds++], "r/%s/%s", apcNames[i],
+                 apcNames[j]);
+   }
+   assert(iBounds <= MAX_BOUNDS);
+   checkRanges(aacBounds, iBounds);
+
+   iVisits = 0;
+   assert(FT_scanRange("r/a", NULL, stopVisit, &iVisits) == SUCCESS);
+   assert(iVisits == 3);
+
+   /* a scan sees the tree inside a transaction, and after its abort */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("r/a-") == SUCCESS);
+   assert(FT_rmFile("r/a0/a") == SUCCESS);
+   assert(FT_insertDir("r/a-/zz/a") == SUCCESS);
+   checkRanges(aacBounds, iBounds);
+   assert(FT_abort() == SUCCESS);
+   checkRanges(aacBounds, iBounds);
+   assert(FT_containsFile("r/a0/a") && !FT_containsDir("r/a-/zz"));
+   assert(FT_destroy() == SUCCESS);
+
+   printf("ft_scan_client: all checks passed\n");
+   return 0;
+}
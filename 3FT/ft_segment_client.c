@@ -0,0 +1,152 @@
+/*--------------------------------------------------------------------*/
+/* ft_segment_client.c                                                */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The files this client writes, and removes again before exiting */
+#define SNAPSHOT_FILE "ft_segment_client.snap"
+#define LOG_FILE "ft_segment_client.log"
+
+/* The length of each half of the large gathered contents */
+enum {HALF_LENGTH = 3000};
+
+/*--------------------------------------------------------------------*/
+
+/* Sets psSegment to the ulLength bytes at pvData. */
+static void setSegment(struct FT_Segment *psSegment, void *pvData,
+                       size_t ulLength) {
+   psSegment->pvData = pvData;
+   psSegment->ulLength = ulLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks that gathered contents are stored through deduplication and
+  compression like contents inserted whole.
+*/
+static void checkStored(void) {
+   static char acA[HALF_LENGTH];
+   static char acB[HALF_LENGTH];
+   static char acWhole[2 * HALF_LENGTH];
+   struct FT_Segment asSegments[2];
+   struct FT_ContentStats sStats;
+   char *pcContents;
+
+   memset(acA, 'a', sizeof(acA));
+   memset(acB, 'b', sizeof(acB));
+   memcpy(acWhole, acA, HALF_LENGTH);
+   memcpy(acWhole + HALF_LENGTH, acB, HALF_LENGTH);
+   setSegment(&asSegments[0], acA, HALF_LENGTH);
+   setSegment(&asSegments[1], acB, HALF_LENGTH);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_setOwnership(FT_COPY, NULL) == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   assert(FT_setDedup(TRUE) == SUCCESS);
+   assert(FT_insertFile("r/x", acWhole, sizeof(acWhole)) == SUCCESS);
+   assert(FT_insertFileV("r/y", asSegments, 2) == SUCCESS);
+   assert(FT_getFileContents("r/x") == FT_getFileContents("r/y"));
+   FT_getContentStats(&sStats);
+   assert(sStats.ulDistinct == 1 && sStats.ulReferences == 2);
+
+   assert(FT_setDedup(FALSE) == SUCCESS);
+   assert(FT_setCompression(100) == SUCCESS);
+   assert(FT_insertFileV("r/z", asSegments, 2) == SUCCESS);
+   FT_getContentStats(&sStats);
+   assert(sStats.ulCompressed >= 1);
+   pcContents = FT_getFileContents("r/z");
+   assert(pcContents != NULL);
+   assert(memcmp(pcContents, acWhole, sizeof(acWhole)) == 0);
+   pcContents = FT_getFileContents("r/y");
+   assert(pcContents != NULL);
+   assert(memcmp(pcContents, acWhole, sizeof(acWhole)) == 0);
+   assert(FT_destroy() == SUCCESS);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_insertFileV and FT_readFileV: gathering segments into one
+  file, scattering a read across segments, undo by an abort, and
+  replay from the journal. Returns 0.
+*/
+int main(void) {
+   struct FT_Segment asSegments[3];
+   char acHead[] = "HDR:";
+   char acBody[] = "payload";
+   char acTail[] = ":END";
+   char acA[3];
+   char acB[5];
+   char acC[100];
+   char *pcBefore;
+   char *pcAfter;
+   boolean bIsFile;
+   size_t ulSize;
+   size_t ulRead;
+
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+   setSegment(&asSegments[0], acHead, 4);
+   setSegment(&asSegments[1], acBody, 7);
+   setSegment(&asSegments[2], acTail, 4);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertFileV("r/x", asSegments, 3) == CONFLICTING_PATH);
+   assert(FT_insertDir("r") == SUCCESS);
+   assert(FT_openJournal(LOG_FILE, 1) == SUCCESS);
+   assert(FT_checkpoint(SNAPSHOT_FILE) == SUCCESS);
+   assert(FT_insertFileV("r/x", asSegments, 3) == SUCCESS);
+   assert(FT_insertFileV("r/x", asSegments, 3) != SUCCESS);
+   assert(FT_insertFileV("r/e", NULL, 0) == SUCCESS);
+   assert(FT_stat("r/x", &bIsFile, &ulSize) == SUCCESS);
+   assert(bIsFile && ulSize == 15);
+   assert(memcmp(FT_getFileContents("r/x"), "HDR:payload:END", 15) == 0);
+
+   /* a gathered insert inside an aborted transaction leaves nothing */
+   pcBefore = FT_toString();
+   assert(pcBefore != NULL);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_insertFileV("r/t", asSegments, 3) == SUCCESS);
+   assert(FT_rmFile("r/x") == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   pcAfter = FT_toString();
+   assert(pcAfter != NULL && strcmp(pcBefore, pcAfter) == 0);
+   free(pcBefore);
+   free(pcAfter);
+
+   /* scatter a read across segments of different lengths */
+   setSegment(&asSegments[0], acA, sizeof(acA));
+   setSegment(&asSegments[1], acB, sizeof(acB));
+   setSegment(&asSegments[2], acC, sizeof(acC));
+   assert(FT_readFileV("r/x", 1, asSegments, 3, &ulRead) == SUCCESS);
+   assert(ulRead == 14);
+   assert(memcmp(acA, "DR:", 3) == 0 && memcmp(acB, "paylo", 5) == 0);
+   assert(memcmp(acC, "ad:END", 6) == 0);
+   assert(FT_readFileV("r/x", 14, asSegments, 3, &ulRead) == SUCCESS);
+   assert(ulRead == 1 && acA[0] == 'D');
+   assert(FT_readFileV("r", 0, asSegments, 3, &ulRead) == NOT_A_FILE);
+   assert(FT_readFileV("r/t", 0, asSegments, 3, &ulRead)
+          == NO_SUCH_PATH);
+   assert(FT_destroy() == SUCCESS);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_recover(SNAPSHOT_FILE, LOG_FILE) == SUCCESS);
+   assert(memcmp(FT_getFileContents("r/x"), "HDR:payload:END", 15) == 0);
+   assert(FT_stat("r/e", &bIsFile, &ulSize) == SUCCESS);
+   assert(bIsFile && ulSize == 0);
+   assert(!FT_containsFile("r/t"));
+   assert(FT_destroy() == SUCCESS);
+   remove(SNAPSHOT_FILE);
+   remove(LOG_FILE);
+
+   checkStored();
+
+   printf("ft_segment_client: all checks passed\n");
+   return 0;
+}
@@ -0,0 +1,122 @@
+/*--------------------------------------------------------------------*/
+/* ft_serial_client.c                                                 */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The longest representation gathered from FT_writeSubtree */
+enum {MAX_TEXT = 1024};
+
+/* What gatherText collects from FT_writeSubtree */
+struct Gather
+{
+   /* the pieces written so far, NUL-terminated */
+   char acText[MAX_TEXT];
+   /* the number of pieces written, and the number to accept before
+      failing with IO_ERROR */
+   int iPieces;
+   int iLimit;
+};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Appends the ulLength bytes at pcText to the struct Gather pvExtra.
+  Returns SUCCESS, or IO_ERROR once its limit of pieces is passed.
+*/
+static int gatherText(const char *pcText, size_t ulLength,
+                      void *pvExtra) {
+   struct Gather *psGather = pvExtra;
+   size_t ulUsed = strlen(psGather->acText);
+
+   if (++psGather->iPieces > psGather->iLimit)
+      return IO_ERROR;
+   assert(ulUsed + ulLength < MAX_TEXT);
+   memcpy(psGather->acText + ulUsed, pcText, ulLength);
+   psGather->acText[ulUsed + ulLength] = '\0';
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that FT_toStringSubtree(pcPath, ulMaxDepth) returns
+  pcExpected, and that FT_writeSubtree streams the same text.
+*/
+static void checkSubtree(const char *pcPath, size_t ulMaxDepth,
+                         const char *pcExpected) {
+   struct Gather sGather;
+   char *pcText;
+
+   pcText = FT_toStringSubtree(pcPath, ulMaxDepth);
+   assert(pcText != NULL && strcmp(pcText, pcExpected) == 0);
+   free(pcText);
+   sGather.acText[0] = '\0';
+   sGather.iPieces = 0;
+   sGather.iLimit = MAX_TEXT;
+   assert(FT_writeSubtree(pcPath, ulMaxDepth, gatherText, &sGather)
+          == SUCCESS);
+   assert(strcmp(sGather.acText, pcExpected) == 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_toStringSubtree and FT_writeSubtree: depth limits, that
+  they agree with FT_toString and with each other, that a failing
+  writer ends the stream, and that an abort restores what they
+  report. Returns 0.
+*/
+int main(void) {
+   struct Gather sGather;
+   char acData[] = "0123456789";
+   char *pcWhole;
+
+   assert(FT_toStringSubtree("a", 0) == NULL);
+   assert(FT_writeSubtree("a", 0, gatherText, &sGather)
+          == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("a/b/c/d") == SUCCESS);
+   assert(FT_insertFile("a/b/f", acData, 2) == SUCCESS);
+   assert(FT_insertDir("a/x/y") == SUCCESS);
+   assert(FT_insertFile("a/z", acData, 1) == SUCCESS);
+
+   pcWhole = FT_toString();
+   assert(pcWhole != NULL);
+   checkSubtree("a", FT_UNLIMITED, pcWhole);
+   checkSubtree("a", 0, "a\n");
+   checkSubtree("a", 1, "a\na/z\na/b\na/x\n");
+   checkSubtree("a/b", 1, "a/b\na/b/f\na/b/c\n");
+   checkSubtree("a/b", FT_UNLIMITED - 1, "a/b\na/b/f\na/b/c\na/b/c/d\n");
+   checkSubtree("a/z", 5, "a/z\n");
+   assert(FT_toStringSubtree("a/q", 5) == NULL);
+   assert(FT_writeSubtree("a/q", 5, gatherText, &sGather) == NO_SUCH_PATH);
+   assert(FT_writeSubtree("b", 5, gatherText, &sGather)
+          == CONFLICTING_PATH);
+
+   /* the writer's failure ends the stream and is returned */
+   sGather.acText[0] = '\0';
+   sGather.iPieces = 0;
+   sGather.iLimit = 3;
+   assert(FT_writeSubtree("a", FT_UNLIMITED, gatherText, &sGather)
+          == IO_ERROR);
+   assert(sGather.iPieces == 4);
+
+   /* an abort restores the representation */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("a/b/c") == SUCCESS);
+   assert(FT_insertFile("a/b/e", acData, 3) == SUCCESS);
+   checkSubtree("a/b", FT_UNLIMITED, "a/b\na/b/e\na/b/f\n");
+   assert(FT_abort() == SUCCESS);
+   checkSubtree("a", FT_UNLIMITED, pcWhole);
+   checkSubtree("a/b", FT_UNLIMITED, "a/b\na/b/f\na/b/c\na/b/c/d\n");
+   free(pcWhole);
+   assert(FT_destroy() == SUCCESS);
+
+   printf("ft_serial_client: all checks passed\n");
+   return 0;
+}
@@ -0,0 +1,234 @@
+/*--------------------------------------------------------------------*/
+/* ft_size_client.c                                                   */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The most files a walk or a search may visit */
+enum {MAX_FILES = 5000};
+
+/* The number of random mutations */
+enum {STEP_COUNT = 10000};
+
+/* What the visitors below record about a walk or a search */
+struct Sizes
+{
+   /* the lengths of the files visited, and their number */
+   size_t aulSizes[MAX_FILES];
+   int iCount;
+   /* the number of visits at which to stop, or 0 for none */
+   int iStopAt;
+};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that psEntry is a file of its reported length, adds that
+  length to the struct Sizes pvExtra, and stops once it holds as many
+  as asked.
+*/
+static enum FT_WalkAction sizeVisit(const struct FT_DirEntry *psEntry,
+                                    void *pvExtra) {
+   struct Sizes *psSizes = pvExtra;
+   boolean bIsFile;
+   size_t ulSize;
+
+   assert(psEntry->bIsFile);
+   assert(FT_stat(psEntry->pcPath, &bIsFile, &ulSize) == SUCCESS);
+   assert(bIsFile && ulSize == psEntry->ulSize);
+   assert(psSizes->iCount < MAX_FILES);
+   psSizes->aulSizes[psSizes->iCount++] = psEntry->ulSize;
+   if (psSizes->iCount == psSizes->iStopAt)
+      return FT_WALK_STOP;
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Adds psEntry's length to the struct Sizes pvExtra if it is a file. */
+static enum FT_WalkAction fileVisit(const struct FT_DirEntry *psEntry,
+                                    void *pvExtra) {
+   struct Sizes *psSizes = pvExtra;
+
+   if (psEntry->bIsFile) {
+      assert(psSizes->iCount < MAX_FILES);
+      psSizes->aulSizes[psSizes->iCount++] = psEntry->ulSize;
+   }
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns <0, 0, or >0 as the size_t at pvFirst is less than, equal
+  to, or greater than the one at pvSecond.
+*/
+static int compareAscending(const void *pvFirst, const void *pvSecond) {
+   size_t ulFirst = *(const size_t *)pvFirst;
+   size_t ulSecond = *(const size_t *)pvSecond;
+
+   return (ulFirst > ulSecond) - (ulFirst < ulSecond);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that FT_findBySize(ulMin, ulMax) visits the files a walk of
+  the whole FT finds with lengths in [ulMin, ulMax], in ascending
+  order if bIndexed, and that the index stats count every file and
+  length while it is on.
+*/
+static void checkSizes(size_t ulMin, size_t ulMax, boolean bIndexed) {
+   static struct Sizes sAll;
+   static struct Sizes sFound;
+   struct FT_IndexStats sStats;
+   size_t ulLengths = 0;
+   int iInRange = 0;
+   int i;
+
+   sAll.iCount = 0;
+   if (FT_containsDir("r"))
+      assert(FT_walk("r", fileVisit, &sAll) == SUCCESS);
+   qsort(sAll.aulSizes, (size_t)sAll.iCount, sizeof(size_t),
+         compareAscending);
+
+   sFound.iCount = 0;
+   sFound.iStopAt = 0;
+   assert(FT_findBySize(ulMin, ulMax, sizeVisit, &sFound) == SUCCESS);
+   if (bIndexed)
+      for (i = 1; i < sFound.iCount; i++)
+         assert(sFound.aulSizes[i - 1] <= sFound.aulSizes[i]);
+   qsort(sFound.aulSizes, (size_t)sFound.iCount, sizeof(size_t),
+         compareAscending);
+   for (i = 0; i < sAll.iCount; i++)
+      if (sAll.aulSizes[i] >= ulMin && sAll.aulSizes[i] <= ulMax) {
+         assert(iInRange < sFound.iCount
+                && sFound.aulSizes[iInRange] == sAll.aulSizes[i]);
+         iInRange++;
+      }
+   assert(iInRange == sFound.iCount);
+   if (!bIndexed)
+      return;
+
+   for (i = 0; i < sAll.iCount; i++)
+      if (i == 0 || sAll.aulSizes[i] != sAll.aulSizes[i - 1])
+         ulLengths++;
+   FT_getSizeIndexStats(&sStats);
+   assert(sStats.ulEntries == (size_t)sAll.iCount);
+   assert(sStats.ulKeys == ulLengths);
+
+   /* a visitor's stop ends the search */
+   if (sFound.iCount > 2) {
+      sFound.iCount = 0;
+      sFound.iStopAt = 2;
+      assert(FT_findBySize(ulMin, ulMax, sizeVisit, &sFound) == SUCCESS);
+      assert(sFound.iCount == 2);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Checks a pseudo-random range, now and then an empty one. */
+static void checkRandom(boolean bIndexed) {
+   size_t ulMin = (size_t)(rand() % 300);
+   size_t ulMax = ulMin + (size_t)(rand() % 100);
+
+   if (rand() % 5 == 0)
+      ulMin = ulMax = 0;
+   checkSizes(ulMin, ulMax, bIndexed);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_setSizeIndex, FT_findBySize, and FT_getSizeIndexStats
+  against a walk of the whole FT, across a pseudo-random series of
+  content changes, removals, and transactions committed and aborted,
+  with the index turned off and on again partway, and that an abort
+  restores the order it keeps. Returns 0.
+*/
+int main(void) {
+   struct FT_IndexStats sStats;
+   struct Sizes sFound;
+   char acData[400];
+   char acPath[64];
+   boolean bIndexed = TRUE;
+   int iOp;
+   int iLength;
+   int i;
+
+   assert(FT_setSizeIndex(TRUE) == INITIALIZATION_ERROR);
+   assert(FT_findBySize(0, 1, sizeVisit, &sFound) == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   assert(FT_setSizeIndex(TRUE) == SUCCESS);
+   memset(acData, 'x', sizeof(acData));
+
+   srand(11);
+   for (i = 0; i < STEP_COUNT; i++) {
+      iOp = rand() % 12;
+      sprintf(acPath, "r/%c/%c/%c", 'a' + rand() % 4, 'a' + rand() % 5,
+              'a' + rand() % 8);
+      if (rand() % 2)
+         *strrchr(acPath, '/') = '\0';
+      iLength = rand() % (int)sizeof(acData);
+      /* a transaction begun here may still be open from the last */
+      if (i % 400 == 0 && rand() % 2)
+         (void)FT_begin();
+      if (i == STEP_COUNT * 2 / 5 || i == STEP_COUNT / 2) {
+         bIndexed = !bIndexed;
+         assert(FT_setSizeIndex(bIndexed) == SUCCESS);
+      }
+      if (iOp < 3)
+         (void)FT_insertFile(acPath, acData, (size_t)(iLength % 40));
+      else if (iOp < 5)
+         (void)FT_replaceFileContents(acPath, acData, (size_t)iLength);
+      else if (iOp < 6)
+         (void)FT_appendFile(acPath, acData, (size_t)(iLength % 20));
+      else if (iOp < 7)
+         (void)FT_writeFile(acPath, (size_t)(iLength % 50), acData, 3);
+      else if (iOp < 8) {
+         *strrchr(acPath, '/') = '\0';
+         (void)FT_rmDir(acPath);
+      }
+      else if (iOp < 9)
+         (void)FT_rmFile(acPath);
+      else if (iOp < 11)
+         (void)FT_insertDir(acPath);
+      else if (rand() % 10 == 0) {
+         if (FT_abort() != SUCCESS)
+            (void)FT_commit();
+      }
+      else if (rand() % 10 == 0)
+         (void)FT_commit();
+      if (i % 29 == 0)
+         checkRandom(bIndexed);
+   }
+   (void)FT_commit();
+
+   /* an abort restores the lengths its changes moved */
+   (void)FT_insertDir("r/a");
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("r/a") == SUCCESS);
+   assert(FT_insertFile("r/a/big", acData, sizeof(acData)) == SUCCESS);
+   assert(FT_insertFile("r/a/one", acData, 1) == SUCCESS);
+   checkSizes(0, sizeof(acData), TRUE);
+   checkSizes(sizeof(acData), sizeof(acData), TRUE);
+   assert(FT_abort() == SUCCESS);
+   checkSizes(0, sizeof(acData), TRUE);
+   checkSizes(sizeof(acData), sizeof(acData), TRUE);
+   assert(!FT_containsFile("r/a/big"));
+   assert(FT_destroy() == SUCCESS);
+
+   assert(FT_init() == SUCCESS);
+   FT_getSizeIndexStats(&sStats);
+   assert(sStats.ulKeys == 0 && sStats.ulEntries == 0);
+   assert(FT_destroy() == SUCCESS);
+
+   printf("ft_size_client: all checks passed\n");
+   return 0;
+}
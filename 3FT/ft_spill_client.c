@@ -0,0 +1,277 @@
+/*--------------------------------------------------------------------*/
+/* ft_spill_client.c                                                  */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The files this client writes, and removes again before exiting */
+#define SPILL_FILE "ft_spill_client.spill"
+#define SNAPSHOT_FILE "ft_spill_client.snap"
+
+/* A journal that is never written, so recovery uses the snapshot */
+#define NO_LOG_FILE "ft_spill_client.nolog"
+
+/* A spill file path whose directory does not exist */
+#define BAD_SPILL_FILE "ft_spill_client.missing/spill"
+
+/* The number of files of varied lengths, and of equal lengths */
+enum {FILE_COUNT = 200};
+enum {MANY_FILE_COUNT = 2000};
+
+/* The largest contents inserted */
+enum {MAX_LENGTH = 3000};
+
+/*--------------------------------------------------------------------*/
+
+/* Fills the ulLength bytes at pcBody with contents particular to i. */
+static void fillBody(char *pcBody, int i, size_t ulLength) {
+   size_t ulIndex;
+
+   for (ulIndex = 0; ulIndex < ulLength; ulIndex++)
+      pcBody[ulIndex] = (char)('a' + ((size_t)i * 7 + ulIndex
+                                      * (size_t)(i % 5 + 1)) % 26);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns TRUE if the file pcFile exists, or FALSE if not. */
+static boolean exists(const char *pcFile) {
+   FILE *psFile;
+
+   psFile = fopen(pcFile, "rb");
+   if (psFile == NULL)
+      return FALSE;
+   fclose(psFile);
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that the file at pcPath holds the ulLength bytes fillBody
+  makes for i.
+*/
+static void checkBody(const char *pcPath, int i, size_t ulLength) {
+   static char acExpected[MAX_LENGTH];
+   char *pcContents;
+
+   fillBody(acExpected, i, ulLength);
+   pcContents = FT_getFileContents(pcPath);
+   assert(pcContents != NULL);
+   assert(memcmp(pcContents, acExpected, ulLength) == 0);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks that files of varied lengths, some compressed, stay readable
+  within the budget, through removal, replacement, an abort, a
+  background checkpoint, and turning the budget off and on.
+*/
+static void checkBudget(void) {
+   static char acBody[MAX_LENGTH];
+   struct FT_ContentStats sStats;
+   FT_Contents_T oCPinned;
+   char acPath[32];
+   char *pcBefore;
+   char *pcAfter;
+   boolean bDone;
+   int i;
+
+   assert(FT_setMemoryBudget(SPILL_FILE, 100) == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_setMemoryBudget(BAD_SPILL_FILE, 100) == IO_ERROR);
+   assert(FT_setMemoryBudget(SPILL_FILE, 20000) == SUCCESS);
+   assert(FT_setOwnership(FT_COPY, NULL) == SUCCESS);
+   assert(FT_insertDir("d") == SUCCESS);
+   for (i = 0; i < FILE_COUNT; i++) {
+      sprintf(acPath, "d/f%d", i);
+      fillBody(acBody, i, 500 + (size_t)i * 10);
+      if (i % 3 == 0)
+         assert(FT_setCompression(i % 2 ? 1000 : 0) == SUCCESS);
+      assert(FT_insertFile(acPath, acBody, 500 + (size_t)i * 10)
+             == SUCCESS);
+   }
+   FT_getContentStats(&sStats);
+   assert(sStats.ulResidentBytes <= 20000);
+   assert(sStats.ulSpilled > 0 && sStats.ulEvictions > 0);
+
+   assert(FT_pin("d/f0", &oCPinned) == SUCCESS);
+   for (i = 0; i < FILE_COUNT; i++) {
+      sprintf(acPath, "d/f%d", i);
+      checkBody(acPath, i, 500 + (size_t)i * 10);
+   }
+   fillBody(acBody, 0, 500);
+   assert(memcmp(FT_getPinnedData(oCPinned), acBody, 500) == 0);
+   FT_getContentStats(&sStats);
+   assert(sStats.ulSpillMisses > 0);
+
+   /* an abort brings back spilled files it removed or replaced */
+   pcBefore = FT_toString();
+   assert(pcBefore != NULL);
+   assert(FT_begin() == SUCCESS);
+   for (i = 0; i < FILE_COUNT; i += 5) {
+      sprintf(acPath, "d/f%d", i);
+      assert(FT_rmFile(acPath) == SUCCESS);
+   }
+   fillBody(acBody, 0, 900);
+   assert(FT_replaceFileContents("d/f1", acBody, 900) == NULL);
+   assert(FT_abort() == SUCCESS);
+   pcAfter = FT_toString();
+   assert(pcAfter != NULL && strcmp(pcBefore, pcAfter) == 0);
+   free(pcBefore);
+   free(pcAfter);
+   for (i = 0; i < FILE_COUNT; i += 5) {
+      sprintf(acPath, "d/f%d", i);
+      checkBody(acPath, i, 500 + (size_t)i * 10);
+   }
+   checkBody("d/f1", 1, 510);
+
+   /* remove and replace spilled files for good */
+   for (i = 0; i < FILE_COUNT; i += 2) {
+      sprintf(acPath, "d/f%d", i);
+      assert(FT_rmFile(acPath) == SUCCESS);
+   }
+   for (i = 1; i < FILE_COUNT; i += 4) {
+      sprintf(acPath, "d/f%d", i);
+      fillBody(acBody, i + 1, 900);
+      assert(FT_replaceFileContents(acPath, acBody, 900) == NULL);
+   }
+
+   /* the child reads spilled files while the parent keeps reading */
+   assert(FT_checkpointAsync(SNAPSHOT_FILE) == SUCCESS);
+   for (i = 3; i < FILE_COUNT; i += 4) {
+      sprintf(acPath, "d/f%d", i);
+      assert(FT_getFileContents(acPath) != NULL);
+   }
+   assert(FT_pollCheckpoint(TRUE, &bDone) == SUCCESS && bDone);
+
+   /* turning the budget off reads everything back */
+   assert(FT_setMemoryBudget(NULL, 0) == SUCCESS);
+   FT_getContentStats(&sStats);
+   assert(sStats.ulSpilled == 0);
+   assert(!exists(SPILL_FILE));
+   assert(FT_setMemoryBudget(SPILL_FILE, 0) == SUCCESS);
+   FT_getContentStats(&sStats);
+   assert(sStats.ulSpilled > 0 && sStats.ulResidentBytes <= 500);
+   assert(FT_destroy() == SUCCESS);
+   assert(!exists(SPILL_FILE));
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_recover(SNAPSHOT_FILE, NO_LOG_FILE) == SUCCESS);
+   for (i = 1; i < FILE_COUNT; i += 2) {
+      sprintf(acPath, "d/f%d", i);
+      if ((i - 1) % 4 == 0)
+         checkBody(acPath, i + 1, 900);
+      else
+         checkBody(acPath, i, 500 + (size_t)i * 10);
+   }
+   assert(FT_destroy() == SUCCESS);
+   FT_unpin(oCPinned);
+   remove(SNAPSHOT_FILE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks that a background checkpoint of a fully spilled tree writes
+  every file even if the parent frees their spill slots meanwhile
+  (bRemove TRUE), or turns the budget off, which waits for the child
+  first (bRemove FALSE).
+*/
+static void checkForkedSpill(boolean bRemove) {
+   static char acBody[MAX_LENGTH];
+   char acPath[32];
+   boolean bDone;
+   int i;
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_setOwnership(FT_COPY, NULL) == SUCCESS);
+   assert(FT_setMemoryBudget(SPILL_FILE, 0) == SUCCESS);
+   assert(FT_insertDir("d") == SUCCESS);
+   for (i = 0; i < MANY_FILE_COUNT; i++) {
+      sprintf(acPath, "d/f%d", i);
+      fillBody(acBody, i, 1000);
+      assert(FT_insertFile(acPath, acBody, 1000) == SUCCESS);
+   }
+   assert(FT_checkpointAsync(SNAPSHOT_FILE) == SUCCESS);
+   if (bRemove) {
+      for (i = 0; i < MANY_FILE_COUNT; i++) {
+         sprintf(acPath, "d/f%d", i);
+         assert(FT_rmFile(acPath) == SUCCESS);
+      }
+      for (i = 0; i < MANY_FILE_COUNT; i++) {
+         sprintf(acPath, "d/g%d", i);
+         fillBody(acBody, i + 1, 1000);
+         assert(FT_insertFile(acPath, acBody, 1000) == SUCCESS);
+      }
+      assert(FT_pollCheckpoint(TRUE, &bDone) == SUCCESS && bDone);
+   }
+   else {
+      assert(FT_setMemoryBudget(NULL, 0) == SUCCESS);
+      assert(FT_pollCheckpoint(FALSE, &bDone) == INITIALIZATION_ERROR);
+   }
+   assert(FT_destroy() == SUCCESS);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_recover(SNAPSHOT_FILE, NO_LOG_FILE) == SUCCESS);
+   for (i = 0; i < MANY_FILE_COUNT; i++) {
+      sprintf(acPath, "d/f%d", i);
+      checkBody(acPath, i, 1000);
+   }
+   assert(FT_destroy() == SUCCESS);
+   remove(SNAPSHOT_FILE);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Checks that reading pinned contents leaves the spill LRU alone. */
+static void checkPinnedReads(void) {
+   char acBody[1000];
+   struct FT_ContentStats sBefore;
+   struct FT_ContentStats sAfter;
+   FT_Contents_T oCPinned;
+   int i;
+
+   memset(acBody, 'x', sizeof(acBody));
+   assert(FT_init() == SUCCESS);
+   assert(FT_setOwnership(FT_COPY, NULL) == SUCCESS);
+   assert(FT_setMemoryBudget(SPILL_FILE, 5000) == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   assert(FT_insertFile("r/a", acBody, sizeof(acBody)) == SUCCESS);
+   assert(FT_pin("r/a", &oCPinned) == SUCCESS);
+   FT_getContentStats(&sBefore);
+   for (i = 0; i < 10; i++)
+      assert(memcmp(FT_getPinnedData(oCPinned), acBody, sizeof(acBody))
+             == 0);
+   assert(memcmp(FT_getFileContents("r/a"), acBody, sizeof(acBody))
+          == 0);
+   FT_getContentStats(&sAfter);
+   assert(sBefore.ulSpillHits == sAfter.ulSpillHits);
+   assert(sBefore.ulSpillMisses == sAfter.ulSpillMisses);
+   FT_unpin(oCPinned);
+   assert(FT_destroy() == SUCCESS);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_setMemoryBudget: eviction to and reading back from the
+  spill file, and its interplay with pins, transactions, and
+  background checkpoints. Returns 0.
+*/
+int main(void) {
+   remove(SNAPSHOT_FILE);
+
+   checkBudget();
+   checkForkedSpill(TRUE);
+   checkForkedSpill(FALSE);
+   checkPinnedReads();
+
+   printf("ft_spill_client: all checks passed\n");
+   return 0;
+}
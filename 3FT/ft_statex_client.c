@@ -0,0 +1,87 @@
+/*--------------------------------------------------------------------*/
+/* ft_statex_client.c                                                 */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/*--------------------------------------------------------------------*/
+
+/* Returns TRUE if *psA and *psB report the same, or FALSE if not. */
+static boolean sameStat(const struct FT_StatEx *psA,
+                        const struct FT_StatEx *psB) {
+   return psA->bIsFile == psB->bIsFile && psA->ulSize == psB->ulSize
+          && psA->ulDirChildren == psB->ulDirChildren
+          && psA->ulFileChildren == psB->ulFileChildren
+          && psA->ulDepth == psB->ulDepth
+          && psA->sSubtree.ulDirs == psB->sSubtree.ulDirs
+          && psA->sSubtree.ulFiles == psB->sSubtree.ulFiles
+          && psA->sSubtree.ulBytes == psB->sSubtree.ulBytes;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_statEx: the status for each kind of bad or missing path,
+  what it reports about directories and files, and that it reports
+  the same again after an aborted transaction. Returns 0.
+*/
+int main(void) {
+   struct FT_StatEx sStat;
+   struct FT_StatEx sBefore;
+   char acData[] = "abcdefghi";
+
+   assert(FT_statEx("a", &sStat) == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_statEx("a", &sStat) == NO_SUCH_PATH);
+   assert(FT_insertDir("a/b/c") == SUCCESS);
+   assert(FT_insertDir("a/b/d") == SUCCESS);
+   assert(FT_insertFile("a/b/f", acData, 5) == SUCCESS);
+   assert(FT_insertFile("a/g", acData, 3) == SUCCESS);
+
+   assert(FT_statEx("", &sStat) == BAD_PATH);
+   assert(FT_statEx("/a", &sStat) == BAD_PATH);
+   assert(FT_statEx("a/", &sStat) == BAD_PATH);
+   assert(FT_statEx("a//b", &sStat) == BAD_PATH);
+   assert(FT_statEx("b", &sStat) == CONFLICTING_PATH);
+   assert(FT_statEx("ab", &sStat) == CONFLICTING_PATH);
+   assert(FT_statEx("a/b/f/x", &sStat) == NO_SUCH_PATH);
+   assert(FT_statEx("a/b/e", &sStat) == NO_SUCH_PATH);
+   assert(FT_statEx("a/b/c/d", &sStat) == NO_SUCH_PATH);
+
+   assert(FT_statEx("a/b", &sStat) == SUCCESS);
+   assert(!sStat.bIsFile && sStat.ulSize == 0 && sStat.ulDepth == 2);
+   assert(sStat.ulDirChildren == 2 && sStat.ulFileChildren == 1);
+   assert(sStat.sSubtree.ulDirs == 3 && sStat.sSubtree.ulFiles == 1);
+   assert(sStat.sSubtree.ulBytes == 5);
+   assert(FT_statEx("a", &sStat) == SUCCESS);
+   assert(sStat.ulDepth == 1 && sStat.sSubtree.ulFiles == 2);
+   assert(sStat.sSubtree.ulBytes == 8);
+   assert(FT_statEx("a/b/f", &sStat) == SUCCESS);
+   assert(sStat.bIsFile && sStat.ulSize == 5 && sStat.ulDepth == 3);
+   assert(sStat.ulDirChildren == 0 && sStat.ulFileChildren == 0);
+   assert(sStat.sSubtree.ulFiles == 1 && sStat.sSubtree.ulBytes == 5);
+   assert(FT_containsDir("a/b/c") && !FT_containsDir("a/b/f"));
+   assert(FT_containsFile("a/b/f") && !FT_containsFile("a/b/c"));
+
+   /* an abort brings back the counts along with the nodes */
+   assert(FT_statEx("a/b", &sBefore) == SUCCESS);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("a/b/c") == SUCCESS);
+   assert(FT_appendFile("a/b/f", acData, 4) == SUCCESS);
+   assert(FT_insertFile("a/b/h", acData, 2) == SUCCESS);
+   assert(FT_statEx("a/b", &sStat) == SUCCESS);
+   assert(sStat.ulDirChildren == 1 && sStat.ulFileChildren == 2);
+   assert(sStat.sSubtree.ulBytes == 11);
+   assert(FT_abort() == SUCCESS);
+   assert(FT_statEx("a/b", &sStat) == SUCCESS);
+   assert(sameStat(&sStat, &sBefore));
+   assert(FT_destroy() == SUCCESS);
+   assert(FT_statEx("a", &sStat) == INITIALIZATION_ERROR);
+
+   printf("ft_statex_client: all checks passed\n");
+   return 0;
+}
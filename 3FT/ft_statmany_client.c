@@ -0,0 +1,94 @@
+/*--------------------------------------------------------------------*/
+/* ft_statmany_client.c                                               */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* Paths of every kind, unsorted, with shared prefixes and repeats */
+static const char *const apcPaths[] = {
+   "a/b/c", "", "a/b/f", "b/x", "a/b/f/x", "a", "a/b", "a/bb/q",
+   "a/b/c/d/e", "a/b/c/d", "a//b", "a/b-/z", "a/b-", "a/b/c/d/e",
+   "a/g", "a/b/", "ab", "a/b/c/zz"
+};
+
+/* The number of paths in apcPaths */
+enum {PATH_COUNT = sizeof(apcPaths) / sizeof(apcPaths[0])};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that FT_statMany reports for each path in apcPaths what
+  FT_stat and FT_containsFile report for it one at a time.
+*/
+static void checkAgainstStat(void) {
+   struct FT_StatResult asResults[PATH_COUNT];
+   boolean bIsFile;
+   size_t ulSize;
+   int iStatus;
+   size_t ulIndex;
+
+   assert(FT_statMany(apcPaths, PATH_COUNT, asResults) == SUCCESS);
+   for (ulIndex = 0; ulIndex < PATH_COUNT; ulIndex++) {
+      bIsFile = FALSE;
+      ulSize = 0;
+      iStatus = FT_stat(apcPaths[ulIndex], &bIsFile, &ulSize);
+      assert(asResults[ulIndex].iStatus == iStatus);
+      if (iStatus == SUCCESS) {
+         assert(asResults[ulIndex].bIsFile == bIsFile);
+         assert(asResults[ulIndex].ulSize == (bIsFile ? ulSize : 0));
+      }
+      assert((iStatus == SUCCESS && bIsFile)
+             == FT_containsFile(apcPaths[ulIndex]));
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_statMany against FT_stat on an empty FT, a populated one,
+  and one restored by an abort. Returns 0.
+*/
+int main(void) {
+   struct FT_StatResult asResults[PATH_COUNT];
+   char acData[] = "hello";
+
+   assert(FT_statMany(apcPaths, PATH_COUNT, asResults)
+          == INITIALIZATION_ERROR);
+   assert(asResults[3].iStatus == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   checkAgainstStat();
+
+   assert(FT_insertDir("a/b/c/d/e") == SUCCESS);
+   assert(FT_insertDir("a/b-") == SUCCESS);
+   assert(FT_insertFile("a/b/f", acData, 5) == SUCCESS);
+   assert(FT_insertFile("a/g", acData, 2) == SUCCESS);
+   checkAgainstStat();
+   assert(FT_statMany(apcPaths, PATH_COUNT, asResults) == SUCCESS);
+   assert(asResults[2].bIsFile && asResults[2].ulSize == 5);
+   assert(asResults[4].iStatus == NO_SUCH_PATH);
+   assert(asResults[3].iStatus == CONFLICTING_PATH);
+   assert(asResults[1].iStatus == BAD_PATH);
+   assert(asResults[8].iStatus == SUCCESS);
+   assert(asResults[13].iStatus == SUCCESS);
+
+   /* the walks see the tree an abort restores */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("a/b/c") == SUCCESS);
+   assert(FT_insertFile("a/b/c", acData, 3) == SUCCESS);
+   assert(FT_rmFile("a/g") == SUCCESS);
+   checkAgainstStat();
+   assert(FT_abort() == SUCCESS);
+   checkAgainstStat();
+   assert(FT_statMany(apcPaths, PATH_COUNT, asResults) == SUCCESS);
+   assert(asResults[0].iStatus == SUCCESS && !asResults[0].bIsFile);
+
+   assert(FT_statMany(NULL, 0, NULL) == SUCCESS);
+   assert(FT_destroy() == SUCCESS);
+
+   printf("ft_statmany_client: all checks passed\n");
+   return 0;
+}
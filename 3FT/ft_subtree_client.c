@@ -0,0 +1,192 @@
+/*--------------------------------------------------------------------*/
+/* ft_subtree_client.c                                                */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The file this client writes, and removes again before exiting */
+#define LOG_FILE "ft_subtree_client.log"
+
+/* The number of paths in the fixed tree of three levels below "r" */
+enum {PATH_COUNT = 40};
+
+/* The longest such path, and the number of random mutations */
+enum {MAX_PATH = 32};
+enum {STEP_COUNT = 20000};
+
+/* Every path a mutation may name, and how many have been generated */
+static char aacPaths[PATH_COUNT][MAX_PATH];
+static int iPaths = 0;
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Adds pcPrefix, at depth iDepth, and the three children of each path
+  below it down to depth 3 to aacPaths.
+*/
+static void generatePaths(const char *pcPrefix, int iDepth) {
+   char acChild[MAX_PATH];
+   int i;
+
+   assert(iPaths < PATH_COUNT);
+   strcpy(aacPaths[iPaths++], pcPrefix);
+   if (iDepth == 3)
+      return;
+   for (i = 0; i < 3; i++) {
+      sprintf(acChild, "%s/%c%d", pcPrefix, 'a' + iDepth, i);
+      generatePaths(acChild, iDepth + 1);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Returns TRUE if pcPath is pcAncestor or lies beneath it. */
+static boolean isWithin(const char *pcAncestor, const char *pcPath) {
+   size_t ulLength = strlen(pcAncestor);
+
+   return strncmp(pcAncestor, pcPath, ulLength) == 0
+          && (pcPath[ulLength] == '\0' || pcPath[ulLength] == '/');
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that FT_statSubtree reports for every path in the FT the
+  totals found by visiting each path beneath it with FT_stat.
+*/
+static void checkTotals(void) {
+   struct FT_SubtreeStats sStats;
+   size_t ulDirs;
+   size_t ulFiles;
+   size_t ulBytes;
+   size_t ulSize;
+   boolean bIsFile;
+   int iStatus;
+   int i;
+   int j;
+
+   for (i = 0; i < iPaths; i++) {
+      iStatus = FT_statSubtree(aacPaths[i], &sStats);
+      if (!FT_containsDir(aacPaths[i]) && !FT_containsFile(aacPaths[i])) {
+         assert(iStatus != SUCCESS);
+         continue;
+      }
+      assert(iStatus == SUCCESS);
+      ulDirs = ulFiles = ulBytes = 0;
+      for (j = 0; j < iPaths; j++)
+         if (isWithin(aacPaths[i], aacPaths[j])
+             && FT_stat(aacPaths[j], &bIsFile, &ulSize) == SUCCESS) {
+            if (bIsFile) {
+               ulFiles++;
+               ulBytes += ulSize;
+            }
+            else
+               ulDirs++;
+         }
+      assert(sStats.ulDirs == ulDirs && sStats.ulFiles == ulFiles);
+      assert(sStats.ulBytes == ulBytes);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_statSubtree against a brute-force count after each of a
+  pseudo-random series of mutations, transactions committed and
+  aborted, and recovery of the whole series from the journal.
+  Returns 0.
+*/
+int main(void) {
+   static char acData[300];
+   unsigned long ulSeed = 5;
+   boolean bInTransaction = FALSE;
+   const char *pcPath;
+   char *pcBefore;
+   char *pcAfter;
+   int iOp;
+   int iStep;
+
+   remove(LOG_FILE);
+   memset(acData, 'x', sizeof(acData));
+   generatePaths("r", 0);
+
+   assert(FT_init() == SUCCESS);
+   assert(FT_openJournal(LOG_FILE, 16) == SUCCESS);
+   for (iStep = 0; iStep < STEP_COUNT; iStep++) {
+      ulSeed = ulSeed * 1103515245UL + 12345UL;
+      iOp = (int)((ulSeed >> 16) % 11);
+      ulSeed = ulSeed * 1103515245UL + 12345UL;
+      pcPath = aacPaths[(ulSeed >> 16) % PATH_COUNT];
+      switch (iOp) {
+         case 0:
+         case 1:
+            (void)FT_insertDir(pcPath);
+            break;
+         case 2:
+            (void)FT_insertFile(pcPath, acData, (ulSeed >> 8) % 200);
+            break;
+         case 3:
+            (void)FT_rmDir(pcPath);
+            break;
+         case 4:
+            (void)FT_rmFile(pcPath);
+            break;
+         case 5:
+            if (FT_containsFile(pcPath))
+               (void)FT_replaceFileContents(pcPath, acData,
+                                            (ulSeed >> 8) % 300);
+            break;
+         case 6:
+            (void)FT_writeFile(pcPath, (ulSeed >> 8) % 100, acData,
+                               (ulSeed >> 12) % 50);
+            break;
+         case 7:
+            (void)FT_appendFile(pcPath, acData, (ulSeed >> 8) % 50);
+            break;
+         case 8:
+            if (!bInTransaction) {
+               assert(FT_begin() == SUCCESS);
+               bInTransaction = TRUE;
+            }
+            break;
+         case 9:
+            if (bInTransaction) {
+               assert(FT_abort() == SUCCESS);
+               bInTransaction = FALSE;
+            }
+            break;
+         default:
+            if (bInTransaction) {
+               assert(FT_commit() == SUCCESS);
+               bInTransaction = FALSE;
+            }
+            break;
+      }
+      if (iStep % 7 == 0)
+         checkTotals();
+   }
+   if (bInTransaction)
+      assert(FT_commit() == SUCCESS);
+   checkTotals();
+   pcBefore = FT_toString();
+   assert(pcBefore != NULL);
+   assert(FT_destroy() == SUCCESS);
+
+   /* the totals are rebuilt by recovery */
+   assert(FT_init() == SUCCESS);
+   assert(FT_recover(NULL, LOG_FILE) == SUCCESS);
+   pcAfter = FT_toString();
+   assert(pcAfter != NULL && strcmp(pcBefore, pcAfter) == 0);
+   free(pcBefore);
+   free(pcAfter);
+   checkTotals();
+   assert(FT_destroy() == SUCCESS);
+
+   remove(LOG_FILE);
+   printf("ft_subtree_client: all checks passed\n");
+   return 0;
+}
@@ -0,0 +1,236 @@
+/*--------------------------------------------------------------------*/
+/* ft_topk_client.c                                                   */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The most nodes a walk may value, and the most a ranking may list */
+enum {MAX_VALUES = 5000};
+enum {MAX_RANKED = 200};
+
+/* The number of random mutations */
+enum {STEP_COUNT = 8000};
+
+/* The directories ranked from after each few mutations */
+static const char *apcDirs[] = {"r", "r/a", "r/b/c", "r/c/a/d", "r/d"};
+
+/* The number of directories ranked from */
+enum {DIR_COUNT = 5};
+
+/* What valueVisit records about a walk */
+struct Values
+{
+   /* the ranking to value nodes by */
+   enum FT_Ranking eRanking;
+   /* the values of the nodes it ranks, and their number */
+   size_t aulValues[MAX_VALUES];
+   size_t ulCount;
+};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Adds psEntry's value to the struct Values pvExtra if its ranking
+  ranks psEntry, and goes on.
+*/
+static enum FT_WalkAction valueVisit(const struct FT_DirEntry *psEntry,
+                                     void *pvExtra) {
+   struct Values *psValues = pvExtra;
+   struct FT_StatEx sStat;
+
+   assert(psValues->ulCount < MAX_VALUES);
+   if (psValues->eRanking == FT_RANK_FILE_SIZE && psEntry->bIsFile)
+      psValues->aulValues[psValues->ulCount++] = psEntry->ulSize;
+   else if (psValues->eRanking == FT_RANK_ENTRIES && !psEntry->bIsFile) {
+      assert(FT_statEx(psEntry->pcPath, &sStat) == SUCCESS);
+      psValues->aulValues[psValues->ulCount++] =
+         sStat.ulDirChildren + sStat.ulFileChildren;
+   }
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns <0, 0, or >0 as the size_t at pvFirst is greater than, equal
+  to, or less than the one at pvSecond, sorting largest first.
+*/
+static int compareDescending(const void *pvFirst, const void *pvSecond) {
+   size_t ulFirst = *(const size_t *)pvFirst;
+   size_t ulSecond = *(const size_t *)pvSecond;
+
+   return (ulFirst < ulSecond) - (ulFirst > ulSecond);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that FT_topK(pcDir, eRanking, ulK) lists the values a sorted
+  walk of pcDir's subtree finds, best first, each for a node of the
+  right type below pcDir, or lists nothing if pcDir is not in the FT.
+*/
+static void checkTopK(const char *pcDir, enum FT_Ranking eRanking,
+                      size_t ulK) {
+   static struct Values sValues;
+   struct FT_RankEntry asRanked[MAX_RANKED];
+   size_t ulCount;
+   size_t ulSize;
+   boolean bIsFile;
+   size_t i;
+
+   assert(ulK <= MAX_RANKED);
+   if (FT_topK(pcDir, eRanking, ulK, asRanked, &ulCount) != SUCCESS) {
+      assert(ulCount == 0 && !FT_containsDir(pcDir));
+      return;
+   }
+   sValues.eRanking = eRanking;
+   sValues.ulCount = 0;
+   assert(FT_walk(pcDir, valueVisit, &sValues) == SUCCESS);
+   qsort(sValues.aulValues, sValues.ulCount, sizeof(size_t),
+         compareDescending);
+
+   assert(ulCount == (sValues.ulCount < ulK ? sValues.ulCount : ulK));
+   for (i = 0; i < ulCount; i++) {
+      assert(asRanked[i].ulValue == sValues.aulValues[i]);
+      assert(strncmp(asRanked[i].pcPath, pcDir, strlen(pcDir)) == 0);
+      assert(FT_stat(asRanked[i].pcPath, &bIsFile, &ulSize) == SUCCESS);
+      assert(bIsFile == (eRanking == FT_RANK_FILE_SIZE));
+      assert(!bIsFile || ulSize == asRanked[i].ulValue);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Ranks by both rankings from each of apcDirs, for small and large K. */
+static void checkAll(void) {
+   int i;
+
+   for (i = 0; i < DIR_COUNT; i++) {
+      checkTopK(apcDirs[i], FT_RANK_FILE_SIZE, (size_t)(1 + rand() % 30));
+      checkTopK(apcDirs[i], FT_RANK_ENTRIES, (size_t)(1 + rand() % 30));
+      checkTopK(apcDirs[i], FT_RANK_FILE_SIZE, MAX_RANKED);
+      checkTopK(apcDirs[i], FT_RANK_ENTRIES, MAX_RANKED);
+   }
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_topK against a sorted walk of each subtree, across a
+  pseudo-random series of content changes, removals, and transactions
+  committed and aborted, that an abort restores what it ranks, and
+  that a wide directory keeps its best as its largest files shrink.
+  Returns 0.
+*/
+int main(void) {
+   struct FT_RankEntry asRanked[1];
+   char acData[300];
+   char acPath[64];
+   size_t ulCount = 7;
+   int iOp;
+   int iLength;
+   int i;
+
+   assert(FT_topK("r", FT_RANK_ENTRIES, 1, asRanked, &ulCount)
+          == INITIALIZATION_ERROR);
+   assert(ulCount == 0);
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("r") == SUCCESS);
+   memset(acData, 'x', sizeof(acData));
+
+   srand(9);
+   for (i = 0; i < STEP_COUNT; i++) {
+      iOp = rand() % 12;
+      sprintf(acPath, "r/%c/%c/%c", 'a' + rand() % 4, 'a' + rand() % 5,
+              'a' + rand() % 8);
+      if (rand() % 2)
+         *strrchr(acPath, '/') = '\0';
+      iLength = rand() % (int)sizeof(acData);
+      /* a transaction begun here may still be open from the last */
+      if (i % 400 == 0 && rand() % 2)
+         (void)FT_begin();
+      if (iOp < 3)
+         (void)FT_insertFile(acPath, acData, (size_t)iLength);
+      else if (iOp < 5)
+         (void)FT_replaceFileContents(acPath, acData, (size_t)iLength);
+      else if (iOp < 6)
+         (void)FT_appendFile(acPath, acData, (size_t)(iLength % 20));
+      else if (iOp < 7)
+         (void)FT_writeFile(acPath, 0, acData, 3);
+      else if (iOp < 8) {
+         *strrchr(acPath, '/') = '\0';
+         (void)FT_rmDir(acPath);
+      }
+      else if (iOp < 9)
+         (void)FT_rmFile(acPath);
+      else if (iOp < 11)
+         (void)FT_insertDir(acPath);
+      else if (rand() % 10 == 0) {
+         if (FT_abort() != SUCCESS)
+            (void)FT_commit();
+      }
+      else if (rand() % 10 == 0)
+         (void)FT_commit();
+      if (i % 37 == 0)
+         checkAll();
+   }
+   (void)FT_commit();
+
+   /* an abort restores the best values its changes displaced */
+   (void)FT_insertDir("r/a");
+   assert(FT_topK("r", FT_RANK_FILE_SIZE, 1, asRanked, &ulCount)
+          == SUCCESS);
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("r/a") == SUCCESS);
+   assert(FT_insertFile("r/a/big", acData, sizeof(acData)) == SUCCESS);
+   assert(FT_insertDir("r/a/wide") == SUCCESS);
+   for (i = 0; i < 40; i++) {
+      sprintf(acPath, "r/a/wide/%d", i);
+      assert(FT_insertDir(acPath) == SUCCESS);
+   }
+   checkAll();
+   assert(FT_topK("r", FT_RANK_FILE_SIZE, 1, asRanked, &ulCount)
+          == SUCCESS);
+   assert(ulCount == 1 && strcmp(asRanked[0].pcPath, "r/a/big") == 0);
+   assert(FT_topK("r", FT_RANK_ENTRIES, 1, asRanked, &ulCount)
+          == SUCCESS);
+   assert(ulCount == 1 && strcmp(asRanked[0].pcPath, "r/a/wide") == 0);
+   assert(FT_abort() == SUCCESS);
+   checkAll();
+   assert(!FT_containsDir("r/a/wide"));
+
+   /* a wide, flat directory keeps its best as its files shrink and
+      go, largest first */
+   for (i = 0; i < 300; i++) {
+      sprintf(acPath, "r/flat/%d", i);
+      assert(FT_insertFile(acPath, acData, (size_t)i) == SUCCESS);
+   }
+   for (i = 299; i >= 200; i--) {
+      sprintf(acPath, "r/flat/%d", i);
+      if (i % 2)
+         assert(FT_rmFile(acPath) == SUCCESS);
+      else
+         (void)FT_replaceFileContents(acPath, acData, (size_t)(i % 7));
+      checkTopK("r/flat", FT_RANK_FILE_SIZE, 3);
+      checkTopK("r", FT_RANK_ENTRIES, 2);
+   }
+   assert(FT_topK("r/flat", FT_RANK_FILE_SIZE, 1, asRanked, &ulCount)
+          == SUCCESS);
+   assert(ulCount == 1 && strcmp(asRanked[0].pcPath, "r/flat/199") == 0);
+
+   assert(FT_topK("q", FT_RANK_ENTRIES, 1, asRanked, &ulCount)
+          == CONFLICTING_PATH);
+   assert(ulCount == 0);
+   assert(FT_topK("r//a", FT_RANK_ENTRIES, 1, asRanked, &ulCount)
+          == BAD_PATH);
+   assert(FT_topK("r", FT_RANK_ENTRIES, 0, NULL, &ulCount) == SUCCESS);
+   assert(ulCount == 0);
+   assert(FT_destroy() == SUCCESS);
+
+   printf("ft_topk_client: all checks passed\n");
+   return 0;
+}
@@ -0,0 +1,85 @@
+/*--------------------------------------------------------------------*/
+/* ft_txn_client.c                                                    */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/*
+  Checks FT_begin, FT_commit, and FT_abort: that aborting a
+  transaction of mixed mutations leaves the FT exactly as it was, that
+  committing keeps them, and that FT_destroy aborts an open one.
+  Returns 0.
+*/
+int main(void) {
+   char *pcBefore;
+   char *pcAfter;
+   char acOld[] = "old";
+   char acNew[] = "new";
+   char acBuffer[8];
+   size_t ulRead;
+
+   assert(FT_begin() == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_commit() == INITIALIZATION_ERROR);
+   assert(FT_abort() == INITIALIZATION_ERROR);
+
+   assert(FT_insertDir("r") == SUCCESS);
+   assert(FT_insertFile("r/a/f", acOld, sizeof(acOld)) == SUCCESS);
+   assert(FT_insertFile("r/a/g", acOld, sizeof(acOld)) == SUCCESS);
+   assert(FT_insertDir("r/b/c") == SUCCESS);
+   pcBefore = FT_toString();
+   assert(pcBefore != NULL);
+
+   /* every kind of mutation, some undoing others, is rolled back */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_begin() == INITIALIZATION_ERROR);
+   assert(FT_rmFile("r/a/f") == SUCCESS);
+   assert(FT_insertFile("r/a/f", acNew, sizeof(acNew)) == SUCCESS);
+   assert(FT_replaceFileContents("r/a/f", acOld, sizeof(acOld)) == acNew);
+   assert(FT_writeFile("r/a/g", 1, "XY", 2) == SUCCESS);
+   assert(FT_appendFile("r/a/g", "tail", 4) == SUCCESS);
+   assert(FT_insertDir("r/b/c/d/e") == SUCCESS);
+   assert(FT_rmDir("r/b") == SUCCESS);
+   assert(FT_rmDir("r") == SUCCESS);
+   assert(FT_insertDir("q/x") == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   assert(FT_abort() == INITIALIZATION_ERROR);
+
+   pcAfter = FT_toString();
+   assert(pcAfter != NULL && strcmp(pcBefore, pcAfter) == 0);
+   free(pcAfter);
+   assert(FT_getFileContents("r/a/f") == acOld);
+   assert(FT_readFile("r/a/g", 0, acBuffer, sizeof(acBuffer), &ulRead)
+          == SUCCESS);
+   assert(ulRead == sizeof(acOld) && memcmp(acBuffer, acOld, ulRead) == 0);
+   assert(FT_containsDir("r/b/c") && !FT_containsDir("q"));
+
+   /* a committed transaction keeps its effects */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("r/a") == SUCCESS);
+   assert(FT_insertDir("r/b/c/d") == SUCCESS);
+   assert(FT_commit() == SUCCESS);
+   assert(!FT_containsDir("r/a") && FT_containsDir("r/b/c/d"));
+
+   /* an empty transaction changes nothing either way */
+   pcAfter = FT_toString();
+   assert(FT_begin() == SUCCESS);
+   assert(FT_abort() == SUCCESS);
+   free(pcBefore);
+   pcBefore = FT_toString();
+   assert(strcmp(pcBefore, pcAfter) == 0);
+   free(pcBefore);
+   free(pcAfter);
+
+   /* FT_destroy aborts what is still open */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_insertDir("r/zz") == SUCCESS);
+   assert(FT_destroy() == SUCCESS);
+
+   printf("ft_txn_client: all checks passed\n");
+   return 0;
+}
@@ -0,0 +1,147 @@
+/*--------------------------------------------------------------------*/
+/* ft_walk_client.c                                                   */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ft.h"
+
+/* The longest listing a walk may build */
+enum {MAX_LISTING = 1024};
+
+/* What the visitors below record about a walk */
+struct Walk
+{
+   /* the paths visited, a line apiece */
+   char acListing[MAX_LISTING];
+   /* the number of visits */
+   int iVisits;
+   /* the path of the file that stopped the walk, or NULL */
+   const char *pcFound;
+};
+
+/*--------------------------------------------------------------------*/
+
+/* Starts *psWalk afresh. */
+static void resetWalk(struct Walk *psWalk) {
+   psWalk->acListing[0] = '\0';
+   psWalk->iVisits = 0;
+   psWalk->pcFound = NULL;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Adds psEntry's path to the struct Walk pvExtra, and goes on. */
+static enum FT_WalkAction visitAll(const struct FT_DirEntry *psEntry,
+                                   void *pvExtra) {
+   struct Walk *psWalk = pvExtra;
+
+   assert(strlen(psWalk->acListing) + strlen(psEntry->pcPath) + 1
+          < MAX_LISTING);
+   strcat(psWalk->acListing, psEntry->pcPath);
+   strcat(psWalk->acListing, "\n");
+   psWalk->iVisits++;
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Counts a visit in the struct Walk pvExtra, passing over a/b. */
+static enum FT_WalkAction visitSkip(const struct FT_DirEntry *psEntry,
+                                    void *pvExtra) {
+   struct Walk *psWalk = pvExtra;
+
+   psWalk->iVisits++;
+   if (strcmp(psEntry->pcPath, "a/b") == 0)
+      return FT_WALK_SKIP;
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Counts a visit in the struct Walk pvExtra, and stops at the first
+  file longer than 4 bytes.
+*/
+static enum FT_WalkAction visitFind(const struct FT_DirEntry *psEntry,
+                                    void *pvExtra) {
+   struct Walk *psWalk = pvExtra;
+
+   psWalk->iVisits++;
+   if (psEntry->bIsFile && psEntry->ulSize > 4) {
+      psWalk->pcFound = psEntry->pcPath;
+      return FT_WALK_STOP;
+   }
+   return FT_WALK_CONTINUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Asserts that a full walk from the root visits what FT_toString
+  lists, in the same order.
+*/
+static void checkOrder(void) {
+   struct Walk sWalk;
+   char *pcExpected;
+
+   resetWalk(&sWalk);
+   assert(FT_walk("a", visitAll, &sWalk) == SUCCESS);
+   pcExpected = FT_toString();
+   assert(pcExpected != NULL && strcmp(pcExpected, sWalk.acListing) == 0);
+   free(pcExpected);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Checks FT_walk: that it visits in FT_toString order, passes over
+  skipped subtrees, ends at once when stopped, and sees the tree an
+  abort restores. Returns 0.
+*/
+int main(void) {
+   struct Walk sWalk;
+   char acData[] = "0123456789";
+
+   assert(FT_walk("a", visitAll, &sWalk) == INITIALIZATION_ERROR);
+   assert(FT_init() == SUCCESS);
+   assert(FT_insertDir("a/b/c") == SUCCESS);
+   assert(FT_insertFile("a/b/f", acData, 2) == SUCCESS);
+   assert(FT_insertFile("a/b/g", acData, 9) == SUCCESS);
+   assert(FT_insertDir("a/x/y") == SUCCESS);
+   assert(FT_insertFile("a/z", acData, 1) == SUCCESS);
+   checkOrder();
+
+   resetWalk(&sWalk);
+   assert(FT_walk("a", visitSkip, &sWalk) == SUCCESS);
+   assert(sWalk.iVisits == 5);
+   resetWalk(&sWalk);
+   assert(FT_walk("a", visitFind, &sWalk) == SUCCESS);
+   assert(strcmp(sWalk.pcFound, "a/b/g") == 0 && sWalk.iVisits == 5);
+   resetWalk(&sWalk);
+   assert(FT_walk("a/b/f", visitAll, &sWalk) == SUCCESS);
+   assert(sWalk.iVisits == 1 && strcmp(sWalk.acListing, "a/b/f\n") == 0);
+   assert(FT_walk("a/q", visitAll, &sWalk) == NO_SUCH_PATH);
+   assert(FT_walk("b", visitAll, &sWalk) == CONFLICTING_PATH);
+   assert(FT_walk("a//b", visitAll, &sWalk) == BAD_PATH);
+
+   /* walks during and after an aborted transaction */
+   assert(FT_begin() == SUCCESS);
+   assert(FT_rmDir("a/b") == SUCCESS);
+   assert(FT_insertFile("a/x/y/big", acData, 10) == SUCCESS);
+   checkOrder();
+   resetWalk(&sWalk);
+   assert(FT_walk("a", visitFind, &sWalk) == SUCCESS);
+   assert(strcmp(sWalk.pcFound, "a/x/y/big") == 0);
+   assert(FT_abort() == SUCCESS);
+   checkOrder();
+   resetWalk(&sWalk);
+   assert(FT_walk("a", visitFind, &sWalk) == SUCCESS);
+   assert(strcmp(sWalk.pcFound, "a/b/g") == 0);
+   assert(FT_destroy() == SUCCESS);
+
+   printf("ft_walk_client: all checks passed\n");
+   return 0;
+}
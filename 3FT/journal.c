@@ -0,0 +1,602 @@
+/*--------------------------------------------------------------------*/
+/* journal.c                                                          */
+/*--------------------------------------------------------------------*/
+
+/* fileno, fsync, ftruncate, fseeko, and mmap are POSIX rather than
+   ISO C */
+#define _POSIX_C_SOURCE 200112L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "journal.h"
+
+/*--------------------------------------------------------------------*/
+
+/*
+  On disk, every record is a fixed-size header, the path, the
+  contents, and a trailing checksum of everything before it:
+     op (1 byte) | seq (8) | path length (4) | contents length (8) |
+     path | contents | checksum (4)
+  Multi-byte fields are little-endian. The high bit of op is set when
+  the contents pointer was NULL, so that NULL survives replay.
+*/
+enum { HEADER_SIZE = 21, CHECKSUM_SIZE = 4, NULL_CONTENTS = 0x80 };
+
+/* The initial size of a journal's record buffer */
+static const size_t MIN_BUFFER_SIZE = 4096;
+
+/* A journal and the records buffered for it */
+struct journal
+{
+   /* the open journal file */
+   FILE *psFile;
+   /* the records not yet written to psFile */
+   unsigned char *pucBuffer;
+   /* the number of bytes of pucBuffer in use */
+   size_t ulLength;
+   /* the number of bytes allocated for pucBuffer */
+   size_t ulSize;
+   /* the number of records in pucBuffer */
+   size_t ulPending;
+   /* the number of records that are written out together */
+   size_t ulGroupSize;
+   /* whether a mark is set, and where in pucBuffer it is */
+   boolean bMarked;
+   size_t ulMark;
+   /* the number of records in pucBuffer before the mark */
+   size_t ulMarkPending;
+   /* where in pucBuffer the record being built starts, and how many
+      bytes of its contents are still to come */
+   size_t ulRecord;
+   size_t ulRecordRemaining;
+};
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Stores the low iBytes bytes of ulValue at pucDest, little-endian.
+*/
+static void Journal_putField(unsigned char *pucDest, size_t ulValue,
+                             int iBytes)
+{
+   int i;
+
+   assert(pucDest != NULL);
+
+   for(i = 0; i < iBytes; i++) {
+      pucDest[i] = (unsigned char)(ulValue & 0xFF);
+      ulValue >>= 8;
+   }
+}
+
+/*
+  Returns the little-endian iBytes-byte value stored at pucSrc.
+*/
+static size_t Journal_getField(const unsigned char *pucSrc, int iBytes)
+{
+   size_t ulValue = 0;
+   int i;
+
+   assert(pucSrc != NULL);
+
+   for(i = iBytes - 1; i >= 0; i--)
+      ulValue = (ulValue << 8) | pucSrc[i];
+   return ulValue;
+}
+
+/*
+  Continues the 32-bit FNV-1a checksum ulHash over the ulLength bytes
+  at pucData and returns the result.
+*/
+static unsigned long Journal_checksum(unsigned long ulHash,
+                                      const unsigned char *pucData,
+                                      size_t ulLength)
+{
+   size_t u;
+
+   for(u = 0; u < ulLength; u++) {
+      ulHash ^= pucData[u];
+      ulHash = (ulHash * 16777619UL) & 0xFFFFFFFFUL;
+   }
+   return ulHash;
+}
+
+/* The starting value for Journal_checksum */
+static const unsigned long CHECKSUM_SEED = 2166136261UL;
+
+/*
+  Writes the ulBytes oldest buffered bytes of oJJournal, holding
+  ulRecords records, to its file and fsyncs it. Returns SUCCESS, or
+  IO_ERROR on failure, in which case nothing is removed from the
+  buffer and the file is cut back to where it ended, so that the
+  bytes are not written twice, leaving a torn record before them.
+*/
+static int Journal_flush(Journal_T oJJournal, size_t ulBytes,
+                         size_t ulRecords)
+{
+   off_t oEnd;
+
+   assert(oJJournal != NULL);
+   assert(ulBytes <= oJJournal->ulLength);
+
+   if(ulBytes == 0)
+      return SUCCESS;
+
+   if(fseeko(oJJournal->psFile, 0, SEEK_END) != 0)
+      return IO_ERROR;
+   oEnd = ftello(oJJournal->psFile);
+   if(oEnd < 0)
+      return IO_ERROR;
+
+   if(fwrite(oJJournal->pucBuffer, 1, ulBytes, oJJournal->psFile)
+         != ulBytes
+      || fflush(oJJournal->psFile) != 0
+      || fsync(fileno(oJJournal->psFile)) != 0) {
+      clearerr(oJJournal->psFile);
+      (void) ftruncate(fileno(oJJournal->psFile), oEnd);
+      (void) fseeko(oJJournal->psFile, oEnd, SEEK_SET);
+      return IO_ERROR;
+   }
+
+   memmove(oJJournal->pucBuffer, oJJournal->pucBuffer + ulBytes,
+           oJJournal->ulLength - ulBytes);
+   oJJournal->ulLength -= ulBytes;
+   oJJournal->ulPending -= ulRecords;
+   if(oJJournal->bMarked) {
+      oJJournal->ulMark -= ulBytes;
+      oJJournal->ulMarkPending -= ulRecords;
+   }
+   return SUCCESS;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Journal_open(const char *pcFile, size_t ulGroupSize,
+                 Journal_T *poJResult)
+{
+   struct journal *psNew;
+
+   assert(pcFile != NULL);
+   assert(poJResult != NULL);
+
+   *poJResult = NULL;
+
+   psNew = malloc(sizeof(struct journal));
+   if(psNew == NULL)
+      return MEMORY_ERROR;
+
+   psNew->pucBuffer = malloc(MIN_BUFFER_SIZE);
+   if(psNew->pucBuffer == NULL) {
+      free(psNew);
+      return MEMORY_ERROR;
+   }
+
+   psNew->psFile = fopen(pcFile, "ab");
+   if(psNew->psFile == NULL) {
+      free(psNew->pucBuffer);
+      free(psNew);
+      return IO_ERROR;
+   }
+   /* records are buffered here, and a stdio buffer could hold on to
+      part of a failed group and write it out later */
+   (void) setvbuf(psNew->psFile, NULL, _IONBF, 0);
+
+   psNew->ulLength = 0;
+   psNew->ulSize = MIN_BUFFER_SIZE;
+   psNew->ulPending = 0;
+   psNew->ulGroupSize = (ulGroupSize == 0) ? 1 : ulGroupSize;
+   psNew->bMarked = FALSE;
+   psNew->ulMark = 0;
+   psNew->ulMarkPending = 0;
+   psNew->ulRecord = 0;
+   psNew->ulRecordRemaining = 0;
+
+   *poJResult = psNew;
+   return SUCCESS;
+}
+
+int Journal_close(Journal_T oJJournal)
+{
+   int iStatus;
+
+   assert(oJJournal != NULL);
+
+   iStatus = Journal_sync(oJJournal);
+   if(fclose(oJJournal->psFile) != 0)
+      iStatus = IO_ERROR;
+   free(oJJournal->pucBuffer);
+   free(oJJournal);
+   return iStatus;
+}
+
+int Journal_reserve(Journal_T oJJournal, size_t ulPathLength,
+                    size_t ulLength)
+{
+   size_t ulNeeded;
+   size_t ulNewSize;
+   unsigned char *pucNew;
+   int iStatus;
+
+   assert(oJJournal != NULL);
+
+   /* group commit: write out a full group before starting the next */
+   if(!oJJournal->bMarked &&
+      oJJournal->ulPending >= oJJournal->ulGroupSize) {
+      iStatus = Journal_flush(oJJournal, oJJournal->ulLength,
+                              oJJournal->ulPending);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+
+   ulNeeded = oJJournal->ulLength + HEADER_SIZE + ulPathLength
+      + ulLength + CHECKSUM_SIZE;
+   if(ulNeeded < oJJournal->ulLength)
+      return MEMORY_ERROR;
+   if(ulNeeded <= oJJournal->ulSize)
+      return SUCCESS;
+
+   ulNewSize = oJJournal->ulSize;
+   while(ulNewSize < ulNeeded) {
+      if(ulNewSize * 2 < ulNewSize) {
+         ulNewSize = ulNeeded;
+         break;
+      }
+      ulNewSize *= 2;
+   }
+
+   pucNew = realloc(oJJournal->pucBuffer, ulNewSize);
+   if(pucNew == NULL)
+      return MEMORY_ERROR;
+   oJJournal->pucBuffer = pucNew;
+   oJJournal->ulSize = ulNewSize;
+   return SUCCESS;
+}
+
+/*
+  Starts a record in oJJournal's buffer of kind iOp with the flags
+  iFlags, sequence number ulSeq, path pcPath (which may be NULL), and
+  ulLength bytes of contents, of which ulBody are to follow.
+*/
+static void Journal_startFlagged(Journal_T oJJournal, int iOp,
+                                 int iFlags, size_t ulSeq,
+                                 const char *pcPath, size_t ulLength,
+                                 size_t ulBody)
+{
+   unsigned char *pucRecord;
+   size_t ulPathLength = 0;
+
+   assert(oJJournal != NULL);
+   assert(oJJournal->ulRecordRemaining == 0);
+
+   if(pcPath != NULL)
+      ulPathLength = strlen(pcPath);
+
+   pucRecord = oJJournal->pucBuffer + oJJournal->ulLength;
+   assert(oJJournal->ulLength + HEADER_SIZE + ulPathLength + ulBody
+          + CHECKSUM_SIZE <= oJJournal->ulSize);
+
+   pucRecord[0] = (unsigned char)(iOp | iFlags);
+   Journal_putField(pucRecord + 1, ulSeq, 8);
+   Journal_putField(pucRecord + 9, ulPathLength, 4);
+   Journal_putField(pucRecord + 13, ulLength, 8);
+   if(ulPathLength != 0)
+      memcpy(pucRecord + HEADER_SIZE, pcPath, ulPathLength);
+
+   oJJournal->ulRecord = oJJournal->ulLength;
+   oJJournal->ulRecordRemaining = ulBody;
+   oJJournal->ulLength += HEADER_SIZE + ulPathLength;
+}
+
+void Journal_append(Journal_T oJJournal, int iOp, size_t ulSeq,
+                    const char *pcPath, const void *pvContents,
+                    size_t ulLength)
+{
+   assert(oJJournal != NULL);
+
+   if(pvContents == NULL)
+      Journal_startFlagged(oJJournal, iOp, NULL_CONTENTS, ulSeq, pcPath,
+                           ulLength, 0);
+   else {
+      Journal_startFlagged(oJJournal, iOp, 0, ulSeq, pcPath, ulLength,
+                           ulLength);
+      Journal_addContents(oJJournal, pvContents, ulLength);
+   }
+   Journal_endRecord(oJJournal);
+}
+
+void Journal_startRecord(Journal_T oJJournal, int iOp, size_t ulSeq,
+                         const char *pcPath, size_t ulLength)
+{
+   Journal_startFlagged(oJJournal, iOp, 0, ulSeq, pcPath, ulLength,
+                        ulLength);
+}
+
+void Journal_addContents(Journal_T oJJournal, const void *pvContents,
+                         size_t ulLength)
+{
+   assert(oJJournal != NULL);
+   assert(ulLength <= oJJournal->ulRecordRemaining);
+   assert(pvContents != NULL || ulLength == 0);
+
+   if(ulLength == 0)
+      return;
+   memcpy(oJJournal->pucBuffer + oJJournal->ulLength, pvContents,
+          ulLength);
+   oJJournal->ulLength += ulLength;
+   oJJournal->ulRecordRemaining -= ulLength;
+}
+
+void Journal_endRecord(Journal_T oJJournal)
+{
+   unsigned char *pucRecord;
+   size_t ulRecordLength;
+
+   assert(oJJournal != NULL);
+   assert(oJJournal->ulRecordRemaining == 0);
+
+   pucRecord = oJJournal->pucBuffer + oJJournal->ulRecord;
+   ulRecordLength = oJJournal->ulLength - oJJournal->ulRecord;
+   Journal_putField(pucRecord + ulRecordLength,
+                    Journal_checksum(CHECKSUM_SEED, pucRecord,
+                                     ulRecordLength),
+                    CHECKSUM_SIZE);
+
+   oJJournal->ulLength += CHECKSUM_SIZE;
+   oJJournal->ulPending++;
+}
+
+void Journal_mark(Journal_T oJJournal)
+{
+   assert(oJJournal != NULL);
+   assert(!oJJournal->bMarked);
+
+   oJJournal->bMarked = TRUE;
+   oJJournal->ulMark = oJJournal->ulLength;
+   oJJournal->ulMarkPending = oJJournal->ulPending;
+}
+
+void Journal_release(Journal_T oJJournal)
+{
+   assert(oJJournal != NULL);
+
+   oJJournal->bMarked = FALSE;
+}
+
+void Journal_rollback(Journal_T oJJournal)
+{
+   assert(oJJournal != NULL);
+
+   if(oJJournal->bMarked) {
+      oJJournal->ulLength = oJJournal->ulMark;
+      oJJournal->ulPending = oJJournal->ulMarkPending;
+   }
+   oJJournal->bMarked = FALSE;
+}
+
+int Journal_sync(Journal_T oJJournal)
+{
+   assert(oJJournal != NULL);
+
+   if(oJJournal->bMarked)
+      return Journal_flush(oJJournal, oJJournal->ulMark,
+                           oJJournal->ulMarkPending);
+   return Journal_flush(oJJournal, oJJournal->ulLength,
+                        oJJournal->ulPending);
+}
+
+int Journal_truncate(Journal_T oJJournal)
+{
+   assert(oJJournal != NULL);
+
+   oJJournal->ulLength = 0;
+   oJJournal->ulPending = 0;
+   oJJournal->bMarked = FALSE;
+
+   if(fflush(oJJournal->psFile) != 0
+      || ftruncate(fileno(oJJournal->psFile), 0) != 0
+      || fsync(fileno(oJJournal->psFile)) != 0)
+      return IO_ERROR;
+   return SUCCESS;
+}
+
+int Journal_replay(const char *pcFile,
+                   int (*pfApply)(int iOp, size_t ulSeq,
+                                  const char *pcPath,
+                                  void *pvContents, size_t ulLength,
+                                  void *pvExtra),
+                   void *pvExtra)
+{
+   FILE *psFile;
+   long lRemaining;
+   unsigned char aucHeader[HEADER_SIZE];
+   unsigned char aucChecksum[CHECKSUM_SIZE];
+   char *pcPath;
+   void *pvContents;
+   size_t ulPathLength;
+   size_t ulLength;
+   size_t ulBody;
+   unsigned long ulHash;
+   int iStatus = SUCCESS;
+
+   assert(pcFile != NULL);
+   assert(pfApply != NULL);
+
+   psFile = fopen(pcFile, "rb");
+   if(psFile == NULL)
+      return SUCCESS;
+
+   if(fseek(psFile, 0, SEEK_END) != 0 ||
+      (lRemaining = ftell(psFile)) < 0 ||
+      fseek(psFile, 0, SEEK_SET) != 0) {
+      (void) fclose(psFile);
+      return IO_ERROR;
+   }
+
+   while(fread(aucHeader, 1, HEADER_SIZE, psFile) == HEADER_SIZE) {
+      ulPathLength = Journal_getField(aucHeader + 9, 4);
+      ulLength = Journal_getField(aucHeader + 13, 8);
+      ulBody = (aucHeader[0] & NULL_CONTENTS) ? 0 : ulLength;
+
+      /* a torn header can claim more bytes than the file holds */
+      lRemaining -= HEADER_SIZE;
+      if(ulPathLength > (size_t) lRemaining ||
+         ulBody > (size_t) lRemaining - ulPathLength ||
+         CHECKSUM_SIZE > (size_t) lRemaining - ulPathLength - ulBody)
+         break;
+      lRemaining -= (long) (ulPathLength + ulBody + CHECKSUM_SIZE);
+
+      pcPath = malloc(ulPathLength + 1);
+      pvContents = (ulBody == 0) ? NULL : malloc(ulBody);
+      if(pcPath == NULL || (ulBody != 0 && pvContents == NULL)) {
+         free(pcPath);
+         free(pvContents);
+         iStatus = MEMORY_ERROR;
+         break;
+      }
+
+      if(fread(pcPath, 1, ulPathLength, psFile) != ulPathLength
+         || fread(pvContents, 1, ulBody, psFile) != ulBody
+         || fread(aucChecksum, 1, CHECKSUM_SIZE, psFile)
+            != CHECKSUM_SIZE) {
+         free(pcPath);
+         free(pvContents);
+         break;
+      }
+
+      ulHash = Journal_checksum(CHECKSUM_SEED, aucHeader, HEADER_SIZE);
+      ulHash = Journal_checksum(ulHash, (unsigned char *) pcPath,
+                                ulPathLength);
+      ulHash = Journal_checksum(ulHash, pvContents, ulBody);
+      if(ulHash != Journal_getField(aucChecksum, CHECKSUM_SIZE)) {
+         free(pcPath);
+         free(pvContents);
+         break;
+      }
+
+      pcPath[ulPathLength] = '\0';
+      iStatus = (*pfApply)(aucHeader[0] & ~NULL_CONTENTS,
+                           Journal_getField(aucHeader + 1, 8),
+                           (ulPathLength == 0) ? NULL : pcPath,
+                           pvContents, ulLength, pvExtra);
+      free(pcPath);
+      if(iStatus != SUCCESS)
+         break;
+   }
+
+   if(iStatus == SUCCESS && ferror(psFile))
+      iStatus = IO_ERROR;
+   (void) fclose(psFile);
+   return iStatus;
+}
+
+int Journal_map(const char *pcFile,
+                int (*pfApply)(int iOp, size_t ulSeq,
+                               const char *pcPath,
+                               void *pvContents, size_t ulLength,
+                               void *pvExtra),
+                void *pvExtra, void **ppvMapping, size_t *pulSize)
+{
+   int iFd;
+   struct stat sInfo;
+   unsigned char *pucMap;
+   unsigned char *pucRecord;
+   size_t ulRemaining;
+   char *pcPath = NULL;
+   size_t ulPathSize = 0;
+   size_t ulPathLength;
+   size_t ulLength;
+   size_t ulBody;
+   unsigned long ulHash;
+   int iStatus = SUCCESS;
+
+   assert(pcFile != NULL);
+   assert(pfApply != NULL);
+   assert(ppvMapping != NULL);
+   assert(pulSize != NULL);
+
+   *ppvMapping = NULL;
+   *pulSize = 0;
+
+   iFd = open(pcFile, O_RDONLY);
+   if(iFd < 0)
+      return SUCCESS;
+   if(fstat(iFd, &sInfo) != 0) {
+      (void) close(iFd);
+      return IO_ERROR;
+   }
+   if(sInfo.st_size == 0) {
+      (void) close(iFd);
+      return SUCCESS;
+   }
+
+   /* private and writable, so that clients may scribble on contents
+      without faulting or changing the file */
+   pucMap = mmap(NULL, (size_t) sInfo.st_size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE, iFd, 0);
+   (void) close(iFd);
+   if(pucMap == MAP_FAILED)
+      return IO_ERROR;
+   *ppvMapping = pucMap;
+   *pulSize = (size_t) sInfo.st_size;
+
+   pucRecord = pucMap;
+   ulRemaining = (size_t) sInfo.st_size;
+   while(ulRemaining >= HEADER_SIZE) {
+      ulPathLength = Journal_getField(pucRecord + 9, 4);
+      ulLength = Journal_getField(pucRecord + 13, 8);
+      ulBody = (pucRecord[0] & NULL_CONTENTS) ? 0 : ulLength;
+
+      if(ulPathLength > ulRemaining - HEADER_SIZE ||
+         ulBody > ulRemaining - HEADER_SIZE - ulPathLength ||
+         CHECKSUM_SIZE >
+            ulRemaining - HEADER_SIZE - ulPathLength - ulBody)
+         break;
+
+      ulHash = Journal_checksum(CHECKSUM_SEED, pucRecord,
+                                HEADER_SIZE + ulPathLength + ulBody);
+      if(ulHash != Journal_getField(pucRecord + HEADER_SIZE
+                                    + ulPathLength + ulBody,
+                                    CHECKSUM_SIZE))
+         break;
+
+      /* paths in the file aren't terminated, so copy them out */
+      if(ulPathLength + 1 > ulPathSize) {
+         free(pcPath);
+         ulPathSize = ulPathLength + 1;
+         pcPath = malloc(ulPathSize);
+         if(pcPath == NULL) {
+            iStatus = MEMORY_ERROR;
+            break;
+         }
+      }
+      memcpy(pcPath, pucRecord + HEADER_SIZE, ulPathLength);
+      pcPath[ulPathLength] = '\0';
+
+      iStatus = (*pfApply)(pucRecord[0] & ~NULL_CONTENTS,
+                           Journal_getField(pucRecord + 1, 8),
+                           (ulPathLength == 0) ? NULL : pcPath,
+                           (pucRecord[0] & NULL_CONTENTS) ? NULL :
+                              pucRecord + HEADER_SIZE + ulPathLength,
+                           ulLength, pvExtra);
+      if(iStatus != SUCCESS)
+         break;
+
+      pucRecord += HEADER_SIZE + ulPathLength + ulBody + CHECKSUM_SIZE;
+      ulRemaining -= HEADER_SIZE + ulPathLength + ulBody + CHECKSUM_SIZE;
+   }
+
+   free(pcPath);
+   return iStatus;
+}
+
+void Journal_unmap(void *pvMapping, size_t ulSize)
+{
+   if(pvMapping != NULL)
+      (void) munmap(pvMapping, ulSize);
+}
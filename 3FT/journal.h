@@ -0,0 +1,157 @@
+/*--------------------------------------------------------------------*/
+/* journal.h                                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef JOURNAL_INCLUDED
+#define JOURNAL_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A Journal_T is an append-only log of File Tree mutations kept in a
+  file on disk. Records are collected in memory and written out and
+  fsync'd a group at a time, so that most mutations cost only a
+  memcpy. Every record carries a checksum, so a record torn by a crash
+  is recognized and ends replay.
+*/
+typedef struct journal *Journal_T;
+
+/* The kinds of record in a journal */
+enum { JOURNAL_CHECKPOINT, JOURNAL_INSERT_DIR, JOURNAL_INSERT_FILE,
+       JOURNAL_RM_DIR, JOURNAL_RM_FILE, JOURNAL_REPLACE,
+       JOURNAL_BEGIN, JOURNAL_COMMIT, JOURNAL_WRITE
+};
+
+/*
+  Opens the journal file pcFile for appending, creating it if needed.
+  Buffered records are written and fsync'd once ulGroupSize of them
+  have accumulated (a ulGroupSize of 0 is treated as 1). Returns an
+  int SUCCESS status and sets *poJResult to the new journal if
+  successful. Otherwise, sets *poJResult to NULL and returns status:
+  * IO_ERROR if pcFile could not be opened
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int Journal_open(const char *pcFile, size_t ulGroupSize,
+                 Journal_T *poJResult);
+
+/*
+  Writes out any buffered records before the mark (if one is set),
+  closes, and frees oJJournal.
+  Returns SUCCESS, or IO_ERROR if the buffered records could not be
+  made durable (the journal is freed regardless).
+*/
+int Journal_close(Journal_T oJJournal);
+
+/*
+  Ensures that the next Journal_append to oJJournal, of a record with
+  a path of ulPathLength characters and ulLength bytes of contents,
+  cannot fail. If a full group is buffered and no mark is set, the
+  group is first written out and fsync'd. Returns SUCCESS, or:
+  * IO_ERROR if writing out the buffered group failed
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int Journal_reserve(Journal_T oJJournal, size_t ulPathLength,
+                    size_t ulLength);
+
+/*
+  Buffers a record of kind iOp with sequence number ulSeq, path pcPath
+  (which may be NULL for records without a path) and contents
+  pvContents of ulLength bytes (pvContents may be NULL). Space for the
+  record must have been reserved with Journal_reserve.
+*/
+void Journal_append(Journal_T oJJournal, int iOp, size_t ulSeq,
+                    const char *pcPath, const void *pvContents,
+                    size_t ulLength);
+
+/*
+  Like Journal_append, except that the ulLength bytes of contents (which
+  are never NULL) are not passed here but in one or more calls to
+  Journal_addContents, after which Journal_endRecord completes the
+  record. Space for the whole record must have been reserved with
+  Journal_reserve, and no other record may be appended meanwhile.
+*/
+void Journal_startRecord(Journal_T oJJournal, int iOp, size_t ulSeq,
+                         const char *pcPath, size_t ulLength);
+
+/*
+  Adds the next ulLength bytes at pvContents to the contents of the
+  record started by Journal_startRecord.
+*/
+void Journal_addContents(Journal_T oJJournal, const void *pvContents,
+                         size_t ulLength);
+
+/*
+  Completes the record started by Journal_startRecord, all of whose
+  contents must have been added.
+*/
+void Journal_endRecord(Journal_T oJJournal);
+
+/*
+  Sets a mark at the end of oJJournal's buffered records. Until the
+  mark is cleared by Journal_release or Journal_rollback, no records
+  are written out, so records after the mark can still be discarded.
+*/
+void Journal_mark(Journal_T oJJournal);
+
+/* Clears oJJournal's mark, keeping the records buffered after it. */
+void Journal_release(Journal_T oJJournal);
+
+/* Clears oJJournal's mark, discarding the records buffered after it. */
+void Journal_rollback(Journal_T oJJournal);
+
+/*
+  Writes out and fsyncs oJJournal's buffered records, except those
+  after a mark. Returns SUCCESS, or IO_ERROR on failure.
+*/
+int Journal_sync(Journal_T oJJournal);
+
+/*
+  Discards every record of oJJournal, both buffered and on disk, e.g.
+  once a snapshot has made them redundant. Returns SUCCESS, or
+  IO_ERROR on failure.
+*/
+int Journal_truncate(Journal_T oJJournal);
+
+/*
+  Reads the journal file pcFile from the start, calling
+  (*pfApply)(iOp, ulSeq, pcPath, pvContents, ulLength, pvExtra) for
+  each intact record in order. pcPath is NULL for records without a
+  path and is only valid during the call. pvContents is a fresh
+  allocation (or NULL) that becomes owned by *pfApply. Replay stops
+  quietly at the end of the file or at the first torn record, and
+  stops with *pfApply's status if that is not SUCCESS. A missing file
+  is treated as empty. Returns SUCCESS, or:
+  * IO_ERROR if pcFile exists but could not be read
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  * the status *pfApply returned, if not SUCCESS
+*/
+int Journal_replay(const char *pcFile,
+                   int (*pfApply)(int iOp, size_t ulSeq,
+                                  const char *pcPath,
+                                  void *pvContents, size_t ulLength,
+                                  void *pvExtra),
+                   void *pvExtra);
+
+/*
+  Like Journal_replay, except that pcFile is memory-mapped and each
+  record's pvContents points into the mapping instead of being a
+  fresh allocation: bodies are neither copied nor read from disk
+  until they are touched. The mapping is private and writable, so
+  writes through pvContents change neither the file nor other
+  processes' view of it. Sets *ppvMapping and *pulSize to describe
+  the mapping (NULL and 0 if pcFile is missing or empty), which the
+  caller must keep until no contents point into it and then release
+  with Journal_unmap, even if an error is returned.
+*/
+int Journal_map(const char *pcFile,
+                int (*pfApply)(int iOp, size_t ulSeq,
+                               const char *pcPath,
+                               void *pvContents, size_t ulLength,
+                               void *pvExtra),
+                void *pvExtra, void **ppvMapping, size_t *pulSize);
+
+/* Releases the mapping pvMapping of ulSize bytes from Journal_map. */
+void Journal_unmap(void *pvMapping, size_t ulSize);
+
+#endif
@@ -0,0 +1,242 @@
+/*--------------------------------------------------------------------*/
+/* lz.c                                                               */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <string.h>
+#include "lz.h"
+
+/* The shortest match worth encoding, and the farthest one back */
+enum { LZ_MIN_MATCH = 4, LZ_MAX_OFFSET = 65535 };
+
+/* The number of bits of hash indexing the table of recent positions */
+enum { LZ_HASH_BITS = 12 };
+
+/* The largest count that fits in half a token byte */
+enum { LZ_NIBBLE_MAX = 15 };
+
+/*
+  Returns the four bytes at pucAt as a little-endian number.
+*/
+static unsigned long LZ_read32(const unsigned char *pucAt)
+{
+   return (unsigned long) pucAt[0] | ((unsigned long) pucAt[1] << 8)
+      | ((unsigned long) pucAt[2] << 16)
+      | ((unsigned long) pucAt[3] << 24);
+}
+
+/*
+  Returns the hash table slot for the four bytes ulValue.
+*/
+static size_t LZ_hash(unsigned long ulValue)
+{
+   return (size_t) (((ulValue * 2654435761UL) & 0xFFFFFFFFUL)
+                    >> (32 - LZ_HASH_BITS));
+}
+
+/*
+  Returns the number of bytes needed to extend a count of ulCount past
+  its token nibble.
+*/
+static size_t LZ_extraBytes(size_t ulCount)
+{
+   if(ulCount < LZ_NIBBLE_MAX)
+      return 0;
+   return (ulCount - LZ_NIBBLE_MAX) / 255 + 1;
+}
+
+/*
+  Writes the bytes extending a count of ulCount past its token nibble
+  at pucOut. Returns the position after them.
+*/
+static unsigned char *LZ_writeCount(unsigned char *pucOut,
+                                    size_t ulCount)
+{
+   if(ulCount < LZ_NIBBLE_MAX)
+      return pucOut;
+   ulCount -= LZ_NIBBLE_MAX;
+   while(ulCount >= 255) {
+      *pucOut++ = 255;
+      ulCount -= 255;
+   }
+   *pucOut++ = (unsigned char) ulCount;
+   return pucOut;
+}
+
+/*
+  Reads the bytes extending a count whose token nibble was ulNibble,
+  advancing *ppucIn, which must not pass pucEnd. Stores the count in
+  *pulCount and returns TRUE, or returns FALSE if the input ends.
+*/
+static boolean LZ_readCount(const unsigned char **ppucIn,
+                            const unsigned char *pucEnd,
+                            size_t ulNibble, size_t *pulCount)
+{
+   unsigned char ucByte;
+
+   *pulCount = ulNibble;
+   if(ulNibble < LZ_NIBBLE_MAX)
+      return TRUE;
+   do {
+      if(*ppucIn == pucEnd)
+         return FALSE;
+      ucByte = *(*ppucIn)++;
+      *pulCount += ucByte;
+   } while(ucByte == 255);
+   return TRUE;
+}
+
+/*
+  Appends a sequence of the ulLiterals bytes at pucLiterals followed,
+  if ulMatch is not 0, by a match of ulMatch bytes ulOffset back, to
+  the output at *ppucOut, which must not pass pucEnd. Returns TRUE, or
+  FALSE if it does not fit.
+*/
+static boolean LZ_writeSequence(unsigned char **ppucOut,
+                                const unsigned char *pucEnd,
+                                const unsigned char *pucLiterals,
+                                size_t ulLiterals, size_t ulOffset,
+                                size_t ulMatch)
+{
+   unsigned char *pucOut = *ppucOut;
+   size_t ulMatchCode = (ulMatch == 0) ? 0 : ulMatch - LZ_MIN_MATCH;
+   size_t ulNeeded;
+
+   ulNeeded = 1 + LZ_extraBytes(ulLiterals) + ulLiterals;
+   if(ulMatch != 0)
+      ulNeeded += 2 + LZ_extraBytes(ulMatchCode);
+   if((size_t) (pucEnd - pucOut) < ulNeeded)
+      return FALSE;
+
+   *pucOut++ = (unsigned char)
+      ((((ulLiterals < LZ_NIBBLE_MAX) ? ulLiterals : LZ_NIBBLE_MAX)
+        << 4)
+       | ((ulMatchCode < LZ_NIBBLE_MAX) ? ulMatchCode : LZ_NIBBLE_MAX));
+   pucOut = LZ_writeCount(pucOut, ulLiterals);
+   memcpy(pucOut, pucLiterals, ulLiterals);
+   pucOut += ulLiterals;
+
+   if(ulMatch != 0) {
+      *pucOut++ = (unsigned char) (ulOffset & 0xFF);
+      *pucOut++ = (unsigned char) (ulOffset >> 8);
+      pucOut = LZ_writeCount(pucOut, ulMatchCode);
+   }
+
+   *ppucOut = pucOut;
+   return TRUE;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t LZ_compress(const void *pvSrc, size_t ulSrcLength,
+                   void *pvDst, size_t ulDstCapacity)
+{
+   /* the position plus one of the last occurrence of each hash, or
+      0 if there has been none */
+   size_t aulTable[1 << LZ_HASH_BITS];
+   const unsigned char *pucSrc = pvSrc;
+   unsigned char *pucOut = pvDst;
+   unsigned char *pucEnd = pucOut + ulDstCapacity;
+   size_t ulPos = 0;
+   size_t ulAnchor = 0;
+   size_t ulCandidate;
+   size_t ulMatch;
+   size_t ulSlot;
+
+   assert(pvSrc != NULL || ulSrcLength == 0);
+   assert(pvDst != NULL);
+
+   memset(aulTable, 0, sizeof(aulTable));
+
+   while(ulPos + LZ_MIN_MATCH <= ulSrcLength) {
+      ulSlot = LZ_hash(LZ_read32(pucSrc + ulPos));
+      ulCandidate = aulTable[ulSlot];
+      aulTable[ulSlot] = ulPos + 1;
+
+      if(ulCandidate == 0 || ulPos - (ulCandidate - 1) > LZ_MAX_OFFSET ||
+         memcmp(pucSrc + ulCandidate - 1, pucSrc + ulPos,
+                LZ_MIN_MATCH) != 0) {
+         /* step faster through data that keeps failing to match */
+         ulPos += 1 + ((ulPos - ulAnchor) >> 6);
+         continue;
+      }
+      ulCandidate--;
+
+      ulMatch = LZ_MIN_MATCH;
+      while(ulPos + ulMatch < ulSrcLength &&
+            pucSrc[ulCandidate + ulMatch] == pucSrc[ulPos + ulMatch])
+         ulMatch++;
+
+      if(!LZ_writeSequence(&pucOut, pucEnd, pucSrc + ulAnchor,
+                           ulPos - ulAnchor, ulPos - ulCandidate,
+                           ulMatch))
+         return 0;
+      ulPos += ulMatch;
+      ulAnchor = ulPos;
+   }
+
+   if(!LZ_writeSequence(&pucOut, pucEnd, pucSrc + ulAnchor,
+                        ulSrcLength - ulAnchor, 0, 0))
+      return 0;
+   return (size_t) (pucOut - (unsigned char *) pvDst);
+}
+
+boolean LZ_decompress(const void *pvSrc, size_t ulSrcLength,
+                      void *pvDst, size_t ulDstLength)
+{
+   const unsigned char *pucIn = pvSrc;
+   const unsigned char *pucInEnd = pucIn + ulSrcLength;
+   unsigned char *pucOut = pvDst;
+   unsigned char *pucOutEnd = pucOut + ulDstLength;
+   const unsigned char *pucMatch;
+   size_t ulLiterals;
+   size_t ulMatch;
+   size_t ulOffset;
+   unsigned char ucToken;
+
+   assert(pvSrc != NULL || ulSrcLength == 0);
+   assert(pvDst != NULL || ulDstLength == 0);
+
+   for(;;) {
+      if(pucIn == pucInEnd)
+         return FALSE;
+      ucToken = *pucIn++;
+
+      if(!LZ_readCount(&pucIn, pucInEnd, (size_t) (ucToken >> 4),
+                       &ulLiterals) ||
+         (size_t) (pucInEnd - pucIn) < ulLiterals ||
+         (size_t) (pucOutEnd - pucOut) < ulLiterals)
+         return FALSE;
+      memcpy(pucOut, pucIn, ulLiterals);
+      pucIn += ulLiterals;
+      pucOut += ulLiterals;
+
+      /* only the last sequence ends without a match */
+      if(pucIn == pucInEnd)
+         return (boolean) (pucOut == pucOutEnd);
+
+      if(pucInEnd - pucIn < 2)
+         return FALSE;
+      ulOffset = (size_t) pucIn[0] | ((size_t) pucIn[1] << 8);
+      pucIn += 2;
+      if(!LZ_readCount(&pucIn, pucInEnd, (size_t) (ucToken & 0x0F),
+                       &ulMatch))
+         return FALSE;
+      ulMatch += LZ_MIN_MATCH;
+
+      if(ulOffset == 0 ||
+         ulOffset > (size_t) (pucOut - (unsigned char *) pvDst) ||
+         (size_t) (pucOutEnd - pucOut) < ulMatch)
+         return FALSE;
+
+      /* a match overlapping its own output is copied byte by byte */
+      pucMatch = pucOut - ulOffset;
+      if(ulOffset >= ulMatch) {
+         memcpy(pucOut, pucMatch, ulMatch);
+         pucOut += ulMatch;
+      }
+      else
+         while(ulMatch-- > 0)
+            *pucOut++ = *pucMatch++;
+   }
+}
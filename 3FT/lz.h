@@ -0,0 +1,37 @@
+/*--------------------------------------------------------------------*/
+/* lz.h                                                               */
+/*--------------------------------------------------------------------*/
+
+#ifndef LZ_INCLUDED
+#define LZ_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A byte-oriented LZ77 codec in the style of LZ4: a block is a run of
+  sequences, each a token byte holding a literal count and a match
+  length, then the literals, then a two-byte offset back into the
+  output to copy the match from. The last sequence has literals only.
+  It trades ratio for speed: matches are found through a single hash
+  probe, and decoding is plain copying.
+*/
+
+/*
+  Compresses the ulSrcLength bytes at pvSrc into the ulDstCapacity
+  bytes at pvDst. Returns the compressed length, or 0 if it would not
+  fit in ulDstCapacity bytes.
+*/
+size_t LZ_compress(const void *pvSrc, size_t ulSrcLength,
+                   void *pvDst, size_t ulDstCapacity);
+
+/*
+  Decompresses the ulSrcLength bytes at pvSrc, which LZ_compress
+  produced, into the ulDstLength bytes at pvDst. Returns TRUE if the
+  block decoded to exactly ulDstLength bytes, or FALSE if it is
+  malformed or of another length.
+*/
+boolean LZ_decompress(const void *pvSrc, size_t ulSrcLength,
+                      void *pvDst, size_t ulDstLength);
+
+#endif
@@ -1,8 +1,11 @@
 #include <stdlib.h>
+#include <stddef.h>
 #include <assert.h>
 #include <string.h>
 #include "dynarray.h"
 #include "nodeFT.h"
+#include "ptrtable.h"
+#include "trigram.h"
 #include <stdio.h>
 
 /* A node in a FT */
@@ -19,37 +22,1119 @@ struct node
    DynArray_T oDDirChildren;
    /* the object containing links to this node's file children (if directory) */
    DynArray_T oDFileChildren;
-   /* the pointer to this node's contents (if file) */
-   void* fileContent;
-   /* length of file contents */
-   size_t fileSize;
+   /* this node's contents (if file) */
+   Content_T oCContent;
+   /* the numbers of directories and files beneath this node, and the
+      bytes of the contents of those files (or, if this node is a
+      file, of its own contents) */
+   size_t ulSubtreeDirs;
+   size_t ulSubtreeFiles;
+   size_t ulSubtreeBytes;
+   /* the most nodes and bytes of contents allowed beneath this node,
+      each NODE_UNLIMITED if there is no limit */
+   size_t ulMaxNodes;
+   size_t ulMaxBytes;
+   /* under each ranking, one more than the best value in the subtree
+      rooted at this node (itself included), or 0 if nothing there
+      ranks; this node's children (if directory) in a binary max-heap
+      by that rank, or NULL until it first has a child; and this
+      node's slot in its parent's heap */
+   size_t aulRank[NODE_RANKING_COUNT];
+   DynArray_T aoDRanked[NODE_RANKING_COUNT];
+   size_t aulRankSlot[NODE_RANKING_COUNT];
 };
 
+/* The links of a node that a secondary index files under a key */
+struct keyLinks
+{
+   /* the hash of the key, the next group in its bucket (if the node
+      heads its group), and the nodes before and after it in its
+      group */
+   unsigned long ulHash;
+   Node_T oNNextGroup;
+   Node_T oNPrevSame;
+   Node_T oNNextSame;
+};
+
+/*
+  A secondary index is a hash table of groups of nodes, one group for
+  each distinct key, chained within buckets by their first nodes; it
+  doubles its bucket count whenever it holds as many groups as
+  buckets. The links of the nodes it files are kept in a side table
+  rather than in the nodes, so that an index that is off costs nothing
+  per node. If there is no memory to file a node, the index turns
+  itself off, and its users walk the tree as they do without it.
+*/
+struct keyIndex
+{
+   /* the buckets, or NULL while the index is off */
+   Node_T *poNBuckets;
+   /* the number of buckets and of groups */
+   size_t ulBucketCount;
+   size_t ulGroups;
+   /* the links of each node filed, or NULL while the index is off */
+   PtrTable_T oTLinks;
+};
+
+/* The secondary indexes */
+static struct keyIndex asIndexes[NODE_INDEX_COUNT];
+
+/* The number of buckets an index starts with */
+enum { MIN_KEY_BUCKET_COUNT = 64 };
+
+/* What the content index keeps for a file it tracks */
+struct contentLinks
+{
+   /* whether the file's contents await indexing or could not be
+      indexed, with its neighbours in the list of files that do or
+      could not, and otherwise the trigram slot that indexes them */
+   boolean bStale;
+   boolean bUnindexed;
+   Node_T oNPrevStale;
+   Node_T oNNextStale;
+   size_t ulSlot;
+};
+
+/*
+  The content index tracks every file, indexing its contents by
+  trigram only when it is next queried: a file whose contents have
+  changed since they were last indexed is unindexed at once and put
+  on the stale list. A file whose contents could not be indexed is
+  put on the unindexed list instead, and is a candidate for every
+  query until they are. What it keeps for each file is in a side
+  table, which it gives up, turning itself off, if there is no memory
+  to track a file.
+*/
+
+/* what is kept for each tracked file, or NULL while the content
+   index is off */
+static PtrTable_T oTContentLinks;
+/* the files whose contents await indexing, and those whose contents
+   could not be indexed */
+static Node_T oNStaleHead;
+static Node_T oNUnindexedHead;
+
+/* The links of a file in the size index */
+struct sizeLinks
+{
+   /* the file's random priority, and its parent and children in the
+      index's tree */
+   unsigned long ulPriority;
+   Node_T oNUp;
+   Node_T oNLeft;
+   Node_T oNRight;
+};
+
+/*
+  The size index is a treap of files ordered by the length of their
+  contents, files of equal length in the order they were indexed: a
+  binary search tree in which each file's random priority is no
+  greater than its parent's, so that the tree stays balanced with high
+  probability. Its links are kept in a side table, as the secondary
+  indexes keep theirs, and it turns itself off in the same way.
+*/
+
+/* the links of each file indexed, or NULL while the size index is
+   off */
+static PtrTable_T oTSizeLinks;
+/* the root of the treap, the number of distinct lengths in it, and
+   the state of the priority generator */
+static Node_T oNSizeRoot;
+static size_t ulSizeKeys;
+static unsigned long ulSizeSeed = 1;
+
+/*
+  Returns the key under which eIndex files oNNode, or NULL if it files
+  oNNode under none: the last component of its path for the name
+  index, and what follows the last '.' of a file's last component,
+  unless that is its first character, for the extension index.
+*/
+static const char *Node_getKey(enum Node_Index eIndex, Node_T oNNode)
+{
+   const char *pcPath;
+   const char *pcName;
+   const char *pcDot;
+
+   assert(oNNode != NULL);
+
+   pcPath = Path_getPathname(oNNode->oPPath);
+   pcName = strrchr(pcPath, '/');
+   pcName = (pcName == NULL) ? pcPath : pcName + 1;
+   if(eIndex == NODE_NAME_INDEX)
+      return pcName;
+
+   if(oNNode->isDir)
+      return NULL;
+   pcDot = strrchr(pcName, '.');
+   return (pcDot == NULL || pcDot == pcName) ? NULL : pcDot + 1;
+}
+
+/*
+  Returns the FNV-1a hash of the string pcKey.
+*/
+static unsigned long Node_hashKey(const char *pcKey)
+{
+   unsigned long ulHash = 2166136261UL;
+
+   assert(pcKey != NULL);
+
+   for(; *pcKey != '\0'; pcKey++) {
+      ulHash ^= (unsigned char) *pcKey;
+      ulHash *= 16777619UL;
+   }
+   return ulHash;
+}
+
+/*
+  Returns the links of oNNode in eIndex, which must be on, or NULL if
+  it does not file oNNode.
+*/
+static struct keyLinks *Node_getKeyLinks(enum Node_Index eIndex,
+                                         Node_T oNNode)
+{
+   assert(oNNode != NULL);
+   assert(asIndexes[eIndex].oTLinks != NULL);
+
+   return PtrTable_get(asIndexes[eIndex].oTLinks, oNNode);
+}
+
+/*
+  Returns TRUE if eIndex is on and files oNNode under a key.
+*/
+static boolean Node_isKeyed(enum Node_Index eIndex, Node_T oNNode)
+{
+   assert(oNNode != NULL);
+
+   return (boolean) (asIndexes[eIndex].oTLinks != NULL &&
+                     Node_getKeyLinks(eIndex, oNNode) != NULL);
+}
+
+/*
+  Grows eIndex to twice as many buckets. If there is no memory, leaves
+  it as it is, with longer chains.
+*/
+static void Node_growIndex(enum Node_Index eIndex)
+{
+   struct keyIndex *psIndex = &asIndexes[eIndex];
+   struct keyLinks *psLinks;
+   Node_T *poNNew;
+   Node_T oNCurr;
+   Node_T oNNext;
+   size_t ulNewCount = 2 * psIndex->ulBucketCount;
+   size_t u;
+
+   poNNew = calloc(ulNewCount, sizeof(Node_T));
+   if(poNNew == NULL)
+      return;
+
+   for(u = 0; u < psIndex->ulBucketCount; u++) {
+      for(oNCurr = psIndex->poNBuckets[u]; oNCurr != NULL;
+          oNCurr = oNNext) {
+         psLinks = Node_getKeyLinks(eIndex, oNCurr);
+         oNNext = psLinks->oNNextGroup;
+         psLinks->oNNextGroup = poNNew[psLinks->ulHash % ulNewCount];
+         poNNew[psLinks->ulHash % ulNewCount] = oNCurr;
+      }
+   }
+   free(psIndex->poNBuckets);
+   psIndex->poNBuckets = poNNew;
+   psIndex->ulBucketCount = ulNewCount;
+}
+
+/*
+  Files oNNode, which it must not yet file, in eIndex, which must be
+  on, under its key if it has one. Returns SUCCESS, or MEMORY_ERROR if
+  there is no memory for its links, in which case it is not filed.
+*/
+static int Node_addKey(enum Node_Index eIndex, Node_T oNNode)
+{
+   struct keyIndex *psIndex = &asIndexes[eIndex];
+   struct keyLinks *psLinks;
+   struct keyLinks *psGroup = NULL;
+   const char *pcKey;
+   Node_T oNGroup;
+   Node_T *poNBucket;
+
+   assert(oNNode != NULL);
+   assert(psIndex->poNBuckets != NULL);
+
+   pcKey = Node_getKey(eIndex, oNNode);
+   if(pcKey == NULL)
+      return SUCCESS;
+   /* put first, since putting may move the links of other nodes */
+   psLinks = PtrTable_put(psIndex->oTLinks, oNNode);
+   if(psLinks == NULL)
+      return MEMORY_ERROR;
+   psLinks->ulHash = Node_hashKey(pcKey);
+   psLinks->oNPrevSame = NULL;
+
+   poNBucket = &psIndex->poNBuckets[psLinks->ulHash %
+                                    psIndex->ulBucketCount];
+   for(oNGroup = *poNBucket; oNGroup != NULL;
+       oNGroup = psGroup->oNNextGroup) {
+      psGroup = Node_getKeyLinks(eIndex, oNGroup);
+      if(psGroup->ulHash == psLinks->ulHash &&
+         strcmp(Node_getKey(eIndex, oNGroup), pcKey) == 0)
+         break;
+   }
+
+   /* join an existing group second, so its first node stays put */
+   if(oNGroup != NULL) {
+      psLinks->oNNextGroup = NULL;
+      psLinks->oNPrevSame = oNGroup;
+      psLinks->oNNextSame = psGroup->oNNextSame;
+      if(psGroup->oNNextSame != NULL)
+         Node_getKeyLinks(eIndex, psGroup->oNNextSame)->oNPrevSame =
+            oNNode;
+      psGroup->oNNextSame = oNNode;
+      return SUCCESS;
+   }
+
+   psLinks->oNNextSame = NULL;
+   psLinks->oNNextGroup = *poNBucket;
+   *poNBucket = oNNode;
+   psIndex->ulGroups++;
+   if(psIndex->ulGroups >= psIndex->ulBucketCount)
+      Node_growIndex(eIndex);
+   return SUCCESS;
+}
+
+/*
+  Files oNNode in eIndex, if eIndex is on and does not yet file it.
+  If there is no memory to, turns eIndex off.
+*/
+static void Node_fileKey(enum Node_Index eIndex, Node_T oNNode)
+{
+   assert(oNNode != NULL);
+
+   if(asIndexes[eIndex].poNBuckets == NULL ||
+      Node_isKeyed(eIndex, oNNode))
+      return;
+   if(Node_addKey(eIndex, oNNode) != SUCCESS)
+      (void) Node_setIndex(eIndex, FALSE, NULL);
+}
+
+/*
+  Removes oNNode from eIndex, if eIndex files it.
+*/
+static void Node_removeKey(enum Node_Index eIndex, Node_T oNNode)
+{
+   struct keyIndex *psIndex = &asIndexes[eIndex];
+   struct keyLinks *psLinks;
+   struct keyLinks *psNext;
+   Node_T *poNLink;
+
+   assert(oNNode != NULL);
+
+   if(!Node_isKeyed(eIndex, oNNode))
+      return;
+   psLinks = Node_getKeyLinks(eIndex, oNNode);
+
+   if(psLinks->oNPrevSame != NULL) {
+      Node_getKeyLinks(eIndex, psLinks->oNPrevSame)->oNNextSame =
+         psLinks->oNNextSame;
+      if(psLinks->oNNextSame != NULL)
+         Node_getKeyLinks(eIndex, psLinks->oNNextSame)->oNPrevSame =
+            psLinks->oNPrevSame;
+   }
+   else {
+      /* the first node of a group hands its place to the next, if
+         any */
+      poNLink = &psIndex->poNBuckets[psLinks->ulHash %
+                                     psIndex->ulBucketCount];
+      while(*poNLink != oNNode)
+         poNLink = &Node_getKeyLinks(eIndex, *poNLink)->oNNextGroup;
+      if(psLinks->oNNextSame != NULL) {
+         psNext = Node_getKeyLinks(eIndex, psLinks->oNNextSame);
+         psNext->oNPrevSame = NULL;
+         psNext->oNNextGroup = psLinks->oNNextGroup;
+         *poNLink = psLinks->oNNextSame;
+      }
+      else {
+         *poNLink = psLinks->oNNextGroup;
+         psIndex->ulGroups--;
+      }
+   }
+
+   /* last, since removing may move the links of other nodes */
+   PtrTable_remove(psIndex->oTLinks, oNNode);
+}
+
+/*
+  Files oNNode in every index that is on and files it under a key.
+*/
+static void Node_addKeys(Node_T oNNode)
+{
+   int iIndex;
+
+   assert(oNNode != NULL);
+
+   for(iIndex = 0; iIndex < NODE_INDEX_COUNT; iIndex++)
+      Node_fileKey((enum Node_Index) iIndex, oNNode);
+}
+
+/*
+  Removes oNNode from every index that files it.
+*/
+static void Node_removeKeys(Node_T oNNode)
+{
+   int iIndex;
+
+   assert(oNNode != NULL);
+
+   for(iIndex = 0; iIndex < NODE_INDEX_COUNT; iIndex++)
+      Node_removeKey((enum Node_Index) iIndex, oNNode);
+}
+
+/*
+  Adds (if bAdd is TRUE) or removes oNNode and every node beneath it
+  to or from the indexes: every index that is on, or (if eOnly is not
+  NODE_INDEX_COUNT) just eOnly.
+*/
+static void Node_keySubtree(Node_T oNNode, boolean bAdd,
+                            enum Node_Index eOnly)
+{
+   int iIndex;
+   size_t u;
+
+   assert(oNNode != NULL);
+
+   /* with every index off no node is in one, nor is to be added */
+   if(eOnly == NODE_INDEX_COUNT) {
+      for(iIndex = 0; iIndex < NODE_INDEX_COUNT; iIndex++)
+         if(asIndexes[iIndex].poNBuckets != NULL)
+            break;
+      if(iIndex == NODE_INDEX_COUNT)
+         return;
+   }
+
+   if(eOnly != NODE_INDEX_COUNT) {
+      if(!bAdd)
+         Node_removeKey(eOnly, oNNode);
+      else
+         Node_fileKey(eOnly, oNNode);
+   }
+   else if(bAdd)
+      Node_addKeys(oNNode);
+   else
+      Node_removeKeys(oNNode);
+
+   for(u = 0; u < DynArray_getLength(oNNode->oDDirChildren); u++)
+      Node_keySubtree(DynArray_get(oNNode->oDDirChildren, u), bAdd,
+                      eOnly);
+   for(u = 0; u < DynArray_getLength(oNNode->oDFileChildren); u++)
+      Node_keySubtree(DynArray_get(oNNode->oDFileChildren, u), bAdd,
+                      eOnly);
+}
+
+/*
+  Returns what the content index, which must be on, keeps for oNNode,
+  or NULL if it does not track oNNode.
+*/
+static struct contentLinks *Node_getContentLinks(Node_T oNNode)
+{
+   assert(oNNode != NULL);
+   assert(oTContentLinks != NULL);
+
+   return PtrTable_get(oTContentLinks, oNNode);
+}
+
+/*
+  Returns TRUE if the content index is on and tracks oNNode.
+*/
+static boolean Node_isTracked(Node_T oNNode)
+{
+   assert(oNNode != NULL);
+
+   return (boolean) (oTContentLinks != NULL &&
+                     Node_getContentLinks(oNNode) != NULL);
+}
+
+/*
+  Puts the tracked file oNNode at the front of the stale or unindexed
+  list that *poNHead heads.
+*/
+static void Node_linkTracked(Node_T *poNHead, Node_T oNNode)
+{
+   struct contentLinks *psLinks;
+
+   assert(poNHead != NULL);
+   assert(Node_isTracked(oNNode));
+
+   psLinks = Node_getContentLinks(oNNode);
+   psLinks->oNPrevStale = NULL;
+   psLinks->oNNextStale = *poNHead;
+   if(*poNHead != NULL)
+      Node_getContentLinks(*poNHead)->oNPrevStale = oNNode;
+   *poNHead = oNNode;
+}
+
+/*
+  Takes the tracked file oNNode off the stale or unindexed list that
+  *poNHead heads.
+*/
+static void Node_unlinkTracked(Node_T *poNHead, Node_T oNNode)
+{
+   struct contentLinks *psLinks;
+
+   assert(poNHead != NULL);
+   assert(Node_isTracked(oNNode));
+
+   psLinks = Node_getContentLinks(oNNode);
+   if(psLinks->oNPrevStale != NULL)
+      Node_getContentLinks(psLinks->oNPrevStale)->oNNextStale =
+         psLinks->oNNextStale;
+   else
+      *poNHead = psLinks->oNNextStale;
+   if(psLinks->oNNextStale != NULL)
+      Node_getContentLinks(psLinks->oNNextStale)->oNPrevStale =
+         psLinks->oNPrevStale;
+}
+
+/*
+  Puts the tracked file oNNode on the stale list, unindexing its
+  contents, unless it is there already.
+*/
+static void Node_markStale(Node_T oNNode)
+{
+   struct contentLinks *psLinks;
+
+   assert(Node_isTracked(oNNode));
+
+   psLinks = Node_getContentLinks(oNNode);
+   if(psLinks->bStale)
+      return;
+   if(psLinks->bUnindexed)
+      Node_unlinkTracked(&oNUnindexedHead, oNNode);
+   else
+      Trigram_remove(psLinks->ulSlot);
+   psLinks->bStale = TRUE;
+   psLinks->bUnindexed = FALSE;
+   Node_linkTracked(&oNStaleHead, oNNode);
+}
+
+/*
+  Starts tracking oNNode in the content index, if it is on and
+  oNNode is a file it does not yet track; its contents are indexed
+  at the next query. If there is no memory to, turns the content
+  index off.
+*/
+static void Node_track(Node_T oNNode)
+{
+   struct contentLinks *psLinks;
+
+   assert(oNNode != NULL);
+
+   if(oTContentLinks == NULL || oNNode->isDir || Node_isTracked(oNNode))
+      return;
+   psLinks = PtrTable_put(oTContentLinks, oNNode);
+   if(psLinks == NULL) {
+      (void) Node_setContentIndex(FALSE, NULL);
+      return;
+   }
+   psLinks->bStale = TRUE;
+   Node_linkTracked(&oNStaleHead, oNNode);
+}
+
+/*
+  Stops tracking oNNode in the content index, if it does.
+*/
+static void Node_untrack(Node_T oNNode)
+{
+   struct contentLinks *psLinks;
+
+   assert(oNNode != NULL);
+
+   if(!Node_isTracked(oNNode))
+      return;
+   psLinks = Node_getContentLinks(oNNode);
+   if(psLinks->bStale)
+      Node_unlinkTracked(&oNStaleHead, oNNode);
+   else if(psLinks->bUnindexed)
+      Node_unlinkTracked(&oNUnindexedHead, oNNode);
+   else
+      Trigram_remove(psLinks->ulSlot);
+   PtrTable_remove(oTContentLinks, oNNode);
+}
+
+/*
+  Returns the links of oNNode in the size index, which must be on, or
+  NULL if it does not hold oNNode.
+*/
+static struct sizeLinks *Node_getSizeLinks(Node_T oNNode)
+{
+   assert(oNNode != NULL);
+   assert(oTSizeLinks != NULL);
+
+   return PtrTable_get(oTSizeLinks, oNNode);
+}
+
+/*
+  Returns TRUE if the size index is on and holds oNNode.
+*/
+static boolean Node_isSized(Node_T oNNode)
+{
+   assert(oNNode != NULL);
+
+   return (boolean) (oTSizeLinks != NULL &&
+                     Node_getSizeLinks(oNNode) != NULL);
+}
+
+/*
+  Returns the file before (if bBefore is TRUE) or after oNNode in the
+  size index's tree, or NULL if there is none.
+*/
+static Node_T Node_stepSize(Node_T oNNode, boolean bBefore)
+{
+   struct sizeLinks *psLinks;
+   Node_T oNNext;
+   Node_T oNFurther;
+
+   assert(Node_isSized(oNNode));
+
+   psLinks = Node_getSizeLinks(oNNode);
+   oNNext = bBefore ? psLinks->oNLeft : psLinks->oNRight;
+   if(oNNext != NULL) {
+      /* the nearest file on that side of oNNode's own subtree */
+      for(;;) {
+         psLinks = Node_getSizeLinks(oNNext);
+         oNFurther = bBefore ? psLinks->oNRight : psLinks->oNLeft;
+         if(oNFurther == NULL)
+            return oNNext;
+         oNNext = oNFurther;
+      }
+   }
+   /* otherwise the first ancestor reached from that side */
+   for(oNNext = psLinks->oNUp; oNNext != NULL;
+       oNNode = oNNext, oNNext = psLinks->oNUp) {
+      psLinks = Node_getSizeLinks(oNNext);
+      if((bBefore ? psLinks->oNRight : psLinks->oNLeft) == oNNode)
+         return oNNext;
+   }
+   return NULL;
+}
+
+/*
+  Returns TRUE if oNNode is the size index's only file of its length.
+*/
+static boolean Node_isSoleSize(Node_T oNNode)
+{
+   Node_T oNNeighbour;
+
+   assert(Node_isSized(oNNode));
+
+   oNNeighbour = Node_stepSize(oNNode, TRUE);
+   if(oNNeighbour != NULL &&
+      oNNeighbour->ulSubtreeBytes == oNNode->ulSubtreeBytes)
+      return FALSE;
+   oNNeighbour = Node_stepSize(oNNode, FALSE);
+   return (boolean) (oNNeighbour == NULL ||
+                     oNNeighbour->ulSubtreeBytes !=
+                     oNNode->ulSubtreeBytes);
+}
+
+/*
+  Rotates oNNode above its parent in the size index's treap, keeping
+  the order of the files.
+*/
+static void Node_rotateSize(Node_T oNNode)
+{
+   struct sizeLinks *psLinks;
+   struct sizeLinks *psUp;
+   struct sizeLinks *psGrand;
+   Node_T oNUp;
+   Node_T oNGrand;
+   Node_T oNMoved;
+
+   assert(Node_isSized(oNNode));
+
+   psLinks = Node_getSizeLinks(oNNode);
+   oNUp = psLinks->oNUp;
+   assert(oNUp != NULL);
+   psUp = Node_getSizeLinks(oNUp);
+   oNGrand = psUp->oNUp;
+   if(psUp->oNLeft == oNNode) {
+      oNMoved = psLinks->oNRight;
+      psUp->oNLeft = oNMoved;
+      psLinks->oNRight = oNUp;
+   }
+   else {
+      oNMoved = psLinks->oNLeft;
+      psUp->oNRight = oNMoved;
+      psLinks->oNLeft = oNUp;
+   }
+   if(oNMoved != NULL)
+      Node_getSizeLinks(oNMoved)->oNUp = oNUp;
+   psUp->oNUp = oNNode;
+   psLinks->oNUp = oNGrand;
+
+   if(oNGrand == NULL)
+      oNSizeRoot = oNNode;
+   else {
+      psGrand = Node_getSizeLinks(oNGrand);
+      if(psGrand->oNLeft == oNUp)
+         psGrand->oNLeft = oNNode;
+      else
+         psGrand->oNRight = oNNode;
+   }
+}
+
+/*
+  Links oNNode, which the size index holds but has not linked into its
+  treap, in after every file no longer than oNNode.
+*/
+static void Node_insertSize(Node_T oNNode)
+{
+   struct sizeLinks *psLinks;
+   struct sizeLinks *psCurr;
+   Node_T oNCurr;
+   Node_T *poNLink = &oNSizeRoot;
+
+   assert(Node_isSized(oNNode));
+
+   psLinks = Node_getSizeLinks(oNNode);
+   psLinks->oNUp = NULL;
+   psLinks->oNLeft = NULL;
+   psLinks->oNRight = NULL;
+
+   for(oNCurr = oNSizeRoot; oNCurr != NULL; oNCurr = *poNLink) {
+      psCurr = Node_getSizeLinks(oNCurr);
+      psLinks->oNUp = oNCurr;
+      poNLink = (oNNode->ulSubtreeBytes < oNCurr->ulSubtreeBytes) ?
+         &psCurr->oNLeft : &psCurr->oNRight;
+   }
+   *poNLink = oNNode;
+   while(psLinks->oNUp != NULL &&
+         Node_getSizeLinks(psLinks->oNUp)->ulPriority <
+         psLinks->ulPriority)
+      Node_rotateSize(oNNode);
+
+   if(Node_isSoleSize(oNNode))
+      ulSizeKeys++;
+}
+
+/*
+  Unlinks oNNode from the size index's treap, leaving the index
+  holding its links.
+*/
+static void Node_extractSize(Node_T oNNode)
+{
+   struct sizeLinks *psLinks;
+   struct sizeLinks *psUp;
+   Node_T oNChild;
+
+   assert(Node_isSized(oNNode));
+
+   if(Node_isSoleSize(oNNode))
+      ulSizeKeys--;
+
+   /* rotate it down to a leaf, keeping the priorities in order */
+   psLinks = Node_getSizeLinks(oNNode);
+   while(psLinks->oNLeft != NULL || psLinks->oNRight != NULL) {
+      if(psLinks->oNLeft == NULL)
+         oNChild = psLinks->oNRight;
+      else if(psLinks->oNRight == NULL)
+         oNChild = psLinks->oNLeft;
+      else
+         oNChild = (Node_getSizeLinks(psLinks->oNLeft)->ulPriority >
+                    Node_getSizeLinks(psLinks->oNRight)->ulPriority) ?
+            psLinks->oNLeft : psLinks->oNRight;
+      Node_rotateSize(oNChild);
+   }
+
+   if(psLinks->oNUp == NULL)
+      oNSizeRoot = NULL;
+   else {
+      psUp = Node_getSizeLinks(psLinks->oNUp);
+      if(psUp->oNLeft == oNNode)
+         psUp->oNLeft = NULL;
+      else
+         psUp->oNRight = NULL;
+   }
+}
+
+/*
+  Adds oNNode to the size index, if it is on and oNNode is a file it
+  does not yet hold, after every file no longer than oNNode. If there
+  is no memory to, turns the size index off.
+*/
+static void Node_addSize(Node_T oNNode)
+{
+   struct sizeLinks *psLinks;
+
+   assert(oNNode != NULL);
+
+   if(oTSizeLinks == NULL || oNNode->isDir || Node_isSized(oNNode))
+      return;
+   psLinks = PtrTable_put(oTSizeLinks, oNNode);
+   if(psLinks == NULL) {
+      (void) Node_setSizeIndex(FALSE, NULL);
+      return;
+   }
+   ulSizeSeed = (ulSizeSeed * 1103515245UL + 12345UL) & 0xFFFFFFFFUL;
+   psLinks->ulPriority = ulSizeSeed;
+   Node_insertSize(oNNode);
+}
+
+/*
+  Removes oNNode from the size index, if it is there.
+*/
+static void Node_removeSize(Node_T oNNode)
+{
+   assert(oNNode != NULL);
+
+   if(!Node_isSized(oNNode))
+      return;
+   Node_extractSize(oNNode);
+   PtrTable_remove(oTSizeLinks, oNNode);
+}
+
+/*
+  Starts (if bTrack is TRUE) or stops tracking oNNode and every file
+  beneath it in the content and size indexes.
+*/
+static void Node_trackSubtree(Node_T oNNode, boolean bTrack)
+{
+   size_t u;
+
+   assert(oNNode != NULL);
+
+   if(oTContentLinks == NULL && oTSizeLinks == NULL)
+      return;
+   if(bTrack) {
+      Node_track(oNNode);
+      Node_addSize(oNNode);
+   }
+   else {
+      Node_untrack(oNNode);
+      Node_removeSize(oNNode);
+   }
+
+   for(u = 0; u < DynArray_getLength(oNNode->oDDirChildren); u++)
+      Node_trackSubtree(DynArray_get(oNNode->oDDirChildren, u), bTrack);
+   for(u = 0; u < DynArray_getLength(oNNode->oDFileChildren); u++)
+      Node_trackSubtree(DynArray_get(oNNode->oDFileChildren, u), bTrack);
+}
+
+/*
+  Adds (if bAdd is TRUE) or subtracts ulDirs directories, ulFiles
+  files, and ulBytes bytes of contents to or from the totals of
+  oNAncestor and each of its ancestors.
+*/
+static void Node_adjustTotals(Node_T oNAncestor, size_t ulDirs,
+                              size_t ulFiles, size_t ulBytes,
+                              boolean bAdd)
+{
+   for(; oNAncestor != NULL; oNAncestor = oNAncestor->oNParent) {
+      if(bAdd) {
+         oNAncestor->ulSubtreeDirs += ulDirs;
+         oNAncestor->ulSubtreeFiles += ulFiles;
+         oNAncestor->ulSubtreeBytes += ulBytes;
+      }
+      else {
+         oNAncestor->ulSubtreeDirs -= ulDirs;
+         oNAncestor->ulSubtreeFiles -= ulFiles;
+         oNAncestor->ulSubtreeBytes -= ulBytes;
+      }
+   }
+}
+
+/*
+  Returns TRUE if oNChild is in the heaps of oNParent, and FALSE if it
+  has been unlinked from them.
+*/
+static boolean Node_isRanked(Node_T oNParent, Node_T oNChild)
+{
+   DynArray_T oDHeap;
+   size_t ulSlot;
+
+   assert(oNParent != NULL);
+   assert(oNChild != NULL);
+
+   /* every child is in every heap, so one heap tells */
+   oDHeap = oNParent->aoDRanked[0];
+   ulSlot = oNChild->aulRankSlot[0];
+   return (boolean) (oDHeap != NULL &&
+                     ulSlot < DynArray_getLength(oDHeap) &&
+                     DynArray_get(oDHeap, ulSlot) == oNChild);
+}
+
+/*
+  Moves the child in slot ulSlot of oNParent's heap under eRanking up
+  or down to its place, after its rank changed.
+*/
+static void Node_siftRanked(Node_T oNParent, enum Node_Ranking eRanking,
+                            size_t ulSlot)
+{
+   DynArray_T oDHeap;
+   Node_T oNChild;
+   Node_T oNOther;
+   size_t ulLength;
+   size_t ulNext;
+
+   assert(oNParent != NULL);
+
+   oDHeap = oNParent->aoDRanked[eRanking];
+   ulLength = DynArray_getLength(oDHeap);
+   oNChild = DynArray_get(oDHeap, ulSlot);
+
+   while(ulSlot > 0) {
+      ulNext = (ulSlot - 1) / 2;
+      oNOther = DynArray_get(oDHeap, ulNext);
+      if(oNOther->aulRank[eRanking] >= oNChild->aulRank[eRanking])
+         break;
+      (void) DynArray_set(oDHeap, ulSlot, oNOther);
+      oNOther->aulRankSlot[eRanking] = ulSlot;
+      ulSlot = ulNext;
+   }
+   for(;;) {
+      ulNext = 2 * ulSlot + 1;
+      if(ulNext >= ulLength)
+         break;
+      if(ulNext + 1 < ulLength &&
+         ((Node_T) DynArray_get(oDHeap, ulNext + 1))->aulRank[eRanking] >
+         ((Node_T) DynArray_get(oDHeap, ulNext))->aulRank[eRanking])
+         ulNext++;
+      oNOther = DynArray_get(oDHeap, ulNext);
+      if(oNOther->aulRank[eRanking] <= oNChild->aulRank[eRanking])
+         break;
+      (void) DynArray_set(oDHeap, ulSlot, oNOther);
+      oNOther->aulRankSlot[eRanking] = ulSlot;
+      ulSlot = ulNext;
+   }
+   (void) DynArray_set(oDHeap, ulSlot, oNChild);
+   oNChild->aulRankSlot[eRanking] = ulSlot;
+}
+
+/*
+  Removes oNChild from oNParent's heap under eRanking.
+*/
+static void Node_unrankChild(Node_T oNParent, enum Node_Ranking eRanking,
+                             Node_T oNChild)
+{
+   DynArray_T oDHeap;
+   Node_T oNLast;
+
+   assert(oNParent != NULL);
+   assert(oNChild != NULL);
+
+   oDHeap = oNParent->aoDRanked[eRanking];
+   assert(DynArray_get(oDHeap, oNChild->aulRankSlot[eRanking]) == oNChild);
+
+   /* the last child fills the hole, then finds its place */
+   oNLast = DynArray_removeAt(oDHeap, DynArray_getLength(oDHeap) - 1);
+   if(oNLast != oNChild) {
+      (void) DynArray_set(oDHeap, oNChild->aulRankSlot[eRanking], oNLast);
+      Node_siftRanked(oNParent, eRanking, oNChild->aulRankSlot[eRanking]);
+   }
+}
+
+/*
+  Adds oNChild to each of oNParent's heaps. Returns SUCCESS, or
+  MEMORY_ERROR if a heap could not grow, in which case it is added to
+  none.
+*/
+static int Node_rankChild(Node_T oNParent, Node_T oNChild)
+{
+   DynArray_T oDHeap;
+   int iRanking;
+
+   assert(oNParent != NULL);
+   assert(oNChild != NULL);
+
+   for(iRanking = 0; iRanking < NODE_RANKING_COUNT; iRanking++) {
+      if(oNParent->aoDRanked[iRanking] == NULL)
+         oNParent->aoDRanked[iRanking] = DynArray_new(0);
+      oDHeap = oNParent->aoDRanked[iRanking];
+      if(oDHeap == NULL || !DynArray_add(oDHeap, oNChild)) {
+         while(--iRanking >= 0)
+            Node_unrankChild(oNParent, (enum Node_Ranking) iRanking,
+                             oNChild);
+         return MEMORY_ERROR;
+      }
+      Node_siftRanked(oNParent, (enum Node_Ranking) iRanking,
+                      DynArray_getLength(oDHeap) - 1);
+   }
+   return SUCCESS;
+}
+
+/*
+  Recomputes the ranks of oNNode from its own contents or number of
+  children and the children atop its heaps. Returns TRUE if any
+  changed, or FALSE if not.
+*/
+static boolean Node_rankMaxima(Node_T oNNode)
+{
+   DynArray_T oDHeap;
+   Node_T oNTop;
+   size_t ulRank;
+   boolean bChanged = FALSE;
+   int iRanking;
+
+   assert(oNNode != NULL);
+
+   for(iRanking = 0; iRanking < NODE_RANKING_COUNT; iRanking++) {
+      if(iRanking == NODE_RANK_FILE_SIZE)
+         ulRank = oNNode->isDir ? 0 : oNNode->ulSubtreeBytes + 1;
+      else
+         ulRank = oNNode->isDir ? Node_getNumChildren(oNNode) + 1 : 0;
+      oDHeap = oNNode->aoDRanked[iRanking];
+      if(oDHeap != NULL && DynArray_getLength(oDHeap) > 0) {
+         oNTop = DynArray_get(oDHeap, 0);
+         if(oNTop->aulRank[iRanking] > ulRank)
+            ulRank = oNTop->aulRank[iRanking];
+      }
+      if(ulRank != oNNode->aulRank[iRanking]) {
+         oNNode->aulRank[iRanking] = ulRank;
+         bChanged = TRUE;
+      }
+   }
+   return bChanged;
+}
+
+/*
+  Brings the ranks of oNNode and its ancestors up to date after
+  oNNode's own contents or children changed. Each node whose ranks
+  change is moved to its place in its parent's heaps, in time
+  proportional to the logarithm of the parent's number of children.
+  Stops at the first node whose ranks do not change, or that has been
+  unlinked from its parent.
+*/
+static void Node_propagateMaxima(Node_T oNNode)
+{
+   Node_T oNParent;
+   int iRanking;
+
+   assert(oNNode != NULL);
+
+   for(; Node_rankMaxima(oNNode); oNNode = oNParent) {
+      oNParent = oNNode->oNParent;
+      if(oNParent == NULL || !Node_isRanked(oNParent, oNNode))
+         return;
+      for(iRanking = 0; iRanking < NODE_RANKING_COUNT; iRanking++)
+         Node_siftRanked(oNParent, (enum Node_Ranking) iRanking,
+                         oNNode->aulRankSlot[iRanking]);
+   }
+}
+
+/*
+  Adds (if bAdd is TRUE) or subtracts the subtree rooted at oNNode,
+  which has just been linked into or unlinked from its parent, to or
+  from the totals and ranks of its ancestors.
+*/
+static void Node_accountSubtree(Node_T oNNode, boolean bAdd)
+{
+   assert(oNNode != NULL);
+
+   Node_adjustTotals(oNNode->oNParent,
+                     oNNode->ulSubtreeDirs + (oNNode->isDir ? 1 : 0),
+                     oNNode->ulSubtreeFiles + (oNNode->isDir ? 0 : 1),
+                     oNNode->ulSubtreeBytes, bAdd);
+   if(oNNode->oNParent != NULL)
+      Node_propagateMaxima(oNNode->oNParent);
+}
+
+/*
+  Removes oNChild, at index ulIndex of oDChildren, one of oNParent's
+  children arrays, from that array and from oNParent's heaps.
+*/
+static void Node_removeChild(Node_T oNParent, DynArray_T oDChildren,
+                             size_t ulIndex, Node_T oNChild)
+{
+   int iRanking;
+
+   assert(oNParent != NULL);
+   assert(oDChildren != NULL);
+   assert(DynArray_get(oDChildren, ulIndex) == oNChild);
+
+   (void) DynArray_removeAt(oDChildren, ulIndex);
+   for(iRanking = 0; iRanking < NODE_RANKING_COUNT; iRanking++)
+      Node_unrankChild(oNParent, (enum Node_Ranking) iRanking, oNChild);
+}
+
+
+/*
+  Links new child oNChild into oNParent's children array at index
+  ulIndex, and into oNParent's heaps. Returns SUCCESS if the new child
+  was added successfully, or MEMORY_ERROR if allocation fails adding
+  oNChild to the array or the heaps, in which case it is in none.
+*/
+static int Node_addChild(Node_T oNParent, Node_T oNChild, size_t ulIndex, boolean isDirec)
+{
+   DynArray_T oDChildren;
+
+   assert(oNParent != NULL);
+   assert(oNChild != NULL);
+
+
+   if(isDirec)
+      oDChildren = oNParent->oDDirChildren;
+   else
+      oDChildren = oNParent->oDFileChildren;
+   if(!DynArray_addAt(oDChildren, ulIndex, oNChild))
+      return MEMORY_ERROR;
+   if(Node_rankChild(oNParent, oNChild) != SUCCESS) {
+      (void) DynArray_removeAt(oDChildren, ulIndex);
+      return MEMORY_ERROR;
+   }
+   return SUCCESS;
+}
+
+/* The first ulLength characters of a path, as Node_findChild seeks */
+struct prefix
+{
+   const char *pcPath;
+   size_t ulLength;
+};
 
 /*
-  Links new child oNChild into oNParent's children array at index
-  ulIndex. Returns SUCCESS if the new child was added successfully,
-  or  MEMORY_ERROR if allocation fails adding oNChild to the array.
+  Compares the string representation of oNFirst with the prefix
+  *psSecond, as strcmp would if the prefix were a string of its own.
 */
-static int Node_addChild(Node_T oNParent, Node_T oNChild, size_t ulIndex, boolean isDirec)
+static int Node_comparePrefix(const Node_T oNFirst,
+                              const struct prefix *psSecond)
 {
-   
-   assert(oNParent != NULL);
-   assert(oNChild != NULL);
+   const char *pcName;
+   int iCompare;
 
-   
-   if(isDirec) {
-      if(DynArray_addAt(oNParent->oDDirChildren, ulIndex, oNChild))
-         return SUCCESS;
-      else
-         return MEMORY_ERROR;
-   }
-   else {
-      if(DynArray_addAt(oNParent->oDFileChildren, ulIndex, oNChild))
-         return SUCCESS;
-      else
-         return MEMORY_ERROR;
-   }
+   assert(oNFirst != NULL);
+   assert(psSecond != NULL);
+
+   pcName = Path_getPathname(oNFirst->oPPath);
+   iCompare = strncmp(pcName, psSecond->pcPath, psSecond->ulLength);
+   if(iCompare != 0)
+      return iCompare;
+   return (pcName[psSecond->ulLength] == '\0') ? 0 : 1;
+}
+
+/* A child's last component, as Node_seekChildName seeks it */
+struct name
+{
+   /* the length of the parent's path plus its separator */
+   size_t ulSkip;
+   const char *pcName;
+   size_t ulLength;
+};
+
+/*
+  Compares the last component of oNFirst's path, which starts
+  psSecond->ulSkip characters in, with the name *psSecond, as strcmp
+  would if the name were a string of its own.
+*/
+static int Node_compareName(const Node_T oNFirst,
+                            const struct name *psSecond)
+{
+   const char *pcName;
+   int iCompare;
+
+   assert(oNFirst != NULL);
+   assert(psSecond != NULL);
+
+   pcName = Path_getPathname(oNFirst->oPPath) + psSecond->ulSkip;
+   iCompare = strncmp(pcName, psSecond->pcName, psSecond->ulLength);
+   if(iCompare != 0)
+      return iCompare;
+   return (pcName[psSecond->ulLength] == '\0') ? 0 : 1;
 }
 
 /*
@@ -79,7 +1164,7 @@ static int Node_compareString(const Node_T oNFirst, const char *pcSecond)
                  or oNParent is NULL but oPPath is not of depth 1
   * ALREADY_IN_TREE if oNParent already has a child with this path
 */
-int Node_new(boolean isDirec, Path_T oPPath, Node_T oNParent, Node_T *poNResult, void *pvContents, size_t ulLength)
+int Node_new(boolean isDirec, Path_T oPPath, Node_T oNParent, Node_T *poNResult, Content_T oCContents)
 {
    
    struct node *psNew;
@@ -88,6 +1173,7 @@ int Node_new(boolean isDirec, Path_T oPPath, Node_T oNParent, Node_T *poNResult,
    size_t ulParentDepth;
    size_t ulIndex;
    int iStatus;
+   int i;
    boolean isDir;
  
    assert(oPPath != NULL);
@@ -141,6 +1227,13 @@ int Node_new(boolean isDirec, Path_T oPPath, Node_T oNParent, Node_T *poNResult,
          *poNResult = NULL;
          return ALREADY_IN_TREE;
       }
+
+      /* Node_hasChild leaves the file children's insertion point in
+         ulIndex, so a directory needs its own insertion point */
+      if(isDirec)
+         (void) DynArray_bsearch(oNParent->oDDirChildren,
+                   (char*) Path_getPathname(oPPath), &ulIndex,
+                   (int (*)(const void*,const void*)) Node_compareString);
    }
    else {
       /* new node must be root */
@@ -164,116 +1257,158 @@ int Node_new(boolean isDirec, Path_T oPPath, Node_T oNParent, Node_T *poNResult,
          return MEMORY_ERROR;
       }
       psNew->isDir = isDirec;
-      
+
+   if(!(isDirec))
+      psNew->oCContent = oCContents;
+   else
+      psNew->oCContent = NULL;
+   psNew->ulSubtreeDirs = 0;
+   psNew->ulSubtreeFiles = 0;
+   psNew->ulMaxNodes = NODE_UNLIMITED;
+   psNew->ulMaxBytes = NODE_UNLIMITED;
+   psNew->ulSubtreeBytes = (psNew->oCContent == NULL) ? 0
+      : Content_getLength(psNew->oCContent);
+   /* ranked before it is linked, so that it goes to its place in its
+      parent's heaps */
+   for(i = 0; i < NODE_RANKING_COUNT; i++) {
+      psNew->aulRank[i] = 0;
+      psNew->aoDRanked[i] = NULL;
+   }
+   (void) Node_rankMaxima(psNew);
+
    /* Link into parent's children list */
    if(oNParent != NULL) {
       iStatus = Node_addChild(oNParent, psNew, ulIndex, psNew->isDir);
       if(iStatus != SUCCESS) {
+         DynArray_free(psNew->oDDirChildren);
+         DynArray_free(psNew->oDFileChildren);
          Path_free(psNew->oPPath);
          free(psNew);
          *poNResult = NULL;
          return iStatus;
       }
    }
-   
 
-   if(!(isDirec)) {
-      psNew->fileContent = pvContents;
-      psNew->fileSize = ulLength;
-   }
-   else {
-      psNew->fileContent = NULL;
-      psNew->fileSize = 0;
-   }
-   psNew->isDir = isDirec;
+   Node_accountSubtree(psNew, TRUE);
+   Node_addKeys(psNew);
+   Node_track(psNew);
+   Node_addSize(psNew);
 
    *poNResult = psNew;
    
    return SUCCESS;
 }
 
-size_t Node_free(Node_T oNNode)
+void Node_unlink(Node_T oNNode)
 {
-   
    size_t ulIndex;
-   size_t ulCount = 0;
-   
+
    assert(oNNode != NULL);
-   
-   /* remove from parent's list */
+
+   /* a detached subtree is not found through the indexes */
+   Node_keySubtree(oNNode, FALSE, NODE_INDEX_COUNT);
+   Node_trackSubtree(oNNode, FALSE);
+
+   /* remove from parent's list (a detached node's path may since
+      have been reused by another child, so match on identity) */
    if(oNNode->oNParent != NULL) {
       if(oNNode->oNParent->oDDirChildren != NULL &&
          DynArray_bsearch(
             oNNode->oNParent->oDDirChildren,
             oNNode, &ulIndex,
-            (int (*)(const void *, const void *)) Node_compare)
-         )
-         (void) DynArray_removeAt(oNNode->oNParent->oDDirChildren,
-                                  ulIndex);
+            (int (*)(const void *, const void *)) Node_compare) &&
+         DynArray_get(oNNode->oNParent->oDDirChildren, ulIndex) == oNNode) {
+         Node_removeChild(oNNode->oNParent,
+                          oNNode->oNParent->oDDirChildren, ulIndex,
+                          oNNode);
+         Node_accountSubtree(oNNode, FALSE);
+      }
       
       if(oNNode->oNParent->oDFileChildren != NULL &&
          DynArray_bsearch(
             oNNode->oNParent->oDFileChildren,
             oNNode, &ulIndex,
-            (int (*)(const void *, const void *)) Node_compare))
-         (void) DynArray_removeAt(oNNode->oNParent->oDFileChildren,
-                                  ulIndex);
+            (int (*)(const void *, const void *)) Node_compare) &&
+         DynArray_get(oNNode->oNParent->oDFileChildren, ulIndex) == oNNode) {
+         Node_removeChild(oNNode->oNParent,
+                          oNNode->oNParent->oDFileChildren, ulIndex,
+                          oNNode);
+         Node_accountSubtree(oNNode, FALSE);
+      }
    }
+}
 
+int Node_relink(Node_T oNNode)
+{
+   DynArray_T oDSiblings;
+   size_t ulIndex;
 
-         /* recursively remove children */
-         while(DynArray_getLength(oNNode->oDDirChildren) != 0) {
-            ulCount += Node_free(DynArray_get(oNNode->oDDirChildren, 0));
-         }
-         
-         DynArray_free(oNNode->oDDirChildren);
-         oNNode->oDDirChildren = NULL;
-         
-         while(DynArray_getLength(oNNode->oDFileChildren) != 0){ 
-            
-            ulCount += Node_free(DynArray_get(oNNode->oDFileChildren, 0));
-         }
-            
-         DynArray_free(oNNode->oDFileChildren);
-         oNNode->oDFileChildren = NULL;
- 
+   assert(oNNode != NULL);
 
-    
-      /* remove path */
-      Path_free(oNNode->oPPath);
+   if(oNNode->oNParent != NULL) {
+      if(oNNode->isDir)
+         oDSiblings = oNNode->oNParent->oDDirChildren;
+      else
+         oDSiblings = oNNode->oNParent->oDFileChildren;
+
+      if(!DynArray_bsearch(oDSiblings, oNNode, &ulIndex,
+               (int (*)(const void *, const void *)) Node_compare)) {
+         if(Node_addChild(oNNode->oNParent, oNNode, ulIndex,
+                          oNNode->isDir) != SUCCESS)
+            return MEMORY_ERROR;
+         Node_accountSubtree(oNNode, TRUE);
+      }
+      else
+         assert(DynArray_get(oDSiblings, ulIndex) == oNNode);
+   }
 
-      /* finally, free the struct node */
-      free(oNNode);
-      ulCount++;
-      return ulCount;
- 
+   Node_keySubtree(oNNode, TRUE, NODE_INDEX_COUNT);
+   Node_trackSubtree(oNNode, TRUE);
+   return SUCCESS;
+}
+
+size_t Node_free(Node_T oNNode)
+{
+   
+   assert(oNNode != NULL);
+   
+   Node_unlink(oNNode);
+
+   /* once detached, the subtree's nodes need no unlinking, and
+      unlinking them would take them off their old ancestors' totals
+      twice */
+   return Node_destroyFree(oNNode);
 }
 
 size_t Node_destroyFree(Node_T oNNode) {
 
-   size_t ulCount;
-   Node_T child;
+   size_t ulCount = 0;
+   Node_T child = NULL;
    size_t i;
    
    assert(oNNode != NULL);
 
+   /* the whole tree is going, so no child needs unlinking */
    for(i=0;i < DynArray_getLength(oNNode->oDDirChildren); i++) {
-  
       (void) Node_getChild(TRUE, oNNode, i, &child);
-      ulCount += Node_free(child);
+      ulCount += Node_destroyFree(child);
    }
-
    DynArray_free(oNNode->oDDirChildren);
 
    for(i=0;i < DynArray_getLength(oNNode->oDFileChildren); i++) {
- 
       (void) Node_getChild(FALSE, oNNode, i, &child);
-      free(child);
-      ulCount++;
+      ulCount += Node_destroyFree(child);
    }
-
    DynArray_free(oNNode->oDFileChildren);
-
+   for(i = 0; i < NODE_RANKING_COUNT; i++)
+      if(oNNode->aoDRanked[i] != NULL)
+         DynArray_free(oNNode->aoDRanked[i]);
+
+   Node_removeKeys(oNNode);
+   Node_untrack(oNNode);
+   Node_removeSize(oNNode);
+   Path_free(oNNode->oPPath);
+   Content_release(oNNode->oCContent);
    free(oNNode);
    ulCount++;
 
@@ -363,6 +1498,60 @@ int  Node_getChild(boolean childIsDir, Node_T oNParent, size_t ulChildID, Node_T
       }
 }
 
+Node_T Node_findChild(Node_T oNParent, const char *pcPath,
+                      size_t ulLength)
+{
+   struct prefix sSought;
+   size_t ulIndex;
+
+   assert(oNParent != NULL);
+   assert(pcPath != NULL);
+
+   sSought.pcPath = pcPath;
+   sSought.ulLength = ulLength;
+   if(DynArray_bsearch(oNParent->oDDirChildren, &sSought, &ulIndex,
+         (int (*)(const void *, const void *)) Node_comparePrefix))
+      return DynArray_get(oNParent->oDDirChildren, ulIndex);
+   if(DynArray_bsearch(oNParent->oDFileChildren, &sSought, &ulIndex,
+         (int (*)(const void *, const void *)) Node_comparePrefix))
+      return DynArray_get(oNParent->oDFileChildren, ulIndex);
+   return NULL;
+}
+
+size_t Node_findChildAfter(Node_T oNParent, boolean bIsDir,
+                           const char *pcPath)
+{
+   size_t ulIndex;
+
+   assert(oNParent != NULL);
+   assert(pcPath != NULL);
+
+   if(DynArray_bsearch(bIsDir ? oNParent->oDDirChildren :
+                       oNParent->oDFileChildren, (char *) pcPath,
+                       &ulIndex,
+         (int (*)(const void *, const void *)) Node_compareString))
+      ulIndex++;
+   return ulIndex;
+}
+
+size_t Node_seekChildName(Node_T oNParent, boolean bIsDir,
+                          const char *pcName, size_t ulLength)
+{
+   struct name sSought;
+   size_t ulIndex;
+
+   assert(oNParent != NULL);
+   assert(pcName != NULL);
+
+   sSought.ulSkip = Path_getStrLength(oNParent->oPPath) + 1;
+   sSought.pcName = pcName;
+   sSought.ulLength = ulLength;
+   (void) DynArray_bsearch(bIsDir ? oNParent->oDDirChildren :
+                           oNParent->oDFileChildren, &sSought, &ulIndex,
+         (int (*)(const void *, const void *)) Node_compareName);
+   return ulIndex;
+}
+
 Node_T Node_getParent(Node_T oNNode)
 {
    assert(oNNode != NULL);
@@ -388,7 +1577,9 @@ void *Node_getFileContents(Node_T oNNode)
 
    assert(oNNode != NULL);
 
-   return oNNode->fileContent;
+   if(oNNode->oCContent == NULL)
+      return NULL;
+   return Content_getData(oNNode->oCContent);
 }
 
 size_t Node_getFileSize(Node_T oNNode)
@@ -396,24 +1587,144 @@ size_t Node_getFileSize(Node_T oNNode)
 
    assert(oNNode != NULL);
 
-   return oNNode->fileSize;
+   if(oNNode->oCContent == NULL)
+      return 0;
+   return Content_getLength(oNNode->oCContent);
+}
+
+Content_T Node_getContents(Node_T oNNode)
+{
+
+   assert(oNNode != NULL);
+
+   return oNNode->oCContent;
 }
 
-void *Node_replaceFileContents(Node_T oNNode, void *pvNewContents, size_t ulNewLength)
+Content_T Node_replaceContents(Node_T oNNode, Content_T oCNewContents)
 {
-   void *oldContents;
+   Content_T oCOldContents;
    
    assert(oNNode != NULL);
 
-   /*  oldContents = oNNode->fileContent;
-   contents=realloc(oNNode->fileContent, ulNewLength);
-   contents = pvNewContents;
-   oNNode->fileContent = contents;
-   oNNode->fileSize = ulNewLength; */
-   oldContents = oNNode->fileContent;
-   oNNode->fileContent = pvNewContents;
-   oNNode->fileSize = ulNewLength;
-   return oldContents;
+   oCOldContents = oNNode->oCContent;
+   oNNode->oCContent = oCNewContents;
+   Node_updateSize(oNNode);
+   return oCOldContents;
+}
+
+void Node_updateSize(Node_T oNNode)
+{
+   size_t ulSize;
+   boolean bMoved;
+
+   assert(oNNode != NULL);
+
+   if(oNNode->isDir)
+      return;
+
+   ulSize = Node_getFileSize(oNNode);
+
+   /* a file that changes length moves to its new place in the size
+      index, keeping its links there */
+   bMoved = (boolean) (ulSize != oNNode->ulSubtreeBytes &&
+                       Node_isSized(oNNode));
+   if(bMoved)
+      Node_extractSize(oNNode);
+   if(ulSize >= oNNode->ulSubtreeBytes)
+      Node_adjustTotals(oNNode, 0, 0, ulSize - oNNode->ulSubtreeBytes,
+                        TRUE);
+   else
+      Node_adjustTotals(oNNode, 0, 0, oNNode->ulSubtreeBytes - ulSize,
+                        FALSE);
+   if(bMoved)
+      Node_insertSize(oNNode);
+
+   Node_propagateMaxima(oNNode);
+
+   if(Node_isTracked(oNNode))
+      Node_markStale(oNNode);
+}
+
+boolean Node_withinQuotas(Node_T oNNode, size_t ulNodes,
+                         size_t ulBytes)
+{
+   size_t ulUsed;
+
+   for(; oNNode != NULL; oNNode = oNNode->oNParent) {
+      ulUsed = oNNode->ulSubtreeDirs + oNNode->ulSubtreeFiles;
+      if(ulNodes != 0 && (ulUsed > oNNode->ulMaxNodes ||
+                          ulNodes > oNNode->ulMaxNodes - ulUsed))
+         return FALSE;
+      ulUsed = oNNode->ulSubtreeBytes;
+      if(ulBytes != 0 && (ulUsed > oNNode->ulMaxBytes ||
+                          ulBytes > oNNode->ulMaxBytes - ulUsed))
+         return FALSE;
+   }
+   return TRUE;
+}
+
+void Node_setQuota(Node_T oNNode, size_t ulMaxNodes, size_t ulMaxBytes)
+{
+   assert(oNNode != NULL);
+
+   oNNode->ulMaxNodes = ulMaxNodes;
+   oNNode->ulMaxBytes = ulMaxBytes;
+}
+
+void Node_getQuota(Node_T oNNode, size_t *pulMaxNodes,
+                   size_t *pulMaxBytes)
+{
+   assert(oNNode != NULL);
+   assert(pulMaxNodes != NULL);
+   assert(pulMaxBytes != NULL);
+
+   *pulMaxNodes = oNNode->ulMaxNodes;
+   *pulMaxBytes = oNNode->ulMaxBytes;
+}
+
+boolean Node_getBest(Node_T oNNode, enum Node_Ranking eRanking,
+                     size_t *pulBest)
+{
+   assert(oNNode != NULL);
+   assert(eRanking < NODE_RANKING_COUNT);
+   assert(pulBest != NULL);
+
+   if(oNNode->aulRank[eRanking] == 0)
+      return FALSE;
+   *pulBest = oNNode->aulRank[eRanking] - 1;
+   return TRUE;
+}
+
+size_t Node_getNumRanked(Node_T oNParent, enum Node_Ranking eRanking)
+{
+   assert(oNParent != NULL);
+   assert(eRanking < NODE_RANKING_COUNT);
+
+   if(oNParent->aoDRanked[eRanking] == NULL)
+      return 0;
+   return DynArray_getLength(oNParent->aoDRanked[eRanking]);
+}
+
+Node_T Node_getRanked(Node_T oNParent, enum Node_Ranking eRanking,
+                      size_t ulSlot)
+{
+   assert(oNParent != NULL);
+   assert(ulSlot < Node_getNumRanked(oNParent, eRanking));
+
+   return DynArray_get(oNParent->aoDRanked[eRanking], ulSlot);
+}
+
+void Node_getTotals(Node_T oNNode, size_t *pulDirs, size_t *pulFiles,
+                    size_t *pulBytes)
+{
+   assert(oNNode != NULL);
+   assert(pulDirs != NULL);
+   assert(pulFiles != NULL);
+   assert(pulBytes != NULL);
+
+   *pulDirs = oNNode->ulSubtreeDirs;
+   *pulFiles = oNNode->ulSubtreeFiles;
+   *pulBytes = oNNode->ulSubtreeBytes;
 }
 
 boolean Node_isDir(Node_T oNNode)
@@ -425,9 +1736,24 @@ boolean Node_isDir(Node_T oNNode)
 
 void Node_setDir(Node_T oNNode, boolean isDirec)
 {
-
    assert(oNNode != NULL);
+
+   /* whether a node has an extension depends on what it is */
+   Node_removeKey(NODE_EXTENSION_INDEX, oNNode);
    oNNode->isDir = isDirec;
+   Node_fileKey(NODE_EXTENSION_INDEX, oNNode);
+
+   /* only files are tracked in the content and size indexes */
+   if(isDirec) {
+      Node_untrack(oNNode);
+      Node_removeSize(oNNode);
+   }
+   else {
+      Node_track(oNNode);
+      Node_addSize(oNNode);
+   }
+
+   Node_propagateMaxima(oNNode);
 }
 
 char *Node_toString(Node_T oNNode)
@@ -442,3 +1768,294 @@ char *Node_toString(Node_T oNNode)
    else
       return strcpy(copyPath, Path_getPathname(Node_getPath(oNNode)));
 }
+
+int Node_setIndex(enum Node_Index eIndex, boolean bEnable,
+                  Node_T oNRoot)
+{
+   struct keyIndex *psIndex = &asIndexes[eIndex];
+
+   assert(eIndex < NODE_INDEX_COUNT);
+
+   if(!bEnable) {
+      free(psIndex->poNBuckets);
+      PtrTable_free(psIndex->oTLinks);
+      psIndex->poNBuckets = NULL;
+      psIndex->oTLinks = NULL;
+      psIndex->ulBucketCount = 0;
+      psIndex->ulGroups = 0;
+      return SUCCESS;
+   }
+
+   if(psIndex->poNBuckets != NULL)
+      return SUCCESS;
+   psIndex->poNBuckets = calloc(MIN_KEY_BUCKET_COUNT, sizeof(Node_T));
+   psIndex->oTLinks = PtrTable_new(sizeof(struct keyLinks));
+   if(psIndex->poNBuckets == NULL || psIndex->oTLinks == NULL) {
+      (void) Node_setIndex(eIndex, FALSE, NULL);
+      return MEMORY_ERROR;
+   }
+   psIndex->ulBucketCount = MIN_KEY_BUCKET_COUNT;
+
+   /* filing a node for which there is no memory turns the index off */
+   if(oNRoot != NULL)
+      Node_keySubtree(oNRoot, TRUE, eIndex);
+   return (psIndex->poNBuckets != NULL) ? SUCCESS : MEMORY_ERROR;
+}
+
+boolean Node_hasIndex(enum Node_Index eIndex)
+{
+   assert(eIndex < NODE_INDEX_COUNT);
+
+   return (boolean) (asIndexes[eIndex].poNBuckets != NULL);
+}
+
+Node_T Node_findKeyed(enum Node_Index eIndex, const char *pcKey)
+{
+   struct keyIndex *psIndex = &asIndexes[eIndex];
+   Node_T oNGroup;
+   unsigned long ulHash;
+
+   assert(eIndex < NODE_INDEX_COUNT);
+   assert(pcKey != NULL);
+   assert(psIndex->poNBuckets != NULL);
+
+   ulHash = Node_hashKey(pcKey);
+   for(oNGroup = psIndex->poNBuckets[ulHash % psIndex->ulBucketCount];
+       oNGroup != NULL;
+       oNGroup = Node_getKeyLinks(eIndex, oNGroup)->oNNextGroup)
+      if(Node_getKeyLinks(eIndex, oNGroup)->ulHash == ulHash &&
+         strcmp(Node_getKey(eIndex, oNGroup), pcKey) == 0)
+         return oNGroup;
+   return NULL;
+}
+
+Node_T Node_getNextKeyed(enum Node_Index eIndex, Node_T oNNode)
+{
+   assert(eIndex < NODE_INDEX_COUNT);
+   assert(oNNode != NULL);
+   assert(Node_isKeyed(eIndex, oNNode));
+
+   return Node_getKeyLinks(eIndex, oNNode)->oNNextSame;
+}
+
+void Node_getIndexStats(enum Node_Index eIndex, size_t *pulKeys,
+                        size_t *pulNodes, size_t *pulBytes)
+{
+   struct keyIndex *psIndex = &asIndexes[eIndex];
+
+   assert(eIndex < NODE_INDEX_COUNT);
+   assert(pulKeys != NULL);
+   assert(pulNodes != NULL);
+   assert(pulBytes != NULL);
+
+   *pulKeys = psIndex->ulGroups;
+   *pulNodes = 0;
+   *pulBytes = psIndex->ulBucketCount * sizeof(Node_T);
+   if(psIndex->oTLinks != NULL) {
+      *pulNodes = PtrTable_getLength(psIndex->oTLinks);
+      *pulBytes += PtrTable_getBytes(psIndex->oTLinks);
+   }
+}
+
+int Node_setContentIndex(boolean bEnable, Node_T oNRoot)
+{
+   if(!bEnable) {
+      Trigram_reset();
+      PtrTable_free(oTContentLinks);
+      oTContentLinks = NULL;
+      oNStaleHead = NULL;
+      oNUnindexedHead = NULL;
+      return SUCCESS;
+   }
+
+   if(oTContentLinks != NULL)
+      return SUCCESS;
+   oTContentLinks = PtrTable_new(sizeof(struct contentLinks));
+   if(oTContentLinks == NULL)
+      return MEMORY_ERROR;
+
+   /* tracking a file for which there is no memory turns the index
+      off */
+   if(oNRoot != NULL)
+      Node_trackSubtree(oNRoot, TRUE);
+   return (oTContentLinks != NULL) ? SUCCESS : MEMORY_ERROR;
+}
+
+boolean Node_hasContentIndex(void)
+{
+   return (boolean) (oTContentLinks != NULL);
+}
+
+/* The visitor a content query reports each candidate file to */
+struct contentQuery
+{
+   boolean (*pfVisit)(Node_T oNNode, void *pvExtra);
+   void *pvExtra;
+};
+
+/*
+  Passes the file pvOwner on to the visitor of the contentQuery
+  pvQuery, for Trigram_query.
+*/
+static boolean Node_visitCandidate(void *pvOwner, void *pvQuery)
+{
+   struct contentQuery *psQuery = pvQuery;
+
+   assert(pvOwner != NULL);
+   assert(psQuery != NULL);
+
+   return (*psQuery->pfVisit)((Node_T) pvOwner, psQuery->pvExtra);
+}
+
+/*
+  Indexes the contents of the tracked file oNNode by trigram, storing
+  its slot. Returns SUCCESS, or MEMORY_ERROR or IO_ERROR if its
+  contents could not be read or indexed.
+*/
+static int Node_indexContents(Node_T oNNode)
+{
+   void *pvData;
+   size_t ulLength;
+   int iStatus;
+
+   assert(Node_isTracked(oNNode));
+
+   ulLength = Node_getFileSize(oNNode);
+   /* a caller's NULL has no bytes to index */
+   iStatus = Content_fetch(oNNode->oCContent, &pvData);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   if(pvData == NULL)
+      ulLength = 0;
+   return Trigram_add(oNNode, pvData, ulLength,
+                      &Node_getContentLinks(oNNode)->ulSlot);
+}
+
+int Node_queryContents(const char *pcPattern,
+                       boolean (*pfVisit)(Node_T oNNode, void *pvExtra),
+                       void *pvExtra)
+{
+   struct contentQuery sQuery;
+   struct contentLinks *psLinks;
+   Node_T oNCurr;
+   Node_T oNNext;
+
+   assert(pcPattern != NULL);
+   assert(pfVisit != NULL);
+   assert(oTContentLinks != NULL);
+
+   /* retry what could not be indexed before, then index what has
+      changed since the last query; what still cannot be is left a
+      candidate for every query */
+   for(oNCurr = oNUnindexedHead; oNCurr != NULL; oNCurr = oNNext) {
+      oNNext = Node_getContentLinks(oNCurr)->oNNextStale;
+      if(Node_indexContents(oNCurr) == SUCCESS) {
+         Node_unlinkTracked(&oNUnindexedHead, oNCurr);
+         Node_getContentLinks(oNCurr)->bUnindexed = FALSE;
+      }
+   }
+   while(oNStaleHead != NULL) {
+      oNCurr = oNStaleHead;
+      Node_unlinkTracked(&oNStaleHead, oNCurr);
+      Node_getContentLinks(oNCurr)->bStale = FALSE;
+      if(Node_indexContents(oNCurr) != SUCCESS) {
+         Node_getContentLinks(oNCurr)->bUnindexed = TRUE;
+         Node_linkTracked(&oNUnindexedHead, oNCurr);
+      }
+   }
+
+   for(oNCurr = oNUnindexedHead; oNCurr != NULL;
+       oNCurr = psLinks->oNNextStale) {
+      psLinks = Node_getContentLinks(oNCurr);
+      if(!(*pfVisit)(oNCurr, pvExtra))
+         return SUCCESS;
+   }
+
+   sQuery.pfVisit = pfVisit;
+   sQuery.pvExtra = pvExtra;
+   return Trigram_query(pcPattern, Node_visitCandidate, &sQuery);
+}
+
+void Node_getContentIndexStats(size_t *pulTrigrams,
+                               size_t *pulPostings, size_t *pulBytes)
+{
+   size_t ulStrings;
+
+   assert(pulTrigrams != NULL);
+   assert(pulPostings != NULL);
+   assert(pulBytes != NULL);
+
+   Trigram_getStats(pulTrigrams, pulPostings, &ulStrings, pulBytes);
+   if(oTContentLinks != NULL)
+      *pulBytes += PtrTable_getBytes(oTContentLinks);
+}
+
+int Node_setSizeIndex(boolean bEnable, Node_T oNRoot)
+{
+   if(!bEnable) {
+      PtrTable_free(oTSizeLinks);
+      oTSizeLinks = NULL;
+      oNSizeRoot = NULL;
+      ulSizeKeys = 0;
+      return SUCCESS;
+   }
+
+   if(oTSizeLinks != NULL)
+      return SUCCESS;
+   oTSizeLinks = PtrTable_new(sizeof(struct sizeLinks));
+   if(oTSizeLinks == NULL)
+      return MEMORY_ERROR;
+
+   /* indexing a file for which there is no memory turns the index
+      off */
+   if(oNRoot != NULL)
+      Node_trackSubtree(oNRoot, TRUE);
+   return (oTSizeLinks != NULL) ? SUCCESS : MEMORY_ERROR;
+}
+
+boolean Node_hasSizeIndex(void)
+{
+   return (boolean) (oTSizeLinks != NULL);
+}
+
+Node_T Node_findSizeAtLeast(size_t ulSize)
+{
+   Node_T oNCurr;
+   Node_T oNFound = NULL;
+
+   assert(oTSizeLinks != NULL);
+
+   for(oNCurr = oNSizeRoot; oNCurr != NULL; ) {
+      if(oNCurr->ulSubtreeBytes >= ulSize) {
+         oNFound = oNCurr;
+         oNCurr = Node_getSizeLinks(oNCurr)->oNLeft;
+      }
+      else
+         oNCurr = Node_getSizeLinks(oNCurr)->oNRight;
+   }
+   return oNFound;
+}
+
+Node_T Node_getNextBySize(Node_T oNNode)
+{
+   assert(oNNode != NULL);
+   assert(Node_isSized(oNNode));
+
+   return Node_stepSize(oNNode, FALSE);
+}
+
+void Node_getSizeIndexStats(size_t *pulSizes, size_t *pulFiles,
+                            size_t *pulBytes)
+{
+   assert(pulSizes != NULL);
+   assert(pulFiles != NULL);
+   assert(pulBytes != NULL);
+
+   *pulSizes = ulSizeKeys;
+   *pulFiles = 0;
+   *pulBytes = 0;
+   if(oTSizeLinks != NULL) {
+      *pulFiles = PtrTable_getLength(oTSizeLinks);
+      *pulBytes = PtrTable_getBytes(oTSizeLinks);
+   }
+}
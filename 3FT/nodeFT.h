@@ -0,0 +1,369 @@
+/*--------------------------------------------------------------------*/
+/* nodeFT.h                                                           */
+/* Author: Christopher Moretti                                        */
+/*--------------------------------------------------------------------*/
+
+#ifndef NODE_INCLUDED
+#define NODE_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "path.h"
+#include "content.h"
+
+
+/* A Node_T is a node in a File Tree */
+typedef struct node *Node_T;
+
+/* The quota of a node that has no limit */
+#define NODE_UNLIMITED ((size_t) -1)
+
+/* The secondary indexes that find nodes by a key */
+enum Node_Index
+{
+   /* by the last component of a node's path */
+   NODE_NAME_INDEX,
+   /* by the extension of a file's last component */
+   NODE_EXTENSION_INDEX,
+   NODE_INDEX_COUNT
+};
+
+/* The rankings each directory keeps its children in order by */
+enum Node_Ranking
+{
+   /* by the length of the largest file in each child's subtree */
+   NODE_RANK_FILE_SIZE,
+   /* by the most children any directory in each child's subtree has */
+   NODE_RANK_ENTRIES,
+   NODE_RANKING_COUNT
+};
+
+/*
+  Creates a new node in the File Tree, with path oPPath and parent
+  oNParent. The node is a directory if isDirec is TRUE, and otherwise
+  a file with contents oCContents (which may be NULL), taking over the
+  caller's reference to them if successful. Returns an
+  int SUCCESS status and sets *poNResult to be the new node if
+  successful. Otherwise, sets *poNResult to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  * CONFLICTING_PATH if oNParent's path is not an ancestor of oPPath
+  * NO_SUCH_PATH if oPPath is of depth 0
+                 or oNParent's path is not oPPath's direct parent
+                 or oNParent is NULL but oPPath is not of depth 1
+  * ALREADY_IN_TREE if oNParent already has a child with this path
+*/
+int Node_new(boolean isDirec, Path_T oPPath, Node_T oNParent,
+             Node_T *poNResult, Content_T oCContents);
+
+/*
+  Destroys and frees all memory allocated for the subtree rooted at
+  oNNode, i.e., deletes this node and all its descendents, releasing
+  their contents. Returns the number of nodes deleted.
+*/
+size_t Node_free(Node_T oNNode);
+
+/*
+  Destroys and frees all memory allocated for the subtree rooted at
+  oNNode without unlinking it from its parent. Used when tearing down
+  the whole tree. Returns the number of nodes deleted.
+*/
+size_t Node_destroyFree(Node_T oNNode);
+
+/*
+  Unlinks oNNode from its parent's children arrays without freeing
+  the subtree rooted at it, so that it may later be restored with
+  Node_relink or discarded with Node_free.
+*/
+void Node_unlink(Node_T oNNode);
+
+/*
+  Links oNNode, previously detached with Node_unlink, back into its
+  parent's children arrays. Returns SUCCESS, or MEMORY_ERROR if the
+  parent's children array or rankings could not grow to hold it.
+*/
+int Node_relink(Node_T oNNode);
+
+/* Returns the path object representing oNNode's absolute path. */
+Path_T Node_getPath(Node_T oNNode);
+
+/*
+  Returns TRUE if oNParent has a child with path oPPath. Returns
+  FALSE if it does not.
+
+  If oNParent has such a child, stores in *pulChildID the child's
+  identifier (as used in Node_getChild) and in *isDir whether the
+  child is a directory. If oNParent does not have such a child,
+  stores in *pulChildID the identifier that such a child _would_
+  have if inserted as a file.
+*/
+boolean Node_hasChild(Node_T oNParent, Path_T oPPath,
+                      size_t *pulChildID, boolean *isDir);
+
+/* Returns the number of directory children that oNParent has. */
+size_t Node_getNumDirChildren(Node_T oNParent);
+
+/* Returns the number of file children that oNParent has. */
+size_t Node_getNumFileChildren(Node_T oNParent);
+
+/* Returns the number of children that oNParent has. */
+size_t Node_getNumChildren(Node_T oNParent);
+
+/*
+  Returns an int SUCCESS status and sets *poNResult to be the
+  directory child (if childIsDir) or file child (otherwise) of
+  oNParent with identifier ulChildID, if one exists.
+  Otherwise, sets *poNResult to NULL and returns status:
+  * NO_SUCH_PATH if ulChildID is not a valid child for oNParent
+*/
+int Node_getChild(boolean childIsDir, Node_T oNParent,
+                  size_t ulChildID, Node_T *poNResult);
+
+/*
+  Returns the child of oNParent whose path is the first ulLength
+  characters of pcPath, or NULL if it has none. Unlike
+  Node_hasChild, this needs no Path_T, so callers can look paths up
+  without allocating.
+*/
+Node_T Node_findChild(Node_T oNParent, const char *pcPath,
+                      size_t ulLength);
+
+/*
+  Returns the identifier (as used in Node_getChild) of the first
+  directory child (if bIsDir) or file child (otherwise) of oNParent
+  whose path sorts after pcPath, or the number of such children if
+  none does. pcPath need not be the path of a child.
+*/
+size_t Node_findChildAfter(Node_T oNParent, boolean bIsDir,
+                           const char *pcPath);
+
+/*
+  Returns the identifier (as used in Node_getChild) of the first
+  directory child (if bIsDir) or file child (otherwise) of oNParent
+  whose last path component does not sort before the first ulLength
+  characters of pcName, or the number of such children if there is
+  none. Children whose names begin with those characters follow it.
+*/
+size_t Node_seekChildName(Node_T oNParent, boolean bIsDir,
+                          const char *pcName, size_t ulLength);
+
+/*
+  Returns a the parent node of oNNode.
+  Returns NULL if oNNode is the root and thus has no parent.
+*/
+Node_T Node_getParent(Node_T oNNode);
+
+/*
+  Compares oNFirst and oNSecond lexicographically based on their paths.
+  Returns <0, 0, or >0 if onFirst is "less than", "equal to", or
+  "greater than" oNSecond, respectively.
+*/
+int Node_compare(Node_T oNFirst, Node_T oNSecond);
+
+/* Returns the contents of the file oNNode. */
+void *Node_getFileContents(Node_T oNNode);
+
+/* Returns the length in bytes of the contents of the file oNNode. */
+size_t Node_getFileSize(Node_T oNNode);
+
+/* Returns the Content_T holding the contents of the file oNNode. */
+Content_T Node_getContents(Node_T oNNode);
+
+/*
+  Replaces the contents of the file oNNode with oCNewContents, taking
+  over the caller's reference to them. Returns the old contents along
+  with the reference oNNode held to them.
+*/
+Content_T Node_replaceContents(Node_T oNNode, Content_T oCNewContents);
+
+/*
+  Brings the totals of oNNode and its ancestors up to date with the
+  length of oNNode's contents, after they were changed in place.
+  Does nothing if oNNode is a directory.
+*/
+void Node_updateSize(Node_T oNNode);
+
+/*
+  Stores in *pulBest the best value under eRanking in the subtree
+  rooted at oNNode, itself included: the length of the largest file's
+  contents, or the most children any directory has. Returns TRUE, or
+  FALSE if nothing in the subtree ranks, in which case *pulBest is
+  left alone. Like the totals, the best values are kept up to date as
+  nodes change, each change costing time proportional to the
+  logarithm of the number of children of each directory above it, so
+  this takes constant time.
+*/
+boolean Node_getBest(Node_T oNNode, enum Node_Ranking eRanking,
+                     size_t *pulBest);
+
+/*
+  Returns the number of children oNParent ranks under eRanking, which
+  is either all of them or, before it has had any, 0.
+*/
+size_t Node_getNumRanked(Node_T oNParent, enum Node_Ranking eRanking);
+
+/*
+  Returns the child of oNParent in slot ulSlot of its ranking under
+  eRanking, a binary max-heap: the best value in the subtree of the
+  child in slot s is no lower than those of the children in slots
+  2s+1 and 2s+2, so that slot 0 holds the child whose subtree holds
+  the best value beneath oNParent. The slots change as the FT does.
+*/
+Node_T Node_getRanked(Node_T oNParent, enum Node_Ranking eRanking,
+                      size_t ulSlot);
+
+/*
+  Stores in *pulDirs and *pulFiles the numbers of directories and
+  files beneath oNNode, and in *pulBytes the bytes of the contents of
+  those files, or of oNNode's own if it is a file. The totals are
+  kept up to date as nodes are linked, unlinked, and resized, so this
+  takes constant time.
+*/
+void Node_getTotals(Node_T oNNode, size_t *pulDirs, size_t *pulFiles,
+                    size_t *pulBytes);
+
+/*
+  Returns TRUE if ulNodes more nodes and ulBytes more bytes of
+  contents beneath oNNode would keep oNNode and each of its ancestors
+  within their quotas, and FALSE if not. Adding nothing always fits,
+  even beneath a node already over its quota.
+*/
+boolean Node_withinQuotas(Node_T oNNode, size_t ulNodes,
+                         size_t ulBytes);
+
+/*
+  Limits the nodes beneath oNNode to ulMaxNodes and the bytes of their
+  contents to ulMaxBytes, either of which may be NODE_UNLIMITED.
+*/
+void Node_setQuota(Node_T oNNode, size_t ulMaxNodes, size_t ulMaxBytes);
+
+/*
+  Stores in *pulMaxNodes and *pulMaxBytes the quotas of oNNode, each
+  NODE_UNLIMITED if it has none.
+*/
+void Node_getQuota(Node_T oNNode, size_t *pulMaxNodes,
+                   size_t *pulMaxBytes);
+
+/* Returns TRUE if oNNode is a directory, FALSE if it is a file. */
+boolean Node_isDir(Node_T oNNode);
+
+/* Sets whether oNNode is a directory (TRUE) or a file (FALSE). */
+void Node_setDir(Node_T oNNode, boolean isDirec);
+
+/*
+  Turns the secondary index eIndex on (if bEnable) or off. Turning it
+  on indexes the tree rooted at oNRoot (which may be NULL); from then
+  on nodes are indexed as they are created or relinked and leave it as
+  they are unlinked or freed. The index keeps its links for the nodes
+  it files in a side table, so that it costs nothing per node while
+  it is off; if there is no memory to file a node as the tree
+  changes, it turns itself off. Returns SUCCESS, or MEMORY_ERROR if it
+  could not be turned on, in which case it stays off.
+*/
+int Node_setIndex(enum Node_Index eIndex, boolean bEnable,
+                  Node_T oNRoot);
+
+/* Returns TRUE if the secondary index eIndex is on. */
+boolean Node_hasIndex(enum Node_Index eIndex);
+
+/*
+  Returns the first node that eIndex, which must be on, files under
+  the key pcKey, or NULL if there is none.
+*/
+Node_T Node_findKeyed(enum Node_Index eIndex, const char *pcKey);
+
+/*
+  Returns the node after oNNode that eIndex files under the same key,
+  or NULL if there is none.
+*/
+Node_T Node_getNextKeyed(enum Node_Index eIndex, Node_T oNNode);
+
+/*
+  Stores in *pulKeys and *pulNodes the numbers of distinct keys and of
+  nodes in eIndex, and in *pulBytes the bytes its buckets and the
+  links of the nodes it files occupy.
+*/
+void Node_getIndexStats(enum Node_Index eIndex, size_t *pulKeys,
+                        size_t *pulNodes, size_t *pulBytes);
+
+/*
+  Turns the content index on (if bEnable) or off. While it is on,
+  every file is tracked so that Node_queryContents can find those
+  whose contents might match a pattern; contents that have changed
+  are indexed again at the next query. Turning it on tracks every file
+  beneath oNRoot (which may be NULL). Like a secondary index, it keeps
+  what it tracks in a side table, and turns itself off if there is no
+  memory to track a file. Returns SUCCESS, or MEMORY_ERROR if it could
+  not be turned on, in which case it stays off.
+*/
+int Node_setContentIndex(boolean bEnable, Node_T oNRoot);
+
+/* Returns TRUE if the content index is on. */
+boolean Node_hasContentIndex(void);
+
+/*
+  Indexes the contents of any file that has changed since the last
+  query, then calls (*pfVisit)(oNNode, pvExtra) for each file whose
+  contents hold every trigram a match of the Trigram_query pattern
+  pcPattern must, and each whose contents could not be indexed, until
+  it returns FALSE. The content index must be on. Returns SUCCESS, or
+  MEMORY_ERROR if the pattern could not be read.
+*/
+int Node_queryContents(const char *pcPattern,
+                       boolean (*pfVisit)(Node_T oNNode, void *pvExtra),
+                       void *pvExtra);
+
+/*
+  Stores in *pulTrigrams the number of distinct trigrams in the
+  content index, in *pulPostings the number of entries in their
+  posting lists, and in *pulBytes the bytes of memory it and what it
+  keeps for the files it tracks occupy.
+*/
+void Node_getContentIndexStats(size_t *pulTrigrams,
+                               size_t *pulPostings, size_t *pulBytes);
+
+/*
+  Turns the size index on (if bEnable) or off. While it is on, every
+  file is kept in order of the length of its contents, so that the
+  files of a range of lengths can be listed without walking the tree.
+  Turning it on indexes every file beneath oNRoot (which may be
+  NULL). Like a secondary index, it keeps its links in a side table,
+  and turns itself off if there is no memory to index a file. Returns
+  SUCCESS, or MEMORY_ERROR if it could not be turned on, in which case
+  it stays off.
+*/
+int Node_setSizeIndex(boolean bEnable, Node_T oNRoot);
+
+/* Returns TRUE if the size index is on. */
+boolean Node_hasSizeIndex(void);
+
+/*
+  Returns the first file in the size index, which must be on, whose
+  contents are at least ulSize bytes long, or NULL if there is none.
+  Takes time proportional to the logarithm of the number of files.
+*/
+Node_T Node_findSizeAtLeast(size_t ulSize);
+
+/*
+  Returns the file after oNNode, which must be in the size index, in
+  order of length, or NULL if there is none.
+*/
+Node_T Node_getNextBySize(Node_T oNNode);
+
+/*
+  Stores in *pulSizes and *pulFiles the numbers of distinct lengths
+  and of files in the size index, and in *pulBytes the bytes the
+  links of those files occupy.
+*/
+void Node_getSizeIndexStats(size_t *pulSizes, size_t *pulFiles,
+                            size_t *pulBytes);
+
+/*
+  Returns a string representation for oNNode, or NULL if
+  there is an allocation error.
+
+  Allocates memory for the returned string, which is then owned by
+  the caller!
+*/
+char *Node_toString(Node_T oNNode);
+
+#endif
@@ -0,0 +1,259 @@
+/*--------------------------------------------------------------------*/
+/* ptrtable.c                                                         */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ptrtable.h"
+
+/* The types whose alignment a record's may need */
+union align
+{
+   long l;
+   double d;
+   void *pv;
+   size_t ul;
+};
+
+/*
+  A PtrTable is an open-addressed hash table, probed linearly, whose
+  slot count is a power of two. It doubles its slots whenever they are
+  three quarters full, and halves them whenever they are less than an
+  eighth full; a removal shifts back the keys after it that probed
+  past it, so that no probe need look past an empty slot.
+*/
+struct PtrTable
+{
+   /* the bytes each record takes, rounded up so each is aligned */
+   size_t ulStride;
+   /* the key in each slot, or NULL if the slot is empty */
+   const void **ppvKeys;
+   /* the record of each slot, ulStride bytes apiece */
+   unsigned char *pucRecords;
+   /* the number of slots, and of them in use */
+   size_t ulCapacity;
+   size_t ulLength;
+};
+
+/* The number of slots a table starts with, and never goes below */
+enum { MIN_CAPACITY = 16 };
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns the slot at which a probe for pvKey starts in a table of
+  ulCapacity slots.
+*/
+static size_t PtrTable_hash(const void *pvKey, size_t ulCapacity)
+{
+   unsigned long ulBits = (unsigned long) pvKey;
+
+   /* the low bits of an allocated address are mostly zero */
+   ulBits ^= ulBits >> 16;
+   ulBits *= 2654435761UL;
+   ulBits ^= ulBits >> 15;
+   return (size_t) ulBits & (ulCapacity - 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Moves the records of oTTable into ulNewCapacity slots. Returns 1, or
+  0 if there is not enough memory, in which case it leaves oTTable as
+  it is.
+*/
+static int PtrTable_resize(PtrTable_T oTTable, size_t ulNewCapacity)
+{
+   const void **ppvNewKeys;
+   unsigned char *pucNewRecords;
+   size_t ulOld;
+   size_t ulNew;
+
+   assert(oTTable != NULL);
+   assert(ulNewCapacity > oTTable->ulLength);
+
+   ppvNewKeys = calloc(ulNewCapacity, sizeof(const void *));
+   if(ppvNewKeys == NULL)
+      return 0;
+   pucNewRecords = malloc(ulNewCapacity * oTTable->ulStride);
+   if(pucNewRecords == NULL) {
+      free(ppvNewKeys);
+      return 0;
+   }
+
+   for(ulOld = 0; ulOld < oTTable->ulCapacity; ulOld++) {
+      if(oTTable->ppvKeys[ulOld] == NULL)
+         continue;
+      ulNew = PtrTable_hash(oTTable->ppvKeys[ulOld], ulNewCapacity);
+      while(ppvNewKeys[ulNew] != NULL)
+         ulNew = (ulNew + 1) & (ulNewCapacity - 1);
+      ppvNewKeys[ulNew] = oTTable->ppvKeys[ulOld];
+      memcpy(pucNewRecords + ulNew * oTTable->ulStride,
+             oTTable->pucRecords + ulOld * oTTable->ulStride,
+             oTTable->ulStride);
+   }
+   free(oTTable->ppvKeys);
+   free(oTTable->pucRecords);
+   oTTable->ppvKeys = ppvNewKeys;
+   oTTable->pucRecords = pucNewRecords;
+   oTTable->ulCapacity = ulNewCapacity;
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns the slot holding pvKey in oTTable, or, if there is none, the
+  empty slot at which the probe for it ended.
+*/
+static size_t PtrTable_find(PtrTable_T oTTable, const void *pvKey)
+{
+   size_t ulSlot;
+
+   assert(oTTable != NULL);
+   assert(pvKey != NULL);
+
+   ulSlot = PtrTable_hash(pvKey, oTTable->ulCapacity);
+   while(oTTable->ppvKeys[ulSlot] != NULL &&
+         oTTable->ppvKeys[ulSlot] != pvKey)
+      ulSlot = (ulSlot + 1) & (oTTable->ulCapacity - 1);
+   return ulSlot;
+}
+
+/*--------------------------------------------------------------------*/
+
+PtrTable_T PtrTable_new(size_t ulRecordSize)
+{
+   PtrTable_T oTTable;
+   size_t ulAlign = sizeof(union align);
+
+   assert(ulRecordSize > 0);
+
+   oTTable = malloc(sizeof(struct PtrTable));
+   if(oTTable == NULL)
+      return NULL;
+   oTTable->ulStride = (ulRecordSize + ulAlign - 1) / ulAlign * ulAlign;
+   oTTable->ppvKeys = calloc(MIN_CAPACITY, sizeof(const void *));
+   oTTable->pucRecords = malloc(MIN_CAPACITY * oTTable->ulStride);
+   if(oTTable->ppvKeys == NULL || oTTable->pucRecords == NULL) {
+      free(oTTable->ppvKeys);
+      free(oTTable->pucRecords);
+      free(oTTable);
+      return NULL;
+   }
+   oTTable->ulCapacity = MIN_CAPACITY;
+   oTTable->ulLength = 0;
+   return oTTable;
+}
+
+/*--------------------------------------------------------------------*/
+
+void PtrTable_free(PtrTable_T oTTable)
+{
+   if(oTTable == NULL)
+      return;
+   free(oTTable->ppvKeys);
+   free(oTTable->pucRecords);
+   free(oTTable);
+}
+
+/*--------------------------------------------------------------------*/
+
+void *PtrTable_get(PtrTable_T oTTable, const void *pvKey)
+{
+   size_t ulSlot;
+
+   assert(oTTable != NULL);
+   assert(pvKey != NULL);
+
+   ulSlot = PtrTable_find(oTTable, pvKey);
+   if(oTTable->ppvKeys[ulSlot] == NULL)
+      return NULL;
+   return oTTable->pucRecords + ulSlot * oTTable->ulStride;
+}
+
+/*--------------------------------------------------------------------*/
+
+void *PtrTable_put(PtrTable_T oTTable, const void *pvKey)
+{
+   void *pvRecord;
+   size_t ulSlot;
+
+   assert(oTTable != NULL);
+   assert(pvKey != NULL);
+   assert(PtrTable_get(oTTable, pvKey) == NULL);
+
+   /* without the memory to grow, fill on while a slot stays empty to
+      end every probe */
+   if(4 * (oTTable->ulLength + 1) > 3 * oTTable->ulCapacity &&
+      !PtrTable_resize(oTTable, 2 * oTTable->ulCapacity) &&
+      oTTable->ulLength + 1 >= oTTable->ulCapacity)
+      return NULL;
+
+   ulSlot = PtrTable_find(oTTable, pvKey);
+   oTTable->ppvKeys[ulSlot] = pvKey;
+   oTTable->ulLength++;
+   pvRecord = oTTable->pucRecords + ulSlot * oTTable->ulStride;
+   memset(pvRecord, 0, oTTable->ulStride);
+   return pvRecord;
+}
+
+/*--------------------------------------------------------------------*/
+
+void PtrTable_remove(PtrTable_T oTTable, const void *pvKey)
+{
+   size_t ulMask;
+   size_t ulHole;
+   size_t ulNext;
+   size_t ulHome;
+
+   assert(oTTable != NULL);
+   assert(pvKey != NULL);
+
+   ulHole = PtrTable_find(oTTable, pvKey);
+   if(oTTable->ppvKeys[ulHole] == NULL)
+      return;
+   ulMask = oTTable->ulCapacity - 1;
+
+   /* a key after the hole stays put only if its probe starts after
+      the hole and no later than where it is */
+   for(ulNext = (ulHole + 1) & ulMask; oTTable->ppvKeys[ulNext] != NULL;
+       ulNext = (ulNext + 1) & ulMask) {
+      ulHome = PtrTable_hash(oTTable->ppvKeys[ulNext],
+                             oTTable->ulCapacity);
+      if(((ulHome - ulHole - 1) & ulMask) < ((ulNext - ulHole) & ulMask))
+         continue;
+      oTTable->ppvKeys[ulHole] = oTTable->ppvKeys[ulNext];
+      memcpy(oTTable->pucRecords + ulHole * oTTable->ulStride,
+             oTTable->pucRecords + ulNext * oTTable->ulStride,
+             oTTable->ulStride);
+      ulHole = ulNext;
+   }
+   oTTable->ppvKeys[ulHole] = NULL;
+   oTTable->ulLength--;
+
+   /* shrinking is only to give memory back, so may fail */
+   if(oTTable->ulCapacity > MIN_CAPACITY &&
+      8 * oTTable->ulLength < oTTable->ulCapacity)
+      (void) PtrTable_resize(oTTable, oTTable->ulCapacity / 2);
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t PtrTable_getLength(PtrTable_T oTTable)
+{
+   assert(oTTable != NULL);
+
+   return oTTable->ulLength;
+}
+
+/*--------------------------------------------------------------------*/
+
+size_t PtrTable_getBytes(PtrTable_T oTTable)
+{
+   assert(oTTable != NULL);
+
+   return sizeof(struct PtrTable) +
+      oTTable->ulCapacity * (sizeof(const void *) + oTTable->ulStride);
+}
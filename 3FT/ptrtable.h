@@ -0,0 +1,50 @@
+/*--------------------------------------------------------------------*/
+/* ptrtable.h                                                         */
+/*--------------------------------------------------------------------*/
+
+#ifndef PTRTABLE_INCLUDED
+#define PTRTABLE_INCLUDED
+
+#include <stddef.h>
+
+/*
+  A PtrTable maps pointers to records of a fixed size, so that a
+  module can keep state for some of the objects it handles without a
+  field in every one of them. The records live in the table itself:
+  putting or removing a key may move any of them, so the address of a
+  record is good only until the next PtrTable_put or PtrTable_remove.
+*/
+typedef struct PtrTable *PtrTable_T;
+
+/*
+  Returns a new, empty PtrTable whose records are ulRecordSize bytes
+  long, or NULL if there is not enough memory.
+*/
+PtrTable_T PtrTable_new(size_t ulRecordSize);
+
+/* Frees oTTable and all of its records. */
+void PtrTable_free(PtrTable_T oTTable);
+
+/*
+  Returns the record oTTable holds for pvKey, or NULL if it holds none.
+  Never allocates or moves a record.
+*/
+void *PtrTable_get(PtrTable_T oTTable, const void *pvKey);
+
+/*
+  Adds to oTTable a record, all of its bytes zero, for pvKey, which
+  must be non-NULL and not yet in oTTable. Returns the record, or NULL
+  if there is not enough memory, in which case nothing is added.
+*/
+void *PtrTable_put(PtrTable_T oTTable, const void *pvKey);
+
+/* Removes the record oTTable holds for pvKey, if it holds one. */
+void PtrTable_remove(PtrTable_T oTTable, const void *pvKey);
+
+/* Returns the number of records in oTTable. */
+size_t PtrTable_getLength(PtrTable_T oTTable);
+
+/* Returns the bytes of memory oTTable occupies. */
+size_t PtrTable_getBytes(PtrTable_T oTTable);
+
+#endif
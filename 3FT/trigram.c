@@ -0,0 +1,551 @@
+/*--------------------------------------------------------------------*/
+/* trigram.c                                                          */
+/*--------------------------------------------------------------------*/
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "trigram.h"
+
+/* The slots of the strings holding one trigram */
+struct posting
+{
+   /* the trigram, its three bytes from most significant down */
+   unsigned long ulTrigram;
+   /* the slots in ascending order, how many there are, and how many
+      there is room for */
+   size_t *pulSlots;
+   size_t ulCount;
+   size_t ulCapacity;
+   /* the next posting in this one's bucket */
+   struct posting *psNext;
+};
+
+/* An indexed string */
+struct slot
+{
+   /* whether the slot is in use, and if so on whose behalf */
+   boolean bUsed;
+   void *pvOwner;
+   /* the distinct trigrams of the string, and how many there are */
+   unsigned long *pulTrigrams;
+   size_t ulTrigrams;
+   /* if the slot is free, the next free slot, or NO_SLOT */
+   size_t ulNextFree;
+};
+
+/* A slot number that names no slot */
+#define NO_SLOT ((size_t) -1)
+
+/* The number of distinct trigrams */
+#define TRIGRAM_COUNT 0x1000000UL
+
+/* The number of buckets and slots the index starts with */
+enum { MIN_BUCKET_COUNT = 256, MIN_SLOT_COUNT = 16 };
+
+/*
+  The postings are a hash table chained within buckets that doubles
+  its bucket count whenever it holds as many postings as buckets.
+*/
+
+/* the buckets, or NULL before anything is indexed */
+static struct posting **ppsBuckets;
+/* the number of buckets, postings, and entries in posting lists */
+static size_t ulBucketCount;
+static size_t ulPostingCount;
+static size_t ulEntryCount;
+/* the bytes the posting lists have room for */
+static size_t ulListBytes;
+
+/* the slots, how many have ever been used, and how many there is
+   room for */
+static struct slot *psSlots;
+static size_t ulSlotCount;
+static size_t ulSlotCapacity;
+/* the first free slot, or NO_SLOT */
+static size_t ulFreeSlot = NO_SLOT;
+/* the number of slots in use, and the bytes of their trigrams */
+static size_t ulStringCount;
+static size_t ulTrigramBytes;
+/* one bit for each trigram, all clear between calls of Trigram_add,
+   which uses it to find a string's distinct trigrams without sorting
+   them; or NULL before anything is indexed */
+static unsigned char *pucSeen;
+
+/*--------------------------------------------------------------------*/
+
+/*
+  Returns the bucket index of ulTrigram.
+*/
+static size_t Trigram_bucket(unsigned long ulTrigram)
+{
+   return (size_t) (((ulTrigram * 2654435761UL) & 0xFFFFFFFFUL)
+                    % ulBucketCount);
+}
+
+/*
+  Compares the trigrams at pvFirst and pvSecond, for qsort.
+*/
+static int Trigram_compare(const void *pvFirst, const void *pvSecond)
+{
+   unsigned long ulFirst = *(const unsigned long *) pvFirst;
+   unsigned long ulSecond = *(const unsigned long *) pvSecond;
+
+   return (ulFirst > ulSecond) - (ulFirst < ulSecond);
+}
+
+/*
+  Sorts the ulCount trigrams at pulTrigrams and drops duplicates.
+  Returns how many remain.
+*/
+static size_t Trigram_unique(unsigned long *pulTrigrams, size_t ulCount)
+{
+   size_t ulIn;
+   size_t ulOut = 0;
+
+   if(ulCount == 0)
+      return 0;
+   qsort(pulTrigrams, ulCount, sizeof(unsigned long), Trigram_compare);
+   for(ulIn = 1; ulIn < ulCount; ulIn++)
+      if(pulTrigrams[ulIn] != pulTrigrams[ulOut])
+         pulTrigrams[++ulOut] = pulTrigrams[ulIn];
+   return ulOut + 1;
+}
+
+/*
+  Returns the posting of ulTrigram, or NULL if it has none.
+*/
+static struct posting *Trigram_find(unsigned long ulTrigram)
+{
+   struct posting *psCurr;
+
+   if(ulBucketCount == 0)
+      return NULL;
+   for(psCurr = ppsBuckets[Trigram_bucket(ulTrigram)]; psCurr != NULL;
+       psCurr = psCurr->psNext)
+      if(psCurr->ulTrigram == ulTrigram)
+         return psCurr;
+   return NULL;
+}
+
+/*
+  Grows the hash table to twice as many buckets, or to
+  MIN_BUCKET_COUNT if it has none. Returns SUCCESS, or MEMORY_ERROR,
+  in which case it is left as it was.
+*/
+static int Trigram_grow(void)
+{
+   struct posting **ppsNew;
+   struct posting *psCurr;
+   struct posting *psNext;
+   size_t ulOldCount = ulBucketCount;
+   size_t u;
+
+   ulBucketCount = (ulOldCount == 0) ? MIN_BUCKET_COUNT
+      : 2 * ulOldCount;
+   ppsNew = calloc(ulBucketCount, sizeof(struct posting *));
+   if(ppsNew == NULL) {
+      ulBucketCount = ulOldCount;
+      return MEMORY_ERROR;
+   }
+
+   for(u = 0; u < ulOldCount; u++) {
+      for(psCurr = ppsBuckets[u]; psCurr != NULL; psCurr = psNext) {
+         psNext = psCurr->psNext;
+         psCurr->psNext = ppsNew[Trigram_bucket(psCurr->ulTrigram)];
+         ppsNew[Trigram_bucket(psCurr->ulTrigram)] = psCurr;
+      }
+   }
+   free(ppsBuckets);
+   ppsBuckets = ppsNew;
+   return SUCCESS;
+}
+
+/*
+  Returns the position of ulSlot in psPosting's list, if it is there,
+  or the position it would be inserted at, if not. Stores in *pbFound
+  whether it is there.
+*/
+static size_t Trigram_search(const struct posting *psPosting,
+                             size_t ulSlot, boolean *pbFound)
+{
+   size_t ulLo = 0;
+   size_t ulHi = psPosting->ulCount;
+   size_t ulMid;
+
+   while(ulLo < ulHi) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      if(psPosting->pulSlots[ulMid] < ulSlot)
+         ulLo = ulMid + 1;
+      else
+         ulHi = ulMid;
+   }
+   *pbFound = (boolean) (ulLo < psPosting->ulCount &&
+                         psPosting->pulSlots[ulLo] == ulSlot);
+   return ulLo;
+}
+
+/*
+  Adds ulSlot to the posting of ulTrigram, creating it if need be.
+  Returns SUCCESS, or MEMORY_ERROR, in which case nothing changes.
+*/
+static int Trigram_post(unsigned long ulTrigram, size_t ulSlot)
+{
+   struct posting *psPosting;
+   size_t *pulNew;
+   size_t ulNewCapacity;
+   size_t ulIndex;
+   boolean bFound;
+
+   psPosting = Trigram_find(ulTrigram);
+   if(psPosting == NULL) {
+      if(ulBucketCount == 0 && Trigram_grow() != SUCCESS)
+         return MEMORY_ERROR;
+      psPosting = malloc(sizeof(struct posting));
+      if(psPosting == NULL)
+         return MEMORY_ERROR;
+      psPosting->ulTrigram = ulTrigram;
+      psPosting->pulSlots = NULL;
+      psPosting->ulCount = 0;
+      psPosting->ulCapacity = 0;
+      psPosting->psNext = ppsBuckets[Trigram_bucket(ulTrigram)];
+      ppsBuckets[Trigram_bucket(ulTrigram)] = psPosting;
+      ulPostingCount++;
+   }
+
+   if(psPosting->ulCount == psPosting->ulCapacity) {
+      ulNewCapacity = (psPosting->ulCapacity == 0) ? 1
+         : 2 * psPosting->ulCapacity;
+      pulNew = realloc(psPosting->pulSlots,
+                       ulNewCapacity * sizeof(size_t));
+      if(pulNew == NULL) {
+         /* a posting just made is dropped again */
+         if(psPosting->ulCount == 0) {
+            ppsBuckets[Trigram_bucket(ulTrigram)] = psPosting->psNext;
+            free(psPosting);
+            ulPostingCount--;
+         }
+         return MEMORY_ERROR;
+      }
+      ulListBytes += (ulNewCapacity - psPosting->ulCapacity) *
+         sizeof(size_t);
+      psPosting->pulSlots = pulNew;
+      psPosting->ulCapacity = ulNewCapacity;
+   }
+
+   /* reused slots are lower than those after them, so insert in
+      order rather than append */
+   ulIndex = Trigram_search(psPosting, ulSlot, &bFound);
+   assert(!bFound);
+   memmove(&psPosting->pulSlots[ulIndex + 1],
+           &psPosting->pulSlots[ulIndex],
+           (psPosting->ulCount - ulIndex) * sizeof(size_t));
+   psPosting->pulSlots[ulIndex] = ulSlot;
+   psPosting->ulCount++;
+   ulEntryCount++;
+
+   if(ulPostingCount >= ulBucketCount)
+      (void) Trigram_grow();
+   return SUCCESS;
+}
+
+/*
+  Removes ulSlot from the posting of ulTrigram, freeing the posting if
+  it is left empty.
+*/
+static void Trigram_unpost(unsigned long ulTrigram, size_t ulSlot)
+{
+   struct posting **ppsLink;
+   struct posting *psPosting;
+   size_t ulIndex;
+   boolean bFound;
+
+   ppsLink = &ppsBuckets[Trigram_bucket(ulTrigram)];
+   while((*ppsLink)->ulTrigram != ulTrigram)
+      ppsLink = &(*ppsLink)->psNext;
+   psPosting = *ppsLink;
+
+   ulIndex = Trigram_search(psPosting, ulSlot, &bFound);
+   assert(bFound);
+   memmove(&psPosting->pulSlots[ulIndex],
+           &psPosting->pulSlots[ulIndex + 1],
+           (psPosting->ulCount - ulIndex - 1) * sizeof(size_t));
+   psPosting->ulCount--;
+   ulEntryCount--;
+
+   if(psPosting->ulCount == 0) {
+      *ppsLink = psPosting->psNext;
+      ulListBytes -= psPosting->ulCapacity * sizeof(size_t);
+      free(psPosting->pulSlots);
+      free(psPosting);
+      ulPostingCount--;
+   }
+}
+
+/*
+  Returns slot ulSlot, with its trigrams, to the free list.
+*/
+static void Trigram_freeSlot(size_t ulSlot)
+{
+   struct slot *psSlot = &psSlots[ulSlot];
+
+   ulTrigramBytes -= psSlot->ulTrigrams * sizeof(unsigned long);
+   free(psSlot->pulTrigrams);
+   psSlot->pulTrigrams = NULL;
+   psSlot->ulTrigrams = 0;
+   psSlot->bUsed = FALSE;
+   psSlot->ulNextFree = ulFreeSlot;
+   ulFreeSlot = ulSlot;
+   ulStringCount--;
+}
+
+/*--------------------------------------------------------------------*/
+
+int Trigram_add(void *pvOwner, const void *pvData, size_t ulLength,
+                size_t *pulSlot)
+{
+   const unsigned char *pucData = pvData;
+   unsigned long *pulTrigrams = NULL;
+   unsigned long ulTrigram;
+   struct slot *psNew;
+   size_t ulTrigrams = 0;
+   size_t ulNewCapacity;
+   size_t ulSlot;
+   size_t u;
+
+   assert(pvData != NULL || ulLength == 0);
+   assert(pulSlot != NULL);
+
+   /* count the distinct trigrams by setting their bits, then gather
+      them by clearing the bits again */
+   if(ulLength >= 3) {
+      if(pucSeen == NULL) {
+         pucSeen = calloc(TRIGRAM_COUNT / 8, 1);
+         if(pucSeen == NULL)
+            return MEMORY_ERROR;
+      }
+      for(u = 0; u + 2 < ulLength; u++) {
+         ulTrigram = ((unsigned long) pucData[u] << 16) |
+            ((unsigned long) pucData[u + 1] << 8) | pucData[u + 2];
+         if(!(pucSeen[ulTrigram >> 3] & (1 << (ulTrigram & 7)))) {
+            pucSeen[ulTrigram >> 3] |= (unsigned char)
+               (1 << (ulTrigram & 7));
+            ulTrigrams++;
+         }
+      }
+      pulTrigrams = malloc(ulTrigrams * sizeof(unsigned long));
+      ulTrigrams = 0;
+      for(u = 0; u + 2 < ulLength; u++) {
+         ulTrigram = ((unsigned long) pucData[u] << 16) |
+            ((unsigned long) pucData[u + 1] << 8) | pucData[u + 2];
+         if(pucSeen[ulTrigram >> 3] & (1 << (ulTrigram & 7))) {
+            pucSeen[ulTrigram >> 3] &= (unsigned char)
+               ~(1 << (ulTrigram & 7));
+            if(pulTrigrams != NULL)
+               pulTrigrams[ulTrigrams++] = ulTrigram;
+         }
+      }
+      if(pulTrigrams == NULL)
+         return MEMORY_ERROR;
+   }
+
+   if(ulFreeSlot == NO_SLOT && ulSlotCount == ulSlotCapacity) {
+      ulNewCapacity = (ulSlotCapacity == 0) ? MIN_SLOT_COUNT
+         : 2 * ulSlotCapacity;
+      psNew = realloc(psSlots, ulNewCapacity * sizeof(struct slot));
+      if(psNew == NULL) {
+         free(pulTrigrams);
+         return MEMORY_ERROR;
+      }
+      psSlots = psNew;
+      ulSlotCapacity = ulNewCapacity;
+   }
+   if(ulFreeSlot != NO_SLOT) {
+      ulSlot = ulFreeSlot;
+      ulFreeSlot = psSlots[ulSlot].ulNextFree;
+   }
+   else
+      ulSlot = ulSlotCount++;
+
+   psSlots[ulSlot].bUsed = TRUE;
+   psSlots[ulSlot].pvOwner = pvOwner;
+   psSlots[ulSlot].pulTrigrams = pulTrigrams;
+   psSlots[ulSlot].ulTrigrams = ulTrigrams;
+   ulTrigramBytes += ulTrigrams * sizeof(unsigned long);
+   ulStringCount++;
+
+   for(u = 0; u < ulTrigrams; u++) {
+      if(Trigram_post(pulTrigrams[u], ulSlot) != SUCCESS) {
+         while(u > 0)
+            Trigram_unpost(pulTrigrams[--u], ulSlot);
+         Trigram_freeSlot(ulSlot);
+         return MEMORY_ERROR;
+      }
+   }
+
+   *pulSlot = ulSlot;
+   return SUCCESS;
+}
+
+void Trigram_remove(size_t ulSlot)
+{
+   struct slot *psSlot;
+   size_t u;
+
+   assert(ulSlot < ulSlotCount);
+   psSlot = &psSlots[ulSlot];
+   assert(psSlot->bUsed);
+
+   for(u = 0; u < psSlot->ulTrigrams; u++)
+      Trigram_unpost(psSlot->pulTrigrams[u], ulSlot);
+   Trigram_freeSlot(ulSlot);
+}
+
+int Trigram_query(const char *pcPattern,
+                  boolean (*pfVisit)(void *pvOwner, void *pvExtra),
+                  void *pvExtra)
+{
+   struct posting **ppsPostings = NULL;
+   struct posting *psShortest;
+   unsigned long *pulTrigrams;
+   unsigned long ulWindow = 0;
+   size_t ulTrigrams = 0;
+   size_t ulRun = 0;
+   size_t ulSlot;
+   size_t u;
+   size_t v;
+   const char *pcCurr;
+   unsigned char ucByte = 0;
+   boolean bLiteral;
+   boolean bFound;
+
+   assert(pcPattern != NULL);
+   assert(pfVisit != NULL);
+
+   /* each byte of the pattern ends at most one trigram */
+   pulTrigrams = malloc((strlen(pcPattern) + 1) * sizeof(unsigned long));
+   if(pulTrigrams == NULL)
+      return MEMORY_ERROR;
+
+   for(pcCurr = pcPattern; *pcCurr != '\0'; ) {
+      bLiteral = TRUE;
+      if(*pcCurr == '\\' && pcCurr[1] != '\0') {
+         ucByte = (unsigned char) pcCurr[1];
+         pcCurr += 2;
+      }
+      else if(*pcCurr == '.') {
+         bLiteral = FALSE;
+         pcCurr++;
+      }
+      else
+         ucByte = (unsigned char) *pcCurr++;
+
+      /* an item that may repeat, or be absent, breaks the run */
+      if(*pcCurr == '*') {
+         bLiteral = FALSE;
+         while(*pcCurr == '*')
+            pcCurr++;
+      }
+
+      if(!bLiteral) {
+         ulRun = 0;
+         continue;
+      }
+      ulWindow = ((ulWindow << 8) | ucByte) & 0xFFFFFFUL;
+      if(++ulRun >= 3)
+         pulTrigrams[ulTrigrams++] = ulWindow;
+   }
+   ulTrigrams = Trigram_unique(pulTrigrams, ulTrigrams);
+
+   /* a pattern with no trigrams could match any string */
+   if(ulTrigrams == 0) {
+      free(pulTrigrams);
+      for(ulSlot = 0; ulSlot < ulSlotCount; ulSlot++)
+         if(psSlots[ulSlot].bUsed &&
+            !(*pfVisit)(psSlots[ulSlot].pvOwner, pvExtra))
+            break;
+      return SUCCESS;
+   }
+
+   ppsPostings = malloc(ulTrigrams * sizeof(struct posting *));
+   if(ppsPostings == NULL) {
+      free(pulTrigrams);
+      return MEMORY_ERROR;
+   }
+   psShortest = NULL;
+   for(u = 0; u < ulTrigrams; u++) {
+      ppsPostings[u] = Trigram_find(pulTrigrams[u]);
+      if(ppsPostings[u] == NULL) {
+         psShortest = NULL;
+         break;
+      }
+      if(psShortest == NULL || ppsPostings[u]->ulCount <
+         psShortest->ulCount)
+         psShortest = ppsPostings[u];
+   }
+   free(pulTrigrams);
+
+   /* walk the shortest list, seeking each slot in the others */
+   for(v = 0; psShortest != NULL && v < psShortest->ulCount; v++) {
+      ulSlot = psShortest->pulSlots[v];
+      bFound = TRUE;
+      for(u = 0; bFound && u < ulTrigrams; u++)
+         if(ppsPostings[u] != psShortest)
+            (void) Trigram_search(ppsPostings[u], ulSlot, &bFound);
+      if(bFound && !(*pfVisit)(psSlots[ulSlot].pvOwner, pvExtra))
+         break;
+   }
+
+   free(ppsPostings);
+   return SUCCESS;
+}
+
+void Trigram_reset(void)
+{
+   struct posting *psCurr;
+   struct posting *psNext;
+   size_t u;
+
+   for(u = 0; u < ulBucketCount; u++) {
+      for(psCurr = ppsBuckets[u]; psCurr != NULL; psCurr = psNext) {
+         psNext = psCurr->psNext;
+         free(psCurr->pulSlots);
+         free(psCurr);
+      }
+   }
+   free(ppsBuckets);
+   ppsBuckets = NULL;
+   ulBucketCount = 0;
+   ulPostingCount = 0;
+   ulEntryCount = 0;
+   ulListBytes = 0;
+
+   for(u = 0; u < ulSlotCount; u++)
+      free(psSlots[u].pulTrigrams);
+   free(psSlots);
+   free(pucSeen);
+   psSlots = NULL;
+   pucSeen = NULL;
+   ulSlotCount = 0;
+   ulSlotCapacity = 0;
+   ulFreeSlot = NO_SLOT;
+   ulStringCount = 0;
+   ulTrigramBytes = 0;
+}
+
+void Trigram_getStats(size_t *pulTrigrams, size_t *pulPostings,
+                      size_t *pulStrings, size_t *pulBytes)
+{
+   assert(pulTrigrams != NULL);
+   assert(pulPostings != NULL);
+   assert(pulStrings != NULL);
+   assert(pulBytes != NULL);
+
+   *pulTrigrams = ulPostingCount;
+   *pulPostings = ulEntryCount;
+   *pulStrings = ulStringCount;
+   *pulBytes = ulBucketCount * sizeof(struct posting *) +
+      ulPostingCount * sizeof(struct posting) + ulListBytes +
+      ulSlotCapacity * sizeof(struct slot) + ulTrigramBytes +
+      ((pucSeen == NULL) ? 0 : TRIGRAM_COUNT / 8);
+}
@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------*/
+/* trigram.h                                                          */
+/*--------------------------------------------------------------------*/
+
+#ifndef TRIGRAM_INCLUDED
+#define TRIGRAM_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  The trigram index maps each sequence of three bytes to the indexed
+  byte strings that hold it, so that the strings that might match a
+  pattern can be found without reading any of them. Each indexed
+  string occupies a slot, which records an opaque owner and the
+  distinct trigrams of the string; each trigram has a posting list of
+  the slots that hold it, kept in ascending order so that lists can be
+  intersected by binary search.
+*/
+
+/*
+  Indexes the ulLength bytes at pvData (which may be NULL only if
+  ulLength is 0) on behalf of pvOwner, and stores in *pulSlot the slot
+  that records them. Returns SUCCESS, or MEMORY_ERROR, in which case
+  nothing is indexed.
+*/
+int Trigram_add(void *pvOwner, const void *pvData, size_t ulLength,
+                size_t *pulSlot);
+
+/*
+  Removes the string in slot ulSlot from the index, freeing the slot.
+  Never allocates.
+*/
+void Trigram_remove(size_t ulSlot);
+
+/*
+  Calls (*pfVisit)(pvOwner, pvExtra) for the owner of each indexed
+  string that holds every trigram of each run of literal bytes that a
+  match of pcPattern must contain, until it returns FALSE. pcPattern
+  is a simple regular expression: '.' matches any byte, '*' lets the
+  item before it repeat any number of times, none included, '\' makes
+  the byte after it literal, and every other byte is literal. Every
+  string with a match is visited; others may be too, and must be
+  checked. Returns SUCCESS, or MEMORY_ERROR if the pattern's runs
+  could not be gathered.
+*/
+int Trigram_query(const char *pcPattern,
+                  boolean (*pfVisit)(void *pvOwner, void *pvExtra),
+                  void *pvExtra);
+
+/* Empties the index and frees all of its memory. */
+void Trigram_reset(void);
+
+/*
+  Stores in *pulTrigrams the number of distinct trigrams indexed, in
+  *pulPostings the number of entries in their posting lists, in
+  *pulStrings the number of strings indexed, and in *pulBytes the bytes
+  of memory the index occupies.
+*/
+void Trigram_getStats(size_t *pulTrigrams, size_t *pulPostings,
+                      size_t *pulStrings, size_t *pulBytes);
+
+#endif